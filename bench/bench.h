@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "tl_tensor.h"
+
+#define BENCH_MAX_TENSORS 8
+
+/* problem size classes; the element counts are in bench_tensorlight.c */
+enum bench_size {
+    BENCH_SIZE_INVALID = -1,
+    BENCH_SMALL = 0, /* a few KB, dominated by call overhead */
+    BENCH_CACHE,     /* fits in L2 */
+    BENCH_DRAM,      /* streams from main memory */
+    BENCH_SIZE_SIZE
+};
+typedef enum bench_size bench_size;
+
+/* clang-format off */
+struct bench_ctx {
+    tl_dtype   dtype;
+    int        len;                    /* target element count of the size class */
+    tl_tensor *t[BENCH_MAX_TENSORS];   /* operands, freed by the harness */
+    double     bytes;                  /* bytes read + written by one run */
+    double     elems;                  /* elements produced (MACs for matmul/conv) */
+    char       shape[64];              /* human readable operand shape */
+};
+typedef struct bench_ctx bench_ctx;
+
+struct bench_op {
+    const char     *name;
+    const tl_dtype *dtypes;            /* TL_DTYPE_INVALID terminated, NULL for all */
+    int             max_len;           /* cap on ctx->len, 0 for no cap */
+    void          (*setup)(bench_ctx *ctx);
+    void          (*run)(bench_ctx *ctx);
+};
+typedef struct bench_op bench_op;
+/* clang-format on */
+
+extern const bench_op bench_ops[];
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,733 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+/*
+ * One entry per public op in tl_tensor.h. Pure metadata ops (index, coords,
+ * create, free, reshape, create_slice, slice_nocopy, ...) do no per-element
+ * work and are left out. Every setup creates the operands in ctx->t[] and,
+ * where the destination shape is not obvious, allocates dst by calling the op
+ * once with dst == NULL, so the timed run never allocates unless allocation is
+ * what the op does (zeros, clone, repeat).
+ */
+
+static const tl_dtype dtypes_float[] = { TL_FLOAT, TL_DTYPE_INVALID };
+static const tl_dtype dtypes_real[] = { TL_FLOAT, TL_DOUBLE, TL_DTYPE_INVALID };
+static const tl_dtype dtypes_matmul[] = { TL_FLOAT, TL_DOUBLE, TL_INT32, TL_DTYPE_INVALID };
+static const tl_dtype dtypes_image[] = { TL_UINT8, TL_FLOAT, TL_DTYPE_INVALID };
+static const tl_dtype dtypes_arange[] = { TL_DOUBLE, TL_FLOAT, TL_INT64, TL_INT32,
+                                          TL_UINT64, TL_UINT32, TL_DTYPE_INVALID };
+
+/* channels used by the NCHW ops */
+#define BENCH_CHANNELS 16
+/* row length of the 2D element-wise shapes */
+#define BENCH_COLS 256
+
+static unsigned int seed = 1;
+
+static void fill_random(tl_tensor *t)
+{
+    double v;
+    size_t dsize = tl_size_of(t->dtype);
+
+    for (int i = 0; i < t->len; i++) {
+        seed = seed * 1103515245 + 12345;
+        v = ((seed >> 16) % 2048) / 32.0 - 32.0;
+        if (tl_dtype_min_double(t->dtype) >= 0)
+            v += 32.0;
+        tl_convert(tl_padd(t->data, i, dsize), t->dtype, &v, TL_DOUBLE);
+    }
+}
+
+static void set_shape(bench_ctx *ctx, int ndim, const int *dims)
+{
+    int n = 0;
+
+    for (int i = 0; i < ndim; i++)
+        n += snprintf(ctx->shape + n, sizeof(ctx->shape) - n, i ? "x%d" : "%d", dims[i]);
+}
+
+static tl_tensor *make(bench_ctx *ctx, int i, int ndim, const int *dims, tl_dtype dtype)
+{
+    ctx->t[i] = tl_tensor_zeros(ndim, dims, dtype);
+    fill_random(ctx->t[i]);
+    return ctx->t[i];
+}
+
+static int isqrt(int n)
+{
+    int s = (int)sqrt((double)n);
+    return s > 0 ? s : 1;
+}
+
+/* [len / BENCH_COLS, BENCH_COLS] */
+static void rows_cols(bench_ctx *ctx, int *dims)
+{
+    dims[1] = ctx->len < BENCH_COLS ? ctx->len : BENCH_COLS;
+    dims[0] = ctx->len / dims[1];
+    set_shape(ctx, 2, dims);
+}
+
+/* [1, BENCH_CHANNELS, H, W] with H == W */
+static void nchw(bench_ctx *ctx, int *dims)
+{
+    dims[0] = 1;
+    dims[1] = BENCH_CHANNELS;
+    dims[2] = dims[3] = isqrt(ctx->len / BENCH_CHANNELS);
+    set_shape(ctx, 4, dims);
+}
+
+/* [H, W, 3] with H == W, the layout of a decoded image */
+static void hwc(bench_ctx *ctx, int *dims)
+{
+    dims[0] = dims[1] = isqrt(ctx->len / 3);
+    dims[2] = 3;
+    set_shape(ctx, 3, dims);
+}
+
+static double dsize(bench_ctx *ctx)
+{
+    return (double)tl_size_of(ctx->dtype);
+}
+
+static void setup_1d(bench_ctx *ctx)
+{
+    ctx->t[0] = tl_tensor_zeros(1, &ctx->len, ctx->dtype);
+    set_shape(ctx, 1, &ctx->len);
+    ctx->elems = ctx->len;
+}
+
+static void setup_2d(bench_ctx *ctx)
+{
+    int dims[2];
+
+    rows_cols(ctx, dims);
+    make(ctx, 0, 2, dims, ctx->dtype);
+    ctx->elems = ctx->t[0]->len;
+}
+
+/* zeros: allocate and clear */
+
+static void setup_zeros(bench_ctx *ctx)
+{
+    set_shape(ctx, 1, &ctx->len);
+    ctx->elems = ctx->len;
+    ctx->bytes = ctx->len * dsize(ctx);
+}
+
+static void run_zeros(bench_ctx *ctx)
+{
+    tl_tensor_free_data_too(tl_tensor_zeros(1, &ctx->len, ctx->dtype));
+}
+
+/* clone */
+
+static void setup_clone(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_clone(bench_ctx *ctx)
+{
+    tl_tensor_free_data_too(tl_tensor_clone(ctx->t[0]));
+}
+
+/* repeat: len / 2 elements repeated twice */
+
+static void setup_repeat(bench_ctx *ctx)
+{
+    int dims[2];
+
+    rows_cols(ctx, dims);
+    dims[0] = dims[0] > 1 ? dims[0] / 2 : 1;
+    make(ctx, 0, 2, dims, ctx->dtype);
+    ctx->elems = 2 * ctx->t[0]->len;
+    ctx->bytes = 3 * ctx->t[0]->len * dsize(ctx);
+}
+
+static void run_repeat(bench_ctx *ctx)
+{
+    tl_tensor_free_data_too(tl_tensor_repeat(ctx->t[0], 2));
+}
+
+/* rearange: arange into an existing tensor */
+
+static void setup_arange(bench_ctx *ctx)
+{
+    setup_1d(ctx);
+    ctx->bytes = ctx->len * dsize(ctx);
+}
+
+static void run_arange(bench_ctx *ctx)
+{
+    tl_tensor_rearange(ctx->t[0], 0, ctx->len, 1);
+}
+
+/* fill, fill_uniform, fill_normal: fills of an existing tensor */
+
+static void run_fill(bench_ctx *ctx)
+{
+    tl_tensor_fill(ctx->t[0], 3);
+}
+
+static void run_fill_uniform(bench_ctx *ctx)
+{
+    tl_tensor_fill_uniform(ctx->t[0], 0, 100, 1);
+}
+
+static void run_fill_normal(bench_ctx *ctx)
+{
+    tl_tensor_fill_normal(ctx->t[0], 0, 10, 1);
+}
+
+/* fprint/save: formatting throughput, written to /dev/null */
+
+static FILE *devnull;
+
+static void setup_fprint(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->bytes = ctx->elems * dsize(ctx);
+    if (!devnull && !(devnull = fopen("/dev/null", "w")))
+        devnull = stderr;
+}
+
+static void run_fprint(bench_ctx *ctx)
+{
+    tl_tensor_fprint(devnull, ctx->t[0], NULL);
+}
+
+static void run_save(bench_ctx *ctx)
+{
+    tl_tensor_save("/dev/null", ctx->t[0], NULL);
+}
+
+/* save_compressed: shuffling and compression, written to /dev/null */
+
+static void run_save_compressed(bench_ctx *ctx)
+{
+    tl_tensor_save_compressed("/dev/null", ctx->t[0], TL_SHUFFLE_BYTE);
+}
+
+/* slice: the middle half of every row */
+
+static void setup_slice(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_slice(ctx->t[0], NULL, 1, ctx->t[0]->dims[1] / 4,
+                                ctx->t[0]->dims[1] / 2);
+    ctx->elems = ctx->t[1]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_slice(bench_ctx *ctx)
+{
+    tl_tensor_slice(ctx->t[0], ctx->t[1], 1, ctx->t[0]->dims[1] / 4, ctx->t[0]->dims[1] / 2);
+}
+
+/* slice_nd: every other column */
+
+static const int slice_nd_step[] = { 1, 2 };
+
+static void setup_slice_nd(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_slice_nd(ctx->t[0], NULL, NULL, NULL, slice_nd_step);
+    ctx->elems = ctx->t[1]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_slice_nd(bench_ctx *ctx)
+{
+    tl_tensor_slice_nd(ctx->t[0], ctx->t[1], NULL, NULL, slice_nd_step);
+}
+
+/* pad/pad_border: 4 elements on every side */
+
+static const int pads[] = { 4, 4, 4, 4 };
+
+static void setup_pad(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_pad(ctx->t[0], NULL, pads, TL_PAD_CONSTANT, 0);
+    ctx->elems = ctx->t[1]->len;
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len) * dsize(ctx);
+}
+
+static void run_pad(bench_ctx *ctx)
+{
+    tl_tensor_pad(ctx->t[0], ctx->t[1], pads, TL_PAD_CONSTANT, 0);
+}
+
+static void setup_pad_border(bench_ctx *ctx)
+{
+    setup_pad(ctx);
+    ctx->elems = ctx->t[1]->len - ctx->t[0]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_pad_border(bench_ctx *ctx)
+{
+    tl_tensor_pad_border(ctx->t[1], pads, TL_PAD_REFLECT, 0);
+}
+
+/* concat/concat_n/split_n along the rows, the strided case */
+
+#define BENCH_PARTS 4
+
+static void setup_parts(bench_ctx *ctx, int parts)
+{
+    int dims[2];
+
+    rows_cols(ctx, dims);
+    dims[1] /= parts;
+    for (int i = 0; i < parts; i++)
+        make(ctx, i, 2, dims, ctx->dtype);
+    dims[1] *= parts;
+    make(ctx, parts, 2, dims, ctx->dtype);
+    ctx->elems = ctx->t[parts]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void setup_concat(bench_ctx *ctx)
+{
+    setup_parts(ctx, 2);
+}
+
+static void run_concat(bench_ctx *ctx)
+{
+    tl_tensor_concat(ctx->t[0], ctx->t[1], ctx->t[2], 1);
+}
+
+static void setup_concat_n(bench_ctx *ctx)
+{
+    setup_parts(ctx, BENCH_PARTS);
+}
+
+static void run_concat_n(bench_ctx *ctx)
+{
+    tl_tensor_concat_n((const tl_tensor **)ctx->t, BENCH_PARTS, ctx->t[BENCH_PARTS], 1);
+}
+
+static void run_split_n(bench_ctx *ctx)
+{
+    tl_tensor_split_n(ctx->t[BENCH_PARTS], ctx->t, BENCH_PARTS, NULL, 1);
+}
+
+/* maxreduce along the contiguous and the outer axis */
+
+static void setup_maxreduce(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_maxreduce(ctx->t[0], NULL, NULL, 1);
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len) * dsize(ctx);
+}
+
+static void run_maxreduce(bench_ctx *ctx)
+{
+    tl_tensor_maxreduce(ctx->t[0], ctx->t[1], NULL, 1);
+}
+
+static void setup_maxreduce_outer(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_maxreduce(ctx->t[0], NULL, NULL, 0);
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len) * dsize(ctx);
+}
+
+static void run_maxreduce_outer(bench_ctx *ctx)
+{
+    tl_tensor_maxreduce(ctx->t[0], ctx->t[1], NULL, 0);
+}
+
+/* elew/elew_param */
+
+static void setup_elew(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    make(ctx, 1, 2, ctx->t[0]->dims, ctx->dtype);
+    make(ctx, 2, 2, ctx->t[0]->dims, ctx->dtype);
+    ctx->bytes = 3 * ctx->elems * dsize(ctx);
+}
+
+static void run_elew(bench_ctx *ctx)
+{
+    tl_tensor_elew(ctx->t[0], ctx->t[1], ctx->t[2], TL_MUL);
+}
+
+static void setup_unary(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    make(ctx, 1, 2, ctx->t[0]->dims, ctx->dtype);
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_elew_param(bench_ctx *ctx)
+{
+    tl_tensor_elew_param(ctx->t[0], 3, ctx->t[1], TL_SUM);
+}
+
+static void run_lrelu(bench_ctx *ctx)
+{
+    tl_tensor_lrelu(ctx->t[0], ctx->t[1], 0.1f);
+}
+
+static void run_softmax(bench_ctx *ctx)
+{
+    tl_tensor_softmax(ctx->t[0], ctx->t[1], 1);
+}
+
+static void run_log_softmax(bench_ctx *ctx)
+{
+    tl_tensor_log_softmax(ctx->t[0], ctx->t[1], 1);
+}
+
+/* convert to float, or to int32 from float */
+
+static tl_dtype convert_to(tl_dtype dtype)
+{
+    return dtype == TL_FLOAT ? TL_INT32 : TL_FLOAT;
+}
+
+static void setup_convert(bench_ctx *ctx)
+{
+    setup_2d(ctx);
+    ctx->t[1] = tl_tensor_convert(ctx->t[0], NULL, convert_to(ctx->dtype));
+    ctx->bytes = ctx->elems * (dsize(ctx) + tl_size_of(ctx->t[1]->dtype));
+}
+
+static void run_convert(bench_ctx *ctx)
+{
+    tl_tensor_convert(ctx->t[0], ctx->t[1], convert_to(ctx->dtype));
+}
+
+/* dot_product/norm/cosine_similarity over a vector */
+
+static void setup_vec2(bench_ctx *ctx)
+{
+    setup_1d(ctx);
+    fill_random(ctx->t[0]);
+    make(ctx, 1, 1, &ctx->len, ctx->dtype);
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void setup_dot_product(bench_ctx *ctx)
+{
+    setup_vec2(ctx);
+    ctx->t[2] = tl_tensor_dot_product(ctx->t[0], ctx->t[1], NULL);
+}
+
+static void run_dot_product(bench_ctx *ctx)
+{
+    tl_tensor_dot_product(ctx->t[0], ctx->t[1], ctx->t[2]);
+}
+
+static void setup_norm(bench_ctx *ctx)
+{
+    setup_1d(ctx);
+    fill_random(ctx->t[0]);
+    ctx->t[1] = tl_tensor_norm(ctx->t[0], NULL, TL_NORM_L2);
+    ctx->bytes = ctx->elems * dsize(ctx);
+}
+
+static void run_norm(bench_ctx *ctx)
+{
+    tl_tensor_norm(ctx->t[0], ctx->t[1], TL_NORM_L2);
+}
+
+static void setup_cosine_similarity(bench_ctx *ctx)
+{
+    setup_vec2(ctx);
+    ctx->t[2] = tl_tensor_cosine_similarity(ctx->t[0], ctx->t[1], NULL);
+}
+
+static void run_cosine_similarity(bench_ctx *ctx)
+{
+    tl_tensor_cosine_similarity(ctx->t[0], ctx->t[1], ctx->t[2]);
+}
+
+/* conv2d: 3x3, BENCH_CHANNELS in and out, same padding */
+
+static const int ones[] = { 1, 1 };
+static const int twos[] = { 2, 2 };
+
+static void setup_conv2d(bench_ctx *ctx)
+{
+    int dims[4];
+    int wdims[] = { BENCH_CHANNELS, BENCH_CHANNELS, 3, 3 };
+
+    nchw(ctx, dims);
+    make(ctx, 0, 4, dims, TL_FLOAT);
+    make(ctx, 1, 4, wdims, TL_FLOAT);
+    make(ctx, 2, 1, wdims, TL_FLOAT);
+    ctx->t[3] = tl_tensor_conv2d(ctx->t[0], ctx->t[1], ctx->t[2], NULL, ones, ones, ones, 1,
+                                 TL_NCHW, 0, 0);
+    ctx->elems = (double)ctx->t[3]->len * BENCH_CHANNELS * 9;
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len + ctx->t[3]->len) * dsize(ctx);
+}
+
+static void run_conv2d(bench_ctx *ctx)
+{
+    tl_tensor_conv2d(ctx->t[0], ctx->t[1], ctx->t[2], ctx->t[3], ones, ones, ones, 1, TL_NCHW, 0,
+                     0);
+}
+
+/* pooling: 2x2 windows with stride 2, and the global variants */
+
+static void setup_pool(bench_ctx *ctx)
+{
+    int dims[4];
+
+    nchw(ctx, dims);
+    make(ctx, 0, 4, dims, TL_FLOAT);
+    ctx->t[1] = tl_tensor_maxpool2d(ctx->t[0], NULL, NULL, twos, twos, NULL, 0, TL_NCHW);
+    ctx->elems = ctx->t[0]->len;
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len) * dsize(ctx);
+}
+
+static void run_maxpool2d(bench_ctx *ctx)
+{
+    tl_tensor_maxpool2d(ctx->t[0], ctx->t[1], NULL, twos, twos, NULL, 0, TL_NCHW);
+}
+
+static void run_avgpool2d(bench_ctx *ctx)
+{
+    tl_tensor_avgpool2d(ctx->t[0], ctx->t[1], twos, twos, NULL, 0, 1, TL_NCHW);
+}
+
+static void setup_global_pool(bench_ctx *ctx)
+{
+    int dims[4];
+
+    nchw(ctx, dims);
+    make(ctx, 0, 4, dims, TL_FLOAT);
+    ctx->t[1] = tl_tensor_global_maxpool(ctx->t[0], NULL, TL_NCHW);
+    ctx->elems = ctx->t[0]->len;
+    ctx->bytes = ctx->t[0]->len * dsize(ctx);
+}
+
+static void run_global_maxpool(bench_ctx *ctx)
+{
+    tl_tensor_global_maxpool(ctx->t[0], ctx->t[1], TL_NCHW);
+}
+
+static void run_global_avgpool(bench_ctx *ctx)
+{
+    tl_tensor_global_avgpool(ctx->t[0], ctx->t[1], TL_NCHW);
+}
+
+/* matmul: square operands holding len / 2 elements each */
+
+static void setup_matmul(bench_ctx *ctx)
+{
+    int n = isqrt(ctx->len / 2);
+    int dims[] = { n, n };
+
+    set_shape(ctx, 2, dims);
+    make(ctx, 0, 2, dims, ctx->dtype);
+    make(ctx, 1, 2, dims, ctx->dtype);
+    ctx->t[2] = tl_tensor_matmul(ctx->t[0], ctx->t[1], NULL, 0, 0);
+    ctx->elems = (double)n * n * n;
+    ctx->bytes = 3.0 * n * n * dsize(ctx);
+}
+
+static void run_matmul(bench_ctx *ctx)
+{
+    tl_tensor_matmul(ctx->t[0], ctx->t[1], ctx->t[2], 0, 0);
+}
+
+/* transpose: a square matrix, and CHW to HWC */
+
+static const int axes_2d[] = { 1, 0 };
+static const int axes_chw[] = { 1, 2, 0 };
+
+static void setup_transpose(bench_ctx *ctx)
+{
+    int n = isqrt(ctx->len);
+    int dims[] = { n, n };
+
+    set_shape(ctx, 2, dims);
+    make(ctx, 0, 2, dims, ctx->dtype);
+    ctx->t[1] = tl_tensor_transpose(ctx->t[0], NULL, axes_2d);
+    ctx->elems = ctx->t[0]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_transpose(bench_ctx *ctx)
+{
+    tl_tensor_transpose(ctx->t[0], ctx->t[1], axes_2d);
+}
+
+static void setup_transpose_chw(bench_ctx *ctx)
+{
+    int dims[4];
+
+    nchw(ctx, dims);
+    set_shape(ctx, 3, dims + 1);
+    make(ctx, 0, 3, dims + 1, ctx->dtype);
+    ctx->t[1] = tl_tensor_transpose(ctx->t[0], NULL, axes_chw);
+    ctx->elems = ctx->t[0]->len;
+    ctx->bytes = 2 * ctx->elems * dsize(ctx);
+}
+
+static void run_transpose_chw(bench_ctx *ctx)
+{
+    tl_tensor_transpose(ctx->t[0], ctx->t[1], axes_chw);
+}
+
+/* resize: 2x nearest upsampling to len elements */
+
+static void setup_resize(bench_ctx *ctx)
+{
+    int n = isqrt(ctx->len) / 2;
+    int dims[] = { n > 0 ? n : 1, n > 0 ? n : 1 };
+    int new_dims[] = { dims[0] * 2, dims[1] * 2 };
+
+    set_shape(ctx, 2, dims);
+    make(ctx, 0, 2, dims, ctx->dtype);
+    ctx->t[1] = tl_tensor_resize(ctx->t[0], NULL, new_dims, TL_NEAREST);
+    ctx->elems = ctx->t[1]->len;
+    ctx->bytes = (ctx->t[0]->len + ctx->t[1]->len) * dsize(ctx);
+}
+
+static void run_resize(bench_ctx *ctx)
+{
+    tl_tensor_resize(ctx->t[0], ctx->t[1], ctx->t[1]->dims, TL_NEAREST);
+}
+
+/* submean/preprocess: HWC image to normalized CHW float */
+
+static const double mean[] = { 123.7, 116.3, 103.5 };
+static const double std[] = { 58.4, 57.1, 57.4 };
+
+static void setup_submean(bench_ctx *ctx)
+{
+    int dims[3];
+
+    hwc(ctx, dims);
+    make(ctx, 0, 3, dims, ctx->dtype);
+    ctx->t[1] = tl_tensor_submean(ctx->t[0], NULL, mean);
+    ctx->elems = ctx->t[0]->len;
+    ctx->bytes = ctx->elems * (dsize(ctx) + sizeof(float));
+}
+
+static void run_submean(bench_ctx *ctx)
+{
+    tl_tensor_submean(ctx->t[0], ctx->t[1], mean);
+}
+
+static void setup_preprocess(bench_ctx *ctx)
+{
+    int dims[3], new_hw[2];
+
+    hwc(ctx, dims);
+    make(ctx, 0, 3, dims, ctx->dtype);
+    new_hw[0] = dims[0] > 1 ? dims[0] / 2 : 1;
+    new_hw[1] = dims[1] > 1 ? dims[1] / 2 : 1;
+    ctx->t[1] = tl_tensor_preprocess(ctx->t[0], NULL, new_hw, TL_NEAREST, mean, std, 1.0, 1);
+    ctx->elems = ctx->t[1]->len;
+    ctx->bytes = ctx->elems * (dsize(ctx) + sizeof(float));
+}
+
+static void run_preprocess(bench_ctx *ctx)
+{
+    tl_tensor_preprocess(ctx->t[0], ctx->t[1], ctx->t[1]->dims + 1, TL_NEAREST, mean, std, 1.0,
+                         1);
+}
+
+/* preprocess_batch: BENCH_PARTS images sharing the lookup tables */
+
+static void setup_preprocess_batch(bench_ctx *ctx)
+{
+    int dims[4], new_hw[2];
+
+    dims[0] = BENCH_PARTS;
+    dims[1] = dims[2] = isqrt(ctx->len / 3 / BENCH_PARTS);
+    dims[3] = 3;
+    set_shape(ctx, 4, dims);
+    for (int i = 0; i < BENCH_PARTS; i++)
+        make(ctx, i, 3, dims + 1, ctx->dtype);
+    new_hw[0] = dims[1] > 1 ? dims[1] / 2 : 1;
+    new_hw[1] = dims[2] > 1 ? dims[2] / 2 : 1;
+    ctx->t[BENCH_PARTS] = tl_tensor_preprocess_batch((const tl_tensor **)ctx->t, BENCH_PARTS,
+                                                     NULL, new_hw, TL_NEAREST, mean, std, 1.0, 1);
+    ctx->elems = ctx->t[BENCH_PARTS]->len;
+    ctx->bytes = ctx->elems * (dsize(ctx) + sizeof(float));
+}
+
+static void run_preprocess_batch(bench_ctx *ctx)
+{
+    tl_tensor_preprocess_batch((const tl_tensor **)ctx->t, BENCH_PARTS, ctx->t[BENCH_PARTS],
+                               ctx->t[BENCH_PARTS]->dims + 2, TL_NEAREST, mean, std, 1.0, 1);
+}
+
+/* clang-format off */
+const bench_op bench_ops[] = {
+    { "zeros",              NULL,          0,       setup_zeros,             run_zeros },
+    { "clone",              NULL,          0,       setup_clone,             run_clone },
+    { "repeat",             NULL,          0,       setup_repeat,            run_repeat },
+    { "arange",             dtypes_arange, 0,       setup_arange,            run_arange },
+    { "fill",               NULL,          0,       setup_arange,            run_fill },
+    { "fill_uniform",       dtypes_real,   0,       setup_arange,            run_fill_uniform },
+    { "fill_normal",        dtypes_real,   0,       setup_arange,            run_fill_normal },
+    { "fprint",             NULL,          1 << 20, setup_fprint,            run_fprint },
+    { "save",               NULL,          1 << 20, setup_fprint,            run_save },
+    { "save_compressed",    NULL,          0,       setup_fprint,            run_save_compressed },
+    { "slice",              NULL,          0,       setup_slice,             run_slice },
+    { "slice_nd",           NULL,          0,       setup_slice_nd,          run_slice_nd },
+    { "pad",                NULL,          0,       setup_pad,               run_pad },
+    { "pad_border",         NULL,          0,       setup_pad_border,        run_pad_border },
+    { "concat",             NULL,          0,       setup_concat,            run_concat },
+    { "concat_n",           NULL,          0,       setup_concat_n,          run_concat_n },
+    { "split_n",            NULL,          0,       setup_concat_n,          run_split_n },
+    { "maxreduce",          NULL,          0,       setup_maxreduce,         run_maxreduce },
+    { "maxreduce_outer",    NULL,          0,       setup_maxreduce_outer,   run_maxreduce_outer },
+    { "elew",               NULL,          0,       setup_elew,              run_elew },
+    { "elew_param",         NULL,          0,       setup_unary,             run_elew_param },
+    { "dot_product",        NULL,          0,       setup_dot_product,       run_dot_product },
+    { "norm",               NULL,          0,       setup_norm,              run_norm },
+    { "cosine_similarity",  NULL,          0,       setup_cosine_similarity, run_cosine_similarity },
+    { "conv2d",             dtypes_float,  1 << 20, setup_conv2d,            run_conv2d },
+    { "maxpool2d",          dtypes_float,  0,       setup_pool,              run_maxpool2d },
+    { "avgpool2d",          dtypes_float,  0,       setup_pool,              run_avgpool2d },
+    { "global_maxpool",     dtypes_float,  0,       setup_global_pool,       run_global_maxpool },
+    { "global_avgpool",     dtypes_float,  0,       setup_global_pool,       run_global_avgpool },
+    { "matmul",             dtypes_matmul, 1 << 19, setup_matmul,            run_matmul },
+    { "transpose",          NULL,          0,       setup_transpose,         run_transpose },
+    { "transpose_chw",      NULL,          0,       setup_transpose_chw,     run_transpose_chw },
+    { "lrelu",              NULL,          0,       setup_unary,             run_lrelu },
+    { "softmax",            dtypes_real,   0,       setup_unary,             run_softmax },
+    { "log_softmax",        dtypes_real,   0,       setup_unary,             run_log_softmax },
+    { "convert",            NULL,          0,       setup_convert,           run_convert },
+    { "resize",             NULL,          0,       setup_resize,            run_resize },
+    { "submean",            dtypes_image,  0,       setup_submean,           run_submean },
+    { "preprocess",         dtypes_image,  0,       setup_preprocess,        run_preprocess },
+    { "preprocess_batch",   dtypes_image,  0,       setup_preprocess_batch,  run_preprocess_batch },
+    { NULL,                 NULL,          0,       NULL,                    NULL }
+};
+/* clang-format on */
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ctype.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tl_util.h"
+#include "bench.h"
+
+#define BENCH_MAX_LIST 32
+
+static const char *size_names[] = { "small", "cache", "dram" };
+static const int size_lens[] = { 1 << 12, 1 << 16, 1 << 24 };
+
+/* clang-format off */
+struct bench_result {
+    const char *op;
+    tl_dtype    dtype;
+    bench_size  size;
+    char        shape[64];
+    int         threads;
+    int         reps;
+    double      median_ns;
+    double      p99_ns;
+    double      min_ns;
+    double      gb_per_s;
+    double      elem_per_s;
+};
+/* clang-format on */
+
+struct bench_opts {
+    const char *filter;
+    int dtypes[BENCH_MAX_LIST];
+    int ndtypes;
+    int sizes[BENCH_SIZE_SIZE];
+    int nsizes;
+    int threads[BENCH_MAX_LIST];
+    int nthreads;
+    double min_time;
+    int min_reps;
+    int max_reps;
+    const char *json_file;
+    const char *csv_file;
+};
+
+static void print_bench_usage_exit(void)
+{
+    const char *usage = "\
+Usage: bench_tensorlight [OPTION...]\n\
+Benchmark tensorlight operators.\n\
+\n\
+Options:\n\
+  -h, --help               display this message\n\
+  -l, --list               list the benchmarked operators and exit\n\
+  -f, --filter=OP1[|OP2...]\n\
+                           specify operators to be run;\n\
+                           OP can contain '*' for glob matching;\n\
+                           add '!' before the glob to take the complement;\n\
+                           use '|' between OPs to do multiple matches;\n\
+                           run all operators if omit this option\n\
+  -d, --dtypes=DTYPE1[,DTYPE2...]\n\
+                           data types, like 'float' or 'TL_FLOAT'\n\
+                           (default: float,int32,uint8)\n\
+  -s, --sizes=SIZE1[,SIZE2...]\n\
+                           problem sizes among small (4K elements),\n\
+                           cache (64K elements) and dram (16M elements)\n\
+                           (default: small,cache,dram)\n\
+  -t, --threads=N1[,N2...] thread counts (default: 1 and tl_get_num_threads())\n\
+  -c, --cpu-level=LEVEL    kernel instruction set, like 'avx2'\n\
+  -m, --min-time=SECONDS   minimal timed duration per case (default: 0.2)\n\
+  -r, --reps=N             minimal number of samples per case (default: 10)\n\
+  -R, --max-reps=N         maximal number of samples per case (default: 10000)\n\
+  -j, --json=FILE          write the results to FILE as JSON\n\
+  -o, --csv=FILE           write the results to FILE as CSV\n\
+";
+    fputs(usage, stderr);
+    exit(EXIT_SUCCESS);
+}
+
+static void list_ops_exit(void)
+{
+    for (const bench_op *op = bench_ops; op->name; op++)
+        printf("%s\n", op->name);
+    exit(EXIT_SUCCESS);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* each '|' separated glob matches, or doesn't match if prefixed by '!' */
+static int match_filter(const char *filter, const char *name)
+{
+    char buf[256], *glob, *saveptr;
+    int neg;
+
+    snprintf(buf, sizeof(buf), "%s", filter);
+    for (glob = strtok_r(buf, "|", &saveptr); glob; glob = strtok_r(NULL, "|", &saveptr)) {
+        neg = glob[0] == '!';
+        if ((fnmatch(glob + neg, name, 0) == 0) != neg)
+            return 1;
+    }
+    return 0;
+}
+
+static int op_supports(const bench_op *op, tl_dtype dtype)
+{
+    if (!op->dtypes)
+        return 1;
+    for (const tl_dtype *d = op->dtypes; *d != TL_DTYPE_INVALID; d++)
+        if (*d == dtype)
+            return 1;
+    return 0;
+}
+
+static int parse_dtype(const char *str)
+{
+    char buf[32];
+    int i, n;
+
+    if (!strncmp(str, "TL_", 3))
+        return tl_dtype_from_str(str);
+    n = snprintf(buf, sizeof(buf), "TL_");
+    for (i = 0; str[i] && n < (int)sizeof(buf) - 1; i++)
+        buf[n++] = toupper((unsigned char)str[i]);
+    buf[n] = '\0';
+    return tl_dtype_from_str(buf);
+}
+
+static int parse_size(const char *str)
+{
+    for (int i = 0; i < BENCH_SIZE_SIZE; i++)
+        if (!strcmp(str, size_names[i]))
+            return i;
+    return BENCH_SIZE_INVALID;
+}
+
+/* split a comma separated list and parse each item; return the count */
+static int parse_list(const char *str, int *arr, int max, int (*parse)(const char *),
+                      const char *what)
+{
+    char buf[256], *item, *saveptr;
+    int n = 0;
+
+    snprintf(buf, sizeof(buf), "%s", str);
+    for (item = strtok_r(buf, ",", &saveptr); item && n < max;
+         item = strtok_r(NULL, ",", &saveptr)) {
+        if ((arr[n] = parse(item)) < 0) {
+            fprintf(stderr, "invalid %s: %s\n", what, item);
+            exit(EXIT_FAILURE);
+        }
+        n++;
+    }
+    return n;
+}
+
+static int parse_threads(const char *str)
+{
+    int n = atoi(str);
+    return n > 0 ? n : -1;
+}
+
+static void bench_case(const bench_op *op, tl_dtype dtype, bench_size size, int threads,
+                       const struct bench_opts *opts, struct bench_result *res)
+{
+    bench_ctx ctx;
+    double *samples, start, total;
+    int n, cap;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.dtype = dtype;
+    ctx.len = size_lens[size];
+    if (op->max_len && ctx.len > op->max_len)
+        ctx.len = op->max_len;
+    op->setup(&ctx);
+
+    tl_set_num_threads(threads);
+    op->run(&ctx); /* warm up caches and the thread pool */
+
+    cap = opts->min_reps;
+    samples = tl_alloc(sizeof(double) * cap);
+    for (n = 0, total = 0; n < opts->max_reps && (n < opts->min_reps || total < opts->min_time);
+         n++) {
+        if (n == cap) {
+            cap *= 2;
+            samples = realloc(samples, sizeof(double) * cap);
+        }
+        start = now_ns();
+        op->run(&ctx);
+        samples[n] = now_ns() - start;
+        total += samples[n] * 1e-9;
+    }
+    qsort(samples, n, sizeof(double), cmp_double);
+
+    res->op = op->name;
+    res->dtype = dtype;
+    res->size = size;
+    memcpy(res->shape, ctx.shape, sizeof(res->shape));
+    res->threads = threads;
+    res->reps = n;
+    res->median_ns = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    res->p99_ns = samples[(int)ceil(0.99 * n) - 1];
+    res->min_ns = samples[0];
+    res->gb_per_s = ctx.bytes / res->median_ns;
+    res->elem_per_s = ctx.elems / res->median_ns * 1e9;
+
+    tl_free(samples);
+    for (int i = 0; i < BENCH_MAX_TENSORS; i++)
+        if (ctx.t[i])
+            tl_tensor_free_data_too(ctx.t[i]);
+}
+
+static void print_header(void)
+{
+    printf("%-18s %-10s %-6s %-14s %3s %6s %12s %12s %9s %10s\n", "op", "dtype", "size", "shape",
+           "thr", "reps", "median_ns", "p99_ns", "GB/s", "Melem/s");
+}
+
+static void print_result(const struct bench_result *r)
+{
+    printf("%-18s %-10s %-6s %-14s %3d %6d %12.0f %12.0f %9.3f %10.2f\n", r->op,
+           tl_dtype_name(r->dtype), size_names[r->size], r->shape, r->threads, r->reps,
+           r->median_ns, r->p99_ns, r->gb_per_s, r->elem_per_s * 1e-6);
+    fflush(stdout);
+}
+
+static void write_json(const char *file, const struct bench_result *res, int n,
+                       const struct bench_opts *opts)
+{
+    FILE *fp;
+
+    if (!(fp = fopen(file, "w"))) {
+        tl_warn_ret("ERROR: cannot open %s", file);
+        return;
+    }
+    fprintf(fp, "{\n  \"cpu_level\": \"%s\",\n  \"min_time\": %g,\n  \"min_reps\": %d,\n",
+            tl_cpu_level_name(tl_get_cpu_level()), opts->min_time, opts->min_reps);
+    fprintf(fp, "  \"results\": [\n");
+    for (int i = 0; i < n; i++) {
+        fprintf(fp,
+                "    {\"op\": \"%s\", \"dtype\": \"%s\", \"size\": \"%s\", \"shape\": \"%s\", "
+                "\"threads\": %d, \"reps\": %d, \"median_ns\": %.1f, \"p99_ns\": %.1f, "
+                "\"min_ns\": %.1f, \"gb_per_s\": %.6g, \"elem_per_s\": %.6g}%s\n",
+                res[i].op, tl_dtype_name(res[i].dtype), size_names[res[i].size], res[i].shape,
+                res[i].threads, res[i].reps, res[i].median_ns, res[i].p99_ns, res[i].min_ns,
+                res[i].gb_per_s, res[i].elem_per_s, i == n - 1 ? "" : ",");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+static void write_csv(const char *file, const struct bench_result *res, int n)
+{
+    FILE *fp;
+
+    if (!(fp = fopen(file, "w"))) {
+        tl_warn_ret("ERROR: cannot open %s", file);
+        return;
+    }
+    fprintf(fp, "op,dtype,size,shape,threads,cpu_level,reps,median_ns,p99_ns,min_ns,gb_per_s,"
+                "elem_per_s\n");
+    for (int i = 0; i < n; i++)
+        fprintf(fp, "%s,%s,%s,%s,%d,%s,%d,%.1f,%.1f,%.1f,%.6g,%.6g\n", res[i].op,
+                tl_dtype_name(res[i].dtype), size_names[res[i].size], res[i].shape,
+                res[i].threads, tl_cpu_level_name(tl_get_cpu_level()), res[i].reps,
+                res[i].median_ns, res[i].p99_ns, res[i].min_ns, res[i].gb_per_s,
+                res[i].elem_per_s);
+    fclose(fp);
+}
+
+int main(int argc, char **argv)
+{
+    int optindex, opt, nres, cap;
+    struct bench_result *res;
+    struct bench_opts opts;
+    tl_cpu_level level;
+    const struct option longopts[] = {
+        { "help", no_argument, NULL, 'h' },
+        { "list", no_argument, NULL, 'l' },
+        { "filter", required_argument, NULL, 'f' },
+        { "dtypes", required_argument, NULL, 'd' },
+        { "sizes", required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 't' },
+        { "cpu-level", required_argument, NULL, 'c' },
+        { "min-time", required_argument, NULL, 'm' },
+        { "reps", required_argument, NULL, 'r' },
+        { "max-reps", required_argument, NULL, 'R' },
+        { "json", required_argument, NULL, 'j' },
+        { "csv", required_argument, NULL, 'o' },
+        { 0, 0, 0, 0 }
+    };
+
+    memset(&opts, 0, sizeof(opts));
+    opts.filter = "*";
+    opts.ndtypes = parse_list("float,int32,uint8", opts.dtypes, BENCH_MAX_LIST, parse_dtype,
+                              "dtype");
+    opts.nsizes = parse_list("small,cache,dram", opts.sizes, BENCH_SIZE_SIZE, parse_size, "size");
+    opts.min_time = 0.2;
+    opts.min_reps = 10;
+    opts.max_reps = 10000;
+
+    optind = 1;
+    while ((opt = getopt_long_only(argc, argv, ":hlf:d:s:t:c:m:r:R:j:o:", longopts,
+                                   &optindex)) != -1) {
+        switch (opt) {
+        case 0:
+            break;
+        case 'h':
+            print_bench_usage_exit();
+            break;
+        case 'l':
+            list_ops_exit();
+            break;
+        case 'f':
+            opts.filter = optarg;
+            break;
+        case 'd':
+            opts.ndtypes = parse_list(optarg, opts.dtypes, BENCH_MAX_LIST, parse_dtype, "dtype");
+            break;
+        case 's':
+            opts.nsizes = parse_list(optarg, opts.sizes, BENCH_SIZE_SIZE, parse_size, "size");
+            break;
+        case 't':
+            opts.nthreads =
+                parse_list(optarg, opts.threads, BENCH_MAX_LIST, parse_threads, "thread count");
+            break;
+        case 'c':
+            if ((level = tl_cpu_level_from_str(optarg)) == TL_CPU_LEVEL_INVALID) {
+                fprintf(stderr, "invalid cpu level: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            tl_set_cpu_level(level);
+            break;
+        case 'm':
+            opts.min_time = atof(optarg);
+            break;
+        case 'r':
+            opts.min_reps = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        case 'R':
+            opts.max_reps = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        case 'j':
+            opts.json_file = optarg;
+            break;
+        case 'o':
+            opts.csv_file = optarg;
+            break;
+        case ':':
+            fprintf(stderr, "option %s needs a value\n", argv[optind - 1]);
+            exit(EXIT_FAILURE);
+            break;
+        case '?':
+            fprintf(stderr, "unknown option %s\n", argv[optind - 1]);
+            exit(EXIT_FAILURE);
+            break;
+        default:
+            fprintf(stderr, "unknown option %s\n", argv[optind - 1]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (opts.max_reps < opts.min_reps)
+        opts.max_reps = opts.min_reps;
+    if (!opts.nthreads) {
+        opts.threads[opts.nthreads++] = 1;
+        if (tl_get_num_threads() > 1)
+            opts.threads[opts.nthreads++] = tl_get_num_threads();
+    }
+
+    printf("cpu level: %s\n", tl_cpu_level_name(tl_get_cpu_level()));
+    print_header();
+    nres = 0;
+    cap = 64;
+    res = tl_alloc(sizeof(struct bench_result) * cap);
+    for (const bench_op *op = bench_ops; op->name; op++) {
+        if (!match_filter(opts.filter, op->name))
+            continue;
+        for (int d = 0; d < opts.ndtypes; d++) {
+            if (!op_supports(op, opts.dtypes[d]))
+                continue;
+            for (int s = 0; s < opts.nsizes; s++) {
+                for (int t = 0; t < opts.nthreads; t++) {
+                    if (nres == cap) {
+                        cap *= 2;
+                        res = realloc(res, sizeof(struct bench_result) * cap);
+                    }
+                    bench_case(op, opts.dtypes[d], opts.sizes[s], opts.threads[t], &opts,
+                               &res[nres]);
+                    print_result(&res[nres++]);
+                }
+            }
+        }
+    }
+
+    if (opts.json_file)
+        write_json(opts.json_file, res, nres, &opts);
+    if (opts.csv_file)
+        write_csv(opts.csv_file, res, nres);
+    tl_free(res);
+
+    return 0;
+}
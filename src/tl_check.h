@@ -25,6 +25,8 @@
 
 #include <check.h>
 #include <math.h>
+#include <stdint.h>
+#include <string.h>
 
 #ifndef ck_assert_double_eq_tol
 #define ck_assert_double_eq_tol(X, Y, T)                                \
@@ -122,10 +124,13 @@
                                   ((TP*)_ck_ty->data)[i]) <= (T),       \
                    (msg), i, ((TP*)_ck_tx->data)[i],                    \
                    i, ((TP*)_ck_ty->data)[i], (T));
-#define tl_assert_tensor_eq_tol(TX, TY, T)                              \
+#define _tl_tensor_msg_half(FUNC, msg, T)                               \
+     ck_assert_msg(_tl_tensor_abs(FUNC(((uint16_t*)_ck_tx->data)[i]),   \
+                                  FUNC(((uint16_t*)_ck_ty->data)[i])) <= (T), \
+                   (msg), i, FUNC(((uint16_t*)_ck_tx->data)[i]),        \
+                   i, FUNC(((uint16_t*)_ck_ty->data)[i]), (double)(T));
+#define _tl_assert_tensor_shape(TX, TY)                                 \
      do {                                                               \
-          tl_tensor *_ck_tx = (TX);                                     \
-          tl_tensor *_ck_ty = (TY);                                     \
           ck_assert_msg(_ck_tx->ndim == _ck_ty->ndim,                   \
                         "Assertion tensor '"#TX" == "#TY"' failed: "#TX"->ndim == %d, "#TY"->ndim == %d", \
                         _ck_tx->ndim, _ck_ty->ndim);                    \
@@ -141,6 +146,12 @@
                              "Assertion tensor '"#TX" == "#TY"' failed: "#TX"->dims[%d] == %d, "#TY"->dims[%d] == %d", \
                              i, _ck_tx->dims[i], i, _ck_ty->dims[i]);   \
 	  }                                                             \
+     } while(0)
+#define tl_assert_tensor_eq_tol(TX, TY, T)                              \
+     do {                                                               \
+          tl_tensor *_ck_tx = (TX);                                     \
+          tl_tensor *_ck_ty = (TY);                                     \
+          _tl_assert_tensor_shape(TX, TY);                              \
           const char *dtype_fmt = tl_dtype_fmt(_ck_tx->dtype);          \
           const char *msg_fmt = "Assertion tensor '"#TX" == "#TY"' failed: "#TX"->data[%%d] == %s, "#TY"->data[%%d] == %s, "#T" == %s"; \
           size_t n = (strlen(msg_fmt)+20);                              \
@@ -154,6 +165,9 @@
                case TL_FLOAT:                                           \
                     _tl_tensor_msg(float, msg, (T));                    \
                     break;                                              \
+               case TL_INT64:                                           \
+                    _tl_tensor_msg(int64_t, msg, (T));                  \
+                    break;                                              \
                case TL_INT32:                                           \
                     _tl_tensor_msg(int32_t, msg, (T));                  \
                     break;                                              \
@@ -163,6 +177,9 @@
                case TL_INT8:                                            \
                     _tl_tensor_msg(int8_t, msg, (T));                   \
                     break;                                              \
+               case TL_UINT64:                                          \
+                    _tl_tensor_msg(uint64_t, msg, (T));                 \
+                    break;                                              \
                case TL_UINT32:                                          \
                     _tl_tensor_msg(uint32_t, msg, (T));                 \
                     break;                                              \
@@ -175,6 +192,12 @@
                case TL_BOOL:                                            \
                     _tl_tensor_msg(tl_bool_t, msg, (T));                \
                     break;                                              \
+               case TL_FLOAT16:                                         \
+                    _tl_tensor_msg_half(tl_float16_to_float, msg, (T)); \
+                    break;                                              \
+               case TL_BFLOAT16:                                        \
+                    _tl_tensor_msg_half(tl_bfloat16_to_float, msg, (T)); \
+                    break;                                              \
                default:                                                 \
                     assert(0 && "unsupported tl_dtype");                \
                     break;                                              \
@@ -186,4 +209,95 @@
 
 #define tl_assert_tensor_eq(TX, TY) tl_assert_tensor_eq_tol(TX, TY, 0)
 
+#ifndef tl_assert_tensor_eq_ulp
+/* distance in units in the last place, with -0.0 == 0.0 and NaN == NaN */
+static inline uint64_t _tl_ulp_diff_float(float x, float y)
+{
+     int32_t ix, iy;
+
+     if (isnan(x) || isnan(y))
+          return isnan(x) && isnan(y) ? 0 : UINT64_MAX;
+     memcpy(&ix, &x, sizeof(ix));
+     memcpy(&iy, &y, sizeof(iy));
+     ix = ix < 0 ? INT32_MIN - ix : ix;
+     iy = iy < 0 ? INT32_MIN - iy : iy;
+     return ix > iy ? (uint64_t)((int64_t)ix - iy) : (uint64_t)((int64_t)iy - ix);
+}
+
+static inline uint64_t _tl_ulp_diff_double(double x, double y)
+{
+     int64_t ix, iy;
+
+     if (isnan(x) || isnan(y))
+          return isnan(x) && isnan(y) ? 0 : UINT64_MAX;
+     memcpy(&ix, &x, sizeof(ix));
+     memcpy(&iy, &y, sizeof(iy));
+     ix = ix < 0 ? INT64_MIN - ix : ix;
+     iy = iy < 0 ? INT64_MIN - iy : iy;
+     return ix > iy ? (uint64_t)ix - (uint64_t)iy : (uint64_t)iy - (uint64_t)ix;
+}
+
+/* the 16-bit float formats are sign-magnitude like float, with the
+   exponent all ones for NaN */
+static inline uint64_t _tl_ulp_diff_bits16(uint16_t x, uint16_t y, uint16_t exp_mask)
+{
+     int ix, iy, nx, ny;
+
+     nx = (x & exp_mask) == exp_mask && (x & ~exp_mask & 0x7FFF);
+     ny = (y & exp_mask) == exp_mask && (y & ~exp_mask & 0x7FFF);
+     if (nx || ny)
+          return nx && ny ? 0 : UINT64_MAX;
+     ix = x & 0x8000 ? -(x & 0x7FFF) : x;
+     iy = y & 0x8000 ? -(y & 0x7FFF) : y;
+     return ix > iy ? ix - iy : iy - ix;
+}
+
+static inline uint64_t _tl_ulp_diff_float16(uint16_t x, uint16_t y)
+{
+     return _tl_ulp_diff_bits16(x, y, 0x7C00);
+}
+
+static inline uint64_t _tl_ulp_diff_bfloat16(uint16_t x, uint16_t y)
+{
+     return _tl_ulp_diff_bits16(x, y, 0x7F80);
+}
+
+#define _tl_tensor_ulp_msg(TP, FUNC, U)                                 \
+     ck_assert_msg(FUNC(((TP*)_ck_tx->data)[i],                         \
+                        ((TP*)_ck_ty->data)[i]) <= (uint64_t)(U),       \
+                   "Assertion tensor '%s ~= %s' failed: [%d] %.17g != %.17g by %llu ulp, tolerance %llu", \
+                   _ck_sx, _ck_sy, i, (double)((TP*)_ck_tx->data)[i],   \
+                   (double)((TP*)_ck_ty->data)[i],                      \
+                   (unsigned long long)FUNC(((TP*)_ck_tx->data)[i],     \
+                                            ((TP*)_ck_ty->data)[i]),    \
+                   (unsigned long long)(U));
+
+/* floating point tensors must agree to within U ulps element-wise, other
+   dtypes exactly */
+#define tl_assert_tensor_eq_ulp(TX, TY, U)                              \
+     do {                                                               \
+          tl_tensor *_ck_tx = (TX);                                     \
+          tl_tensor *_ck_ty = (TY);                                     \
+          const char *_ck_sx = #TX, *_ck_sy = #TY;                      \
+          _tl_assert_tensor_shape(TX, TY);                              \
+          size_t _ck_dsize = tl_size_of(_ck_tx->dtype);                 \
+          for (int i = 0; i < _ck_tx->len; i++) {                       \
+               if (_ck_tx->dtype == TL_FLOAT)                           \
+                    _tl_tensor_ulp_msg(float, _tl_ulp_diff_float, (U))  \
+               else if (_ck_tx->dtype == TL_DOUBLE)                     \
+                    _tl_tensor_ulp_msg(double, _tl_ulp_diff_double, (U)) \
+               else if (_ck_tx->dtype == TL_FLOAT16)                    \
+                    _tl_tensor_ulp_msg(uint16_t, _tl_ulp_diff_float16, (U)) \
+               else if (_ck_tx->dtype == TL_BFLOAT16)                   \
+                    _tl_tensor_ulp_msg(uint16_t, _tl_ulp_diff_bfloat16, (U)) \
+               else                                                     \
+                    ck_assert_msg(!memcmp((char *)_ck_tx->data + i * _ck_dsize, \
+                                          (char *)_ck_ty->data + i * _ck_dsize, \
+                                          _ck_dsize),                   \
+                                  "Assertion tensor '%s == %s' failed: [%d] differs", \
+                                  _ck_sx, _ck_sy, i);                   \
+          }                                                             \
+     } while(0)
+#endif
+
 #endif	/* _TL_CHECK_H_ */
@@ -0,0 +1,717 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+#include "tl_stream.h"
+#include "tl_chunk.h"
+
+/* File layout, all in host byte order:
+
+   "TLCK", u32 version, u32 dtype, u32 ndim, i32 dims[ndim], i32 tile_rows
+   tiles, each rows * dims[1] * ... * dims[ndim-1] elements
+   index: ntiles of struct chunk_entry
+   u64 index offset, u64 ntiles, "TLCI"
+
+   dims[0] in the header is 0 until the writer is closed. */
+
+#define CHUNK_MAGIC "TLCK"
+#define CHUNK_INDEX_MAGIC "TLCI"
+#define CHUNK_VERSION 1
+
+struct chunk_entry {
+    uint64_t offset;
+    uint64_t size; /* bytes in the file */
+    int32_t rows;
+    uint32_t flags; /* 0: raw elements */
+};
+
+struct chunk_trailer {
+    uint64_t index_offset;
+    uint64_t ntiles;
+    char magic[4];
+};
+
+struct write_task {
+    tl_chunk_writer *w;
+    const uint8_t *data;
+    size_t size;
+};
+
+struct tl_chunk_writer {
+    FILE *fp;
+    struct tl_chunk_info info;
+    size_t row_bytes;
+    uint8_t *bufs[2];
+    int cur;       /* the buffer being filled */
+    int cur_rows;  /* rows in it */
+    struct chunk_entry *index;
+    int index_cap;
+    uint64_t offset; /* of the next tile */
+    tl_stream *stream;
+    tl_future *pending; /* the write of bufs[!cur] */
+    struct write_task task;
+    int error;
+};
+
+struct read_task {
+    tl_chunk_reader *r;
+    int tile;
+    int slot;
+};
+
+struct tl_chunk_reader {
+    FILE *fp;
+    struct tl_chunk_info info;
+    struct chunk_entry *index;
+    size_t row_bytes;
+    int nslots; /* prefetch + 1 */
+    tl_tensor **slots;
+    struct read_task *tasks;
+    tl_future **futures;
+    tl_stream *stream; /* NULL without prefetch */
+    int next;
+    int failed; /* a read failed since the last rewind */
+};
+
+static size_t row_bytes_of(const struct tl_chunk_info *info)
+{
+    size_t n = tl_size_of(info->dtype);
+    int i;
+
+    for (i = 1; i < info->ndim; i++)
+        n *= info->dims[i];
+    return n;
+}
+
+static void set_rows(tl_tensor *t, int rows)
+{
+    t->len = t->len / t->dims[0] * rows;
+    t->dims[0] = rows;
+}
+
+static int write_header(FILE *fp, const struct tl_chunk_info *info)
+{
+    uint32_t u[3] = { CHUNK_VERSION, info->dtype, info->ndim };
+
+    return fseeko(fp, 0, SEEK_SET) == 0 && fwrite(CHUNK_MAGIC, 1, 4, fp) == 4 &&
+                   fwrite(u, sizeof(u), 1, fp) == 1 &&
+                   fwrite(info->dims, sizeof(int32_t), info->ndim, fp) == (size_t)info->ndim &&
+                   fwrite(&info->tile_rows, sizeof(int32_t), 1, fp) == 1
+               ? 0
+               : -1;
+}
+
+static void *write_tile(void *arg)
+{
+    struct write_task *task = arg;
+
+    if (fwrite(task->data, 1, task->size, task->w->fp) != task->size)
+        return NULL;
+    return task;
+}
+
+/* wait for the background write; nonzero if it failed */
+static int wait_write(tl_chunk_writer *w)
+{
+    int failed = 0;
+
+    if (w->pending) {
+        failed = !tl_future_get(w->pending);
+        tl_future_free(w->pending);
+        w->pending = NULL;
+    }
+    return failed;
+}
+
+static void flush_tile(tl_chunk_writer *w)
+{
+    struct chunk_entry *e;
+
+    if (w->cur_rows == 0)
+        return;
+    w->error |= wait_write(w);
+    if (w->info.ntiles == w->index_cap) {
+        w->index_cap *= 2;
+        e = tl_alloc(sizeof(struct chunk_entry) * w->index_cap);
+        memcpy(e, w->index, sizeof(struct chunk_entry) * w->info.ntiles);
+        tl_free(w->index);
+        w->index = e;
+    }
+    e = &w->index[w->info.ntiles++];
+    e->offset = w->offset;
+    e->size = w->cur_rows * w->row_bytes;
+    e->rows = w->cur_rows;
+    e->flags = 0;
+    w->offset += e->size;
+    w->info.dims[0] += w->cur_rows;
+
+    w->task.w = w;
+    w->task.data = w->bufs[w->cur];
+    w->task.size = e->size;
+    w->pending = tl_stream_enqueue(w->stream, write_tile, &w->task);
+    w->cur ^= 1;
+    w->cur_rows = 0;
+}
+
+/* Create file_name for tiles of shape tile_dims, where tile_dims[0] is the
+   number of rows per tile. Returns NULL if the file can't be written. */
+TL_EXPORT tl_chunk_writer *tl_chunk_writer_create(const char *file_name, int ndim,
+                                                  const int *tile_dims, tl_dtype dtype)
+{
+    tl_chunk_writer *w;
+    FILE *fp;
+    int i;
+
+    TL_PROFILE_OP();
+
+    assert(file_name && tile_dims);
+    assert(ndim > 0 && ndim <= TL_MAXDIM);
+    tl_check_dtype(dtype);
+    for (i = 0; i < ndim; i++)
+        assert(tile_dims[i] > 0);
+
+    fp = fopen(file_name, "wb");
+    if (!fp) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return NULL;
+    }
+    w = tl_alloc(sizeof(tl_chunk_writer));
+    memset(w, 0, sizeof(tl_chunk_writer));
+    w->fp = fp;
+    w->info.dtype = dtype;
+    w->info.ndim = ndim;
+    memcpy(w->info.dims, tile_dims, sizeof(int) * ndim);
+    w->info.dims[0] = 0;
+    w->info.tile_rows = tile_dims[0];
+    w->row_bytes = row_bytes_of(&w->info);
+    w->bufs[0] = tl_alloc(w->row_bytes * w->info.tile_rows);
+    w->bufs[1] = tl_alloc(w->row_bytes * w->info.tile_rows);
+    w->index_cap = 16;
+    w->index = tl_alloc(sizeof(struct chunk_entry) * w->index_cap);
+    w->error = write_header(fp, &w->info);
+    w->offset = ftello(fp);
+    w->stream = tl_stream_create();
+    return w;
+}
+
+/* Append the rows of t, whose shape past the leading axis and dtype must
+   be those of the tiles. Returns 0, or -1 if a write failed so far. */
+TL_EXPORT int tl_chunk_writer_append(tl_chunk_writer *w, const tl_tensor *t)
+{
+    int i, rows, n;
+
+    TL_PROFILE_OP();
+
+    assert(w && t && t->data);
+    assert(t->dtype == w->info.dtype && t->ndim == w->info.ndim);
+    for (i = 1; i < t->ndim; i++)
+        assert(t->dims[i] == w->info.dims[i]);
+
+    for (rows = 0; rows < t->dims[0]; rows += n) {
+        n = t->dims[0] - rows;
+        if (n > w->info.tile_rows - w->cur_rows)
+            n = w->info.tile_rows - w->cur_rows;
+        memcpy(w->bufs[w->cur] + w->cur_rows * w->row_bytes,
+               (const uint8_t *)t->data + rows * w->row_bytes, n * w->row_bytes);
+        w->cur_rows += n;
+        if (w->cur_rows == w->info.tile_rows)
+            flush_tile(w);
+    }
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(t), TL_PROFILE_TENSOR_BYTES(t));
+    return w->error ? -1 : 0;
+}
+
+/* Write the last partial tile, the index and the final shape, and free w.
+   Returns 0, or -1 if any write failed. */
+TL_EXPORT int tl_chunk_writer_close(tl_chunk_writer *w)
+{
+    struct chunk_trailer trailer;
+    int error;
+
+    TL_PROFILE_OP();
+
+    assert(w);
+    flush_tile(w);
+    error = w->error | wait_write(w);
+    tl_stream_free(w->stream);
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.index_offset = w->offset;
+    trailer.ntiles = w->info.ntiles;
+    memcpy(trailer.magic, CHUNK_INDEX_MAGIC, 4);
+    if (fwrite(w->index, sizeof(struct chunk_entry), w->info.ntiles, w->fp) !=
+            (size_t)w->info.ntiles ||
+        fwrite(&trailer, sizeof(trailer), 1, w->fp) != 1 || write_header(w->fp, &w->info))
+        error = 1;
+    if (fclose(w->fp))
+        error = 1;
+
+    tl_free(w->bufs[0]);
+    tl_free(w->bufs[1]);
+    tl_free(w->index);
+    tl_free(w);
+    return error ? -1 : 0;
+}
+
+/* The header of fp into info, checked before anything is sized by it: a
+   row, and a tile of rows, must have at most INT32_MAX elements. */
+static int read_header(FILE *fp, struct tl_chunk_info *info)
+{
+    char magic[4];
+    uint32_t u[3];
+    int64_t len = 1;
+    int i;
+
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, CHUNK_MAGIC, 4) ||
+        fread(u, sizeof(u), 1, fp) != 1 || u[0] != CHUNK_VERSION || u[1] >= TL_DTYPE_SIZE ||
+        u[2] == 0 || u[2] > TL_MAXDIM)
+        return -1;
+    info->dtype = u[1];
+    info->ndim = u[2];
+    if (fread(info->dims, sizeof(int32_t), info->ndim, fp) != (size_t)info->ndim ||
+        fread(&info->tile_rows, sizeof(int32_t), 1, fp) != 1 || info->tile_rows <= 0)
+        return -1;
+    if (info->dims[0] < 0)
+        return -1;
+    for (i = 1; i < info->ndim; i++) {
+        if (info->dims[i] <= 0)
+            return -1;
+        len *= info->dims[i];
+        if (len > INT32_MAX)
+            return -1;
+    }
+    if (len * info->tile_rows > INT32_MAX)
+        return -1;
+    return 0;
+}
+
+/* The index of r, checked against the file size before it is allocated and
+   each entry against the data before the index. */
+static int read_index(tl_chunk_reader *r)
+{
+    struct chunk_trailer trailer;
+    const struct chunk_entry *e;
+    int64_t rows;
+    off_t size;
+    int i;
+
+    if (fseeko(r->fp, 0, SEEK_END) || (size = ftello(r->fp)) < (off_t)sizeof(trailer) ||
+        fseeko(r->fp, -(off_t)sizeof(trailer), SEEK_END) ||
+        fread(&trailer, sizeof(trailer), 1, r->fp) != 1 ||
+        memcmp(trailer.magic, CHUNK_INDEX_MAGIC, 4) || trailer.ntiles > INT32_MAX)
+        return -1;
+    size -= sizeof(trailer);
+    if (trailer.index_offset > (uint64_t)size ||
+        trailer.ntiles != ((uint64_t)size - trailer.index_offset) / sizeof(struct chunk_entry) ||
+        ((uint64_t)size - trailer.index_offset) % sizeof(struct chunk_entry))
+        return -1;
+    r->info.ntiles = trailer.ntiles;
+    r->index = tl_alloc(sizeof(struct chunk_entry) * (trailer.ntiles ? trailer.ntiles : 1));
+    if (fseeko(r->fp, trailer.index_offset, SEEK_SET) ||
+        fread(r->index, sizeof(struct chunk_entry), trailer.ntiles, r->fp) != trailer.ntiles)
+        return -1;
+    for (i = 0, rows = 0; i < r->info.ntiles; i++) {
+        e = &r->index[i];
+        if (e->rows <= 0 || e->rows > r->info.tile_rows || e->flags != 0 ||
+            e->size != (uint64_t)e->rows * r->row_bytes || e->offset > trailer.index_offset ||
+            e->size > trailer.index_offset - e->offset)
+            return -1;
+        rows += e->rows;
+    }
+    return rows == r->info.dims[0] ? 0 : -1;
+}
+
+static int read_tile(tl_chunk_reader *r, int tile, void *data)
+{
+    const struct chunk_entry *e = &r->index[tile];
+
+    return fseeko(r->fp, e->offset, SEEK_SET) == 0 && fread(data, 1, e->size, r->fp) == e->size
+               ? 0
+               : -1;
+}
+
+static void *read_slot(void *arg)
+{
+    struct read_task *task = arg;
+    tl_chunk_reader *r = task->r;
+
+    if (read_tile(r, task->tile, r->slots[task->slot]->data))
+        return NULL;
+    return task;
+}
+
+static void prefetch_tile(tl_chunk_reader *r, int tile)
+{
+    int slot = tile % r->nslots;
+
+    if (tile >= r->info.ntiles)
+        return;
+    r->tasks[slot].r = r;
+    r->tasks[slot].tile = tile;
+    r->tasks[slot].slot = slot;
+    r->futures[slot] = tl_stream_enqueue(r->stream, read_slot, &r->tasks[slot]);
+}
+
+/* wait for the reads in flight and forget them */
+static void drain(tl_chunk_reader *r)
+{
+    int i;
+
+    for (i = 0; i < r->nslots; i++) {
+        if (r->futures[i]) {
+            tl_future_get(r->futures[i]);
+            tl_future_free(r->futures[i]);
+            r->futures[i] = NULL;
+        }
+    }
+}
+
+/* Open file_name for reading, with up to prefetch tiles read ahead in the
+   background by tl_chunk_reader_next(), or none if prefetch is 0. Returns
+   NULL if the file can't be read or isn't a chunked tensor file. */
+TL_EXPORT tl_chunk_reader *tl_chunk_reader_open(const char *file_name, int prefetch)
+{
+    tl_chunk_reader *r;
+    int dims[TL_MAXDIM];
+    FILE *fp;
+    int i;
+
+    TL_PROFILE_OP();
+
+    assert(file_name && prefetch >= 0);
+    fp = fopen(file_name, "rb");
+    if (!fp) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return NULL;
+    }
+    r = tl_alloc(sizeof(tl_chunk_reader));
+    memset(r, 0, sizeof(tl_chunk_reader));
+    r->fp = fp;
+    if (read_header(fp, &r->info)) {
+        tl_warn_msg("ERROR: %s is not a chunked tensor file", file_name);
+        tl_chunk_reader_close(r);
+        return NULL;
+    }
+    r->row_bytes = row_bytes_of(&r->info);
+    if (read_index(r)) {
+        tl_warn_msg("ERROR: %s has a broken tile index", file_name);
+        tl_chunk_reader_close(r);
+        return NULL;
+    }
+
+    r->nslots = prefetch + 1;
+    r->slots = tl_alloc(sizeof(tl_tensor *) * r->nslots);
+    r->tasks = tl_alloc(sizeof(struct read_task) * r->nslots);
+    r->futures = tl_alloc(sizeof(tl_future *) * r->nslots);
+    memcpy(dims, r->info.dims, sizeof(int) * r->info.ndim);
+    dims[0] = r->info.tile_rows;
+    for (i = 0; i < r->nslots; i++) {
+        r->slots[i] = tl_tensor_create(NULL, r->info.ndim, dims, r->info.dtype);
+        r->slots[i]->owner = r->slots[i];
+        r->slots[i]->data = tl_alloc(r->row_bytes * r->info.tile_rows);
+        r->futures[i] = NULL;
+    }
+    if (prefetch > 0) {
+        r->stream = tl_stream_create();
+        for (i = 0; i < prefetch; i++)
+            prefetch_tile(r, i);
+    }
+    return r;
+}
+
+TL_EXPORT const struct tl_chunk_info *tl_chunk_reader_info(const tl_chunk_reader *r)
+{
+    assert(r);
+    return &r->info;
+}
+
+/* The next tile in file order, or NULL after the last one or if a read
+   failed, which tl_chunk_reader_failed() tells apart. The tile belongs to r
+   and stays valid until the next call. */
+TL_EXPORT const tl_tensor *tl_chunk_reader_next(tl_chunk_reader *r)
+{
+    tl_tensor *t;
+    int tile, slot, failed;
+
+    TL_PROFILE_OP();
+
+    assert(r);
+    if (r->next >= r->info.ntiles)
+        return NULL;
+    tile = r->next++;
+    slot = tile % r->nslots;
+    t = r->slots[slot];
+    if (r->stream) {
+        failed = !tl_future_get(r->futures[slot]);
+        tl_future_free(r->futures[slot]);
+        r->futures[slot] = NULL;
+        /* into the slot of the previous tile, which the caller is done with */
+        prefetch_tile(r, tile + r->nslots - 1);
+    } else {
+        failed = read_tile(r, tile, t->data);
+    }
+    if (failed) {
+        tl_warn_msg("ERROR: failed to read tile %d", tile);
+        r->next = r->info.ntiles;
+        r->failed = 1;
+        return NULL;
+    }
+    set_rows(t, r->index[tile].rows);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(t), TL_PROFILE_TENSOR_BYTES(t));
+    return t;
+}
+
+/* Whether tl_chunk_reader_next() stopped on a failed read rather than after
+   the last tile. */
+TL_EXPORT int tl_chunk_reader_failed(const tl_chunk_reader *r)
+{
+    assert(r);
+    return r->failed;
+}
+
+/* Restart tl_chunk_reader_next() from the first tile. */
+TL_EXPORT void tl_chunk_reader_rewind(tl_chunk_reader *r)
+{
+    int i;
+
+    assert(r);
+    r->next = 0;
+    r->failed = 0;
+    if (!r->stream)
+        return;
+    drain(r);
+    for (i = 0; i < r->nslots - 1; i++)
+        prefetch_tile(r, i);
+}
+
+/* Read the given tile into dst, or into a new tensor if dst is NULL.
+   Returns NULL if the read fails. Tiles from tl_chunk_reader_next() stay
+   valid. */
+TL_EXPORT tl_tensor *tl_chunk_reader_read(tl_chunk_reader *r, int tile, tl_tensor *dst)
+{
+    int dims[TL_MAXDIM];
+
+    TL_PROFILE_OP();
+
+    assert(r && tile >= 0 && tile < r->info.ntiles);
+    memcpy(dims, r->info.dims, sizeof(int) * r->info.ndim);
+    dims[0] = r->index[tile].rows;
+    if (dst) {
+        assert(dst->data);
+        assert(dst->dtype == r->info.dtype && dst->ndim == r->info.ndim);
+        assert(tl_compute_length(r->info.ndim, dims) == dst->len);
+    } else {
+        dst = tl_tensor_zeros(r->info.ndim, dims, r->info.dtype);
+    }
+    /* the prefetching reads share the file position */
+    if (r->stream)
+        tl_stream_synchronize(r->stream);
+    if (read_tile(r, tile, dst->data)) {
+        tl_warn_msg("ERROR: failed to read tile %d", tile);
+        return NULL;
+    }
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT void tl_chunk_reader_close(tl_chunk_reader *r)
+{
+    int i;
+
+    if (!r)
+        return;
+    if (r->stream) {
+        drain(r);
+        tl_stream_free(r->stream);
+    }
+    for (i = 0; r->slots && i < r->nslots; i++)
+        tl_tensor_free_data_too(r->slots[i]);
+    tl_free(r->slots);
+    tl_free(r->tasks);
+    tl_free(r->futures);
+    tl_free(r->index);
+    fclose(r->fp);
+    tl_free(r);
+}
+
+struct reduce_info {
+    void *acc;
+    const void *rows;
+    int nrows;
+    int row_len;
+    tl_elew_op elew_op;
+    tl_dtype dtype;
+};
+
+/* every row folded into a column block of acc at a time */
+static void reduce_worker(void *arg, int start, int end)
+{
+    const struct reduce_info *info = arg;
+    size_t dsize = tl_size_of(info->dtype);
+    void *acc = tl_padd(info->acc, start, dsize);
+    int i;
+
+    for (i = 0; i < info->nrows; i++)
+        tl_elew_n(acc, (const uint8_t *)info->rows + ((size_t)i * info->row_len + start) * dsize,
+                  acc, end - start, info->elew_op, info->dtype);
+}
+
+/* Reduce a chunked tensor along its leading axis with elew_op (TL_SUM,
+   TL_MUL, TL_MAX or TL_MIN), one tile at a time. dst has the shape of a
+   row, or [1] for a 1-D tensor, and is allocated if NULL. Returns NULL if
+   the file can't be read or has no rows. */
+TL_EXPORT tl_tensor *tl_chunk_reduce(const char *file_name, tl_tensor *dst, tl_elew_op elew_op,
+                                     int prefetch)
+{
+    const struct tl_chunk_info *ci;
+    struct reduce_info info;
+    tl_chunk_reader *r;
+    const tl_tensor *t;
+    tl_tensor *ret;
+    int ndim, first;
+
+    TL_PROFILE_OP();
+
+    assert(elew_op == TL_SUM || elew_op == TL_MUL || elew_op == TL_MAX || elew_op == TL_MIN);
+    if (!(r = tl_chunk_reader_open(file_name, prefetch)))
+        return NULL;
+    ci = tl_chunk_reader_info(r);
+    if (ci->ntiles == 0) {
+        tl_warn_msg("ERROR: %s has no rows to reduce", file_name);
+        tl_chunk_reader_close(r);
+        return NULL;
+    }
+    ndim = ci->ndim > 1 ? ci->ndim - 1 : 1;
+    if (dst) {
+        assert(dst->data && dst->dtype == ci->dtype);
+        assert(dst->len == (int)(r->row_bytes / tl_size_of(ci->dtype)));
+        ret = dst;
+    } else {
+        ret = tl_tensor_zeros(ndim, ci->ndim > 1 ? ci->dims + 1 : (int[]){ 1 }, ci->dtype);
+    }
+
+    info.acc = ret->data;
+    info.row_len = ret->len;
+    info.elew_op = elew_op;
+    info.dtype = ci->dtype;
+    for (first = 1; (t = tl_chunk_reader_next(r)); first = 0) {
+        info.rows = t->data;
+        info.nrows = t->dims[0];
+        if (first) {
+            memcpy(ret->data, t->data, r->row_bytes);
+            info.rows = (const uint8_t *)t->data + r->row_bytes;
+            info.nrows--;
+        }
+        tl_parallel_for(info.row_len, 4096, reduce_worker, &info);
+    }
+    if (tl_chunk_reader_failed(r)) {
+        if (!dst)
+            tl_tensor_free_data_too(ret);
+        ret = NULL;
+    }
+    tl_chunk_reader_close(r);
+    return ret;
+}
+
+static int same_layout(const struct tl_chunk_info *a, const struct tl_chunk_info *b)
+{
+    return a->dtype == b->dtype && a->ndim == b->ndim && a->tile_rows == b->tile_rows &&
+           !memcmp(a->dims, b->dims, sizeof(int) * a->ndim);
+}
+
+/* the tiles of src1 and, if src2 is NULL, param combined with elew_op into
+   the tiles of a new file dst */
+static int chunk_elew(const char *src1, const char *src2, double param, const char *dst,
+                      tl_elew_op elew_op, int prefetch)
+{
+    tl_chunk_reader *r1, *r2 = NULL;
+    tl_chunk_writer *w = NULL;
+    const struct tl_chunk_info *ci;
+    const tl_tensor *t1, *t2;
+    tl_tensor *out = NULL;
+    int dims[TL_MAXDIM];
+    int ret = -1;
+
+    if (!(r1 = tl_chunk_reader_open(src1, prefetch)))
+        return -1;
+    ci = tl_chunk_reader_info(r1);
+    if (src2) {
+        if (!(r2 = tl_chunk_reader_open(src2, prefetch)))
+            goto end;
+        if (!same_layout(ci, tl_chunk_reader_info(r2))) {
+            tl_warn_msg("ERROR: %s and %s have different shapes or tiles", src1, src2);
+            goto end;
+        }
+    }
+    memcpy(dims, ci->dims, sizeof(int) * ci->ndim);
+    dims[0] = ci->tile_rows;
+    if (!(w = tl_chunk_writer_create(dst, ci->ndim, dims, ci->dtype)))
+        goto end;
+    out = tl_tensor_zeros(ci->ndim, dims, ci->dtype);
+
+    while ((t1 = tl_chunk_reader_next(r1))) {
+        set_rows(out, t1->dims[0]);
+        if (r2) {
+            if (!(t2 = tl_chunk_reader_next(r2)))
+                goto end;
+            tl_tensor_elew(t1, t2, out, elew_op);
+        } else {
+            tl_tensor_elew_param(t1, param, out, elew_op);
+        }
+        if (tl_chunk_writer_append(w, out))
+            goto end;
+    }
+    ret = tl_chunk_reader_failed(r1) ? -1 : 0;
+
+end:
+    if (w && tl_chunk_writer_close(w))
+        ret = -1;
+    tl_tensor_free_data_too(out);
+    tl_chunk_reader_close(r1);
+    tl_chunk_reader_close(r2);
+    return ret;
+}
+
+/* Write src1 elew_op src2 to dst, a new chunked file with the tiles of src1
+   and src2, which must be laid out the same. Returns 0, or -1 if a file
+   can't be read or written. */
+TL_EXPORT int tl_chunk_elew(const char *src1, const char *src2, const char *dst,
+                            tl_elew_op elew_op, int prefetch)
+{
+    TL_PROFILE_OP();
+
+    assert(src1 && src2 && dst);
+    return chunk_elew(src1, src2, 0, dst, elew_op, prefetch);
+}
+
+/* Write src elew_op param to dst, a new chunked file with the tiles of src.
+   Returns 0, or -1 if a file can't be read or written. */
+TL_EXPORT int tl_chunk_elew_param(const char *src, double param, const char *dst,
+                                  tl_elew_op elew_op, int prefetch)
+{
+    TL_PROFILE_OP();
+
+    assert(src && dst);
+    return chunk_elew(src, NULL, param, dst, elew_op, prefetch);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_CHUNK_H_
+#define _TL_CHUNK_H_
+
+#include "tl_tensor.h"
+
+/* Chunked tensor files for data that doesn't fit in memory. A file holds
+   a tensor as fixed-shape tiles along the leading axis: every tile has
+   tile_rows rows of the shape dims[1..ndim-1], except that the last one may
+   be shorter. An index at the end of the file locates the tiles, so they can
+   be read in any order.
+
+   Readers stream the tiles in order, reading up to prefetch tiles ahead on
+   a background stream, so that at most prefetch + 1 tiles are in memory and
+   disk reads overlap the caller's compute. Writers likewise write each full
+   tile in the background while the next one is filled. Files are written in
+   the host byte order. */
+
+typedef struct tl_chunk_writer tl_chunk_writer;
+typedef struct tl_chunk_reader tl_chunk_reader;
+
+struct tl_chunk_info {
+    tl_dtype dtype;
+    int ndim;
+    int dims[TL_MAXDIM]; /* dims[0] counts the rows of all tiles */
+    int tile_rows;
+    int ntiles;
+};
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+tl_chunk_writer *tl_chunk_writer_create(const char *file_name, int ndim, const int *tile_dims,
+                                        tl_dtype dtype);
+int tl_chunk_writer_append(tl_chunk_writer *w, const tl_tensor *t);
+int tl_chunk_writer_close(tl_chunk_writer *w);
+
+tl_chunk_reader *tl_chunk_reader_open(const char *file_name, int prefetch);
+const struct tl_chunk_info *tl_chunk_reader_info(const tl_chunk_reader *r);
+const tl_tensor *tl_chunk_reader_next(tl_chunk_reader *r);
+int tl_chunk_reader_failed(const tl_chunk_reader *r);
+void tl_chunk_reader_rewind(tl_chunk_reader *r);
+tl_tensor *tl_chunk_reader_read(tl_chunk_reader *r, int tile, tl_tensor *dst);
+void tl_chunk_reader_close(tl_chunk_reader *r);
+
+tl_tensor *tl_chunk_reduce(const char *file_name, tl_tensor *dst, tl_elew_op elew_op,
+                           int prefetch);
+int tl_chunk_elew(const char *src1, const char *src2, const char *dst, tl_elew_op elew_op,
+                  int prefetch);
+int tl_chunk_elew_param(const char *src, double param, const char *dst, tl_elew_op elew_op,
+                        int prefetch);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_CHUNK_H_ */
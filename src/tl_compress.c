@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+
+#include "tl_kernel.h"
+#include "tl_compress.h"
+
+/* A compressed block is a series of sequences, each a run of literal bytes
+   followed by a copy of earlier output:
+
+   token: literal count in the high nibble, match length - 4 in the low one;
+          a nibble of 15 is followed by bytes added to it, up to one < 255
+   the literal bytes
+   offset of the match back from the current output, u16 little endian
+
+   The last sequence ends after its literals. Offsets are limited to 64 KiB,
+   blocks may be longer. */
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_LOG 14
+#define LZ_SKIP_TRIGGER 6 /* skip faster after 2^6 misses in a row */
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
+
+/* the number of bytes from p on that equal those from ref, before end */
+static inline size_t match_length(const uint8_t *p, const uint8_t *ref, const uint8_t *end)
+{
+    const uint8_t *start = p;
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t a, b;
+
+    while (end - p >= 8) {
+        memcpy(&a, p, 8);
+        memcpy(&b, ref, 8);
+        if (a != b)
+            return p - start + (__builtin_ctzll(a ^ b) >> 3);
+        p += 8;
+        ref += 8;
+    }
+#endif
+    while (p < end && *p == *ref) {
+        p++;
+        ref++;
+    }
+    return p - start;
+}
+
+static inline uint8_t *put_length(uint8_t *op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* Write nlit literals from lit and a match of mlen bytes at offset, or no
+   match if mlen is 0. Returns the new end of the output, or NULL if it
+   doesn't fit before oend. */
+static uint8_t *put_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t nlit,
+                             size_t offset, size_t mlen)
+{
+    uint8_t *token = op;
+
+    if (3 + nlit + nlit / 255 + (mlen ? 3 + mlen / 255 : 0) > (size_t)(oend - op))
+        return NULL;
+    op++;
+    if (nlit >= 15) {
+        *token = 15 << 4;
+        op = put_length(op, nlit - 15);
+    } else {
+        *token = (uint8_t)(nlit << 4);
+    }
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (mlen) {
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        mlen -= LZ_MIN_MATCH;
+        if (mlen >= 15) {
+            *token |= 15;
+            op = put_length(op, mlen - 15);
+        } else {
+            *token |= mlen;
+        }
+    }
+    return op;
+}
+
+/* Greedy matching on a hash table of 4-byte prefixes. After many misses in
+   a row the step grows, so incompressible data passes quickly. */
+static size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t cap, uint32_t *table)
+{
+    uint8_t *op = dst, *oend = dst + cap;
+    size_t pos = 0, anchor = 0, ref, len;
+    unsigned misses = 0;
+    uint32_t v, h;
+
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_LOG);
+    while (n >= LZ_MIN_MATCH && pos <= n - LZ_MIN_MATCH) {
+        v = read32(src + pos);
+        h = lz_hash(v);
+        ref = table[h];
+        table[h] = (uint32_t)pos;
+        if (ref >= pos || pos - ref > LZ_MAX_OFFSET || read32(src + ref) != v) {
+            pos += 1 + (misses++ >> LZ_SKIP_TRIGGER);
+            continue;
+        }
+        misses = 0;
+        while (pos > anchor && ref > 0 && src[pos - 1] == src[ref - 1]) {
+            pos--;
+            ref--;
+        }
+        len = LZ_MIN_MATCH + match_length(src + pos + LZ_MIN_MATCH, src + ref + LZ_MIN_MATCH,
+                                          src + n);
+        op = put_sequence(op, oend, src + anchor, pos - anchor, pos - ref, len);
+        if (!op)
+            return 0;
+        pos += len;
+        anchor = pos;
+        if (pos + 2 <= n)
+            table[lz_hash(read32(src + pos - 2))] = (uint32_t)(pos - 2);
+    }
+    op = put_sequence(op, oend, src + anchor, n - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+static inline int get_length(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    unsigned b;
+
+    do {
+        if (*ip == iend)
+            return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+static int lz_decompress(const uint8_t *src, size_t csize, uint8_t *dst, size_t n)
+{
+    const uint8_t *ip = src, *iend = src + csize;
+    uint8_t *op = dst, *oend = dst + n, *ref;
+    size_t len, offset, c;
+    unsigned token;
+
+    for (;;) {
+        if (ip == iend)
+            return -1;
+        token = *ip++;
+        len = token >> 4;
+        if (len == 15 && get_length(&ip, iend, &len))
+            return -1;
+        if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+            return -1;
+        /* short runs are copied 16 bytes at once when there is room, the
+           bytes past them get overwritten later */
+        if (len <= 16 && iend - ip >= 16 && oend - op >= 16)
+            memcpy(op, ip, 16);
+        else
+            memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        if (ip == iend)
+            return op == oend ? 0 : -1;
+
+        if (iend - ip < 2)
+            return -1;
+        offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return -1;
+        len = token & 15;
+        if (len == 15 && get_length(&ip, iend, &len))
+            return -1;
+        len += LZ_MIN_MATCH;
+        if (len > (size_t)(oend - op))
+            return -1;
+        ref = op - offset;
+        if (offset >= 8 && (size_t)(oend - op) >= len + 8) {
+            for (c = 0; c < len; c += 8)
+                memcpy(op + c, ref + c, 8);
+            op += len;
+            continue;
+        }
+        /* the output from ref on repeats with a period of offset, so it
+           can be copied in pieces that double each time */
+        while (len > 0) {
+            c = (size_t)(op - ref) < len ? (size_t)(op - ref) : len;
+            memcpy(op, ref, c);
+            op += c;
+            len -= c;
+        }
+    }
+}
+
+/* byte shuffling whole bytes is a no-op */
+static int shuffles(tl_shuffle shuffle, int esize)
+{
+    return shuffle == TL_SHUFFLE_BIT || (shuffle == TL_SHUFFLE_BYTE && esize > 1);
+}
+
+/* Shuffling is done by the kernels: a byte shuffle puts byte b of every
+   element in run b of n / esize bytes, a bit shuffle further splits each run
+   by bit with bit_transpose. */
+size_t tl_compress_block(const void *src, size_t n, int esize, tl_shuffle shuffle, void *dst,
+                         void *scratch)
+{
+    const struct tl_kernels *k = tl_get_kernels();
+    uint32_t *table = scratch;
+    uint8_t *buf = (uint8_t *)scratch + (sizeof(uint32_t) << LZ_HASH_LOG);
+    const uint8_t *in = src;
+    size_t nelem = n / esize;
+    int b;
+
+    assert(src && dst && scratch);
+    assert((esize == 1 || esize == 2 || esize == 4 || esize == 8) && n % esize == 0);
+    tl_check_shuffle(shuffle);
+
+    if (n < 2)
+        return 0;
+    if (shuffle != TL_SHUFFLE_NONE && esize > 1) {
+        k->shuffle[tl_size_index(esize)](buf, src, nelem);
+        in = buf;
+    }
+    if (shuffle == TL_SHUFFLE_BIT) {
+        for (b = 0; b < esize; b++)
+            k->bit_transpose(buf + n + b * nelem, in + b * nelem, nelem);
+        in = buf + n;
+    }
+    return lz_compress(in, n, dst, n - 1, table);
+}
+
+int tl_decompress_block(const void *src, size_t csize, size_t n, int esize, tl_shuffle shuffle,
+                        void *dst, void *scratch)
+{
+    const struct tl_kernels *k = tl_get_kernels();
+    uint8_t *buf = (uint8_t *)scratch + (sizeof(uint32_t) << LZ_HASH_LOG);
+    size_t nelem = n / esize;
+    int b;
+
+    assert(src && dst && scratch);
+    assert((esize == 1 || esize == 2 || esize == 4 || esize == 8) && n % esize == 0);
+    tl_check_shuffle(shuffle);
+
+    if (!shuffles(shuffle, esize))
+        return lz_decompress(src, csize, dst, n);
+    if (lz_decompress(src, csize, buf, n))
+        return -1;
+    if (shuffle == TL_SHUFFLE_BIT && esize == 1) {
+        k->bit_untranspose(dst, buf, n);
+        return 0;
+    }
+    if (shuffle == TL_SHUFFLE_BIT) {
+        for (b = 0; b < esize; b++)
+            k->bit_untranspose(buf + n + b * nelem, buf + b * nelem, nelem);
+        buf += n;
+    }
+    k->unshuffle[tl_size_index(esize)](dst, buf, nelem);
+    return 0;
+}
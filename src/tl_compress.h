@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_COMPRESS_H_
+#define _TL_COMPRESS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tl_type.h"
+
+/* Block codec for binary tensor files. A block of whole elements is first
+   shuffled, so that bytes (or bits) of equal significance across elements
+   end up next to each other, then coded with a byte-oriented LZ77 in the
+   manner of LZ4. Blocks are independent of each other, so any number of
+   them can be coded at the same time. */
+
+/* bytes of scratch space tl_compress_block and tl_decompress_block need
+   for a block of n bytes */
+#define TL_COMPRESS_SCRATCH(n) (2 * (n) + sizeof(uint32_t) * (1 << 14))
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+/* Compress the n bytes at src, elements of esize = 1, 2, 4 or 8 bytes,
+   into dst, which has room for n - 1 bytes. Returns the compressed size, or
+   0 if the block doesn't get smaller and should be stored as it is. */
+size_t tl_compress_block(const void *src, size_t n, int esize, tl_shuffle shuffle, void *dst,
+                         void *scratch);
+/* Decompress csize bytes at src, made by tl_compress_block, into the n
+   bytes at dst. Returns 0, or -1 if the input is malformed. */
+int tl_decompress_block(const void *src, size_t csize, size_t n, int esize, tl_shuffle shuffle,
+                        void *dst, void *scratch);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_COMPRESS_H_ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "tl_util.h"
+#include "tl_parallel.h"
+#include "tl_gemm.h"
+
+/* Goto-style blocking: a KC x NC panel of B and an MC x KC block of A are
+   packed into contiguous strips, then an MR x NR micro-kernel runs over
+   them. MC * KC elements of A should fit in L2, KC * NR of B in L1. */
+#define TL_GEMM_KC 256
+#define TL_GEMM_MC 128
+#define TL_GEMM_NC 2048
+#define TL_GEMM_NSUB 256
+#define TL_GEMM_PARALLEL_MIN (1 << 18)
+
+#define GEMM_T float
+#define GEMM_AB_T float
+#define GEMM_NAME(x) x##_float
+#define GEMM_MR 4
+#define GEMM_NR 16
+#include "tl_gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_AB_T
+#undef GEMM_NAME
+#undef GEMM_MR
+#undef GEMM_NR
+
+#define GEMM_T double
+#define GEMM_AB_T double
+#define GEMM_NAME(x) x##_double
+#define GEMM_MR 4
+#define GEMM_NR 8
+#include "tl_gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_AB_T
+#undef GEMM_NAME
+#undef GEMM_MR
+#undef GEMM_NR
+
+#define GEMM_T int32_t
+#define GEMM_AB_T int32_t
+#define GEMM_NAME(x) x##_int32
+#define GEMM_MR 4
+#define GEMM_NR 16
+#include "tl_gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_AB_T
+#undef GEMM_NAME
+#undef GEMM_MR
+#undef GEMM_NR
+
+/* int16 A and B (quantized values less their zero points) into int32 C */
+#define GEMM_T int32_t
+#define GEMM_AB_T int16_t
+#define GEMM_NAME(x) x##_int16
+#define GEMM_MR 4
+#define GEMM_NR 16
+#include "tl_gemm_impl.h"
+#undef GEMM_T
+#undef GEMM_AB_T
+#undef GEMM_NAME
+#undef GEMM_MR
+#undef GEMM_NR
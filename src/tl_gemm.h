@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_GEMM_H_
+#define _TL_GEMM_H_
+
+#include <stdint.h>
+
+/* Row-major C[M][N] = op(A)[M][K] * op(B)[K][N] + beta * C, where op(X) is
+   X or its transpose, selected by transa/transb. lda, ldb and ldc are the
+   row strides of A, B and C as they are stored. beta == 0 means C is
+   overwritten without being read. */
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+void tl_gemm_float(int transa, int transb, int M, int N, int K, const float *A, int lda,
+                   const float *B, int ldb, float beta, float *C, int ldc);
+void tl_gemm_double(int transa, int transb, int M, int N, int K, const double *A, int lda,
+                    const double *B, int ldb, double beta, double *C, int ldc);
+void tl_gemm_int32(int transa, int transb, int M, int N, int K, const int32_t *A, int lda,
+                   const int32_t *B, int ldb, int32_t beta, int32_t *C, int ldc);
+/* int16 A and B into an int32 C, for the quantized matmul */
+void tl_gemm_int16(int transa, int transb, int M, int N, int K, const int16_t *A, int lda,
+                   const int16_t *B, int ldb, int32_t beta, int32_t *C, int ldc);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_GEMM_H_ */
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Typed GEMM template, included by tl_gemm.c once per data type with
+   GEMM_T (type of C and of the accumulators), GEMM_AB_T (type of A and B,
+   usually GEMM_T), GEMM_NAME(x) (name mangler), GEMM_MR and GEMM_NR
+   (register block size of the micro-kernel) defined. */
+
+struct GEMM_NAME(args) {
+    int transa, transb;
+    int M, nc, kc;
+    const GEMM_AB_T *A;
+    int lda;
+    const GEMM_AB_T *B;
+    int ldb;
+    GEMM_T beta;
+    GEMM_T *C;
+    int ldc;
+    int first;
+    GEMM_AB_T *Ap;
+    GEMM_AB_T *Bp;
+    int ntiles;
+};
+
+/* pack strips [start, end) of MR rows of op(A)[M][kc];
+   element (i, p) of a strip is stored at p * MR + i */
+static void GEMM_NAME(pack_a)(void *arg, int start, int end)
+{
+    const struct GEMM_NAME(args) *g = arg;
+    int s, i, p, i0, mr;
+    GEMM_AB_T *Ap;
+
+    for (s = start; s < end; s++) {
+        i0 = s * GEMM_MR;
+        mr = g->M - i0 < GEMM_MR ? g->M - i0 : GEMM_MR;
+        Ap = g->Ap + (size_t)s * g->kc * GEMM_MR;
+        if (g->transa) {
+            for (p = 0; p < g->kc; p++) {
+                const GEMM_AB_T *a = g->A + (size_t)p * g->lda + i0;
+                for (i = 0; i < mr; i++)
+                    Ap[p * GEMM_MR + i] = a[i];
+                for (; i < GEMM_MR; i++)
+                    Ap[p * GEMM_MR + i] = 0;
+            }
+        } else {
+            for (i = 0; i < mr; i++) {
+                const GEMM_AB_T *a = g->A + (size_t)(i0 + i) * g->lda;
+                for (p = 0; p < g->kc; p++)
+                    Ap[p * GEMM_MR + i] = a[p];
+            }
+            for (; i < GEMM_MR; i++)
+                for (p = 0; p < g->kc; p++)
+                    Ap[p * GEMM_MR + i] = 0;
+        }
+    }
+}
+
+/* pack strips [start, end) of NR columns of op(B)[kc][nc];
+   element (p, j) of a strip is stored at p * NR + j */
+static void GEMM_NAME(pack_b)(void *arg, int start, int end)
+{
+    const struct GEMM_NAME(args) *g = arg;
+    int s, j, p, j0, nr;
+    GEMM_AB_T *Bp;
+
+    for (s = start; s < end; s++) {
+        j0 = s * GEMM_NR;
+        nr = g->nc - j0 < GEMM_NR ? g->nc - j0 : GEMM_NR;
+        Bp = g->Bp + (size_t)s * g->kc * GEMM_NR;
+        if (g->transb) {
+            for (j = 0; j < nr; j++) {
+                const GEMM_AB_T *b = g->B + (size_t)(j0 + j) * g->ldb;
+                for (p = 0; p < g->kc; p++)
+                    Bp[p * GEMM_NR + j] = b[p];
+            }
+            for (; j < GEMM_NR; j++)
+                for (p = 0; p < g->kc; p++)
+                    Bp[p * GEMM_NR + j] = 0;
+        } else {
+            for (p = 0; p < g->kc; p++) {
+                const GEMM_AB_T *b = g->B + (size_t)p * g->ldb + j0;
+                for (j = 0; j < nr; j++)
+                    Bp[p * GEMM_NR + j] = b[j];
+                for (; j < GEMM_NR; j++)
+                    Bp[p * GEMM_NR + j] = 0;
+            }
+        }
+    }
+}
+
+static void GEMM_NAME(micro_kernel)(int kc, const GEMM_AB_T *restrict Ap,
+                                    const GEMM_AB_T *restrict Bp, GEMM_T *C, int ldc, int mr,
+                                    int nr, int first, GEMM_T beta)
+{
+    GEMM_T acc[GEMM_MR * GEMM_NR];
+    int i, j, p;
+
+    for (i = 0; i < GEMM_MR * GEMM_NR; i++)
+        acc[i] = 0;
+    for (p = 0; p < kc; p++) {
+        for (i = 0; i < GEMM_MR; i++) {
+            GEMM_T a = Ap[p * GEMM_MR + i];
+            for (j = 0; j < GEMM_NR; j++)
+                acc[i * GEMM_NR + j] += a * Bp[p * GEMM_NR + j];
+        }
+    }
+
+    for (i = 0; i < mr; i++) {
+        GEMM_T *c = C + (size_t)i * ldc;
+        if (!first) {
+            for (j = 0; j < nr; j++)
+                c[j] += acc[i * GEMM_NR + j];
+        } else if (beta == 0) {
+            for (j = 0; j < nr; j++)
+                c[j] = acc[i * GEMM_NR + j];
+        } else {
+            for (j = 0; j < nr; j++)
+                c[j] = beta * c[j] + acc[i * GEMM_NR + j];
+        }
+    }
+}
+
+/* compute tiles [start, end) of TL_GEMM_MC rows x TL_GEMM_NSUB columns */
+static void GEMM_NAME(macro_kernel)(void *arg, int start, int end)
+{
+    const struct GEMM_NAME(args) *g = arg;
+    int t, i, j, i_end, j_end;
+
+    for (t = start; t < end; t++) {
+        i = t / g->ntiles * TL_GEMM_MC;
+        j = t % g->ntiles * TL_GEMM_NSUB;
+        i_end = i + TL_GEMM_MC < g->M ? i + TL_GEMM_MC : g->M;
+        j_end = j + TL_GEMM_NSUB < g->nc ? j + TL_GEMM_NSUB : g->nc;
+        for (int jr = j; jr < j_end; jr += GEMM_NR) {
+            const GEMM_AB_T *Bp = g->Bp + (size_t)(jr / GEMM_NR) * g->kc * GEMM_NR;
+            int nr = j_end - jr < GEMM_NR ? j_end - jr : GEMM_NR;
+            for (int ir = i; ir < i_end; ir += GEMM_MR) {
+                const GEMM_AB_T *Ap = g->Ap + (size_t)(ir / GEMM_MR) * g->kc * GEMM_MR;
+                int mr = i_end - ir < GEMM_MR ? i_end - ir : GEMM_MR;
+                GEMM_NAME(micro_kernel)(g->kc, Ap, Bp, g->C + (size_t)ir * g->ldc + jr, g->ldc, mr,
+                                        nr, g->first, g->beta);
+            }
+        }
+    }
+}
+
+void GEMM_NAME(tl_gemm)(int transa, int transb, int M, int N, int K, const GEMM_AB_T *A, int lda,
+                        const GEMM_AB_T *B, int ldb, GEMM_T beta, GEMM_T *C, int ldc)
+{
+    struct GEMM_NAME(args) g;
+    int jc, pc, mstrips, nstrips, tiles, grain;
+
+    assert(M >= 0 && N >= 0 && K >= 0);
+    assert(A && B && C);
+    if (M == 0 || N == 0)
+        return;
+    if (K == 0) {
+        for (int i = 0; i < M; i++)
+            for (int j = 0; j < N; j++)
+                C[(size_t)i * ldc + j] = beta == 0 ? 0 : beta * C[(size_t)i * ldc + j];
+        return;
+    }
+
+    mstrips = (M + GEMM_MR - 1) / GEMM_MR;
+    g.transa = transa;
+    g.transb = transb;
+    g.M = M;
+    g.lda = lda;
+    g.ldb = ldb;
+    g.beta = beta;
+    g.ldc = ldc;
+    g.Ap = tl_alloc(sizeof(GEMM_AB_T) * mstrips * GEMM_MR * (K < TL_GEMM_KC ? K : TL_GEMM_KC));
+    g.Bp = tl_alloc(sizeof(GEMM_AB_T) * (N < TL_GEMM_NC ? N + GEMM_NR : TL_GEMM_NC) *
+                    (K < TL_GEMM_KC ? K : TL_GEMM_KC));
+
+    for (jc = 0; jc < N; jc += TL_GEMM_NC) {
+        g.nc = N - jc < TL_GEMM_NC ? N - jc : TL_GEMM_NC;
+        nstrips = (g.nc + GEMM_NR - 1) / GEMM_NR;
+        g.ntiles = (g.nc + TL_GEMM_NSUB - 1) / TL_GEMM_NSUB;
+        tiles = (M + TL_GEMM_MC - 1) / TL_GEMM_MC * g.ntiles;
+        for (pc = 0; pc < K; pc += TL_GEMM_KC) {
+            g.kc = K - pc < TL_GEMM_KC ? K - pc : TL_GEMM_KC;
+            g.first = pc == 0;
+            g.A = transa ? A + (size_t)pc * lda : A + pc;
+            g.B = transb ? B + (size_t)jc * ldb + pc : B + (size_t)pc * ldb + jc;
+            g.C = C + jc;
+
+            /* keep small products in the calling thread */
+            grain = (long long)M * g.nc * g.kc < TL_GEMM_PARALLEL_MIN ? tiles : 1;
+            tl_parallel_for(nstrips, grain == 1 ? 1 : nstrips, GEMM_NAME(pack_b), &g);
+            tl_parallel_for(mstrips, grain == 1 ? 1 : mstrips, GEMM_NAME(pack_a), &g);
+            tl_parallel_for(tiles, grain, GEMM_NAME(macro_kernel), &g);
+        }
+    }
+
+    tl_free(g.Ap);
+    tl_free(g.Bp);
+}
@@ -0,0 +1,875 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+#include "tl_graph.h"
+
+/* elements per block of a fused step, so that the blocks of all its
+   intermediate results stay in L1/L2 */
+#define GRAPH_BLOCK 1024
+/* largest maxreduce slab (dim * inner elements) fused into a chain */
+#define GRAPH_MAX_SLAB 65536
+/* elements per thread of a fused step, below which it's not worth it */
+#define GRAPH_GRAIN 65536
+#define GRAPH_ALIGN 64
+
+enum node_kind {
+    NODE_INPUT,
+    NODE_CONST,
+    NODE_ELEW,
+    NODE_ELEW_PARAM,
+    NODE_LRELU,
+    NODE_CONVERT,
+    NODE_MAXREDUCE,
+    NODE_MATMUL,
+    NODE_TRANSPOSE,
+    NODE_SOFTMAX,
+};
+
+static const char *node_kind_names[] = { "input",    "const",     "elew",      "elew_param",
+                                         "lrelu",    "convert",   "maxreduce", "matmul",
+                                         "transpose", "softmax" };
+
+enum node_storage {
+    STORE_NONE,   /* dead, or only lives in the blocks of a fused step */
+    STORE_INPUT,  /* bound by tl_graph_run() */
+    STORE_CONST,  /* owned by the node's tensor */
+    STORE_OUTPUT, /* owned by the graph, persists between runs */
+    STORE_ARENA,  /* a temporary in the arena */
+};
+
+struct node {
+    enum node_kind kind;
+    tl_tensor *t; /* shape and dtype, data is set by compile and run */
+    int src[2];
+    int nsrc;
+    tl_elew_op elew_op;
+    double param; /* converted to t->dtype, for elew_param */
+    float negslope;
+    int axis;
+    int axes[TL_MAXDIM];
+    int trans1, trans2;
+
+    /* filled by tl_graph_compile() */
+    int uses;   /* number of consumers, -1 if the node is dead */
+    int output; /* output index, or -1 */
+    int step;   /* step computing it, or -1 */
+    int slot;   /* scratch slot in its fused step, or -1 */
+    int last_use;
+    int alias; /* node whose arena memory it shares, or itself */
+    enum node_storage storage;
+    size_t offset; /* offset in the arena of alias roots */
+};
+
+/* A step is either one non-elementwise op, or a fused tree of elementwise
+   ops of the same length whose only result is the last member, optionally
+   followed by a maxreduce of that result. */
+struct step {
+    int *members; /* topological order */
+    int nmembers;
+    int cap;
+    int reduce; /* fused maxreduce node, or -1 */
+    int result; /* node the step produces */
+    int fused;
+
+    /* of fused steps, filled by plan_scratch() */
+    int block;           /* elements per block */
+    int nblocks;
+    int inner;           /* of the fused maxreduce */
+    size_t *scratch_off; /* of each member's block in a thread's scratch */
+};
+
+struct tl_graph {
+    struct node *nodes;
+    int nnodes;
+    int cap_nodes;
+    int *inputs;
+    int ninputs;
+    int cap_inputs;
+    int *outputs;
+    int noutputs;
+    int cap_outputs;
+    struct step *steps;
+    int nsteps;
+    void *arena;
+    size_t arena_size;
+    void *scratch;       /* nscratch areas of scratch_size bytes, one per chunk */
+    size_t scratch_size; /* the most any fused step needs */
+    int nscratch;
+    int compiled;
+};
+
+static void *grow(void *p, int *cap, int n, size_t esize)
+{
+    void *np;
+
+    if (n < *cap)
+        return p;
+    *cap = *cap ? *cap * 2 : 8;
+    np = tl_alloc(*cap * esize);
+    if (p) {
+        memmove(np, p, n * esize);
+        tl_free(p);
+    }
+    return np;
+}
+
+TL_EXPORT tl_graph *tl_graph_create(void)
+{
+    tl_graph *g;
+
+    g = tl_alloc(sizeof(tl_graph));
+    memset(g, 0, sizeof(tl_graph));
+    return g;
+}
+
+TL_EXPORT void tl_graph_free(tl_graph *g)
+{
+    int i;
+
+    if (!g)
+        return;
+    for (i = 0; i < g->nnodes; i++) {
+        if (g->nodes[i].kind == NODE_CONST)
+            tl_tensor_free_data_too(g->nodes[i].t);
+        else if (g->compiled && g->nodes[i].storage == STORE_OUTPUT)
+            tl_tensor_free_data_too(g->nodes[i].t);
+        else
+            tl_tensor_free(g->nodes[i].t);
+    }
+    for (i = 0; i < g->nsteps; i++) {
+        tl_free(g->steps[i].members);
+        tl_free(g->steps[i].scratch_off);
+    }
+    tl_free(g->nodes);
+    tl_free(g->inputs);
+    tl_free(g->outputs);
+    tl_free(g->steps);
+    tl_free(g->arena);
+    tl_free(g->scratch);
+    tl_free(g);
+}
+
+static struct node *node_at(const tl_graph *g, int id)
+{
+    assert(id >= 0 && id < g->nnodes);
+    return &g->nodes[id];
+}
+
+static int add_node(tl_graph *g, enum node_kind kind, tl_tensor *t, int src1, int src2)
+{
+    struct node *n;
+
+    assert(!g->compiled && "can't add ops to a compiled graph");
+    g->nodes = grow(g->nodes, &g->cap_nodes, g->nnodes, sizeof(struct node));
+    n = &g->nodes[g->nnodes];
+    memset(n, 0, sizeof(struct node));
+    n->kind = kind;
+    n->t = t;
+    n->src[0] = src1;
+    n->src[1] = src2;
+    n->nsrc = (src1 >= 0) + (src2 >= 0);
+    n->output = -1;
+    return g->nnodes++;
+}
+
+TL_EXPORT int tl_graph_input(tl_graph *g, int ndim, const int *dims, tl_dtype dtype)
+{
+    int id;
+
+    id = add_node(g, NODE_INPUT, tl_tensor_create(NULL, ndim, dims, dtype), -1, -1);
+    g->inputs = grow(g->inputs, &g->cap_inputs, g->ninputs, sizeof(int));
+    g->inputs[g->ninputs++] = id;
+    return id;
+}
+
+/* t is copied, so it can be freed after the call */
+TL_EXPORT int tl_graph_const(tl_graph *g, const tl_tensor *t)
+{
+    assert(t && t->data);
+    return add_node(g, NODE_CONST, tl_tensor_clone(t), -1, -1);
+}
+
+TL_EXPORT int tl_graph_elew(tl_graph *g, int src1, int src2, tl_elew_op elew_op)
+{
+    const tl_tensor *t1 = node_at(g, src1)->t;
+    const tl_tensor *t2 = node_at(g, src2)->t;
+    int id;
+
+    assert(tl_tensor_issameshape(t1, t2));
+    assert(t1->dtype == t2->dtype);
+    id = add_node(g, NODE_ELEW, tl_tensor_create(NULL, t1->ndim, t1->dims, t1->dtype), src1,
+                  src2);
+    g->nodes[id].elew_op = elew_op;
+    return id;
+}
+
+TL_EXPORT int tl_graph_elew_param(tl_graph *g, int src, double param, tl_elew_op elew_op)
+{
+    const tl_tensor *t = node_at(g, src)->t;
+    struct node *n;
+    int id;
+
+    id = add_node(g, NODE_ELEW_PARAM, tl_tensor_create(NULL, t->ndim, t->dims, t->dtype), src,
+                  -1);
+    n = &g->nodes[id];
+    n->elew_op = elew_op;
+    tl_convert(&n->param, t->dtype, &param, TL_DOUBLE);
+    return id;
+}
+
+TL_EXPORT int tl_graph_lrelu(tl_graph *g, int src, float negslope)
+{
+    const tl_tensor *t = node_at(g, src)->t;
+    int id;
+
+    id = add_node(g, NODE_LRELU, tl_tensor_create(NULL, t->ndim, t->dims, t->dtype), src, -1);
+    g->nodes[id].negslope = negslope;
+    return id;
+}
+
+TL_EXPORT int tl_graph_convert(tl_graph *g, int src, tl_dtype dtype_d)
+{
+    const tl_tensor *t = node_at(g, src)->t;
+
+    return add_node(g, NODE_CONVERT, tl_tensor_create(NULL, t->ndim, t->dims, dtype_d), src, -1);
+}
+
+TL_EXPORT int tl_graph_maxreduce(tl_graph *g, int src, int axis)
+{
+    tl_shape shape;
+    int id;
+
+    tl_tensor_maxreduce_out_shape(node_at(g, src)->t, axis, &shape);
+    id = add_node(g, NODE_MAXREDUCE, tl_tensor_create_shape(NULL, &shape), src, -1);
+    g->nodes[id].axis = axis;
+    return id;
+}
+
+TL_EXPORT int tl_graph_matmul(tl_graph *g, int src1, int src2, int trans1, int trans2)
+{
+    tl_shape shape;
+    int id;
+
+    tl_tensor_matmul_out_shape(node_at(g, src1)->t, node_at(g, src2)->t, trans1, trans2, &shape);
+    id = add_node(g, NODE_MATMUL, tl_tensor_create_shape(NULL, &shape), src1, src2);
+    g->nodes[id].trans1 = trans1;
+    g->nodes[id].trans2 = trans2;
+    return id;
+}
+
+TL_EXPORT int tl_graph_transpose(tl_graph *g, int src, const int *axes)
+{
+    const tl_tensor *t = node_at(g, src)->t;
+    tl_shape shape;
+    int id;
+
+    tl_tensor_transpose_out_shape(t, axes, &shape);
+    id = add_node(g, NODE_TRANSPOSE, tl_tensor_create_shape(NULL, &shape), src, -1);
+    memmove(g->nodes[id].axes, axes, sizeof(int) * t->ndim);
+    return id;
+}
+
+TL_EXPORT int tl_graph_softmax(tl_graph *g, int src, int axis)
+{
+    const tl_tensor *t = node_at(g, src)->t;
+    int id;
+
+    assert(t->dtype == TL_FLOAT || t->dtype == TL_DOUBLE);
+    assert(axis < t->ndim && axis >= 0);
+    id = add_node(g, NODE_SOFTMAX, tl_tensor_create(NULL, t->ndim, t->dims, t->dtype), src, -1);
+    g->nodes[id].axis = axis;
+    return id;
+}
+
+/* Marks src as an output and returns its index for tl_graph_get_output().
+   Inputs, constants and nodes that already are outputs get a copy. */
+TL_EXPORT int tl_graph_output(tl_graph *g, int src)
+{
+    struct node *n = node_at(g, src);
+
+    assert(!g->compiled && "can't add outputs to a compiled graph");
+    if (n->kind == NODE_INPUT || n->kind == NODE_CONST || n->output >= 0)
+        src = tl_graph_convert(g, src, n->t->dtype);
+    g->outputs = grow(g->outputs, &g->cap_outputs, g->noutputs, sizeof(int));
+    g->nodes[src].output = g->noutputs;
+    g->outputs[g->noutputs] = src;
+    return g->noutputs++;
+}
+
+/* The shape and dtype of a node. Its data is only meaningful for constants
+   and outputs after a run. */
+TL_EXPORT const tl_tensor *tl_graph_tensor(const tl_graph *g, int id)
+{
+    return node_at(g, id)->t;
+}
+
+static int is_fusible(enum node_kind kind)
+{
+    return kind == NODE_ELEW || kind == NODE_ELEW_PARAM || kind == NODE_LRELU ||
+           kind == NODE_CONVERT;
+}
+
+static void step_push(struct step *s, int id)
+{
+    s->members = grow(s->members, &s->cap, s->nmembers, sizeof(int));
+    s->members[s->nmembers++] = id;
+}
+
+/* the group src's step can be extended by its consumer */
+static int can_extend(const tl_graph *g, const struct step *steps, const int *group, int src)
+{
+    const struct node *n = &g->nodes[src];
+
+    return is_fusible(n->kind) && n->uses == 1 && n->output < 0 &&
+           steps[group[src]].result == src && steps[group[src]].reduce < 0;
+}
+
+static int maxreduce_slab(const tl_tensor *t, int axis, int *outer, int *inner)
+{
+    int i;
+
+    for (i = axis + 1, *inner = 1; i < t->ndim; i++)
+        *inner *= t->dims[i];
+    for (i = 0, *outer = 1; i < axis; i++)
+        *outer *= t->dims[i];
+    return t->dims[axis] * *inner;
+}
+
+static int step_cmp(const void *a, const void *b)
+{
+    return ((const struct step *)a)->result - ((const struct step *)b)->result;
+}
+
+/* Groups the live nodes into steps. */
+static void plan_steps(tl_graph *g)
+{
+    struct step *steps;
+    int *group;
+    int i, j, k, nsteps, outer, inner;
+
+    steps = tl_alloc(sizeof(struct step) * g->nnodes);
+    group = tl_alloc(sizeof(int) * g->nnodes);
+    memset(steps, 0, sizeof(struct step) * g->nnodes);
+    for (i = 0, nsteps = 0; i < g->nnodes; i++) {
+        struct node *n = &g->nodes[i];
+        int joined = -1;
+
+        group[i] = -1;
+        if (n->uses < 0 || n->kind == NODE_INPUT || n->kind == NODE_CONST)
+            continue;
+
+        if (is_fusible(n->kind)) {
+            for (j = 0; j < n->nsrc; j++) {
+                int s = n->src[j];
+
+                if (!can_extend(g, steps, group, s) || group[s] == joined)
+                    continue;
+                if (joined < 0) {
+                    joined = group[s];
+                    continue;
+                }
+                /* both inputs end fused chains: merge them */
+                k = group[s];
+                for (int m = 0; m < steps[k].nmembers; m++) {
+                    step_push(&steps[joined], steps[k].members[m]);
+                    group[steps[k].members[m]] = joined;
+                }
+                tl_free(steps[k].members);
+                memset(&steps[k], 0, sizeof(struct step));
+                steps[k].result = -1;
+            }
+        } else if (n->kind == NODE_MAXREDUCE && can_extend(g, steps, group, n->src[0]) &&
+                   maxreduce_slab(g->nodes[n->src[0]].t, n->axis, &outer, &inner) <=
+                       GRAPH_MAX_SLAB) {
+            k = group[n->src[0]];
+            steps[k].reduce = i;
+            steps[k].result = i;
+            group[i] = k;
+            continue;
+        }
+
+        if (joined < 0) {
+            joined = nsteps++;
+            steps[joined].reduce = -1;
+            steps[joined].fused = is_fusible(n->kind);
+        }
+        step_push(&steps[joined], i);
+        steps[joined].result = i;
+        group[i] = joined;
+    }
+
+    /* drop the merged steps and order the rest by their results, which
+       keeps the topological order since all the members precede it */
+    for (i = 0, k = 0; i < nsteps; i++)
+        if (steps[i].result >= 0)
+            steps[k++] = steps[i];
+    qsort(steps, k, sizeof(struct step), step_cmp);
+    g->steps = steps;
+    g->nsteps = k;
+
+    for (i = 0; i < g->nsteps; i++) {
+        struct step *s = &g->steps[i];
+
+        for (j = 0; j < s->nmembers; j++) {
+            g->nodes[s->members[j]].step = i;
+            g->nodes[s->members[j]].slot = s->fused ? j : -1;
+        }
+        if (s->reduce >= 0)
+            g->nodes[s->reduce].step = i;
+    }
+    tl_free(group);
+}
+
+static void node_last_use(tl_graph *g, int step, int id)
+{
+    struct node *n = &g->nodes[id];
+
+    for (int j = 0; j < n->nsrc; j++) {
+        struct node *s = &g->nodes[n->src[j]];
+        if (s->step != step && s->last_use < step)
+            s->last_use = step;
+    }
+}
+
+static int alias_root(const tl_graph *g, int id)
+{
+    while (g->nodes[id].alias != id)
+        id = g->nodes[id].alias;
+    return id;
+}
+
+/* An elementwise step may write its result over an arena input of the same
+   element size that nothing reads after it. */
+static void plan_alias(tl_graph *g, int step)
+{
+    const struct step *s = &g->steps[step];
+    struct node *r = &g->nodes[s->result];
+
+    if (!s->fused || s->reduce >= 0 || r->storage != STORE_ARENA)
+        return;
+    for (int i = 0; i < s->nmembers; i++) {
+        const struct node *m = &g->nodes[s->members[i]];
+
+        for (int j = 0; j < m->nsrc; j++) {
+            const struct node *src = &g->nodes[m->src[j]];
+
+            if (src->step != step && src->storage == STORE_ARENA && src->last_use == step &&
+                tl_size_of(src->t->dtype) == tl_size_of(r->t->dtype)) {
+                r->alias = alias_root(g, m->src[j]);
+                return;
+            }
+        }
+    }
+}
+
+struct interval {
+    int id;
+    size_t size;
+    int start;
+    int end;
+};
+
+static int interval_cmp(const void *a, const void *b)
+{
+    const struct interval *ia = a, *ib = b;
+
+    if (ia->size != ib->size)
+        return ia->size < ib->size ? 1 : -1;
+    return ia->start - ib->start;
+}
+
+static size_t align_up(size_t n)
+{
+    return (n + GRAPH_ALIGN - 1) / GRAPH_ALIGN * GRAPH_ALIGN;
+}
+
+/* Places the alias sets in the arena, biggest first, each at the lowest
+   offset not overlapping a placed set that's live at the same time. */
+static void plan_arena(tl_graph *g)
+{
+    struct interval *iv;
+    int *index;
+    int i, j, n, moved;
+    size_t off;
+
+    iv = tl_alloc(sizeof(struct interval) * g->nnodes);
+    index = tl_alloc(sizeof(int) * g->nnodes);
+    for (i = 0, n = 0; i < g->nnodes; i++) {
+        struct node *nd = &g->nodes[i];
+        int r, end;
+
+        index[i] = -1;
+        if (nd->storage != STORE_ARENA)
+            continue;
+        r = alias_root(g, i);
+        if (index[r] < 0) {
+            index[r] = n;
+            iv[n].id = r;
+            iv[n].size = 0;
+            iv[n].start = nd->step;
+            iv[n].end = nd->step;
+            n++;
+        }
+        end = nd->last_use > nd->step ? nd->last_use : nd->step;
+        if (iv[index[r]].end < end)
+            iv[index[r]].end = end;
+        if (iv[index[r]].size < align_up(tl_size_of(nd->t->dtype) * nd->t->len))
+            iv[index[r]].size = align_up(tl_size_of(nd->t->dtype) * nd->t->len);
+    }
+    qsort(iv, n, sizeof(struct interval), interval_cmp);
+
+    g->arena_size = 0;
+    for (i = 0; i < n; i++) {
+        off = 0;
+        do {
+            moved = 0;
+            for (j = 0; j < i; j++) {
+                size_t o = g->nodes[iv[j].id].offset;
+
+                if (iv[j].end < iv[i].start || iv[i].end < iv[j].start)
+                    continue;
+                if (off < o + iv[j].size && o < off + iv[i].size) {
+                    off = o + iv[j].size;
+                    moved = 1;
+                }
+            }
+        } while (moved);
+        g->nodes[iv[i].id].offset = off;
+        if (g->arena_size < off + iv[i].size)
+            g->arena_size = off + iv[i].size;
+    }
+    tl_free(iv);
+    tl_free(index);
+}
+
+/* Splits every fused step into blocks and lays out the blocks of its
+   members in a scratch area. A run uses one area per parallel chunk, at most
+   as many as the threads at compile time. */
+static void plan_scratch(tl_graph *g)
+{
+    const struct node *root;
+    struct step *s;
+    size_t size;
+    int i, j, outer;
+
+    g->scratch_size = 0;
+    for (i = 0; i < g->nsteps; i++) {
+        s = &g->steps[i];
+        if (!s->fused)
+            continue;
+        root = &g->nodes[s->members[s->nmembers - 1]];
+        if (s->reduce >= 0) {
+            s->block = maxreduce_slab(root->t, g->nodes[s->reduce].axis, &outer, &s->inner);
+            s->nblocks = outer;
+        } else {
+            s->block = root->t->len < GRAPH_BLOCK ? root->t->len : GRAPH_BLOCK;
+            s->nblocks = (root->t->len + s->block - 1) / s->block;
+        }
+        s->scratch_off = tl_alloc(sizeof(size_t) * s->nmembers);
+        for (j = 0, size = 0; j < s->nmembers; j++) {
+            s->scratch_off[j] = size;
+            if (j < s->nmembers - 1 || s->reduce >= 0)
+                size += align_up(tl_size_of(g->nodes[s->members[j]].t->dtype) * s->block);
+        }
+        if (size > g->scratch_size)
+            g->scratch_size = size;
+    }
+    g->nscratch = tl_get_num_threads();
+}
+
+/* Fuses the graph into steps and plans the memory of its temporaries. Only
+   the nodes the outputs depend on are computed. */
+TL_EXPORT void tl_graph_compile(tl_graph *g)
+{
+    int i, j;
+
+    TL_PROFILE_OP();
+
+    assert(!g->compiled && "graph already compiled");
+    assert(g->noutputs > 0);
+
+    /* count the uses by live nodes, going back from the outputs */
+    for (i = 0; i < g->nnodes; i++) {
+        g->nodes[i].uses = -1;
+        g->nodes[i].step = -1;
+        g->nodes[i].slot = -1;
+        g->nodes[i].last_use = -1;
+        g->nodes[i].alias = i;
+    }
+    for (i = 0; i < g->noutputs; i++)
+        g->nodes[g->outputs[i]].uses = 0;
+    for (i = g->nnodes - 1; i >= 0; i--) {
+        struct node *n = &g->nodes[i];
+        if (n->uses < 0)
+            continue;
+        for (j = 0; j < n->nsrc; j++) {
+            struct node *s = &g->nodes[n->src[j]];
+            s->uses = s->uses < 0 ? 1 : s->uses + 1;
+        }
+    }
+
+    plan_steps(g);
+
+    for (i = 0; i < g->nsteps; i++) {
+        const struct step *s = &g->steps[i];
+
+        for (j = 0; j < s->nmembers; j++)
+            node_last_use(g, i, s->members[j]);
+        if (s->reduce >= 0)
+            node_last_use(g, i, s->reduce);
+    }
+
+    for (i = 0; i < g->nnodes; i++) {
+        struct node *n = &g->nodes[i];
+
+        if (n->kind == NODE_INPUT)
+            n->storage = STORE_INPUT;
+        else if (n->kind == NODE_CONST)
+            n->storage = STORE_CONST;
+        else if (n->step < 0 || g->steps[n->step].result != i)
+            n->storage = STORE_NONE;
+        else if (n->output >= 0)
+            n->storage = STORE_OUTPUT;
+        else
+            n->storage = STORE_ARENA;
+    }
+
+    for (i = 0; i < g->nsteps; i++)
+        plan_alias(g, i);
+    plan_arena(g);
+    plan_scratch(g);
+
+    g->arena = g->arena_size ? tl_alloc(g->arena_size) : NULL;
+    g->scratch = g->scratch_size ? tl_alloc(g->scratch_size * g->nscratch) : NULL;
+    for (i = 0; i < g->nnodes; i++) {
+        struct node *n = &g->nodes[i];
+
+        if (n->storage == STORE_OUTPUT)
+            n->t->data = tl_alloc(tl_size_of(n->t->dtype) * n->t->len);
+        else if (n->storage == STORE_ARENA)
+            n->t->data = (char *)g->arena + g->nodes[alias_root(g, i)].offset;
+    }
+    g->compiled = 1;
+}
+
+struct fused_info {
+    const tl_graph *g;
+    const struct step *s;
+    int nchunks;
+};
+
+/* blocks [start, end) of s with the member blocks in scratch */
+static void fused_blocks(const tl_graph *g, const struct step *s, int start, int end,
+                         void *scratch)
+{
+    const struct node *root = &g->nodes[s->members[s->nmembers - 1]];
+    const struct node *m, *src;
+    const void *p[2];
+    void *d;
+    int b, i, j, n;
+    size_t off;
+
+    for (b = start; b < end; b++) {
+        off = (size_t)b * s->block;
+        n = root->t->len - off < (size_t)s->block ? root->t->len - off : s->block;
+        for (i = 0; i < s->nmembers; i++) {
+            m = &g->nodes[s->members[i]];
+            if (m == root && s->reduce < 0)
+                d = tl_padd(m->t->data, off, tl_size_of(m->t->dtype));
+            else
+                d = (char *)scratch + s->scratch_off[i];
+            for (j = 0; j < m->nsrc; j++) {
+                src = &g->nodes[m->src[j]];
+                if (src->step == m->step)
+                    p[j] = (char *)scratch + s->scratch_off[src->slot];
+                else
+                    p[j] = tl_padd(src->t->data, off, tl_size_of(src->t->dtype));
+            }
+            switch (m->kind) {
+            case NODE_ELEW:
+                tl_elew_n(p[0], p[1], d, n, m->elew_op, m->t->dtype);
+                break;
+            case NODE_ELEW_PARAM:
+                tl_elew_scalar_n(p[0], &m->param, d, n, m->elew_op, m->t->dtype);
+                break;
+            case NODE_LRELU:
+                tl_lrelu_n(d, p[0], m->negslope, n, m->t->dtype);
+                break;
+            case NODE_CONVERT:
+                tl_convert_n(d, m->t->dtype, p[0], g->nodes[m->src[0]].t->dtype, n);
+                break;
+            default:
+                assert(0 && "unfusible node");
+                break;
+            }
+        }
+        if (s->reduce >= 0) {
+            m = &g->nodes[s->reduce];
+            tl_get_kernels()->maxreduce[root->t->dtype](
+                (char *)scratch + s->scratch_off[s->nmembers - 1],
+                tl_padd(m->t->data, (size_t)b * s->inner, tl_size_of(m->t->dtype)), NULL, 1,
+                root->t->dims[m->axis], s->inner);
+        }
+    }
+}
+
+/* chunk c runs its share of the blocks in the c-th scratch area, so no two
+   threads share one */
+static void fused_worker(void *arg, int start, int end)
+{
+    const struct fused_info *info = arg;
+    const tl_graph *g = info->g;
+    const struct step *s = info->s;
+    int c;
+
+    for (c = start; c < end; c++)
+        fused_blocks(g, s, (int64_t)s->nblocks * c / info->nchunks,
+                     (int64_t)s->nblocks * (c + 1) / info->nchunks,
+                     (char *)g->scratch + g->scratch_size * c);
+}
+
+static void run_fused(const tl_graph *g, const struct step *s)
+{
+    struct fused_info info;
+
+    info.g = g;
+    info.s = s;
+    info.nchunks =
+        tl_parallel_max_chunks(s->nblocks, (GRAPH_GRAIN + s->block - 1) / s->block);
+    if (info.nchunks > g->nscratch)
+        info.nchunks = g->nscratch;
+    if (info.nchunks > 1)
+        tl_parallel_for(info.nchunks, 1, fused_worker, &info);
+    else
+        fused_worker(&info, 0, 1);
+}
+
+static void run_single(const tl_graph *g, const struct node *n)
+{
+    const tl_tensor *t1 = g->nodes[n->src[0]].t;
+
+    switch (n->kind) {
+    case NODE_MAXREDUCE:
+        tl_tensor_maxreduce(t1, n->t, NULL, n->axis);
+        break;
+    case NODE_MATMUL:
+        tl_tensor_matmul(t1, g->nodes[n->src[1]].t, n->t, n->trans1, n->trans2);
+        break;
+    case NODE_TRANSPOSE:
+        tl_tensor_transpose(t1, n->t, n->axes);
+        break;
+    case NODE_SOFTMAX:
+        tl_tensor_softmax(t1, n->t, n->axis);
+        break;
+    default:
+        assert(0 && "unsupported node");
+        break;
+    }
+}
+
+/* inputs[i] is the data of the i-th tl_graph_input(), with the same shape
+   and dtype. */
+TL_EXPORT void tl_graph_run(tl_graph *g, const tl_tensor **inputs)
+{
+    int i;
+
+    TL_PROFILE_OP();
+
+    assert(g->compiled && "graph not compiled");
+    assert(g->ninputs == 0 || inputs);
+    for (i = 0; i < g->ninputs; i++) {
+        tl_tensor *t = g->nodes[g->inputs[i]].t;
+
+        assert(inputs[i] && inputs[i]->data);
+        assert(tl_tensor_issameshape(inputs[i], t));
+        assert(inputs[i]->dtype == t->dtype);
+        t->data = inputs[i]->data;
+    }
+
+    for (i = 0; i < g->nsteps; i++) {
+        const struct step *s = &g->steps[i];
+
+        if (s->fused)
+            run_fused(g, s);
+        else
+            run_single(g, &g->nodes[s->members[0]]);
+    }
+}
+
+/* The index-th output, owned by the graph and overwritten by the next run. */
+TL_EXPORT tl_tensor *tl_graph_get_output(const tl_graph *g, int index)
+{
+    assert(g->compiled && "graph not compiled");
+    assert(index >= 0 && index < g->noutputs);
+    return g->nodes[g->outputs[index]].t;
+}
+
+TL_EXPORT int tl_graph_num_steps(const tl_graph *g)
+{
+    assert(g->compiled && "graph not compiled");
+    return g->nsteps;
+}
+
+TL_EXPORT size_t tl_graph_arena_size(const tl_graph *g)
+{
+    assert(g->compiled && "graph not compiled");
+    return g->arena_size;
+}
+
+static void fprint_node(FILE *stream, const tl_graph *g, int id)
+{
+    const struct node *n = &g->nodes[id];
+
+    fprintf(stream, " %%%d=%s(", id, node_kind_names[n->kind]);
+    for (int j = 0; j < n->nsrc; j++)
+        fprintf(stream, "%s%%%d", j ? "," : "", n->src[j]);
+    fprintf(stream, ")");
+}
+
+TL_EXPORT void tl_graph_fprint_plan(FILE *stream, const tl_graph *g)
+{
+    const struct step *s;
+    const struct node *r;
+    int i, j;
+
+    assert(g->compiled && "graph not compiled");
+    for (i = 0; i < g->nsteps; i++) {
+        s = &g->steps[i];
+        r = &g->nodes[s->result];
+        fprintf(stream, "step %d:", i);
+        for (j = 0; j < s->nmembers; j++)
+            fprint_node(stream, g, s->members[j]);
+        if (s->reduce >= 0)
+            fprint_node(stream, g, s->reduce);
+        fprintf(stream, " -> [");
+        for (j = 0; j < r->t->ndim; j++)
+            fprintf(stream, "%s%d", j ? ", " : "", r->t->dims[j]);
+        fprintf(stream, "] %s ", tl_dtype_name(r->t->dtype));
+        if (r->storage == STORE_OUTPUT)
+            fprintf(stream, "output %d\n", r->output);
+        else
+            fprintf(stream, "arena+%zu\n", g->nodes[alias_root(g, s->result)].offset);
+    }
+    fprintf(stream, "arena: %zu bytes\n", g->arena_size);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_GRAPH_H_
+#define _TL_GRAPH_H_
+
+#include <stdio.h>
+
+#include "tl_tensor.h"
+
+/* Lazy graph mode. Ops are recorded on symbolic tensors, referred to by the
+   ids the tl_graph_* builders return, and run only after tl_graph_compile():
+   - chains of elementwise ops (elew, elew_param, lrelu, convert) of the same
+     shape are fused and run block by block in cache, without materializing
+     their intermediate results; a maxreduce consuming such a chain is fused
+     into it too;
+   - the remaining temporaries are placed in one arena by their liveness,
+     reusing memory across steps, and in place where an elementwise step can
+     overwrite an input it's the last reader of;
+   - tl_graph_run() then executes the plan as many times as needed with new
+     input data, without allocating anything for the temporaries.
+   Input data is read in place, never written. Outputs are owned by the
+   graph and overwritten by the next run. */
+
+typedef struct tl_graph tl_graph;
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+tl_graph *tl_graph_create(void);
+void tl_graph_free(tl_graph *g);
+int tl_graph_input(tl_graph *g, int ndim, const int *dims, tl_dtype dtype);
+int tl_graph_const(tl_graph *g, const tl_tensor *t);
+int tl_graph_elew(tl_graph *g, int src1, int src2, tl_elew_op elew_op);
+int tl_graph_elew_param(tl_graph *g, int src, double param, tl_elew_op elew_op);
+int tl_graph_lrelu(tl_graph *g, int src, float negslope);
+int tl_graph_convert(tl_graph *g, int src, tl_dtype dtype_d);
+int tl_graph_maxreduce(tl_graph *g, int src, int axis);
+int tl_graph_matmul(tl_graph *g, int src1, int src2, int trans1, int trans2);
+int tl_graph_transpose(tl_graph *g, int src, const int *axes);
+int tl_graph_softmax(tl_graph *g, int src, int axis);
+int tl_graph_output(tl_graph *g, int src);
+const tl_tensor *tl_graph_tensor(const tl_graph *g, int id);
+void tl_graph_compile(tl_graph *g);
+void tl_graph_run(tl_graph *g, const tl_tensor **inputs);
+tl_tensor *tl_graph_get_output(const tl_graph *g, int index);
+int tl_graph_num_steps(const tl_graph *g);
+size_t tl_graph_arena_size(const tl_graph *g);
+void tl_graph_fprint_plan(FILE *stream, const tl_graph *g);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_GRAPH_H_ */
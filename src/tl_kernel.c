@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tl_util.h"
+#include "tl_type.h"
+#include "tl_type_generic.h"
+#include "tl_kernel.h"
+
+#define TL_KERNEL_TILE 32
+#define TL_KERNEL_HALF_BLOCK 256
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TL_KERNEL_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define TL_KERNEL_NEON
+#endif
+
+/* portable C as the build flags compile it */
+#define KERNEL_NAME(x) x##_generic
+#include "tl_kernel_impl.h"
+#undef KERNEL_NAME
+
+/* The variants below let the vectorizer loose: -O2 in GCC only vectorizes
+   loops that need no runtime checks, which misses almost every loop here.
+   The pragmas are spelled out because GCC ignores target() given via
+   _Pragma in a macro. Contracting a * b + c into an FMA is off, so that the
+   float loops round the same in every variant; ignoring floating point
+   exception flags lets float compares become vector selects. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("tree-vectorize", "vect-cost-model=dynamic", "fp-contract=off",              \
+                     "no-trapping-math")
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+#ifdef TL_KERNEL_X86
+#define KERNEL_NAME(x) x##_sse2
+#include "tl_kernel_impl.h"
+#undef KERNEL_NAME
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx2,fma,f16c"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma,f16c")
+#endif
+#define KERNEL_F16C
+#define KERNEL_NAME(x) x##_avx2
+#include "tl_kernel_impl.h"
+#undef KERNEL_NAME
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,f16c"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512dq,avx512vl,f16c")
+#endif
+#define KERNEL_NAME(x) x##_avx512
+#include "tl_kernel_impl.h"
+#undef KERNEL_NAME
+#undef KERNEL_F16C
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif /* TL_KERNEL_X86 */
+
+#ifdef TL_KERNEL_NEON
+#define KERNEL_NAME(x) x##_neon
+#include "tl_kernel_impl.h"
+#undef KERNEL_NAME
+#endif /* TL_KERNEL_NEON */
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+static const struct tl_kernels *kernels_table[TL_CPU_LEVEL_SIZE] = {
+    [TL_CPU_GENERIC] = &kernels_generic,
+#ifdef TL_KERNEL_X86
+    [TL_CPU_SSE2] = &kernels_sse2,
+    [TL_CPU_AVX2] = &kernels_avx2,
+    [TL_CPU_AVX512] = &kernels_avx512,
+#endif
+#ifdef TL_KERNEL_NEON
+    [TL_CPU_NEON] = &kernels_neon,
+#endif
+};
+
+/* read and written with atomics, since the first op of every thread may
+   race to pick the default level */
+static tl_cpu_level cpu_level = TL_CPU_LEVEL_INVALID;
+
+#ifdef TL_KERNEL_X86
+/* __builtin_cpu_supports doesn't know F16C on every compiler */
+static int cpu_has_f16c(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C);
+}
+#endif
+
+TL_EXPORT int tl_cpu_level_supported(tl_cpu_level level)
+{
+    tl_check_cpu_level(level);
+    if (!kernels_table[level])
+        return 0;
+#ifdef TL_KERNEL_X86
+    __builtin_cpu_init();
+    if (level == TL_CPU_AVX2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && cpu_has_f16c();
+    if (level == TL_CPU_AVX512)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl") &&
+               cpu_has_f16c();
+#endif
+    return 1;
+}
+
+static tl_cpu_level best_cpu_level(void)
+{
+    static const tl_cpu_level order[] = { TL_CPU_AVX512, TL_CPU_AVX2, TL_CPU_SSE2, TL_CPU_NEON };
+    size_t i;
+
+    for (i = 0; i < sizeof(order) / sizeof(order[0]); i++)
+        if (tl_cpu_level_supported(order[i]))
+            return order[i];
+    return TL_CPU_GENERIC;
+}
+
+/* TL_CPU_LEVEL takes "avx2" as well as "TL_CPU_AVX2" */
+static tl_cpu_level env_cpu_level(void)
+{
+    char buf[32] = "TL_CPU_";
+    const char *env;
+    size_t i, len;
+
+    env = getenv("TL_CPU_LEVEL");
+    if (!env || !*env)
+        return TL_CPU_LEVEL_INVALID;
+    len = strlen(buf);
+    if (!strncmp(env, buf, len) || !strncmp(env, "tl_cpu_", len))
+        env += len;
+    for (i = 0; env[i] && len + i < sizeof(buf) - 1; i++)
+        buf[len + i] = toupper((unsigned char)env[i]);
+    buf[len + i] = '\0';
+    return tl_cpu_level_from_str(buf);
+}
+
+static tl_cpu_level check_cpu_level(tl_cpu_level level)
+{
+    if (level < 0)
+        level = env_cpu_level();
+    if (level < 0 || level >= TL_CPU_LEVEL_SIZE || !tl_cpu_level_supported(level)) {
+        if (level >= 0 && level < TL_CPU_LEVEL_SIZE)
+            tl_warn_msg("tl_set_cpu_level: %s is not supported on this CPU, using %s",
+                        tl_cpu_level_name(level), tl_cpu_level_name(best_cpu_level()));
+        level = best_cpu_level();
+    }
+    return level;
+}
+
+TL_EXPORT void tl_set_cpu_level(tl_cpu_level level)
+{
+    __atomic_store_n(&cpu_level, check_cpu_level(level), __ATOMIC_RELEASE);
+}
+
+TL_EXPORT tl_cpu_level tl_get_cpu_level(void)
+{
+    tl_cpu_level level, unset;
+
+    level = __atomic_load_n(&cpu_level, __ATOMIC_ACQUIRE);
+    if (level >= 0)
+        return level;
+    /* only install the default if no one has set a level meanwhile */
+    level = check_cpu_level(TL_CPU_LEVEL_INVALID);
+    unset = TL_CPU_LEVEL_INVALID;
+    if (!__atomic_compare_exchange_n(&cpu_level, &unset, level, 0, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE))
+        level = unset;
+    return level;
+}
+
+const struct tl_kernels *tl_get_kernels(void)
+{
+    return kernels_table[tl_get_cpu_level()];
+}
+
+void tl_convert_n(void *pd, tl_dtype dtype_d, const void *ps, tl_dtype dtype_s, size_t n)
+{
+    tl_check_dtype(dtype_d);
+    tl_check_dtype(dtype_s);
+    tl_get_kernels()->convert_n[dtype_d][dtype_s](pd, ps, n);
+}
+
+void tl_elew_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+               tl_dtype dtype)
+{
+    tl_check_dtype(dtype);
+    tl_check_elew_op(elew_op);
+    tl_get_kernels()->elew_n[dtype](p1, p2, res, n, elew_op);
+}
+
+void tl_elew_scalar_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+                      tl_dtype dtype)
+{
+    tl_check_dtype(dtype);
+    tl_check_elew_op(elew_op);
+    tl_get_kernels()->elew_scalar_n[dtype](p1, p2, res, n, elew_op);
+}
+
+void tl_lrelu_n(void *pd, const void *ps, float negslope, size_t n, tl_dtype dtype)
+{
+    tl_check_dtype(dtype);
+    tl_get_kernels()->lrelu_n[dtype](pd, ps, negslope, n);
+}
+
+void tl_quantize_n(void *pd, tl_dtype dtype_d, const float *ps, const float *inv_scale,
+                   const int32_t *zero, size_t n, int per_elem)
+{
+    tl_check_dtype(dtype_d);
+    assert(tl_get_kernels()->quantize_n[dtype_d] && "not a quantized dtype");
+    tl_get_kernels()->quantize_n[dtype_d](pd, ps, inv_scale, zero, n, per_elem);
+}
+
+void tl_dequantize_n(float *pd, const void *ps, tl_dtype dtype_s, const float *scale,
+                     const int32_t *zero, size_t n, int per_elem)
+{
+    tl_check_dtype(dtype_s);
+    assert(tl_get_kernels()->dequantize_n[dtype_s] && "not a quantized dtype");
+    tl_get_kernels()->dequantize_n[dtype_s](pd, ps, scale, zero, n, per_elem);
+}
+
+void tl_qelew_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+                const struct tl_qparam *qp, tl_dtype dtype)
+{
+    tl_check_dtype(dtype);
+    assert(elew_op == TL_SUM || elew_op == TL_MUL);
+    assert(tl_get_kernels()->qelew_n[dtype] && "not a quantized dtype");
+    tl_get_kernels()->qelew_n[dtype](p1, p2, res, n, elew_op, qp);
+}
+
+void tl_qlrelu_n(void *pd, const void *ps, size_t n, const struct tl_qparam *qp, tl_dtype dtype)
+{
+    tl_check_dtype(dtype);
+    assert(tl_get_kernels()->qlrelu_n[dtype] && "not a quantized dtype");
+    tl_get_kernels()->qlrelu_n[dtype](pd, ps, n, qp);
+}
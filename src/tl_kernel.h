@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_KERNEL_H_
+#define _TL_KERNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tl_type.h"
+
+/* Element loops compiled once per instruction set. tl_kernel.c builds one
+   struct tl_kernels per variant from tl_kernel_impl.h; the variant is
+   picked at first use from the host CPU, or from the TL_CPU_LEVEL
+   environment variable (e.g. TL_CPU_LEVEL=sse2), and can be changed with
+   tl_set_cpu_level(). Loops that only move data are indexed by the log2
+   of the element size instead of by dtype. TL_FLOAT16 and TL_BFLOAT16 are
+   storage-only: their loops convert blocks to float (with F16C where the
+   variant has it), compute in float and round back once per element. */
+
+/* Requantization constants of the quantized element loops, which only exist
+   for TL_INT8 and TL_UINT8. With scales s1, s2 and sd, a sum is
+   zd + m1 * (q1 - z1) + m2 * (q2 - z2) with m1 = s1 / sd and m2 = s2 / sd, a
+   product is zd + m1 * (q1 - z1) * (q2 - z2) with m1 = s1 * s2 / sd, and
+   lrelu is zd + m * (q1 - z1), where m is m1 = s1 / sd for q1 >= z1 and
+   m2 = negslope * s1 / sd otherwise. Results are rounded half to even and
+   saturated. */
+struct tl_qparam {
+    float m1, m2;
+    int32_t z1, z2, zd;
+};
+
+struct tl_kernels {
+    void (*elew_n[TL_DTYPE_SIZE])(const void *p1, const void *p2, void *res, size_t n,
+                                  tl_elew_op elew_op);
+    void (*elew_scalar_n[TL_DTYPE_SIZE])(const void *p1, const void *p2, void *res, size_t n,
+                                         tl_elew_op elew_op);
+    void (*convert_n[TL_DTYPE_SIZE][TL_DTYPE_SIZE])(void *pd, const void *ps, size_t n);
+    void (*lrelu_n[TL_DTYPE_SIZE])(void *pd, const void *ps, float negslope, size_t n);
+    /* max over the middle axis of src[outer][dim_size][inner]; arg may be NULL */
+    void (*maxreduce[TL_DTYPE_SIZE])(const void *src, void *dst, int32_t *arg, int outer,
+                                     int dim_size, int inner);
+    /* d[i] = start + step * (first + i) for i in [0, n), computed in double */
+    void (*arange_n[TL_DTYPE_SIZE])(void *pd, double start, double step, int first, int n);
+    /* dst[i] = src[idx[i]] for i in [0, n) */
+    void (*gather[4])(void *dst, const void *src, const int *idx, int n);
+    /* dst[i] = *value for i in [0, n) */
+    void (*fill[4])(void *dst, const void *value, size_t n);
+    /* byte b of element i of src[n] to dst[b * n + i], and back */
+    void (*shuffle[4])(void *dst, const void *src, size_t n);
+    void (*unshuffle[4])(void *dst, const void *src, size_t n);
+    /* dst[r][c] = src[r * rs + c * cs] for a contiguous dst[rows][cols] */
+    void (*transpose2d[4])(void *dst, const void *src, int rows, int cols, ptrdiff_t rs,
+                           ptrdiff_t cs);
+    /* q = round(x * inv_scale + zero) and x = (q - zero) * scale, where
+       inv_scale/scale and zero are n arrays if per_elem is set, or else
+       single values; NULL for the dtypes that can't be quantized */
+    void (*quantize_n[TL_DTYPE_SIZE])(void *pd, const float *ps, const float *inv_scale,
+                                      const int32_t *zero, size_t n, int per_elem);
+    void (*dequantize_n[TL_DTYPE_SIZE])(float *pd, const void *ps, const float *scale,
+                                        const int32_t *zero, size_t n, int per_elem);
+    /* elew_op is TL_SUM or TL_MUL */
+    void (*qelew_n[TL_DTYPE_SIZE])(const void *p1, const void *p2, void *res, size_t n,
+                                   tl_elew_op elew_op, const struct tl_qparam *qp);
+    void (*qlrelu_n[TL_DTYPE_SIZE])(void *pd, const void *ps, size_t n,
+                                    const struct tl_qparam *qp);
+    /* n Philox4x32-10 blocks of 4 words for counters [counter, counter + n) */
+    void (*philox_n)(uint32_t *dst, uint64_t key, uint64_t counter, size_t n);
+    /* bit k of bytes 8 * i to 8 * i + 7 of src[n] to byte k * (n / 8) + i
+       of dst, the last n % 8 bytes as they are; bit_untranspose undoes it */
+    void (*bit_transpose)(void *dst, const void *src, size_t n);
+    void (*bit_untranspose)(void *dst, const void *src, size_t n);
+};
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+const struct tl_kernels *tl_get_kernels(void);
+
+void tl_convert_n(void *pd, tl_dtype dtype_d, const void *ps, tl_dtype dtype_s, size_t n);
+void tl_elew_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+               tl_dtype dtype);
+/* same as tl_elew_n, but p2 points to a single element applied to all of p1 */
+void tl_elew_scalar_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+                      tl_dtype dtype);
+void tl_lrelu_n(void *pd, const void *ps, float negslope, size_t n, tl_dtype dtype);
+void tl_quantize_n(void *pd, tl_dtype dtype_d, const float *ps, const float *inv_scale,
+                   const int32_t *zero, size_t n, int per_elem);
+void tl_dequantize_n(float *pd, const void *ps, tl_dtype dtype_s, const float *scale,
+                     const int32_t *zero, size_t n, int per_elem);
+void tl_qelew_n(const void *p1, const void *p2, void *res, size_t n, tl_elew_op elew_op,
+                const struct tl_qparam *qp, tl_dtype dtype);
+void tl_qlrelu_n(void *pd, const void *ps, size_t n, const struct tl_qparam *qp, tl_dtype dtype);
+
+/* index into the size-based kernel tables */
+static inline int tl_size_index(size_t dsize)
+{
+    return dsize == 1 ? 0 : dsize == 2 ? 1 : dsize == 4 ? 2 : 3;
+}
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_KERNEL_H_ */
@@ -0,0 +1,804 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Kernel template, included by tl_kernel.c once per instruction set with
+   KERNEL_NAME(x) (name mangler) defined. It defines the static table
+   KERNEL_NAME(kernels). */
+
+/* One loop per (dtype, op); A(i) and B(i) are the operands of element i,
+   so the same body serves tensor-tensor and tensor-scalar ops. */
+#define ELEW_LOOPS(type, kind, lo, hi, A, B)                                                       \
+    switch (elew_op) {                                                                             \
+    case TL_MUL:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_WRAP_##kind(type, A(i) * B(i));                                              \
+        break;                                                                                     \
+    case TL_DIV:                                                                                   \
+        for (i = 0; i < n; i++) {                                                                  \
+            assert(B(i));                                                                          \
+            r[i] = TL_WRAP_##kind(type, A(i) / B(i));                                              \
+        }                                                                                          \
+        break;                                                                                     \
+    case TL_SUM:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_WRAP_##kind(type, A(i) + B(i));                                              \
+        break;                                                                                     \
+    case TL_SUB:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_WRAP_##kind(type, A(i) - B(i));                                              \
+        break;                                                                                     \
+    case TL_MAX:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_GENERIC_MAX(A(i), B(i));                                                     \
+        break;                                                                                     \
+    case TL_MIN:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_GENERIC_MIN(A(i), B(i));                                                     \
+        break;                                                                                     \
+    case TL_POW:                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            r[i] = TL_POW_##kind(type, lo, hi, A(i), B(i));                                        \
+        break;                                                                                     \
+    default:                                                                                       \
+        assert(0 && "unsupported tl_elew_op");                                                     \
+        break;                                                                                     \
+    }
+
+#define ARRAY_ELEM(i) a[i]
+#define ARRAY_ELEM2(i) b[i]
+#define SCALAR_ELEM(i) s
+
+#define ELEW_FUNC(dtype, type, name, kind, lo, hi)                                                 \
+    static void KERNEL_NAME(elew_n_##name)(const void *p1, const void *p2, void *res, size_t n,    \
+                                           tl_elew_op elew_op)                                     \
+    {                                                                                              \
+        const type *a = p1;                                                                        \
+        const type *b = p2;                                                                        \
+        type *r = res;                                                                             \
+        size_t i;                                                                                  \
+        ELEW_LOOPS(type, kind, lo, hi, ARRAY_ELEM, ARRAY_ELEM2)                                    \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(elew_scalar_n_##name)(const void *p1, const void *p2, void *res,       \
+                                                  size_t n, tl_elew_op elew_op)                    \
+    {                                                                                              \
+        const type *a = p1;                                                                        \
+        const type s = *(const type *)p2;                                                          \
+        type *r = res;                                                                             \
+        size_t i;                                                                                  \
+        ELEW_LOOPS(type, kind, lo, hi, ARRAY_ELEM, SCALAR_ELEM)                                    \
+    }
+TL_FOREACH_DTYPE(ELEW_FUNC)
+#undef ELEW_FUNC
+#undef ARRAY_ELEM
+#undef ARRAY_ELEM2
+#undef SCALAR_ELEM
+#undef ELEW_LOOPS
+
+#define LRELU_FUNC(dtype, type, name, kind, lo, hi)                                                \
+    static void KERNEL_NAME(lrelu_n_##name)(void *pd, const void *ps, float negslope, size_t n)    \
+    {                                                                                              \
+        const type *s = ps;                                                                        \
+        type *d = pd;                                                                              \
+        const type ns = (type)negslope;                                                            \
+        size_t i;                                                                                  \
+                                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            d[i] = s[i] >= 0 ? s[i] : s[i] * ns;                                                   \
+    }
+TL_FOREACH_DTYPE(LRELU_FUNC)
+#undef LRELU_FUNC
+
+#define CONVERT_FUNC(dtype_d, type_d, name_d, kind_d, lo_d, hi_d, dtype_s, type_s, name_s, kind_s, \
+                     lo_s, hi_s)                                                                   \
+    static void KERNEL_NAME(convert_n_##name_d##_##name_s)(void *pd, const void *ps, size_t n)     \
+    {                                                                                              \
+        const type_s *s = ps;                                                                      \
+        type_d *d = pd;                                                                            \
+        size_t i;                                                                                  \
+                                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            d[i] = TL_SAT(kind_d, kind_s, type_d, lo_d, hi_d, type_s, s[i]);                       \
+    }
+TL_FOREACH_DTYPE_PAIR(CONVERT_FUNC)
+#undef CONVERT_FUNC
+
+/* Rows of src are compared element-wise so that the inner loop runs over
+   contiguous memory; the first maximum wins. */
+#define MAXREDUCE_FUNC(dtype, type, name, kind, lo, hi)                                            \
+    static void KERNEL_NAME(maxreduce_##name)(const void *src, void *dst, int32_t *arg,            \
+                                              int outer, int dim_size, int inner)                  \
+    {                                                                                              \
+        const type *s;                                                                             \
+        type *d;                                                                                   \
+        int32_t *a;                                                                                \
+        int o, i, j, maxi;                                                                         \
+                                                                                                   \
+        for (o = 0; o < outer; o++) {                                                              \
+            s = (const type *)src + (size_t)o * dim_size * inner;                                  \
+            d = (type *)dst + (size_t)o * inner;                                                   \
+            a = arg ? arg + (size_t)o * inner : NULL;                                              \
+            if (inner == 1) {                                                                      \
+                type max = s[0];                                                                   \
+                for (i = 1, maxi = 0; i < dim_size; i++) {                                         \
+                    if (s[i] > max) {                                                              \
+                        max = s[i];                                                                \
+                        maxi = i;                                                                  \
+                    }                                                                              \
+                }                                                                                  \
+                d[0] = max;                                                                        \
+                if (a)                                                                             \
+                    a[0] = maxi;                                                                   \
+                continue;                                                                          \
+            }                                                                                      \
+            for (j = 0; j < inner; j++)                                                            \
+                d[j] = s[j];                                                                       \
+            if (a) {                                                                               \
+                for (j = 0; j < inner; j++)                                                        \
+                    a[j] = 0;                                                                      \
+                for (i = 1; i < dim_size; i++) {                                                   \
+                    const type *row = s + (size_t)i * inner;                                       \
+                    for (j = 0; j < inner; j++) {                                                  \
+                        int gt = row[j] > d[j];                                                    \
+                        d[j] = gt ? row[j] : d[j];                                                 \
+                        a[j] = gt ? i : a[j];                                                      \
+                    }                                                                              \
+                }                                                                                  \
+            } else {                                                                               \
+                for (i = 1; i < dim_size; i++) {                                                   \
+                    const type *row = s + (size_t)i * inner;                                       \
+                    for (j = 0; j < inner; j++)                                                    \
+                        d[j] = row[j] > d[j] ? row[j] : d[j];                                      \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }
+TL_FOREACH_DTYPE(MAXREDUCE_FUNC)
+#undef MAXREDUCE_FUNC
+
+/* Bulk conversions between the 16-bit float dtypes and float. binary16 has
+   an instruction for it (F16C); bfloat16 is a shift or a rounding add, which
+   the vectorizer takes care of. */
+static void KERNEL_NAME(up_float16)(float *d, const uint16_t *s, size_t n)
+{
+    size_t i = 0;
+
+#ifdef KERNEL_F16C
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(d + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(s + i))));
+#endif
+    for (; i < n; i++)
+        d[i] = tl_f16_to_f32(s[i]);
+}
+
+static void KERNEL_NAME(down_float16)(uint16_t *d, const float *s, size_t n)
+{
+    size_t i = 0;
+
+#ifdef KERNEL_F16C
+    const __m256 hi = _mm256_set1_ps(TL_FLOAT16_MAX);
+    const __m256 lo = _mm256_set1_ps(-TL_FLOAT16_MAX);
+    __m256 v;
+
+    for (; i + 8 <= n; i += 8) {
+        /* saturate first; min/max return their second operand for NaNs */
+        v = _mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(s + i)));
+        _mm_storeu_si128((__m128i *)(d + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; i < n; i++)
+        d[i] = tl_f32_to_f16(s[i]);
+}
+
+static void KERNEL_NAME(up_bfloat16)(float *d, const uint16_t *s, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        d[i] = tl_bf16_to_f32(s[i]);
+}
+
+static void KERNEL_NAME(down_bfloat16)(uint16_t *d, const float *s, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        d[i] = tl_f32_to_bf16(s[i]);
+}
+
+/* The 16-bit float dtypes are computed in float, TL_KERNEL_HALF_BLOCK
+   elements at a time, so the float copies stay in L1 between the
+   conversions and the float kernel. */
+#define HALF_FUNC(dtype, type, name, lo, hi)                                                       \
+    static void KERNEL_NAME(elew_n_##name)(const void *p1, const void *p2, void *res, size_t n,    \
+                                           tl_elew_op elew_op)                                     \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK], b[TL_KERNEL_HALF_BLOCK];                                    \
+        size_t i, m;                                                                               \
+                                                                                                   \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(up_##name)(a, (const type *)p1 + i, m);                                    \
+            KERNEL_NAME(up_##name)(b, (const type *)p2 + i, m);                                    \
+            KERNEL_NAME(elew_n_float)(a, b, a, m, elew_op);                                        \
+            KERNEL_NAME(down_##name)((type *)res + i, a, m);                                       \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(elew_scalar_n_##name)(const void *p1, const void *p2, void *res,       \
+                                                  size_t n, tl_elew_op elew_op)                    \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK], s;                                                          \
+        size_t i, m;                                                                               \
+                                                                                                   \
+        KERNEL_NAME(up_##name)(&s, p2, 1);                                                         \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(up_##name)(a, (const type *)p1 + i, m);                                    \
+            KERNEL_NAME(elew_scalar_n_float)(a, &s, a, m, elew_op);                                \
+            KERNEL_NAME(down_##name)((type *)res + i, a, m);                                       \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(lrelu_n_##name)(void *pd, const void *ps, float negslope, size_t n)    \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK];                                                             \
+        size_t i, m;                                                                               \
+                                                                                                   \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(up_##name)(a, (const type *)ps + i, m);                                    \
+            KERNEL_NAME(lrelu_n_float)(a, a, negslope, m);                                         \
+            KERNEL_NAME(down_##name)((type *)pd + i, a, m);                                        \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /* compared in float, but the maxima are copied bit for bit */                                 \
+    static void KERNEL_NAME(maxreduce_##name)(const void *src, void *dst, int32_t *arg,            \
+                                              int outer, int dim_size, int inner)                  \
+    {                                                                                              \
+        float max[TL_KERNEL_HALF_BLOCK], row[TL_KERNEL_HALF_BLOCK];                                \
+        int32_t maxi[TL_KERNEL_HALF_BLOCK];                                                        \
+        const type *s;                                                                             \
+        int o, i, j, j0, m;                                                                        \
+                                                                                                   \
+        for (o = 0; o < outer; o++) {                                                              \
+            s = (const type *)src + (size_t)o * dim_size * inner;                                  \
+            if (inner == 1) {                                                                      \
+                maxi[0] = 0;                                                                       \
+                max[0] = 0;                                                                        \
+                for (j0 = 0; j0 < dim_size; j0 += m) {                                             \
+                    m = dim_size - j0 < TL_KERNEL_HALF_BLOCK ? dim_size - j0                       \
+                                                             : TL_KERNEL_HALF_BLOCK;               \
+                    KERNEL_NAME(up_##name)(row, s + j0, m);                                        \
+                    for (j = 0; j < m; j++) {                                                      \
+                        if (j0 + j == 0 || row[j] > max[0]) {                                      \
+                            max[0] = row[j];                                                       \
+                            maxi[0] = j0 + j;                                                      \
+                        }                                                                          \
+                    }                                                                              \
+                }                                                                                  \
+                ((type *)dst)[o] = s[maxi[0]];                                                     \
+                if (arg)                                                                           \
+                    arg[o] = maxi[0];                                                              \
+                continue;                                                                          \
+            }                                                                                      \
+            for (j0 = 0; j0 < inner; j0 += m) {                                                    \
+                m = inner - j0 < TL_KERNEL_HALF_BLOCK ? inner - j0 : TL_KERNEL_HALF_BLOCK;         \
+                KERNEL_NAME(up_##name)(max, s + j0, m);                                            \
+                for (j = 0; j < m; j++)                                                            \
+                    maxi[j] = 0;                                                                   \
+                for (i = 1; i < dim_size; i++) {                                                   \
+                    KERNEL_NAME(up_##name)(row, s + (size_t)i * inner + j0, m);                    \
+                    for (j = 0; j < m; j++) {                                                      \
+                        int gt = row[j] > max[j];                                                  \
+                        max[j] = gt ? row[j] : max[j];                                             \
+                        maxi[j] = gt ? i : maxi[j];                                                \
+                    }                                                                              \
+                }                                                                                  \
+                for (j = 0; j < m; j++)                                                            \
+                    ((type *)dst)[(size_t)o * inner + j0 + j] =                                    \
+                        s[(size_t)maxi[j] * inner + j0 + j];                                       \
+                if (arg)                                                                           \
+                    for (j = 0; j < m; j++)                                                        \
+                        arg[(size_t)o * inner + j0 + j] = maxi[j];                                 \
+            }                                                                                      \
+        }                                                                                          \
+    }
+TL_FOREACH_HALF_DTYPE(HALF_FUNC)
+#undef HALF_FUNC
+
+/* conversions between a 16-bit float dtype and the other dtypes go through
+   float, reusing the float conversions (and their saturation) */
+#define HALF_CONVERT_FUNC(name_h, dtype, type, name, kind, lo, hi)                                 \
+    static void KERNEL_NAME(convert_n_##name_h##_##name)(void *pd, const void *ps, size_t n)       \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK];                                                             \
+        size_t i, m;                                                                               \
+                                                                                                   \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(convert_n_float_##name)(a, (const type *)ps + i, m);                       \
+            KERNEL_NAME(down_##name_h)((uint16_t *)pd + i, a, m);                                  \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(convert_n_##name##_##name_h)(void *pd, const void *ps, size_t n)       \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK];                                                             \
+        size_t i, m;                                                                               \
+                                                                                                   \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(up_##name_h)(a, (const uint16_t *)ps + i, m);                              \
+            KERNEL_NAME(convert_n_##name##_float)((type *)pd + i, a, m);                           \
+        }                                                                                          \
+    }
+#define FLOAT16_CONVERT_FUNC(...) HALF_CONVERT_FUNC(float16, __VA_ARGS__)
+#define BFLOAT16_CONVERT_FUNC(...) HALF_CONVERT_FUNC(bfloat16, __VA_ARGS__)
+TL_FOREACH_DTYPE(FLOAT16_CONVERT_FUNC)
+TL_FOREACH_DTYPE(BFLOAT16_CONVERT_FUNC)
+#undef FLOAT16_CONVERT_FUNC
+#undef BFLOAT16_CONVERT_FUNC
+#undef HALF_CONVERT_FUNC
+
+static void KERNEL_NAME(convert_n_float16_bfloat16)(void *pd, const void *ps, size_t n)
+{
+    float a[TL_KERNEL_HALF_BLOCK];
+    size_t i, m;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;
+        KERNEL_NAME(up_bfloat16)(a, (const uint16_t *)ps + i, m);
+        KERNEL_NAME(down_float16)((uint16_t *)pd + i, a, m);
+    }
+}
+
+static void KERNEL_NAME(convert_n_bfloat16_float16)(void *pd, const void *ps, size_t n)
+{
+    float a[TL_KERNEL_HALF_BLOCK];
+    size_t i, m;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;
+        KERNEL_NAME(up_float16)(a, (const uint16_t *)ps + i, m);
+        KERNEL_NAME(down_bfloat16)((uint16_t *)pd + i, a, m);
+    }
+}
+
+static void KERNEL_NAME(convert_n_half_copy)(void *pd, const void *ps, size_t n)
+{
+    memmove(pd, ps, n * sizeof(uint16_t));
+}
+
+/* start + step * (first + i) is computed in double and saturated like
+   convert_n from TL_DOUBLE, so a block of arange matches converting its
+   double elements one by one; the 16-bit floats go through float */
+#define ARANGE_FUNC(dtype, type, name, kind, lo, hi)                                               \
+    static void KERNEL_NAME(arange_n_##name)(void *pd, double start, double step, int first,     \
+                                             int n)                                                \
+    {                                                                                              \
+        type *d = pd;                                                                              \
+        int i;                                                                                     \
+                                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            d[i] = TL_SAT(kind, F, type, lo, hi, double, start + step * (first + i));              \
+    }
+TL_FOREACH_DTYPE(ARANGE_FUNC)
+#undef ARANGE_FUNC
+
+#define HALF_ARANGE_FUNC(dtype, type, name, lo, hi)                                                \
+    static void KERNEL_NAME(arange_n_##name)(void *pd, double start, double step, int first,     \
+                                             int n)                                                \
+    {                                                                                              \
+        float a[TL_KERNEL_HALF_BLOCK];                                                             \
+        int i, m;                                                                                  \
+                                                                                                   \
+        for (i = 0; i < n; i += m) {                                                               \
+            m = n - i < TL_KERNEL_HALF_BLOCK ? n - i : TL_KERNEL_HALF_BLOCK;                       \
+            KERNEL_NAME(arange_n_float)(a, start, step, first + i, m);                             \
+            KERNEL_NAME(down_##name)((uint16_t *)pd + i, a, m);                                    \
+        }                                                                                          \
+    }
+TL_FOREACH_HALF_DTYPE(HALF_ARANGE_FUNC)
+#undef HALF_ARANGE_FUNC
+
+/* Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+   3"): block i is the 128-bit counter (counter + i, 0) encrypted with the
+   64-bit key, written as 4 words at dst + 4 * i. The rounds run over
+   PHILOX_LANES blocks at a time, so that the inner loops are the ones over
+   independent blocks and vectorize. */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_LANES 16
+static void KERNEL_NAME(philox_n)(uint32_t *dst, uint64_t key, uint64_t counter, size_t n)
+{
+    uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES], c3[PHILOX_LANES];
+    uint32_t k0, k1, t0, t1;
+    uint64_t p0, p1;
+    size_t i, j, m;
+    int r;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < PHILOX_LANES ? n - i : PHILOX_LANES;
+        /* all lanes, so that the round loops have a constant trip count */
+        for (j = 0; j < PHILOX_LANES; j++) {
+            c0[j] = (uint32_t)(counter + i + j);
+            c1[j] = (uint32_t)((counter + i + j) >> 32);
+            c2[j] = 0;
+            c3[j] = 0;
+        }
+        k0 = (uint32_t)key;
+        k1 = (uint32_t)(key >> 32);
+        for (r = 0; r < 10; r++) {
+            for (j = 0; j < PHILOX_LANES; j++) {
+                p0 = (uint64_t)PHILOX_M0 * c0[j];
+                p1 = (uint64_t)PHILOX_M1 * c2[j];
+                t0 = (uint32_t)(p1 >> 32) ^ c1[j] ^ k0;
+                t1 = (uint32_t)(p0 >> 32) ^ c3[j] ^ k1;
+                c1[j] = (uint32_t)p1;
+                c3[j] = (uint32_t)p0;
+                c0[j] = t0;
+                c2[j] = t1;
+            }
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        for (j = 0; j < m; j++) {
+            dst[4 * (i + j)] = c0[j];
+            dst[4 * (i + j) + 1] = c1[j];
+            dst[4 * (i + j) + 2] = c2[j];
+            dst[4 * (i + j) + 3] = c3[j];
+        }
+    }
+}
+#undef PHILOX_M0
+#undef PHILOX_M1
+#undef PHILOX_W0
+#undef PHILOX_W1
+#undef PHILOX_LANES
+
+/* Affine quantized loops, computed in float. Values are saturated before
+   they are rounded, so adding and subtracting 1.5 * 2^23 rounds them half
+   to even without needing a round instruction; NaNs saturate to lo. */
+#define QUANT_ROUND(v) ((v) + 12582912.0f - 12582912.0f)
+#define QUANT_SAT(v, lo, hi) ((v) > (lo) ? ((v) < (hi) ? (v) : (hi)) : (lo))
+#define QUANT_STORE(type, lo, hi, v)                                                               \
+    ((type)(int32_t)QUANT_ROUND(QUANT_SAT((v), (float)(lo), (float)(hi))))
+
+#define QUANT_FUNC(dtype, type, name, lo, hi)                                                      \
+    static void KERNEL_NAME(quantize_n_##name)(void *pd, const float *ps, const float *inv_scale,  \
+                                               const int32_t *zero, size_t n, int per_elem)        \
+    {                                                                                              \
+        type *d = pd;                                                                              \
+        size_t i;                                                                                  \
+                                                                                                   \
+        if (per_elem) {                                                                            \
+            for (i = 0; i < n; i++)                                                                \
+                d[i] = QUANT_STORE(type, lo, hi, ps[i] * inv_scale[i] + (float)zero[i]);           \
+        } else {                                                                                   \
+            const float is = inv_scale[0], z = (float)zero[0];                                     \
+            for (i = 0; i < n; i++)                                                                \
+                d[i] = QUANT_STORE(type, lo, hi, ps[i] * is + z);                                  \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(dequantize_n_##name)(float *pd, const void *ps, const float *scale,    \
+                                                 const int32_t *zero, size_t n, int per_elem)      \
+    {                                                                                              \
+        const type *s = ps;                                                                        \
+        size_t i;                                                                                  \
+                                                                                                   \
+        if (per_elem) {                                                                            \
+            for (i = 0; i < n; i++)                                                                \
+                pd[i] = (float)((int32_t)s[i] - zero[i]) * scale[i];                               \
+        } else {                                                                                   \
+            const float sc = scale[0];                                                             \
+            const int32_t z = zero[0];                                                             \
+            for (i = 0; i < n; i++)                                                                \
+                pd[i] = (float)((int32_t)s[i] - z) * sc;                                           \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(qelew_n_##name)(const void *p1, const void *p2, void *res, size_t n,   \
+                                            tl_elew_op elew_op, const struct tl_qparam *qp)        \
+    {                                                                                              \
+        const type *a = p1;                                                                        \
+        const type *b = p2;                                                                        \
+        type *r = res;                                                                             \
+        const float m1 = qp->m1, m2 = qp->m2, zd = (float)qp->zd;                                  \
+        const int32_t z1 = qp->z1, z2 = qp->z2;                                                    \
+        size_t i;                                                                                  \
+                                                                                                   \
+        if (elew_op == TL_MUL) {                                                                   \
+            for (i = 0; i < n; i++)                                                                \
+                r[i] = QUANT_STORE(type, lo, hi,                                                   \
+                                   (float)(((int32_t)a[i] - z1) * ((int32_t)b[i] - z2)) * m1 +    \
+                                       zd);                                                        \
+        } else {                                                                                   \
+            for (i = 0; i < n; i++)                                                                \
+                r[i] = QUANT_STORE(type, lo, hi,                                                   \
+                                   (float)((int32_t)a[i] - z1) * m1 +                              \
+                                       (float)((int32_t)b[i] - z2) * m2 + zd);                     \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(qlrelu_n_##name)(void *pd, const void *ps, size_t n,                   \
+                                             const struct tl_qparam *qp)                           \
+    {                                                                                              \
+        const type *s = ps;                                                                        \
+        type *d = pd;                                                                              \
+        const float m1 = qp->m1, m2 = qp->m2, zd = (float)qp->zd;                                  \
+        const int32_t z1 = qp->z1;                                                                 \
+        int32_t v;                                                                                 \
+        size_t i;                                                                                  \
+                                                                                                   \
+        for (i = 0; i < n; i++) {                                                                  \
+            v = (int32_t)s[i] - z1;                                                                \
+            d[i] = QUANT_STORE(type, lo, hi, (float)v * (v >= 0 ? m1 : m2) + zd);                  \
+        }                                                                                          \
+    }
+TL_FOREACH_QUANT_DTYPE(QUANT_FUNC)
+#undef QUANT_FUNC
+#undef QUANT_STORE
+#undef QUANT_SAT
+#undef QUANT_ROUND
+
+/* The bit shuffle filter of tl_compress.c: byte k * n8 + i of the
+   bit_transpose output holds bit k of the input bytes 8 * i to 8 * i + 7,
+   with n8 = n / 8, and the n % 8 bytes left over are copied as they are.
+   Each group of 8 bytes is loaded as a uint64_t, so the order of the bits
+   within a byte of the output depends on the host byte order, like the
+   rest of the file. The group is an 8x8 bit matrix, transposed with 3 swaps
+   of bit blocks (Hacker's Delight, 7-3), BIT_LANES groups at a time. */
+#define BIT_LANES 16
+#define BIT_TRANSPOSE_LANES(x)                                                                     \
+    do {                                                                                           \
+        uint64_t t_;                                                                               \
+        for (j = 0; j < BIT_LANES; j++) {                                                          \
+            t_ = (x[j] ^ (x[j] >> 7)) & 0x00AA00AA00AA00AAULL;                                     \
+            x[j] ^= t_ ^ (t_ << 7);                                                                \
+            t_ = (x[j] ^ (x[j] >> 14)) & 0x0000CCCC0000CCCCULL;                                    \
+            x[j] ^= t_ ^ (t_ << 14);                                                               \
+            t_ = (x[j] ^ (x[j] >> 28)) & 0x00000000F0F0F0F0ULL;                                    \
+            x[j] ^= t_ ^ (t_ << 28);                                                               \
+        }                                                                                          \
+    } while (0)
+
+static void KERNEL_NAME(bit_transpose)(void *dst, const void *src, size_t n)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    size_t n8 = n / 8, i, j, m;
+    uint64_t x[BIT_LANES];
+    int k;
+
+    for (i = 0; i < n8; i += m) {
+        m = n8 - i < BIT_LANES ? n8 - i : BIT_LANES;
+        memset(x, 0, sizeof(x));
+        memcpy(x, s + 8 * i, 8 * m);
+        BIT_TRANSPOSE_LANES(x);
+        for (k = 0; k < 8; k++)
+            for (j = 0; j < m; j++)
+                d[k * n8 + i + j] = (uint8_t)(x[j] >> (8 * k));
+    }
+    for (i = 8 * n8; i < n; i++)
+        d[i] = s[i];
+}
+
+static void KERNEL_NAME(bit_untranspose)(void *dst, const void *src, size_t n)
+{
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    size_t n8 = n / 8, i, j, m;
+    uint64_t x[BIT_LANES];
+    int k;
+
+    for (i = 0; i < n8; i += m) {
+        m = n8 - i < BIT_LANES ? n8 - i : BIT_LANES;
+        for (j = 0; j < BIT_LANES; j++)
+            x[j] = 0;
+        for (k = 0; k < 8; k++)
+            for (j = 0; j < m; j++)
+                x[j] |= (uint64_t)s[k * n8 + i + j] << (8 * k);
+        BIT_TRANSPOSE_LANES(x);
+        memcpy(d + 8 * i, x, 8 * m);
+    }
+    for (i = 8 * n8; i < n; i++)
+        d[i] = s[i];
+}
+#undef BIT_TRANSPOSE_LANES
+#undef BIT_LANES
+
+/* data movement kernels only care about the element size */
+#define SHUFFLE_LANES 32
+#define MOVE_FUNC(type, name)                                                                      \
+    static void KERNEL_NAME(gather_##name)(void *dst, const void *src, const int *idx, int n)     \
+    {                                                                                              \
+        const type *s = src;                                                                       \
+        type *d = dst;                                                                             \
+        int i;                                                                                     \
+                                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            d[i] = s[idx[i]];                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(fill_##name)(void *dst, const void *value, size_t n)                   \
+    {                                                                                              \
+        const type v = *(const type *)value;                                                       \
+        type *d = dst;                                                                             \
+        size_t i;                                                                                  \
+                                                                                                   \
+        for (i = 0; i < n; i++)                                                                    \
+            d[i] = v;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /* byte b of element i, counted from the least significant, goes to                          \
+       dst[b * n + i]; SHUFFLE_LANES elements at a time, so that the inner                         \
+       loops are contiguous */                                                                     \
+    static void KERNEL_NAME(shuffle_##name)(void *dst, const void *src, size_t n)                  \
+    {                                                                                              \
+        const type *s = src;                                                                       \
+        uint8_t *d = dst;                                                                          \
+        size_t i, b, j;                                                                            \
+                                                                                                   \
+        for (i = 0; i + SHUFFLE_LANES <= n; i += SHUFFLE_LANES)                                    \
+            for (b = 0; b < sizeof(type); b++)                                                     \
+                for (j = 0; j < SHUFFLE_LANES; j++)                                                \
+                    d[b * n + i + j] = (uint8_t)(s[i + j] >> (8 * b));                             \
+        for (; i < n; i++)                                                                         \
+            for (b = 0; b < sizeof(type); b++)                                                     \
+                d[b * n + i] = (uint8_t)(s[i] >> (8 * b));                                         \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(unshuffle_##name)(void *dst, const void *src, size_t n)                \
+    {                                                                                              \
+        const uint8_t *s = src;                                                                    \
+        type *d = dst;                                                                             \
+        type v[SHUFFLE_LANES];                                                                     \
+        size_t i, b, j;                                                                            \
+                                                                                                   \
+        for (i = 0; i + SHUFFLE_LANES <= n; i += SHUFFLE_LANES) {                                  \
+            for (j = 0; j < SHUFFLE_LANES; j++)                                                    \
+                v[j] = 0;                                                                          \
+            for (b = 0; b < sizeof(type); b++)                                                     \
+                for (j = 0; j < SHUFFLE_LANES; j++)                                                \
+                    v[j] |= (type)s[b * n + i + j] << (8 * b);                                     \
+            for (j = 0; j < SHUFFLE_LANES; j++)                                                    \
+                d[i + j] = v[j];                                                                   \
+        }                                                                                          \
+        for (; i < n; i++) {                                                                       \
+            v[0] = 0;                                                                              \
+            for (b = 0; b < sizeof(type); b++)                                                     \
+                v[0] |= (type)s[b * n + i] << (8 * b);                                             \
+            d[i] = v[0];                                                                           \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    static void KERNEL_NAME(transpose2d_##name)(void *dst, const void *src, int rows, int cols,    \
+                                                ptrdiff_t rs, ptrdiff_t cs)                        \
+    {                                                                                              \
+        const type *s = src;                                                                       \
+        type *d = dst;                                                                             \
+        int r, c, r0, c0, r1, c1;                                                                  \
+                                                                                                   \
+        if (cs == 1) {                                                                             \
+            for (r = 0; r < rows; r++)                                                             \
+                for (c = 0; c < cols; c++)                                                         \
+                    d[(size_t)r * cols + c] = s[r * rs + c];                                       \
+            return;                                                                                \
+        }                                                                                          \
+        /* blocked, so that both the rows read and the rows written stay in cache */              \
+        for (r0 = 0; r0 < rows; r0 += TL_KERNEL_TILE) {                                            \
+            r1 = r0 + TL_KERNEL_TILE < rows ? r0 + TL_KERNEL_TILE : rows;                          \
+            for (c0 = 0; c0 < cols; c0 += TL_KERNEL_TILE) {                                        \
+                c1 = c0 + TL_KERNEL_TILE < cols ? c0 + TL_KERNEL_TILE : cols;                      \
+                for (r = r0; r < r1; r++)                                                          \
+                    for (c = c0; c < c1; c++)                                                      \
+                        d[(size_t)r * cols + c] = s[r * rs + c * cs];                              \
+            }                                                                                      \
+        }                                                                                          \
+    }
+MOVE_FUNC(uint8_t, 8)
+MOVE_FUNC(uint16_t, 16)
+MOVE_FUNC(uint32_t, 32)
+MOVE_FUNC(uint64_t, 64)
+#undef MOVE_FUNC
+#undef SHUFFLE_LANES
+
+#define ENTRY(dtype, type, name, kind, lo, hi) [dtype] = KERNEL_NAME(elew_n_##name),
+#define SCALAR_ENTRY(dtype, type, name, kind, lo, hi) [dtype] = KERNEL_NAME(elew_scalar_n_##name),
+#define LRELU_ENTRY(dtype, type, name, kind, lo, hi) [dtype] = KERNEL_NAME(lrelu_n_##name),
+#define MAXREDUCE_ENTRY(dtype, type, name, kind, lo, hi) [dtype] = KERNEL_NAME(maxreduce_##name),
+#define ARANGE_ENTRY(dtype, type, name, kind, lo, hi) [dtype] = KERNEL_NAME(arange_n_##name),
+#define CONVERT_ENTRY(dtype_d, type_d, name_d, kind_d, lo_d, hi_d, dtype_s, type_s, name_s,        \
+                      kind_s, lo_s, hi_s)                                                          \
+    [dtype_d][dtype_s] = KERNEL_NAME(convert_n_##name_d##_##name_s),
+
+#define HALF_ENTRY(dtype, type, name, lo, hi) ENTRY(dtype, type, name, F, lo, hi)
+#define HALF_SCALAR_ENTRY(dtype, type, name, lo, hi) SCALAR_ENTRY(dtype, type, name, F, lo, hi)
+#define HALF_LRELU_ENTRY(dtype, type, name, lo, hi) LRELU_ENTRY(dtype, type, name, F, lo, hi)
+#define HALF_MAXREDUCE_ENTRY(dtype, type, name, lo, hi)                                            \
+    MAXREDUCE_ENTRY(dtype, type, name, F, lo, hi)
+#define HALF_ARANGE_ENTRY(dtype, type, name, lo, hi) ARANGE_ENTRY(dtype, type, name, F, lo, hi)
+#define HALF_CONVERT_ENTRY(dtype_h, name_h, dtype, type, name, kind, lo, hi)                       \
+    [dtype_h][dtype] = KERNEL_NAME(convert_n_##name_h##_##name),                                   \
+    [dtype][dtype_h] = KERNEL_NAME(convert_n_##name##_##name_h),
+#define FLOAT16_CONVERT_ENTRY(...) HALF_CONVERT_ENTRY(TL_FLOAT16, float16, __VA_ARGS__)
+#define QUANTIZE_ENTRY(dtype, type, name, lo, hi) [dtype] = KERNEL_NAME(quantize_n_##name),
+#define DEQUANTIZE_ENTRY(dtype, type, name, lo, hi) [dtype] = KERNEL_NAME(dequantize_n_##name),
+#define QELEW_ENTRY(dtype, type, name, lo, hi) [dtype] = KERNEL_NAME(qelew_n_##name),
+#define QLRELU_ENTRY(dtype, type, name, lo, hi) [dtype] = KERNEL_NAME(qlrelu_n_##name),
+#define BFLOAT16_CONVERT_ENTRY(...) HALF_CONVERT_ENTRY(TL_BFLOAT16, bfloat16, __VA_ARGS__)
+
+static const struct tl_kernels KERNEL_NAME(kernels) = {
+    .elew_n = { TL_FOREACH_DTYPE(ENTRY) TL_FOREACH_HALF_DTYPE(HALF_ENTRY) },
+    .elew_scalar_n = { TL_FOREACH_DTYPE(SCALAR_ENTRY) TL_FOREACH_HALF_DTYPE(HALF_SCALAR_ENTRY) },
+    .convert_n = { TL_FOREACH_DTYPE_PAIR(CONVERT_ENTRY) TL_FOREACH_DTYPE(FLOAT16_CONVERT_ENTRY)
+                       TL_FOREACH_DTYPE(BFLOAT16_CONVERT_ENTRY)
+                   [TL_FLOAT16][TL_FLOAT16] = KERNEL_NAME(convert_n_half_copy),
+                   [TL_BFLOAT16][TL_BFLOAT16] = KERNEL_NAME(convert_n_half_copy),
+                   [TL_FLOAT16][TL_BFLOAT16] = KERNEL_NAME(convert_n_float16_bfloat16),
+                   [TL_BFLOAT16][TL_FLOAT16] = KERNEL_NAME(convert_n_bfloat16_float16) },
+    .lrelu_n = { TL_FOREACH_DTYPE(LRELU_ENTRY) TL_FOREACH_HALF_DTYPE(HALF_LRELU_ENTRY) },
+    .maxreduce = { TL_FOREACH_DTYPE(MAXREDUCE_ENTRY)
+                       TL_FOREACH_HALF_DTYPE(HALF_MAXREDUCE_ENTRY) },
+    .arange_n = { TL_FOREACH_DTYPE(ARANGE_ENTRY) TL_FOREACH_HALF_DTYPE(HALF_ARANGE_ENTRY) },
+    .gather = { KERNEL_NAME(gather_8), KERNEL_NAME(gather_16), KERNEL_NAME(gather_32),
+                KERNEL_NAME(gather_64) },
+    .fill = { KERNEL_NAME(fill_8), KERNEL_NAME(fill_16), KERNEL_NAME(fill_32),
+              KERNEL_NAME(fill_64) },
+    .shuffle = { KERNEL_NAME(shuffle_8), KERNEL_NAME(shuffle_16), KERNEL_NAME(shuffle_32),
+                 KERNEL_NAME(shuffle_64) },
+    .unshuffle = { KERNEL_NAME(unshuffle_8), KERNEL_NAME(unshuffle_16),
+                   KERNEL_NAME(unshuffle_32), KERNEL_NAME(unshuffle_64) },
+    .transpose2d = { KERNEL_NAME(transpose2d_8), KERNEL_NAME(transpose2d_16),
+                     KERNEL_NAME(transpose2d_32), KERNEL_NAME(transpose2d_64) },
+    .quantize_n = { TL_FOREACH_QUANT_DTYPE(QUANTIZE_ENTRY) },
+    .dequantize_n = { TL_FOREACH_QUANT_DTYPE(DEQUANTIZE_ENTRY) },
+    .qelew_n = { TL_FOREACH_QUANT_DTYPE(QELEW_ENTRY) },
+    .qlrelu_n = { TL_FOREACH_QUANT_DTYPE(QLRELU_ENTRY) },
+    .philox_n = KERNEL_NAME(philox_n),
+    .bit_transpose = KERNEL_NAME(bit_transpose),
+    .bit_untranspose = KERNEL_NAME(bit_untranspose),
+};
+
+#undef ENTRY
+#undef SCALAR_ENTRY
+#undef LRELU_ENTRY
+#undef MAXREDUCE_ENTRY
+#undef ARANGE_ENTRY
+#undef CONVERT_ENTRY
+#undef HALF_ENTRY
+#undef HALF_SCALAR_ENTRY
+#undef HALF_LRELU_ENTRY
+#undef HALF_MAXREDUCE_ENTRY
+#undef HALF_ARANGE_ENTRY
+#undef HALF_CONVERT_ENTRY
+#undef FLOAT16_CONVERT_ENTRY
+#undef BFLOAT16_CONVERT_ENTRY
+#undef QUANTIZE_ENTRY
+#undef DEQUANTIZE_ENTRY
+#undef QELEW_ENTRY
+#undef QLRELU_ENTRY
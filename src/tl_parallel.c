@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tl_util.h"
+#include "tl_parallel.h"
+
+#define TL_MAX_THREADS 256
+
+static int num_threads = 0;
+
+static int default_num_threads(void)
+{
+    const char *env;
+    int n;
+
+    env = getenv("TL_NUM_THREADS");
+    if (env && (n = atoi(env)) > 0)
+        return n;
+#ifdef _SC_NPROCESSORS_ONLN
+    n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0)
+        return n;
+#endif
+    return 1;
+}
+
+TL_EXPORT void tl_set_num_threads(int num)
+{
+    if (num <= 0)
+        num = default_num_threads();
+    num_threads = num > TL_MAX_THREADS ? TL_MAX_THREADS : num;
+}
+
+TL_EXPORT int tl_get_num_threads(void)
+{
+    if (num_threads <= 0)
+        tl_set_num_threads(0);
+    return num_threads;
+}
+
+int tl_parallel_max_chunks(int n, int grain)
+{
+    int chunks;
+
+    assert(n >= 0);
+    if (grain < 1)
+        grain = 1;
+    chunks = n / grain;
+    if (chunks > tl_get_num_threads())
+        chunks = tl_get_num_threads();
+    return chunks < 1 ? 1 : chunks;
+}
+
+#ifdef ESP32
+
+void tl_parallel_for(int n, int grain, tl_parallel_func func, void *arg)
+{
+    if (n > 0)
+        func(arg, 0, n);
+}
+
+#else  /* ESP32 */
+
+#include <pthread.h>
+
+/* A lazily started pool of workers. Worker i runs chunk i of the current
+   job; the calling thread runs chunk 0. Only one job runs at a time, other
+   callers (and nested calls from inside a job) just run serially. */
+struct pool {
+    pthread_mutex_t  lock;
+    pthread_cond_t   work_cond;
+    pthread_cond_t   done_cond;
+    pthread_mutex_t  run_lock;
+    int              nworkers;
+    unsigned long    generation;
+    int              pending;
+    tl_parallel_func func;
+    void            *arg;
+    int              n;
+    int              nchunks;
+};
+
+static struct pool pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, NULL, NULL, 0, 0
+};
+
+static __thread int in_parallel = 0;
+
+static void run_chunk(tl_parallel_func func, void *arg, int n, int nchunks, int i)
+{
+    int start, end;
+
+    start = (int)((long long)n * i / nchunks);
+    end = (int)((long long)n * (i + 1) / nchunks);
+    if (start < end)
+        func(arg, start, end);
+}
+
+static void *worker_main(void *data)
+{
+    int id = (int)(long)data;
+    unsigned long seen = 0;
+    tl_parallel_func func;
+    void *arg;
+    int n, nchunks;
+
+    in_parallel = 1;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen)
+            pthread_cond_wait(&pool.work_cond, &pool.lock);
+        seen = pool.generation;
+        if (id >= pool.nchunks)
+            continue;
+        func = pool.func;
+        arg = pool.arg;
+        n = pool.n;
+        nchunks = pool.nchunks;
+        pthread_mutex_unlock(&pool.lock);
+
+        run_chunk(func, arg, n, nchunks, id);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0)
+            pthread_cond_signal(&pool.done_cond);
+    }
+    return NULL;
+}
+
+/* called with pool.lock held */
+static int ensure_workers(int nworkers)
+{
+    pthread_attr_t attr;
+    pthread_t tid;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    while (pool.nworkers < nworkers) {
+        /* worker ids start from 1, chunk 0 belongs to the caller */
+        if (pthread_create(&tid, &attr, worker_main, (void *)(long)(pool.nworkers + 1)))
+            break;
+        pool.nworkers++;
+    }
+    pthread_attr_destroy(&attr);
+    return pool.nworkers;
+}
+
+void tl_parallel_for(int n, int grain, tl_parallel_func func, void *arg)
+{
+    int nchunks;
+
+    assert(func);
+    if (n <= 0)
+        return;
+    nchunks = tl_parallel_max_chunks(n, grain);
+    if (nchunks == 1 || in_parallel || pthread_mutex_trylock(&pool.run_lock)) {
+        func(arg, 0, n);
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    if (ensure_workers(nchunks - 1) < nchunks - 1)
+        nchunks = pool.nworkers + 1;
+    pool.func = func;
+    pool.arg = arg;
+    pool.n = n;
+    pool.nchunks = nchunks;
+    pool.pending = nchunks - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.lock);
+
+    in_parallel = 1;
+    run_chunk(func, arg, n, nchunks, 0);
+    in_parallel = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0)
+        pthread_cond_wait(&pool.done_cond, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.run_lock);
+}
+
+#endif /* ESP32 */
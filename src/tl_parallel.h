@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_PARALLEL_H_
+#define _TL_PARALLEL_H_
+
+/* Split [0, n) into contiguous ranges and run func on each of them,
+   possibly in different threads. Ranges are never smaller than grain
+   elements, so small workloads stay in the calling thread. */
+typedef void (*tl_parallel_func)(void *arg, int start, int end);
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+void tl_parallel_for(int n, int grain, tl_parallel_func func, void *arg);
+int tl_parallel_max_chunks(int n, int grain);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_PARALLEL_H_ */
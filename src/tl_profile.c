@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tl_util.h"
+#include "tl_profile_internal.h"
+
+#ifdef TL_PROFILE
+
+#include <pthread.h>
+#include <time.h>
+
+/* trace events kept at most, later ones are counted as dropped */
+#define TL_PROFILE_MAX_EVENTS (1 << 20)
+
+/* clang-format off */
+struct tl_profile_event {
+    struct tl_profile_record *record;
+    int                       tid;
+    uint64_t                  start_ns;
+    uint64_t                  dur_ns;
+    uint64_t                  bytes_read;
+    uint64_t                  bytes_written;
+};
+/* clang-format on */
+
+int tl_profile_on = 0;
+static int trace_on = 0;
+static uint64_t origin_ns;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tl_profile_record *records = NULL;
+static struct tl_profile_event *events = NULL;
+static int num_events = 0;
+static int cap_events = 0;
+static uint64_t dropped_events = 0;
+
+static struct tl_profile_record alloc_record = { "tl_alloc" };
+
+static int next_tid = 0;
+static __thread int thread_tid = -1;
+static __thread struct tl_profile_scope *current_scope = NULL;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void add(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void register_record(struct tl_profile_record *record)
+{
+    if (__atomic_load_n(&record->registered, __ATOMIC_ACQUIRE))
+        return;
+    pthread_mutex_lock(&mutex);
+    if (!record->registered) {
+        record->next = records;
+        records = record;
+        __atomic_store_n(&record->registered, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+static void add_event(struct tl_profile_scope *scope, uint64_t dur_ns)
+{
+    struct tl_profile_event *e;
+
+    if (thread_tid < 0)
+        thread_tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&mutex);
+    if (num_events == cap_events) {
+        if (cap_events == TL_PROFILE_MAX_EVENTS) {
+            dropped_events++;
+            pthread_mutex_unlock(&mutex);
+            return;
+        }
+        cap_events = cap_events ? cap_events * 2 : 1024;
+        events = realloc(events, sizeof(struct tl_profile_event) * cap_events);
+        if (!events)
+            tl_err_dump("realloc(%lu) failed", sizeof(struct tl_profile_event) * cap_events);
+    }
+    e = &events[num_events++];
+    e->record = scope->record;
+    e->tid = thread_tid;
+    e->start_ns = scope->start_ns > origin_ns ? scope->start_ns - origin_ns : 0;
+    e->dur_ns = dur_ns;
+    e->bytes_read = scope->bytes_read;
+    e->bytes_written = scope->bytes_written;
+    pthread_mutex_unlock(&mutex);
+}
+
+void tl_profile_scope_start(struct tl_profile_scope *scope, struct tl_profile_record *record)
+{
+    register_record(record);
+    scope->record = record;
+    scope->parent = current_scope;
+    scope->bytes_read = 0;
+    scope->bytes_written = 0;
+    current_scope = scope;
+    scope->start_ns = now_ns();
+}
+
+void tl_profile_scope_finish(struct tl_profile_scope *scope)
+{
+    struct tl_profile_record *record = scope->record;
+    uint64_t dur, max;
+
+    dur = now_ns() - scope->start_ns;
+    current_scope = scope->parent;
+
+    add(&record->calls, 1);
+    add(&record->total_ns, dur);
+    add(&record->bytes_read, scope->bytes_read);
+    add(&record->bytes_written, scope->bytes_written);
+    max = __atomic_load_n(&record->max_ns, __ATOMIC_RELAXED);
+    while (dur > max && !__atomic_compare_exchange_n(&record->max_ns, &max, dur, 1,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    if (__atomic_load_n(&trace_on, __ATOMIC_RELAXED))
+        add_event(scope, dur);
+}
+
+void tl_profile_alloc(size_t size)
+{
+    if (!__atomic_load_n(&tl_profile_on, __ATOMIC_RELAXED))
+        return;
+    register_record(&alloc_record);
+    add(&alloc_record.calls, 1);
+    add(&alloc_record.allocs, 1);
+    add(&alloc_record.alloc_bytes, size);
+    if (current_scope) {
+        add(&current_scope->record->allocs, 1);
+        add(&current_scope->record->alloc_bytes, size);
+    }
+}
+
+TL_EXPORT int tl_profile_available(void)
+{
+    return 1;
+}
+
+TL_EXPORT void tl_profile_start(int trace)
+{
+    pthread_mutex_lock(&mutex);
+    if (!origin_ns)
+        origin_ns = now_ns();
+    pthread_mutex_unlock(&mutex);
+    __atomic_store_n(&trace_on, trace ? 1 : 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&tl_profile_on, 1, __ATOMIC_RELEASE);
+}
+
+TL_EXPORT void tl_profile_stop(void)
+{
+    __atomic_store_n(&tl_profile_on, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&trace_on, 0, __ATOMIC_RELAXED);
+}
+
+TL_EXPORT void tl_profile_reset(void)
+{
+    struct tl_profile_record *r;
+
+    pthread_mutex_lock(&mutex);
+    for (r = records; r; r = r->next) {
+        r->calls = 0;
+        r->total_ns = 0;
+        r->max_ns = 0;
+        r->bytes_read = 0;
+        r->bytes_written = 0;
+        r->allocs = 0;
+        r->alloc_bytes = 0;
+    }
+    tl_free(events);
+    events = NULL;
+    num_events = 0;
+    cap_events = 0;
+    dropped_events = 0;
+    origin_ns = now_ns();
+    pthread_mutex_unlock(&mutex);
+}
+
+static int cmp_stats(const void *a, const void *b)
+{
+    const tl_profile_stats *x = a, *y = b;
+
+    if (x->total_ns != y->total_ns)
+        return x->total_ns < y->total_ns ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+/* snapshot of the called records sorted by total time, caller frees */
+static tl_profile_stats *collect_stats(int *num)
+{
+    struct tl_profile_record *r;
+    tl_profile_stats *stats;
+    int n, cap;
+
+    /* tl_alloc() may register alloc_record, which takes mutex, so allocate
+       outside of it; records registered meanwhile miss this snapshot */
+    pthread_mutex_lock(&mutex);
+    for (r = records, cap = 0; r; r = r->next)
+        cap++;
+    pthread_mutex_unlock(&mutex);
+    stats = tl_alloc(sizeof(tl_profile_stats) * (cap ? cap : 1));
+    pthread_mutex_lock(&mutex);
+    for (r = records, n = 0; r && n < cap; r = r->next) {
+        if (!__atomic_load_n(&r->calls, __ATOMIC_RELAXED))
+            continue;
+        stats[n].name = r->name;
+        stats[n].calls = __atomic_load_n(&r->calls, __ATOMIC_RELAXED);
+        stats[n].total_ns = __atomic_load_n(&r->total_ns, __ATOMIC_RELAXED);
+        stats[n].max_ns = __atomic_load_n(&r->max_ns, __ATOMIC_RELAXED);
+        stats[n].bytes_read = __atomic_load_n(&r->bytes_read, __ATOMIC_RELAXED);
+        stats[n].bytes_written = __atomic_load_n(&r->bytes_written, __ATOMIC_RELAXED);
+        stats[n].allocs = __atomic_load_n(&r->allocs, __ATOMIC_RELAXED);
+        stats[n].alloc_bytes = __atomic_load_n(&r->alloc_bytes, __ATOMIC_RELAXED);
+        n++;
+    }
+    pthread_mutex_unlock(&mutex);
+    qsort(stats, n, sizeof(tl_profile_stats), cmp_stats);
+    *num = n;
+    return stats;
+}
+
+TL_EXPORT int tl_profile_get_stats(tl_profile_stats *stats, int max)
+{
+    tl_profile_stats *all;
+    int n;
+
+    all = collect_stats(&n);
+    if (stats && max > 0)
+        memcpy(stats, all, sizeof(tl_profile_stats) * (n < max ? n : max));
+    tl_free(all);
+    return n;
+}
+
+TL_EXPORT int tl_profile_dump_json(const char *file_name)
+{
+    tl_profile_stats *s;
+    FILE *fp;
+    int i, n;
+
+    if (!(fp = fopen(file_name, "w"))) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return -1;
+    }
+    s = collect_stats(&n);
+    fprintf(fp, "{\n  \"ops\": [\n");
+    for (i = 0; i < n; i++) {
+        fprintf(fp,
+                "    {\"name\": \"%s\", \"calls\": %lu, \"total_ns\": %lu, \"mean_ns\": %lu, "
+                "\"max_ns\": %lu, \"bytes_read\": %lu, \"bytes_written\": %lu, "
+                "\"allocs\": %lu, \"alloc_bytes\": %lu}%s\n",
+                s[i].name, (unsigned long)s[i].calls, (unsigned long)s[i].total_ns,
+                (unsigned long)(s[i].total_ns / s[i].calls), (unsigned long)s[i].max_ns,
+                (unsigned long)s[i].bytes_read, (unsigned long)s[i].bytes_written,
+                (unsigned long)s[i].allocs, (unsigned long)s[i].alloc_bytes,
+                i == n - 1 ? "" : ",");
+    }
+    fprintf(fp, "  ]\n}\n");
+    tl_free(s);
+    fclose(fp);
+    return 0;
+}
+
+/* Chrome trace-event format, open in chrome://tracing or Perfetto */
+TL_EXPORT int tl_profile_dump_trace(const char *file_name)
+{
+    struct tl_profile_event *e;
+    FILE *fp;
+    int i;
+
+    if (!(fp = fopen(file_name, "w"))) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return -1;
+    }
+    pthread_mutex_lock(&mutex);
+    fprintf(fp, "{\"traceEvents\": [\n");
+    for (i = 0; i < num_events; i++) {
+        e = &events[i];
+        fprintf(fp,
+                "  {\"name\": \"%s\", \"cat\": \"tensorlight\", \"ph\": \"X\", \"ts\": %.3f, "
+                "\"dur\": %.3f, \"pid\": 0, \"tid\": %d, \"args\": {\"bytes_read\": %lu, "
+                "\"bytes_written\": %lu}}%s\n",
+                e->record->name, e->start_ns / 1e3, e->dur_ns / 1e3, e->tid,
+                (unsigned long)e->bytes_read, (unsigned long)e->bytes_written,
+                i == num_events - 1 ? "" : ",");
+    }
+    fprintf(fp, "],\n\"displayTimeUnit\": \"ns\",\n\"otherData\": {\"dropped_events\": %lu}}\n",
+            (unsigned long)dropped_events);
+    pthread_mutex_unlock(&mutex);
+    fclose(fp);
+    return 0;
+}
+
+#else /* TL_PROFILE */
+
+TL_EXPORT int tl_profile_available(void)
+{
+    return 0;
+}
+
+TL_EXPORT void tl_profile_start(int trace)
+{
+}
+
+TL_EXPORT void tl_profile_stop(void)
+{
+}
+
+TL_EXPORT void tl_profile_reset(void)
+{
+}
+
+TL_EXPORT int tl_profile_get_stats(tl_profile_stats *stats, int max)
+{
+    return 0;
+}
+
+TL_EXPORT int tl_profile_dump_json(const char *file_name)
+{
+    tl_warn_msg("ERROR: tensorlight is built without TL_PROFILE");
+    return -1;
+}
+
+TL_EXPORT int tl_profile_dump_trace(const char *file_name)
+{
+    tl_warn_msg("ERROR: tensorlight is built without TL_PROFILE");
+    return -1;
+}
+
+#endif /* TL_PROFILE */
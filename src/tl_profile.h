@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_PROFILE_H_
+#define _TL_PROFILE_H_
+
+#include <stdint.h>
+
+#include "tl_util.h"
+
+/* Per-op profiling. The hooks are only compiled in when the library is built
+   with TL_PROFILE defined (./configure --profile=yes); otherwise these
+   functions are stubs and tl_profile_available() returns 0. */
+
+/* clang-format off */
+struct tl_profile_stats {
+    const char *name;           /* op name, like "tl_tensor_elew" */
+    uint64_t    calls;
+    uint64_t    total_ns;       /* including nested ops */
+    uint64_t    max_ns;
+    uint64_t    bytes_read;
+    uint64_t    bytes_written;
+    uint64_t    allocs;         /* tl_alloc calls made by the op itself */
+    uint64_t    alloc_bytes;
+};
+typedef struct tl_profile_stats tl_profile_stats;
+/* clang-format on */
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+int tl_profile_available(void);
+void tl_profile_start(int trace);
+void tl_profile_stop(void);
+void tl_profile_reset(void);
+int tl_profile_get_stats(tl_profile_stats *stats, int max);
+int tl_profile_dump_json(const char *file_name);
+int tl_profile_dump_trace(const char *file_name);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_PROFILE_H_ */
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_PROFILE_INTERNAL_H_
+#define _TL_PROFILE_INTERNAL_H_
+
+#include "tl_profile.h"
+
+#ifdef TL_PROFILE
+
+/* one per profiled function, registered on its first recorded call */
+/* clang-format off */
+struct tl_profile_record {
+    const char               *name;
+    struct tl_profile_record *next;
+    int                       registered;
+    uint64_t                  calls;
+    uint64_t                  total_ns;
+    uint64_t                  max_ns;
+    uint64_t                  bytes_read;
+    uint64_t                  bytes_written;
+    uint64_t                  allocs;
+    uint64_t                  alloc_bytes;
+};
+
+/* one per active call, lives on the caller's stack */
+struct tl_profile_scope {
+    struct tl_profile_record *record;   /* NULL if profiling is off */
+    struct tl_profile_scope  *parent;
+    uint64_t                  start_ns;
+    uint64_t                  bytes_read;
+    uint64_t                  bytes_written;
+};
+/* clang-format on */
+
+extern int tl_profile_on;
+
+void tl_profile_scope_start(struct tl_profile_scope *scope, struct tl_profile_record *record);
+void tl_profile_scope_finish(struct tl_profile_scope *scope);
+void tl_profile_alloc(size_t size);
+
+static inline void tl_profile_scope_begin(struct tl_profile_scope *scope,
+                                          struct tl_profile_record *record)
+{
+    scope->record = NULL;
+    if (__atomic_load_n(&tl_profile_on, __ATOMIC_RELAXED))
+        tl_profile_scope_start(scope, record);
+}
+
+static inline void tl_profile_scope_end(struct tl_profile_scope *scope)
+{
+    if (scope->record)
+        tl_profile_scope_finish(scope);
+}
+
+/* Put at the top of a function to time it until it returns. */
+#define TL_PROFILE_OP()                                                                            \
+    static struct tl_profile_record _tl_profile_record = { __func__ };                             \
+    struct tl_profile_scope _tl_profile_scope __attribute__((cleanup(tl_profile_scope_end)));      \
+    tl_profile_scope_begin(&_tl_profile_scope, &_tl_profile_record)
+
+/* Account bytes read and written by the current function. */
+#define TL_PROFILE_IO(rd, wr)                                                                      \
+    do {                                                                                           \
+        _tl_profile_scope.bytes_read += (rd);                                                      \
+        _tl_profile_scope.bytes_written += (wr);                                                   \
+    } while (0)
+
+#define TL_PROFILE_ALLOC(size) tl_profile_alloc(size)
+
+#else
+
+#define TL_PROFILE_OP()
+/* unevaluated, but counts as a use of what only feeds the profile */
+#define TL_PROFILE_IO(rd, wr) ((void)sizeof((rd) + (wr)))
+#define TL_PROFILE_ALLOC(size)
+
+#endif /* TL_PROFILE */
+
+/* bytes of tensor data, 0 for NULL */
+#define TL_PROFILE_TENSOR_BYTES(t) ((t) ? (uint64_t)(t)->len * tl_size_of((t)->dtype) : 0)
+
+#endif /* _TL_PROFILE_INTERNAL_H_ */
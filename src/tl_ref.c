@@ -0,0 +1,660 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <float.h>
+
+#include "tl_tensor_internal.h"
+#include "tl_ref.h"
+
+/* The reference ops are deliberately naive: every dst element is computed on
+   its own from its coordinates, with tl_get_coords, tl_get_index and the
+   scalar dtype functions in tl_type.c. Nothing here is threaded or
+   vectorized, so a mismatch against the optimized ops points at the latter. */
+
+static void check_dst(const tl_tensor *dst, int ndim, const int *dims, tl_dtype dtype)
+{
+    int i;
+
+    assert(dst->data);
+    assert(dst->dtype == dtype);
+    assert(dst->ndim == ndim);
+    for (i = 0; i < ndim; i++)
+        assert(dst->dims[i] == dims[i]);
+}
+
+static tl_tensor *ref_dst(tl_tensor *dst, int ndim, const int *dims, tl_dtype dtype)
+{
+    if (dst) {
+        check_dst(dst, ndim, dims, dtype);
+        return dst;
+    }
+    return tl_tensor_zeros(ndim, dims, dtype);
+}
+
+static double get_double(const tl_tensor *t, int i)
+{
+    double v;
+
+    tl_convert(&v, TL_DOUBLE, tl_padd(t->data, i, tl_size_of(t->dtype)), t->dtype);
+    return v;
+}
+
+static void set_double(tl_tensor *t, int i, double v)
+{
+    tl_convert(tl_padd(t->data, i, tl_size_of(t->dtype)), t->dtype, &v, TL_DOUBLE);
+}
+
+tl_tensor *tl_ref_elew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                       tl_elew_op elew_op)
+{
+    size_t dsize;
+    int i;
+
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->data && src2->data);
+    assert(src1->dtype == src2->dtype);
+    tl_check_elew_op(elew_op);
+    dst = ref_dst(dst, src1->ndim, src1->dims, src1->dtype);
+
+    dsize = tl_size_of(src1->dtype);
+    for (i = 0; i < dst->len; i++)
+        tl_elew(tl_padd(src1->data, i, dsize), tl_padd(src2->data, i, dsize),
+                tl_padd(dst->data, i, dsize), elew_op, src1->dtype);
+    return dst;
+}
+
+tl_tensor *tl_ref_elew_param(const tl_tensor *src, double param, tl_tensor *dst,
+                             tl_elew_op elew_op)
+{
+    char param_data[TL_DTYPE_MAX_SIZE];
+    size_t dsize;
+    int i;
+
+    assert(src && src->data);
+    tl_check_elew_op(elew_op);
+    dst = ref_dst(dst, src->ndim, src->dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    tl_convert(param_data, src->dtype, &param, TL_DOUBLE);
+    for (i = 0; i < dst->len; i++)
+        tl_elew(tl_padd(src->data, i, dsize), param_data, tl_padd(dst->data, i, dsize), elew_op,
+                src->dtype);
+    return dst;
+}
+
+tl_tensor *tl_ref_convert(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype_d)
+{
+    size_t ssize, dsize;
+    int i;
+
+    assert(src && src->data);
+    tl_check_dtype(dtype_d);
+    dst = ref_dst(dst, src->ndim, src->dims, dtype_d);
+
+    ssize = tl_size_of(src->dtype);
+    dsize = tl_size_of(dtype_d);
+    for (i = 0; i < dst->len; i++)
+        tl_convert(tl_padd(dst->data, i, dsize), dtype_d, tl_padd(src->data, i, ssize),
+                   src->dtype);
+    return dst;
+}
+
+tl_tensor *tl_ref_lrelu(const tl_tensor *src, tl_tensor *dst, float negslope)
+{
+    size_t dsize;
+    int i;
+
+    assert(src && src->data);
+    dst = ref_dst(dst, src->ndim, src->dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    for (i = 0; i < dst->len; i++)
+        tl_lrelu(tl_padd(dst->data, i, dsize), tl_padd(src->data, i, dsize), negslope,
+                 src->dtype);
+    return dst;
+}
+
+tl_tensor *tl_ref_maxreduce(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg, int axis)
+{
+    int dims[TL_MAXDIM], coords[TL_MAXDIM];
+    int di, si, i, maxi;
+    size_t dsize;
+    void *maxp;
+
+    assert(src && src->data);
+    assert(axis < src->ndim && axis >= 0);
+    memmove(dims, src->dims, sizeof(int) * src->ndim);
+    dims[axis] = 1;
+    dst = ref_dst(dst, src->ndim, dims, src->dtype);
+    if (arg)
+        check_dst(arg, src->ndim, dims, TL_INT32);
+
+    dsize = tl_size_of(src->dtype);
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, coords, dst->ndim, dst->dims);
+        maxp = tl_padd(src->data, tl_get_index(coords, src->ndim, src->dims), dsize);
+        for (i = 1, maxi = 0; i < src->dims[axis]; i++) {
+            coords[axis] = i;
+            si = tl_get_index(coords, src->ndim, src->dims);
+            if (tl_cmp(tl_padd(src->data, si, dsize), maxp, src->dtype) > 0) {
+                maxp = tl_padd(src->data, si, dsize);
+                maxi = i;
+            }
+        }
+        tl_passign(dst->data, di, maxp, 0, dsize);
+        if (arg)
+            ((int32_t *)arg->data)[di] = maxi;
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_transpose(const tl_tensor *src, tl_tensor *dst, const int *axes)
+{
+    int dims[TL_MAXDIM], s_ids[TL_MAXDIM], d_ids[TL_MAXDIM];
+    int di, i;
+    size_t dsize;
+
+    assert(src && src->data);
+    for (i = 0; i < src->ndim; i++)
+        dims[i] = src->dims[axes[i]];
+    dst = ref_dst(dst, src->ndim, dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, d_ids, dst->ndim, dst->dims);
+        for (i = 0; i < dst->ndim; i++)
+            s_ids[axes[i]] = d_ids[i];
+        tl_passign(dst->data, di, src->data, tl_get_index(s_ids, src->ndim, src->dims), dsize);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims,
+                         tl_resize_type rtype)
+{
+    int s_ids[TL_MAXDIM], d_ids[TL_MAXDIM];
+    float scales[TL_MAXDIM];
+    int di, i;
+    size_t dsize;
+
+    assert(src && src->data);
+    assert(new_dims);
+    assert(rtype == TL_NEAREST && "only TL_NEAREST is supported");
+    dst = ref_dst(dst, src->ndim, new_dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    for (i = 0; i < src->ndim; i++)
+        scales[i] = (float)src->dims[i] / (float)new_dims[i];
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, d_ids, dst->ndim, dst->dims);
+        for (i = 0; i < dst->ndim; i++) {
+            s_ids[i] = (int)roundf(((float)d_ids[i] + 0.5) * scales[i] - 0.5);
+            s_ids[i] = s_ids[i] < 0 ? 0 : s_ids[i];
+            s_ids[i] = s_ids[i] >= src->dims[i] ? src->dims[i] - 1 : s_ids[i];
+        }
+        tl_passign(dst->data, di, src->data, tl_get_index(s_ids, src->ndim, src->dims), dsize);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_slice_nd(const tl_tensor *src, tl_tensor *dst, const int *start,
+                           const int *stop, const int *step)
+{
+    int dims[TL_MAXDIM], s_ids[TL_MAXDIM], d_ids[TL_MAXDIM];
+    int di, i, b, e, s;
+    size_t dsize;
+
+    assert(src && src->data);
+    for (i = 0; i < src->ndim; i++) {
+        b = start ? start[i] : 0;
+        e = stop ? stop[i] : src->dims[i];
+        s = step ? step[i] : 1;
+        assert(s > 0 && b >= 0 && b < e && e <= src->dims[i]);
+        dims[i] = (e - b + s - 1) / s;
+    }
+    dst = ref_dst(dst, src->ndim, dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, d_ids, dst->ndim, dst->dims);
+        for (i = 0; i < dst->ndim; i++)
+            s_ids[i] = (start ? start[i] : 0) + d_ids[i] * (step ? step[i] : 1);
+        tl_passign(dst->data, di, src->data, tl_get_index(s_ids, src->ndim, src->dims), dsize);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_concat_n(const tl_tensor **srcs, int n, tl_tensor *dst, int axis)
+{
+    int dims[TL_MAXDIM], ids[TL_MAXDIM];
+    int di, i, k;
+    size_t dsize;
+
+    assert(srcs && n > 0);
+    assert(axis >= 0 && axis < srcs[0]->ndim);
+    memmove(dims, srcs[0]->dims, sizeof(int) * srcs[0]->ndim);
+    for (k = 1; k < n; k++) {
+        assert(srcs[k]->ndim == srcs[0]->ndim);
+        assert(srcs[k]->dtype == srcs[0]->dtype);
+        dims[axis] += srcs[k]->dims[axis];
+    }
+    dst = ref_dst(dst, srcs[0]->ndim, dims, srcs[0]->dtype);
+
+    dsize = tl_size_of(dst->dtype);
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, ids, dst->ndim, dst->dims);
+        for (k = 0; ids[axis] >= srcs[k]->dims[axis]; k++)
+            ids[axis] -= srcs[k]->dims[axis];
+        for (i = 0; i < dst->ndim; i++)
+            assert(i == axis || srcs[k]->dims[i] == dims[i]);
+        tl_passign(dst->data, di, srcs[k]->data, tl_get_index(ids, dst->ndim, srcs[k]->dims),
+                   dsize);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_pad(const tl_tensor *src, tl_tensor *dst, const int *pads, tl_pad_mode mode,
+                      double value)
+{
+    int dims[TL_MAXDIM], s_ids[TL_MAXDIM], d_ids[TL_MAXDIM];
+    int di, i, at, before, n, inside;
+    char value_data[TL_DTYPE_MAX_SIZE];
+    size_t dsize;
+
+    assert(src && src->data);
+    assert(pads);
+    tl_check_pad_mode(mode);
+    for (i = 0; i < src->ndim; i++)
+        dims[i] = pads[2 * i] + src->dims[i] + pads[2 * i + 1];
+    dst = ref_dst(dst, src->ndim, dims, src->dtype);
+
+    dsize = tl_size_of(src->dtype);
+    tl_convert(value_data, src->dtype, &value, TL_DOUBLE);
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, d_ids, dst->ndim, dst->dims);
+        for (i = 0, inside = 1; i < dst->ndim; i++) {
+            at = d_ids[i];
+            before = pads[2 * i];
+            n = src->dims[i];
+            if (at >= before && at < before + n)
+                s_ids[i] = at - before;
+            else if (mode == TL_PAD_REFLECT)
+                s_ids[i] = at < before ? before - at : 2 * (n - 1) - (at - before);
+            else if (mode == TL_PAD_EDGE)
+                s_ids[i] = at < before ? 0 : n - 1;
+            else
+                inside = 0;
+        }
+        if (inside)
+            tl_passign(dst->data, di, src->data, tl_get_index(s_ids, src->ndim, src->dims),
+                       dsize);
+        else
+            tl_passign(dst->data, di, value_data, 0, dsize);
+    }
+    return dst;
+}
+
+/* Integer products are summed exactly in 64 bits and saturated into dst,
+   floating point ones in double. */
+tl_tensor *tl_ref_dot_product(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst)
+{
+    double sum_d = 0, v;
+    int64_t sum_i = 0;
+    int i;
+
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->data && src2->data);
+    assert(src1->dtype == src2->dtype);
+    if (dst) {
+        assert(dst->data);
+        assert(dst->ndim == 1 && dst->dims[0] == 1);
+    } else {
+        dst = tl_tensor_zeros(1, (int[]){ 1 }, src1->dtype);
+    }
+
+    if (src1->dtype == TL_FLOAT || src1->dtype == TL_DOUBLE) {
+        for (i = 0; i < src1->len; i++)
+            sum_d += get_double(src1, i) * get_double(src2, i);
+        set_double(dst, 0, sum_d);
+    } else {
+        for (i = 0; i < src1->len; i++) {
+            v = get_double(src1, i) * get_double(src2, i);
+            sum_i += (int64_t)v;
+        }
+        tl_convert(dst->data, dst->dtype, &sum_i, TL_INT64);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_norm(const tl_tensor *src, tl_tensor *dst, tl_norm_type ord)
+{
+    double r = 0, v;
+    int i;
+
+    assert(src && src->data);
+    tl_check_norm_type(ord);
+    if (dst) {
+        assert(dst->data);
+        assert(dst->ndim == 1 && dst->dims[0] == 1);
+    } else {
+        dst = tl_tensor_zeros(1, (int[]){ 1 }, src->dtype == TL_FLOAT ? TL_FLOAT : TL_DOUBLE);
+    }
+
+    for (i = 0; i < src->len; i++) {
+        v = fabs(get_double(src, i));
+        if (ord == TL_NORM_L1)
+            r += v;
+        else if (ord == TL_NORM_L2)
+            r += v * v;
+        else
+            r = v > r ? v : r;
+    }
+    if (ord == TL_NORM_L2)
+        r = sqrt(r);
+    set_double(dst, 0, r);
+    return dst;
+}
+
+static tl_tensor *ref_softmax(const tl_tensor *src, tl_tensor *dst, int axis, int is_log)
+{
+    int ids[TL_MAXDIM];
+    int di, i, dim, stride;
+    double m, s, v;
+
+    assert(src && src->data);
+    assert(src->dtype == TL_FLOAT || src->dtype == TL_DOUBLE);
+    assert(axis >= 0 && axis < src->ndim);
+    dst = ref_dst(dst, src->ndim, src->dims, src->dtype);
+
+    dim = src->dims[axis];
+    for (i = axis + 1, stride = 1; i < src->ndim; i++)
+        stride *= src->dims[i];
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, ids, dst->ndim, dst->dims);
+        ids[axis] = 0;
+        i = tl_get_index(ids, src->ndim, src->dims);
+        for (m = -DBL_MAX, ids[axis] = 0; ids[axis] < dim; ids[axis]++)
+            m = fmax(m, get_double(src, i + ids[axis] * stride));
+        for (s = 0, ids[axis] = 0; ids[axis] < dim; ids[axis]++)
+            s += exp(get_double(src, i + ids[axis] * stride) - m);
+        v = get_double(src, di) - m;
+        set_double(dst, di, is_log ? v - log(s) : exp(v) / s);
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_softmax(const tl_tensor *src, tl_tensor *dst, int axis)
+{
+    return ref_softmax(src, dst, axis, 0);
+}
+
+tl_tensor *tl_ref_log_softmax(const tl_tensor *src, tl_tensor *dst, int axis)
+{
+    return ref_softmax(src, dst, axis, 1);
+}
+
+/* Batch dims are broadcast numpy-style. TL_INT32 sums wrap like the
+   optimized op, floating point ones are taken in double. */
+tl_tensor *tl_ref_matmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                         int trans1, int trans2)
+{
+    int dims[TL_MAXDIM], ids[TL_MAXDIM], ids1[TL_MAXDIM], ids2[TL_MAXDIM];
+    int ndim, nd1, nd2, M, K, N, di, i, k, m, n, off1, off2;
+    double sum_d;
+    uint32_t sum_i;
+
+    assert(src1->data && src2->data);
+    assert(src1->dtype == src2->dtype);
+    assert(src1->dtype == TL_FLOAT || src1->dtype == TL_DOUBLE || src1->dtype == TL_INT32);
+    assert(src1->ndim >= 2 && src2->ndim >= 2);
+
+    nd1 = src1->ndim;
+    nd2 = src2->ndim;
+    M = trans1 ? src1->dims[nd1 - 1] : src1->dims[nd1 - 2];
+    K = trans1 ? src1->dims[nd1 - 2] : src1->dims[nd1 - 1];
+    N = trans2 ? src2->dims[nd2 - 2] : src2->dims[nd2 - 1];
+    assert(K == (trans2 ? src2->dims[nd2 - 1] : src2->dims[nd2 - 2]));
+    ndim = nd1 > nd2 ? nd1 : nd2;
+    for (i = 0; i < ndim - 2; i++) {
+        m = i - (ndim - nd1) >= 0 ? src1->dims[i - (ndim - nd1)] : 1;
+        n = i - (ndim - nd2) >= 0 ? src2->dims[i - (ndim - nd2)] : 1;
+        assert(m == n || m == 1 || n == 1);
+        dims[i] = m > n ? m : n;
+    }
+    dims[ndim - 2] = M;
+    dims[ndim - 1] = N;
+    dst = ref_dst(dst, ndim, dims, src1->dtype);
+
+    for (di = 0; di < dst->len; di++) {
+        tl_get_coords(di, ids, ndim, dims);
+        for (i = 0; i < nd1 - 2; i++)
+            ids1[i] = src1->dims[i] == 1 ? 0 : ids[i + ndim - nd1];
+        for (i = 0; i < nd2 - 2; i++)
+            ids2[i] = src2->dims[i] == 1 ? 0 : ids[i + ndim - nd2];
+        m = ids[ndim - 2];
+        n = ids[ndim - 1];
+        sum_d = 0;
+        sum_i = 0;
+        for (k = 0; k < K; k++) {
+            ids1[nd1 - 2] = trans1 ? k : m;
+            ids1[nd1 - 1] = trans1 ? m : k;
+            ids2[nd2 - 2] = trans2 ? n : k;
+            ids2[nd2 - 1] = trans2 ? k : n;
+            off1 = tl_get_index(ids1, nd1, src1->dims);
+            off2 = tl_get_index(ids2, nd2, src2->dims);
+            if (src1->dtype == TL_INT32)
+                sum_i += (uint32_t)((int32_t *)src1->data)[off1] *
+                         (uint32_t)((int32_t *)src2->data)[off2];
+            else
+                sum_d += get_double(src1, off1) * get_double(src2, off2);
+        }
+        if (src1->dtype == TL_INT32)
+            ((int32_t *)dst->data)[di] = (int32_t)sum_i;
+        else
+            set_double(dst, di, sum_d);
+    }
+    return dst;
+}
+
+/* [n, c, h, w] coordinates to an index of a TL_NCHW or TL_NHWC tensor */
+static int nchw_index(const tl_tensor *t, tl_layout layout, int n, int c, int h, int w)
+{
+    if (layout == TL_NCHW)
+        return tl_get_index((int[]){ n, c, h, w }, 4, t->dims);
+    return tl_get_index((int[]){ n, h, w, c }, 4, t->dims);
+}
+
+tl_tensor *tl_ref_conv2d(const tl_tensor *src, const tl_tensor *weight, const tl_tensor *bias,
+                         tl_tensor *dst, const int *stride, const int *padding,
+                         const int *dilation, int groups, tl_layout layout, int lrelu,
+                         float negslope)
+{
+    int N, C, H, W, OC, KH, KW, OH, OW, Cg, OCg, sh, sw, ph, pw, dh, dw;
+    int n, oc, oh, ow, c, kh, kw, h, w, wi;
+    int dims[4];
+    double sum;
+    float v;
+
+    assert(src && src->data);
+    assert(weight && weight->data);
+    assert(src->dtype == TL_FLOAT && weight->dtype == TL_FLOAT);
+    assert(src->ndim == 4 && weight->ndim == 4);
+    tl_check_layout(layout);
+
+    N = src->dims[0];
+    C = layout == TL_NCHW ? src->dims[1] : src->dims[3];
+    H = layout == TL_NCHW ? src->dims[2] : src->dims[1];
+    W = layout == TL_NCHW ? src->dims[3] : src->dims[2];
+    OC = layout == TL_NCHW ? weight->dims[0] : weight->dims[3];
+    KH = layout == TL_NCHW ? weight->dims[2] : weight->dims[0];
+    KW = layout == TL_NCHW ? weight->dims[3] : weight->dims[1];
+    sh = stride ? stride[0] : 1;
+    sw = stride ? stride[1] : 1;
+    ph = padding ? padding[0] : 0;
+    pw = padding ? padding[1] : 0;
+    dh = dilation ? dilation[0] : 1;
+    dw = dilation ? dilation[1] : 1;
+    assert(groups > 0 && C % groups == 0 && OC % groups == 0);
+    Cg = C / groups;
+    OCg = OC / groups;
+    OH = (H + 2 * ph - dh * (KH - 1) - 1) / sh + 1;
+    OW = (W + 2 * pw - dw * (KW - 1) - 1) / sw + 1;
+    dims[0] = N;
+    dims[1] = layout == TL_NCHW ? OC : OH;
+    dims[2] = layout == TL_NCHW ? OH : OW;
+    dims[3] = layout == TL_NCHW ? OW : OC;
+    dst = ref_dst(dst, 4, dims, TL_FLOAT);
+
+    for (n = 0; n < N; n++) {
+        for (oc = 0; oc < OC; oc++) {
+            for (oh = 0; oh < OH; oh++) {
+                for (ow = 0; ow < OW; ow++) {
+                    sum = bias ? ((float *)bias->data)[oc] : 0;
+                    for (c = 0; c < Cg; c++) {
+                        for (kh = 0; kh < KH; kh++) {
+                            for (kw = 0; kw < KW; kw++) {
+                                h = oh * sh - ph + kh * dh;
+                                w = ow * sw - pw + kw * dw;
+                                if (h < 0 || h >= H || w < 0 || w >= W)
+                                    continue;
+                                if (layout == TL_NCHW)
+                                    wi = tl_get_index((int[]){ oc, c, kh, kw }, 4, weight->dims);
+                                else
+                                    wi = tl_get_index((int[]){ kh, kw, c, oc }, 4, weight->dims);
+                                sum += (double)((float *)src->data)[nchw_index(
+                                           src, layout, n, (oc / OCg) * Cg + c, h, w)] *
+                                       ((float *)weight->data)[wi];
+                            }
+                        }
+                    }
+                    v = (float)sum;
+                    if (lrelu)
+                        v = v < 0 ? v * negslope : v;
+                    ((float *)dst->data)[nchw_index(dst, layout, n, oc, oh, ow)] = v;
+                }
+            }
+        }
+    }
+    return dst;
+}
+
+static int pool_out_size(int n, int k, int s, int p, int ceil_mode)
+{
+    int out = (n + 2 * p - k + (ceil_mode ? s - 1 : 0)) / s + 1;
+
+    if (ceil_mode && (out - 1) * s >= n + p)
+        out--;
+    return out;
+}
+
+static tl_tensor *ref_pool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
+                             const int *kernel, const int *stride, const int *padding,
+                             int ceil_mode, int count_include_pad, tl_layout layout, int is_max)
+{
+    int N, C, H, W, OH, OW, kh, kw, sh, sw, ph, pw;
+    int n, c, oh, ow, h, w, h0, w0, h1, w1, cnt_h, cnt_w, maxi;
+    int dims[4];
+    double sum;
+    float v, best;
+
+    assert(src && src->data);
+    assert(src->dtype == TL_FLOAT && src->ndim == 4);
+    assert(kernel);
+    tl_check_layout(layout);
+
+    N = src->dims[0];
+    C = layout == TL_NCHW ? src->dims[1] : src->dims[3];
+    H = layout == TL_NCHW ? src->dims[2] : src->dims[1];
+    W = layout == TL_NCHW ? src->dims[3] : src->dims[2];
+    kh = kernel[0];
+    kw = kernel[1];
+    sh = stride ? stride[0] : kh;
+    sw = stride ? stride[1] : kw;
+    ph = padding ? padding[0] : 0;
+    pw = padding ? padding[1] : 0;
+    OH = pool_out_size(H, kh, sh, ph, ceil_mode);
+    OW = pool_out_size(W, kw, sw, pw, ceil_mode);
+    dims[0] = N;
+    dims[1] = layout == TL_NCHW ? C : OH;
+    dims[2] = layout == TL_NCHW ? OH : OW;
+    dims[3] = layout == TL_NCHW ? OW : C;
+    dst = ref_dst(dst, 4, dims, TL_FLOAT);
+    if (arg)
+        check_dst(arg, 4, dims, TL_INT32);
+
+    for (n = 0; n < N; n++) {
+        for (c = 0; c < C; c++) {
+            for (oh = 0; oh < OH; oh++) {
+                for (ow = 0; ow < OW; ow++) {
+                    h0 = oh * sh - ph;
+                    w0 = ow * sw - pw;
+                    best = -FLT_MAX;
+                    maxi = -1;
+                    sum = 0;
+                    for (h = h0 < 0 ? 0 : h0; h < h0 + kh && h < H; h++) {
+                        for (w = w0 < 0 ? 0 : w0; w < w0 + kw && w < W; w++) {
+                            v = ((float *)src->data)[nchw_index(src, layout, n, c, h, w)];
+                            sum += v;
+                            if (maxi < 0 || v > best) {
+                                best = v;
+                                maxi = h * W + w;
+                            }
+                        }
+                    }
+                    if (is_max) {
+                        v = best;
+                    } else {
+                        h1 = h0 + kh;
+                        w1 = w0 + kw;
+                        if (count_include_pad) {
+                            cnt_h = (h1 > H + ph ? H + ph : h1) - h0;
+                            cnt_w = (w1 > W + pw ? W + pw : w1) - w0;
+                        } else {
+                            cnt_h = (h1 > H ? H : h1) - (h0 < 0 ? 0 : h0);
+                            cnt_w = (w1 > W ? W : w1) - (w0 < 0 ? 0 : w0);
+                        }
+                        v = (float)(sum / ((double)cnt_h * cnt_w));
+                    }
+                    ((float *)dst->data)[nchw_index(dst, layout, n, c, oh, ow)] = v;
+                    if (arg)
+                        ((int32_t *)arg->data)[nchw_index(arg, layout, n, c, oh, ow)] = maxi;
+                }
+            }
+        }
+    }
+    return dst;
+}
+
+tl_tensor *tl_ref_maxpool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
+                            const int *kernel, const int *stride, const int *padding,
+                            int ceil_mode, tl_layout layout)
+{
+    return ref_pool2d(src, dst, arg, kernel, stride, padding, ceil_mode, 0, layout, 1);
+}
+
+tl_tensor *tl_ref_avgpool2d(const tl_tensor *src, tl_tensor *dst, const int *kernel,
+                            const int *stride, const int *padding, int ceil_mode,
+                            int count_include_pad, tl_layout layout)
+{
+    return ref_pool2d(src, dst, NULL, kernel, stride, padding, ceil_mode, count_include_pad,
+                      layout, 0);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_REF_H_
+#define _TL_REF_H_
+
+#include "tl_tensor.h"
+
+/* Reference backend: single-threaded, element-at-a-time versions of the
+   tl_tensor_* ops, written for obviousness rather than speed. They take the
+   same arguments and allocate the same dst (and arg) as the ops they mirror,
+   and serve as the oracle for the differential tests. Floating point results
+   may differ from the optimized ops by rounding only, since the reference
+   sums in a different order (and in double where the ops use float). */
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+tl_tensor *tl_ref_elew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                       tl_elew_op elew_op);
+tl_tensor *tl_ref_elew_param(const tl_tensor *src, double param, tl_tensor *dst,
+                             tl_elew_op elew_op);
+tl_tensor *tl_ref_convert(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype_d);
+tl_tensor *tl_ref_lrelu(const tl_tensor *src, tl_tensor *dst, float negslope);
+tl_tensor *tl_ref_maxreduce(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg, int axis);
+tl_tensor *tl_ref_transpose(const tl_tensor *src, tl_tensor *dst, const int *axes);
+tl_tensor *tl_ref_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims,
+                         tl_resize_type rtype);
+tl_tensor *tl_ref_slice_nd(const tl_tensor *src, tl_tensor *dst, const int *start,
+                           const int *stop, const int *step);
+tl_tensor *tl_ref_concat_n(const tl_tensor **srcs, int n, tl_tensor *dst, int axis);
+tl_tensor *tl_ref_pad(const tl_tensor *src, tl_tensor *dst, const int *pads, tl_pad_mode mode,
+                      double value);
+tl_tensor *tl_ref_dot_product(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst);
+tl_tensor *tl_ref_norm(const tl_tensor *src, tl_tensor *dst, tl_norm_type ord);
+tl_tensor *tl_ref_softmax(const tl_tensor *src, tl_tensor *dst, int axis);
+tl_tensor *tl_ref_log_softmax(const tl_tensor *src, tl_tensor *dst, int axis);
+tl_tensor *tl_ref_matmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                         int trans1, int trans2);
+tl_tensor *tl_ref_conv2d(const tl_tensor *src, const tl_tensor *weight, const tl_tensor *bias,
+                         tl_tensor *dst, const int *stride, const int *padding,
+                         const int *dilation, int groups, tl_layout layout, int lrelu,
+                         float negslope);
+tl_tensor *tl_ref_maxpool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
+                            const int *kernel, const int *stride, const int *padding,
+                            int ceil_mode, tl_layout layout);
+tl_tensor *tl_ref_avgpool2d(const tl_tensor *src, tl_tensor *dst, const int *kernel,
+                            const int *stride, const int *padding, int ceil_mode,
+                            int count_include_pad, tl_layout layout);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_REF_H_ */
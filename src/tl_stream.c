@@ -0,0 +1,617 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+#include "tl_stream.h"
+
+#ifndef ESP32
+
+#include <pthread.h>
+
+struct tl_future {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int refs; /* the caller's and the pending task's */
+    int done;
+    void *result;
+};
+
+/* Each record bumps recorded and enqueues a marker, which sets completed to
+   its generation when the stream reaches it. */
+struct tl_event {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int refs; /* the caller's and the pending tasks' */
+    unsigned long recorded;
+    unsigned long completed;
+};
+
+enum task_kind {
+    TASK_FUNC,
+    TASK_RECORD,
+    TASK_WAIT,
+};
+
+struct task {
+    enum task_kind kind;
+    tl_stream_func func;
+    void *arg;
+    tl_future *future;
+    tl_event *event;
+    unsigned long generation;
+    struct task *next;
+};
+
+struct tl_stream {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t idle_cond;
+    struct task *head;
+    struct task *tail;
+    int pending; /* queued and running tasks */
+    int stop;
+    pthread_t thread;
+};
+
+static void future_unref(tl_future *f)
+{
+    int refs;
+
+    pthread_mutex_lock(&f->lock);
+    refs = --f->refs;
+    pthread_mutex_unlock(&f->lock);
+    if (refs > 0)
+        return;
+    pthread_mutex_destroy(&f->lock);
+    pthread_cond_destroy(&f->cond);
+    tl_free(f);
+}
+
+static void event_unref(tl_event *e)
+{
+    int refs;
+
+    pthread_mutex_lock(&e->lock);
+    refs = --e->refs;
+    pthread_mutex_unlock(&e->lock);
+    if (refs > 0)
+        return;
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->cond);
+    tl_free(e);
+}
+
+static void run_task(struct task *t)
+{
+    void *result;
+
+    switch (t->kind) {
+    case TASK_FUNC:
+        result = t->func(t->arg);
+        pthread_mutex_lock(&t->future->lock);
+        t->future->result = result;
+        t->future->done = 1;
+        pthread_cond_broadcast(&t->future->cond);
+        pthread_mutex_unlock(&t->future->lock);
+        future_unref(t->future);
+        break;
+    case TASK_RECORD:
+        pthread_mutex_lock(&t->event->lock);
+        if (t->event->completed < t->generation)
+            t->event->completed = t->generation;
+        pthread_cond_broadcast(&t->event->cond);
+        pthread_mutex_unlock(&t->event->lock);
+        event_unref(t->event);
+        break;
+    case TASK_WAIT:
+        pthread_mutex_lock(&t->event->lock);
+        while (t->event->completed < t->generation)
+            pthread_cond_wait(&t->event->cond, &t->event->lock);
+        pthread_mutex_unlock(&t->event->lock);
+        event_unref(t->event);
+        break;
+    }
+    tl_free(t);
+}
+
+static void *stream_main(void *data)
+{
+    tl_stream *s = data;
+    struct task *t;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (!s->head && !s->stop)
+            pthread_cond_wait(&s->work_cond, &s->lock);
+        if (!s->head)
+            break;
+        t = s->head;
+        s->head = t->next;
+        if (!s->head)
+            s->tail = NULL;
+        pthread_mutex_unlock(&s->lock);
+
+        run_task(t);
+
+        pthread_mutex_lock(&s->lock);
+        if (--s->pending == 0)
+            pthread_cond_broadcast(&s->idle_cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static struct task *task_create(enum task_kind kind)
+{
+    struct task *t;
+
+    t = tl_alloc(sizeof(struct task));
+    memset(t, 0, sizeof(struct task));
+    t->kind = kind;
+    return t;
+}
+
+static void stream_push(tl_stream *s, struct task *t)
+{
+    pthread_mutex_lock(&s->lock);
+    if (s->tail)
+        s->tail->next = t;
+    else
+        s->head = t;
+    s->tail = t;
+    s->pending++;
+    pthread_cond_signal(&s->work_cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+TL_EXPORT tl_stream *tl_stream_create(void)
+{
+    tl_stream *s;
+    int ret;
+
+    s = tl_alloc(sizeof(tl_stream));
+    memset(s, 0, sizeof(tl_stream));
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work_cond, NULL);
+    pthread_cond_init(&s->idle_cond, NULL);
+    ret = pthread_create(&s->thread, NULL, stream_main, s);
+    assert(ret == 0 && "can't create the stream's thread");
+    (void)ret;
+    return s;
+}
+
+/* Waits for the work enqueued on s before freeing it. */
+TL_EXPORT void tl_stream_free(tl_stream *s)
+{
+    if (!s)
+        return;
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_signal(&s->work_cond);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->work_cond);
+    pthread_cond_destroy(&s->idle_cond);
+    tl_free(s);
+}
+
+/* Enqueues func(arg), whose return value becomes the result of the returned
+   future. The future must be freed with tl_future_free(), which may be
+   called before it's ready. */
+TL_EXPORT tl_future *tl_stream_enqueue(tl_stream *s, tl_stream_func func, void *arg)
+{
+    struct task *t;
+    tl_future *f;
+
+    assert(s && func);
+    f = tl_alloc(sizeof(tl_future));
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->cond, NULL);
+    f->refs = 2;
+    f->done = 0;
+    f->result = NULL;
+
+    t = task_create(TASK_FUNC);
+    t->func = func;
+    t->arg = arg;
+    t->future = f;
+    stream_push(s, t);
+    return f;
+}
+
+/* Work enqueued on s after this call waits until the last record of e
+   before this call completes. Does nothing if e was never recorded. */
+TL_EXPORT void tl_stream_wait_event(tl_stream *s, tl_event *e)
+{
+    struct task *t;
+
+    assert(s && e);
+    pthread_mutex_lock(&e->lock);
+    if (e->completed >= e->recorded) {
+        pthread_mutex_unlock(&e->lock);
+        return;
+    }
+    e->refs++;
+    t = task_create(TASK_WAIT);
+    t->event = e;
+    t->generation = e->recorded;
+    pthread_mutex_unlock(&e->lock);
+    stream_push(s, t);
+}
+
+/* Blocks until all the work enqueued on s so far is done. */
+TL_EXPORT void tl_stream_synchronize(tl_stream *s)
+{
+    assert(s);
+    pthread_mutex_lock(&s->lock);
+    while (s->pending > 0)
+        pthread_cond_wait(&s->idle_cond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+TL_EXPORT tl_event *tl_event_create(void)
+{
+    tl_event *e;
+
+    e = tl_alloc(sizeof(tl_event));
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->cond, NULL);
+    e->refs = 1;
+    e->recorded = 0;
+    e->completed = 0;
+    return e;
+}
+
+/* e may be freed while records of it or waits for it are pending. */
+TL_EXPORT void tl_event_free(tl_event *e)
+{
+    if (e)
+        event_unref(e);
+}
+
+/* Captures the work enqueued on s so far: e completes once it's all done.
+   Recording again replaces what e captured. */
+TL_EXPORT void tl_event_record(tl_event *e, tl_stream *s)
+{
+    struct task *t;
+
+    assert(e && s);
+    t = task_create(TASK_RECORD);
+    pthread_mutex_lock(&e->lock);
+    e->refs++;
+    t->event = e;
+    t->generation = ++e->recorded;
+    pthread_mutex_unlock(&e->lock);
+    stream_push(s, t);
+}
+
+/* Returns nonzero if the last record of e completed, or e was never
+   recorded. */
+TL_EXPORT int tl_event_query(tl_event *e)
+{
+    int done;
+
+    assert(e);
+    pthread_mutex_lock(&e->lock);
+    done = e->completed >= e->recorded;
+    pthread_mutex_unlock(&e->lock);
+    return done;
+}
+
+/* Blocks until the last record of e completes. */
+TL_EXPORT void tl_event_synchronize(tl_event *e)
+{
+    unsigned long generation;
+
+    assert(e);
+    pthread_mutex_lock(&e->lock);
+    generation = e->recorded;
+    while (e->completed < generation)
+        pthread_cond_wait(&e->cond, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+}
+
+TL_EXPORT int tl_future_ready(tl_future *f)
+{
+    int done;
+
+    assert(f);
+    pthread_mutex_lock(&f->lock);
+    done = f->done;
+    pthread_mutex_unlock(&f->lock);
+    return done;
+}
+
+/* Blocks until f is ready and returns its result. */
+TL_EXPORT void *tl_future_get(tl_future *f)
+{
+    void *result;
+
+    assert(f);
+    pthread_mutex_lock(&f->lock);
+    while (!f->done)
+        pthread_cond_wait(&f->cond, &f->lock);
+    result = f->result;
+    pthread_mutex_unlock(&f->lock);
+    return result;
+}
+
+TL_EXPORT void tl_future_free(tl_future *f)
+{
+    if (f)
+        future_unref(f);
+}
+
+#else /* ESP32 */
+
+/* Without threads, enqueued work runs right away and everything is always
+   complete. */
+
+struct tl_future {
+    void *result;
+};
+
+struct tl_event {
+    int unused;
+};
+
+struct tl_stream {
+    int unused;
+};
+
+TL_EXPORT tl_stream *tl_stream_create(void)
+{
+    return tl_alloc(sizeof(tl_stream));
+}
+
+TL_EXPORT void tl_stream_free(tl_stream *s)
+{
+    tl_free(s);
+}
+
+TL_EXPORT tl_future *tl_stream_enqueue(tl_stream *s, tl_stream_func func, void *arg)
+{
+    tl_future *f;
+
+    assert(s && func);
+    f = tl_alloc(sizeof(tl_future));
+    f->result = func(arg);
+    return f;
+}
+
+TL_EXPORT void tl_stream_wait_event(tl_stream *s, tl_event *e)
+{
+    assert(s && e);
+}
+
+TL_EXPORT void tl_stream_synchronize(tl_stream *s)
+{
+    assert(s);
+}
+
+TL_EXPORT tl_event *tl_event_create(void)
+{
+    return tl_alloc(sizeof(tl_event));
+}
+
+TL_EXPORT void tl_event_free(tl_event *e)
+{
+    tl_free(e);
+}
+
+TL_EXPORT void tl_event_record(tl_event *e, tl_stream *s)
+{
+    assert(e && s);
+}
+
+TL_EXPORT int tl_event_query(tl_event *e)
+{
+    assert(e);
+    return 1;
+}
+
+TL_EXPORT void tl_event_synchronize(tl_event *e)
+{
+    assert(e);
+}
+
+TL_EXPORT int tl_future_ready(tl_future *f)
+{
+    assert(f);
+    return 1;
+}
+
+TL_EXPORT void *tl_future_get(tl_future *f)
+{
+    assert(f);
+    return f->result;
+}
+
+TL_EXPORT void tl_future_free(tl_future *f)
+{
+    tl_free(f);
+}
+
+#endif /* ESP32 */
+
+/* the arguments of an enqueued op, freed by the op */
+struct op_args {
+    const tl_tensor *src1;
+    const tl_tensor *src2;
+    tl_tensor *dst;
+    tl_elew_op elew_op;
+    double param;
+    float negslope;
+    tl_dtype dtype;
+    int trans1;
+    int trans2;
+    int axes[TL_MAXDIM];
+    tl_graph *graph;
+    const tl_tensor **inputs;
+};
+
+static struct op_args *op_args_create(const tl_tensor *src1, const tl_tensor *src2,
+                                      tl_tensor *dst)
+{
+    struct op_args *a;
+
+    a = tl_alloc(sizeof(struct op_args));
+    memset(a, 0, sizeof(struct op_args));
+    a->src1 = src1;
+    a->src2 = src2;
+    a->dst = dst;
+    return a;
+}
+
+static void *elew_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_elew(a->src1, a->src2, a->dst, a->elew_op);
+
+    tl_free(a);
+    return dst;
+}
+
+TL_EXPORT tl_future *tl_stream_elew(tl_stream *s, const tl_tensor *src1, const tl_tensor *src2,
+                                    tl_tensor *dst, tl_elew_op elew_op)
+{
+    struct op_args *a = op_args_create(src1, src2, dst);
+
+    a->elew_op = elew_op;
+    return tl_stream_enqueue(s, elew_func, a);
+}
+
+static void *elew_param_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_elew_param(a->src1, a->param, a->dst, a->elew_op);
+
+    tl_free(a);
+    return dst;
+}
+
+TL_EXPORT tl_future *tl_stream_elew_param(tl_stream *s, const tl_tensor *src, double param,
+                                          tl_tensor *dst, tl_elew_op elew_op)
+{
+    struct op_args *a = op_args_create(src, NULL, dst);
+
+    a->param = param;
+    a->elew_op = elew_op;
+    return tl_stream_enqueue(s, elew_param_func, a);
+}
+
+static void *convert_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_convert(a->src1, a->dst, a->dtype);
+
+    tl_free(a);
+    return dst;
+}
+
+TL_EXPORT tl_future *tl_stream_convert(tl_stream *s, const tl_tensor *src, tl_tensor *dst,
+                                       tl_dtype dtype_d)
+{
+    struct op_args *a = op_args_create(src, NULL, dst);
+
+    a->dtype = dtype_d;
+    return tl_stream_enqueue(s, convert_func, a);
+}
+
+static void *lrelu_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_lrelu(a->src1, a->dst, a->negslope);
+
+    tl_free(a);
+    return dst;
+}
+
+TL_EXPORT tl_future *tl_stream_lrelu(tl_stream *s, const tl_tensor *src, tl_tensor *dst,
+                                     float negslope)
+{
+    struct op_args *a = op_args_create(src, NULL, dst);
+
+    a->negslope = negslope;
+    return tl_stream_enqueue(s, lrelu_func, a);
+}
+
+static void *transpose_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_transpose(a->src1, a->dst, a->axes);
+
+    tl_free(a);
+    return dst;
+}
+
+/* axes is copied */
+TL_EXPORT tl_future *tl_stream_transpose(tl_stream *s, const tl_tensor *src, tl_tensor *dst,
+                                         const int *axes)
+{
+    struct op_args *a = op_args_create(src, NULL, dst);
+
+    assert(src);
+    memmove(a->axes, axes, sizeof(int) * src->ndim);
+    return tl_stream_enqueue(s, transpose_func, a);
+}
+
+static void *matmul_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_tensor *dst = tl_tensor_matmul(a->src1, a->src2, a->dst, a->trans1, a->trans2);
+
+    tl_free(a);
+    return dst;
+}
+
+TL_EXPORT tl_future *tl_stream_matmul(tl_stream *s, const tl_tensor *src1, const tl_tensor *src2,
+                                      tl_tensor *dst, int trans1, int trans2)
+{
+    struct op_args *a = op_args_create(src1, src2, dst);
+
+    a->trans1 = trans1;
+    a->trans2 = trans2;
+    return tl_stream_enqueue(s, matmul_func, a);
+}
+
+static void *graph_run_func(void *arg)
+{
+    struct op_args *a = arg;
+    tl_graph *g = a->graph;
+
+    tl_graph_run(g, a->inputs);
+    tl_free(a);
+    return g;
+}
+
+/* The future's result is g, whose outputs can be read once it's ready. The
+   inputs array is read when the run starts, so it must stay valid too. */
+TL_EXPORT tl_future *tl_stream_graph_run(tl_stream *s, tl_graph *g, const tl_tensor **inputs)
+{
+    struct op_args *a = op_args_create(NULL, NULL, NULL);
+
+    a->graph = g;
+    a->inputs = inputs;
+    return tl_stream_enqueue(s, graph_run_func, a);
+}
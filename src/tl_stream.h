@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_STREAM_H_
+#define _TL_STREAM_H_
+
+#include "tl_tensor.h"
+#include "tl_graph.h"
+
+/* CPU streams, after the CUDA stream model. Work enqueued on a stream runs
+   asynchronously on the stream's own worker thread, in enqueue order. An
+   event recorded on a stream completes when the stream reaches it, and
+   other streams can wait for it before running their later work. Each
+   enqueue returns a future holding the result of the work.
+
+   Tensors (and graphs) passed to enqueued ops must stay valid, and must not
+   be written by others, until the op's future is ready. Ops with a NULL
+   dst return a new tensor from tl_future_get(), owned by the caller. Ops
+   parallelized with tl_parallel_for() share one thread pool, so ops running
+   on different streams at the same time may run single-threaded. */
+
+typedef struct tl_stream tl_stream;
+typedef struct tl_event tl_event;
+typedef struct tl_future tl_future;
+typedef void *(*tl_stream_func)(void *arg);
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+tl_stream *tl_stream_create(void);
+void tl_stream_free(tl_stream *s);
+tl_future *tl_stream_enqueue(tl_stream *s, tl_stream_func func, void *arg);
+void tl_stream_wait_event(tl_stream *s, tl_event *e);
+void tl_stream_synchronize(tl_stream *s);
+tl_future *tl_stream_elew(tl_stream *s, const tl_tensor *src1, const tl_tensor *src2,
+                          tl_tensor *dst, tl_elew_op elew_op);
+tl_future *tl_stream_elew_param(tl_stream *s, const tl_tensor *src, double param, tl_tensor *dst,
+                                tl_elew_op elew_op);
+tl_future *tl_stream_convert(tl_stream *s, const tl_tensor *src, tl_tensor *dst,
+                             tl_dtype dtype_d);
+tl_future *tl_stream_lrelu(tl_stream *s, const tl_tensor *src, tl_tensor *dst, float negslope);
+tl_future *tl_stream_transpose(tl_stream *s, const tl_tensor *src, tl_tensor *dst,
+                               const int *axes);
+tl_future *tl_stream_matmul(tl_stream *s, const tl_tensor *src1, const tl_tensor *src2,
+                            tl_tensor *dst, int trans1, int trans2);
+tl_future *tl_stream_graph_run(tl_stream *s, tl_graph *g, const tl_tensor **inputs);
+
+tl_event *tl_event_create(void);
+void tl_event_free(tl_event *e);
+void tl_event_record(tl_event *e, tl_stream *s);
+int tl_event_query(tl_event *e);
+void tl_event_synchronize(tl_event *e);
+
+int tl_future_ready(tl_future *f);
+void *tl_future_get(tl_future *f);
+void tl_future_free(tl_future *f);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+#endif /* _TL_STREAM_H_ */
@@ -21,6 +21,8 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+#include "tl_text.h"
 
 TL_EXPORT int tl_tensor_index(const tl_tensor *t, int *coords)
 {
@@ -60,6 +62,8 @@ TL_EXPORT tl_tensor *tl_tensor_create(void *data, int ndim, const int *dims, tl_
 {
     tl_tensor *t;
 
+    TL_PROFILE_OP();
+
     assert(ndim > 0 && ndim <= TL_MAXDIM);
     for (int i = 0; i < ndim; i++)
         assert(dims[i] > 0);
@@ -73,20 +77,26 @@ TL_EXPORT tl_tensor *tl_tensor_create(void *data, int ndim, const int *dims, tl_
     t->backend_data = NULL;
     t->data = data;
     t->owner = NULL;
+    t->quant = NULL;
 
     return t;
 }
 
 TL_EXPORT void tl_tensor_free(tl_tensor *t)
 {
+    TL_PROFILE_OP();
+
     if (!t)
         return;
+    tl_quant_free(t->quant);
     tl_free(t->dims);
     tl_free(t);
 }
 
 TL_EXPORT void tl_tensor_free_data_too(tl_tensor *t)
 {
+    TL_PROFILE_OP();
+
     if (!t)
         return;
     tl_free(t->data);
@@ -98,11 +108,69 @@ TL_EXPORT tl_tensor *tl_tensor_zeros(int ndim, const int *dims, tl_dtype dtype)
     tl_tensor *t;
     size_t size;
 
+    TL_PROFILE_OP();
+
     t = tl_tensor_create(NULL, ndim, dims, dtype);
     t->owner = t;
     size = t->len * tl_size_of(dtype);
     t->data = tl_alloc(size);
     memset(t->data, 0, size);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(t));
+    return t;
+}
+
+struct fill_info {
+    void *data;
+    const void *value;
+    size_t dsize;
+};
+
+#define FILL_GRAIN (1 << 14)
+
+static void fill_worker(void *arg, int start, int end)
+{
+    const struct fill_info *info = arg;
+
+    tl_get_kernels()->fill[tl_size_index(info->dsize)](tl_padd(info->data, start, info->dsize),
+                                                       info->value, end - start);
+}
+
+static tl_tensor *fill(tl_tensor *dst, double value)
+{
+    struct fill_info info;
+    uint8_t elem[sizeof(double) * 2];
+
+    assert(dst && dst->data);
+    info.dsize = tl_size_of(dst->dtype);
+    assert(info.dsize <= sizeof(elem));
+    tl_convert(elem, dst->dtype, &value, TL_DOUBLE);
+    info.data = dst->data;
+    info.value = elem;
+    tl_parallel_for(dst->len, FILL_GRAIN, fill_worker, &info);
+    return dst;
+}
+
+/* Set every element of dst to value, converted to dst's dtype. */
+TL_EXPORT tl_tensor *tl_tensor_fill(tl_tensor *dst, double value)
+{
+    TL_PROFILE_OP();
+
+    fill(dst, value);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_tensor *tl_tensor_full(int ndim, const int *dims, tl_dtype dtype, double value)
+{
+    tl_tensor *t;
+
+    TL_PROFILE_OP();
+
+    t = tl_tensor_create(NULL, ndim, dims, dtype);
+    t->owner = t;
+    t->data = tl_alloc(t->len * tl_size_of(dtype));
+    fill(t, value);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(t));
     return t;
 }
 
@@ -111,177 +179,259 @@ TL_EXPORT size_t tl_tensor_size(tl_tensor *t)
     return t->len * tl_size_of(t->dtype);
 }
 
+/* the dtype and shape of t */
+TL_EXPORT void tl_tensor_shape(const tl_tensor *t, tl_shape *shape)
+{
+    assert(t && shape);
+    shape->dtype = t->dtype;
+    shape->ndim = t->ndim;
+    memcpy(shape->dims, t->dims, sizeof(int) * t->ndim);
+}
+
+/* bytes of a tensor of the shape */
+TL_EXPORT size_t tl_shape_size(const tl_shape *shape)
+{
+    assert(shape);
+    return (size_t)tl_compute_length(shape->ndim, shape->dims) * tl_size_of(shape->dtype);
+}
+
+/* tl_tensor_create() with the dtype and dims of shape; data may be a buffer
+   the caller planned, of tl_shape_size(shape) bytes */
+TL_EXPORT tl_tensor *tl_tensor_create_shape(void *data, const tl_shape *shape)
+{
+    assert(shape);
+    return tl_tensor_create(data, shape->ndim, shape->dims, shape->dtype);
+}
+
+TL_EXPORT tl_tensor *tl_tensor_zeros_shape(const tl_shape *shape)
+{
+    assert(shape);
+    return tl_tensor_zeros(shape->ndim, shape->dims, shape->dtype);
+}
+
 TL_EXPORT tl_tensor *tl_tensor_clone(const tl_tensor *src)
 {
     void *data;
     tl_tensor *dst;
 
+    TL_PROFILE_OP();
+
     assert(src);
     data = tl_clone(src->data, src->len * tl_size_of(src->dtype));
     dst = tl_tensor_create(data, src->ndim, src->dims, src->dtype);
     dst->owner = dst;
+    dst->quant = tl_quant_clone(src->quant);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
+TL_EXPORT tl_shape *tl_tensor_repeat_out_shape(const tl_tensor *src, int times, tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->ndim < TL_MAXDIM);
+    assert(times > 0);
+    shape->dtype = src->dtype;
+    shape->ndim = src->ndim + 1;
+    shape->dims[0] = times;
+    memcpy(shape->dims + 1, src->dims, sizeof(int) * src->ndim);
+    return shape;
+}
+
 TL_EXPORT tl_tensor *tl_tensor_repeat(const tl_tensor *src, int times)
 {
+    tl_shape shape;
     void *data;
-    int *dims;
     tl_tensor *dst;
 
-    assert(src);
+    TL_PROFILE_OP();
+
+    tl_tensor_repeat_out_shape(src, times, &shape);
     data = tl_repeat(src->data, src->len * tl_size_of(src->dtype), times);
-    dims = (int *)tl_alloc(sizeof(int) * (src->ndim + 1));
-    memmove(dims + 1, src->dims, sizeof(int) * (src->ndim));
-    dims[0] = times;
-    dst = tl_tensor_create(data, src->ndim + 1, dims, src->dtype);
+    dst = tl_tensor_create_shape(data, &shape);
     dst->owner = dst;
-    tl_free(dims);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
+struct arange_info {
+    void *data;
+    tl_dtype dtype;
+    double start, step;
+};
+
+static void arange_worker(void *arg, int start, int end)
+{
+    const struct arange_info *info = arg;
+
+    tl_get_kernels()->arange_n[info->dtype](tl_padd(info->data, start, tl_size_of(info->dtype)),
+                                            info->start, info->step, start, end - start);
+}
+
+/* element i is start + step * i computed in double and converted to t's
+   dtype, the same as tl_convert would */
+static void arange_fill(tl_tensor *t, double start, double step)
+{
+    struct arange_info info;
+
+    info.data = t->data;
+    info.dtype = t->dtype;
+    info.start = start;
+    info.step = step;
+    tl_parallel_for(t->len, FILL_GRAIN, arange_worker, &info);
+}
+
+/* NULL if the range has more than INT32_MAX elements */
+TL_EXPORT tl_shape *tl_tensor_arange_out_shape(double start, double stop, double step,
+                                               tl_dtype dtype, tl_shape *shape)
+{
+    double len;
+
+    assert(shape);
+    tl_check_dtype(dtype);
+    len = ceil((stop - start) / step);
+    if (len > INT32_MAX)
+        return NULL;
+    shape->dtype = dtype;
+    shape->ndim = 1;
+    shape->dims[0] = (int)len;
+    return shape;
+}
+
 TL_EXPORT tl_tensor *tl_tensor_arange(double start, double stop, double step, tl_dtype dtype)
 {
-    int dims[1];
+    tl_shape shape;
     tl_tensor *dst;
-    double len, elem;
-    size_t dsize;
 
-    dsize = tl_size_of(dtype);
+    TL_PROFILE_OP();
+
 #ifdef TL_DEBUG
-    double max_d, min_d;
-    max_d = tl_dtype_max_double(dtype);
-    min_d = tl_dtype_min_double(dtype);
-    assert(start >= min_d && start <= max_d);
-    assert(stop >= min_d && stop <= max_d);
-    assert(step >= min_d && step <= max_d);
+    /* elements out of dtype's range saturate, so only the range is checked */
     assert(step != 0);
     assert(stop > start); /* TODO: expand to all possibilities */
 #endif
 
-    len = ceil((stop - start) / step);
-    if (len > INT32_MAX)
+    if (!tl_tensor_arange_out_shape(start, stop, step, dtype, &shape))
         return NULL;
 
-    dims[0] = (int)len;
-    dst = tl_tensor_zeros(1, dims, dtype);
-    for (int i = 0; i < dims[0]; i++) {
-        elem = start + step * i;
-        tl_convert(tl_padd(dst->data, i, dsize), dtype, &elem, TL_DOUBLE);
-    }
+    dst = tl_tensor_create_shape(NULL, &shape);
+    dst->owner = dst;
+    dst->data = tl_alloc(dst->len * tl_size_of(dtype));
+    arange_fill(dst, start, step);
 
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
 TL_EXPORT void tl_tensor_rearange(tl_tensor *src, double start, double stop, double step)
 {
-    double len, elem;
-    size_t dsize;
+    double len;
+
+    TL_PROFILE_OP();
 
 #ifdef TL_DEBUG
-    double max_d, min_d;
-    max_d = tl_dtype_max_double(src->dtype);
-    min_d = tl_dtype_min_double(src->dtype);
-    assert(start >= min_d && start <= max_d);
-    assert(stop >= min_d && stop <= max_d);
-    assert(step >= min_d && step <= max_d);
+    /* elements out of dtype's range saturate, so only the range is checked */
     assert(step != 0);
     assert(stop > start); /* TODO: expand to all possibilities */
 #endif
 
     len = ceil((stop - start) / step);
-    dsize = tl_size_of(src->dtype);
 
     assert(len <= INT32_MAX);
     assert(src->ndim == 1);
     assert(src->len == (int)len);
     assert(src->data);
 
-    for (int i = 0; i < src->len; i++) {
-        elem = start + step * i;
-        tl_convert(tl_padd(src->data, i, dsize), src->dtype, &elem, TL_DOUBLE);
-    }
+    arange_fill(src, start, step);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(src));
 }
 
-TL_EXPORT void tl_tensor_fprint(FILE *stream, const tl_tensor *t, const char *fmt)
+/* Print t in nested brackets, one innermost row per line. If edgeitems > 0,
+   axes longer than 2 * edgeitems only show their first and last edgeitems
+   entries, with "..." in place of the rest. Everything is formatted into one
+   buffer; the bracket bookkeeping is a multi-index that carries from the
+   innermost axis, so that it costs nothing for most elements. */
+static void fprint_tensor(FILE *stream, const tl_tensor *t, const char *fmt, int edgeitems)
 {
-    int ndim, len, *dims; /* pointer short cut */
-    void *data;
-    tl_dtype dtype;
-    size_t dsize;
-
-    /* dimision size and how deep current chars go */
-    int *dim_sizes, *dim_levels;
-    /* buffer for brackets */
-    char *left_buf, *right_buf;
-    char *lp, *rp;
-    size_t right_len;
-    int i, j, k;
+    struct tl_text_writer w;
+    struct tl_text_format f;
+    int idx[TL_MAXDIM], shown[TL_MAXDIM], skip[TL_MAXDIM];
+    size_t strides[TL_MAXDIM], stride, off, dsize;
+    int ndim, i, j, k, gap;
 
     assert(stream && t);
     ndim = t->ndim;
-    len = t->len;
-    dims = t->dims;
-    data = t->data;
-    dtype = t->dtype;
-    dsize = tl_size_of(dtype);
-
-    dim_sizes = (int *)tl_alloc(sizeof(int) * ndim);
-    dim_levels = (int *)tl_alloc(sizeof(int) * ndim);
-    dim_sizes[ndim - 1] = dims[ndim - 1];
-    dim_levels[ndim - 1] = 0;
-    left_buf = (char *)tl_alloc(sizeof(char) * (ndim + 1));
-    right_buf = (char *)tl_alloc(sizeof(char) * (ndim + 1));
-    lp = left_buf;
-    rp = right_buf;
-
-    for (i = ndim - 2; i >= 0; i--) {
-        dim_sizes[i] = dims[i] * dim_sizes[i + 1];
-        dim_levels[i] = 0;
+    dsize = tl_size_of(t->dtype);
+    for (i = ndim - 1, stride = 1; i >= 0; stride *= t->dims[i], i--) {
+        strides[i] = stride;
+        idx[i] = 0;
+        if (edgeitems > 0 && t->dims[i] > 2 * edgeitems) {
+            shown[i] = 2 * edgeitems;
+            skip[i] = t->dims[i] - 2 * edgeitems;
+        } else {
+            shown[i] = t->dims[i];
+            skip[i] = 0;
+        }
     }
-    for (i = 0; i < len; i++) {
-        for (j = 0; j < ndim; j++) {
-            if (i % dim_sizes[j] == 0)
-                dim_levels[j]++;
-            if (dim_levels[j] == 1) {
-                *lp++ = '[';
-                dim_levels[j]++;
-            }
-            if (dim_levels[j] == 3) {
-                *rp++ = ']';
-                if (j != 0 && dim_levels[j] > dim_levels[j - 1]) {
-                    *lp++ = '[';
-                    dim_levels[j] = 2;
-                } else
-                    dim_levels[j] = 0;
-            }
+
+    tl_text_writer_init(&w, stream);
+    tl_text_format_init(&f, t->dtype, fmt);
+    tl_text_repeat(&w, '[', ndim);
+    for (off = 0;;) {
+        tl_text_write_elem(&w, &f, tl_padd(t->data, off, dsize));
+        for (j = ndim - 1; j >= 0 && ++idx[j] == shown[j]; j--)
+            idx[j] = 0;
+        if (j < 0)
+            break;
+        k = ndim - 1 - j; /* axes that wrapped around */
+        gap = skip[j] && idx[j] == edgeitems;
+        if (k == 0) {
+            if (gap)
+                tl_text_write(&w, " ...", 4);
+            tl_text_putc(&w, ' ');
+            off += gap ? skip[j] + 1 : 1;
+            continue;
         }
-        *lp = *rp = '\0';
-        fprintf(stream, "%s", right_buf);
-        if (*right_buf != '\0') {
-            fprintf(stream, "\n");
-            right_len = strlen(right_buf);
-            for (k = ndim - right_len; k > 0; k--)
-                fprintf(stream, " ");
+        tl_text_repeat(&w, ']', k);
+        tl_text_putc(&w, '\n');
+        tl_text_repeat(&w, ' ', ndim - k);
+        if (gap) {
+            tl_text_write(&w, "...\n", 4);
+            tl_text_repeat(&w, ' ', ndim - k);
         }
-        fprintf(stream, "%s", left_buf);
-        if (*left_buf == '\0')
-            fprintf(stream, " ");
-        tl_fprintf(stream, fmt, tl_padd(data, i, dsize), dtype);
-        lp = left_buf, rp = right_buf;
+        tl_text_repeat(&w, '[', k);
+        for (i = 0, off = 0; i < ndim; i++)
+            off += (idx[i] + (skip[i] && idx[i] >= edgeitems ? skip[i] : 0)) * strides[i];
     }
-    for (j = 0; j < ndim; j++)
-        fprintf(stream, "]");
-    fprintf(stream, "\n");
+    tl_text_repeat(&w, ']', ndim);
+    tl_text_putc(&w, '\n');
+    tl_text_writer_finish(&w);
+}
+
+TL_EXPORT void tl_tensor_fprint(FILE *stream, const tl_tensor *t, const char *fmt)
+{
+    TL_PROFILE_OP();
+
+    fprint_tensor(stream, t, fmt, 0);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(t), 0);
+}
+
+/* Like tl_tensor_fprint, but if t has more than threshold elements, print
+   only the first and last edgeitems entries of every axis longer than
+   2 * edgeitems, like NumPy does with threshold=1000 and edgeitems=3. */
+TL_EXPORT void tl_tensor_fprint_elided(FILE *stream, const tl_tensor *t, const char *fmt,
+                                       int threshold, int edgeitems)
+{
+    TL_PROFILE_OP();
 
-    tl_free(dim_sizes);
-    tl_free(dim_levels);
-    tl_free(left_buf);
-    tl_free(right_buf);
+    assert(t && edgeitems > 0);
+    fprint_tensor(stream, t, fmt, t->len > threshold ? edgeitems : 0);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(t), 0);
 }
 
 TL_EXPORT void tl_tensor_print(const tl_tensor *t, const char *fmt)
 {
+    TL_PROFILE_OP();
+
     tl_tensor_fprint(stdout, t, fmt);
 }
 
@@ -289,6 +439,8 @@ TL_EXPORT int tl_tensor_save(const char *file_name, const tl_tensor *t, const ch
 {
     FILE *fp;
 
+    TL_PROFILE_OP();
+
     fp = fopen(file_name, "w");
     if (!fp) {
         tl_warn_ret("ERROR: cannot open %s", file_name);
@@ -298,3 +450,115 @@ TL_EXPORT int tl_tensor_save(const char *file_name, const tl_tensor *t, const ch
     fclose(fp);
     return 0;
 }
+
+/* append v to the growing array *vals of *cap elements */
+static void push_value(uint64_t **vals, int *n, int *cap, uint64_t v)
+{
+    uint64_t *p;
+
+    if (*n == *cap) {
+        *cap *= 2;
+        p = tl_alloc(sizeof(uint64_t) * *cap);
+        memcpy(p, *vals, sizeof(uint64_t) * *n);
+        tl_free(*vals);
+        *vals = p;
+    }
+    (*vals)[(*n)++] = v;
+}
+
+/* The number at r into *v as a vtype, TL_DOUBLE, TL_INT64 or TL_UINT64.
+   Integers are parsed straight into the 64-bit types so that they are exact
+   beyond 2^53; fractions, exponents and out of range values go through
+   double. */
+static int read_value(struct tl_text_reader *r, tl_dtype vtype, uint64_t *v)
+{
+    double d;
+
+    if (vtype != TL_DOUBLE && tl_text_read_integer(r, vtype == TL_UINT64, v))
+        return 1;
+    if (!tl_text_read_number(r, &d))
+        return 0;
+    tl_convert(v, vtype, &d, TL_DOUBLE);
+    return 1;
+}
+
+/* Read a tensor in the format of tl_tensor_save, with its shape taken from
+   the brackets and its elements converted to dtype. Elements may also be
+   separated by commas, and integer dtypes read plain integers exactly.
+   Elided output can't be read back. Returns NULL if the file can't be
+   opened or isn't a well-formed tensor. */
+TL_EXPORT tl_tensor *tl_tensor_load(const char *file_name, tl_dtype dtype)
+{
+    struct tl_text_reader r;
+    int dims[TL_MAXDIM], counts[TL_MAXDIM];
+    int depth = 0, ndim = -1, n = 0, cap = 1024, done = 0, i, c;
+    uint64_t *vals, v;
+    tl_dtype vtype;
+    tl_tensor *t = NULL;
+    FILE *fp;
+
+    TL_PROFILE_OP();
+
+    tl_check_dtype(dtype);
+    if (dtype >= TL_INT64 && dtype <= TL_INT8)
+        vtype = TL_INT64;
+    else if (dtype >= TL_UINT64 && dtype <= TL_UINT8)
+        vtype = TL_UINT64;
+    else
+        vtype = TL_DOUBLE;
+    fp = fopen(file_name, "r");
+    if (!fp) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return NULL;
+    }
+    tl_text_reader_init(&r, fp);
+    vals = tl_alloc(sizeof(uint64_t) * cap);
+    for (i = 0; i < TL_MAXDIM; i++)
+        dims[i] = -1;
+
+    while (!done && (c = tl_text_peek(&r)) >= 0) {
+        if (c == '[') {
+            if (depth == TL_MAXDIM || (ndim >= 0 && depth >= ndim))
+                goto malformed;
+            if (depth > 0)
+                counts[depth - 1]++;
+            counts[depth++] = 0;
+            tl_text_advance(&r);
+        } else if (c == ']') {
+            if (depth == 0 || ndim < 0)
+                goto malformed;
+            depth--;
+            if (dims[depth] < 0)
+                dims[depth] = counts[depth];
+            else if (dims[depth] != counts[depth])
+                goto malformed;
+            done = depth == 0;
+            tl_text_advance(&r);
+        } else if (c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == ',') {
+            tl_text_advance(&r);
+        } else {
+            if (depth == 0 || (ndim >= 0 && depth != ndim) || !read_value(&r, vtype, &v))
+                goto malformed;
+            ndim = depth;
+            counts[depth - 1]++;
+            push_value(&vals, &n, &cap, v);
+        }
+    }
+    if (!done || n == 0)
+        goto malformed;
+
+    t = tl_tensor_create(NULL, ndim, dims, dtype);
+    t->owner = t;
+    t->data = tl_alloc(t->len * tl_size_of(dtype));
+    tl_convert_n(t->data, dtype, vals, vtype, n);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(t));
+    goto end;
+
+malformed:
+    tl_warn_msg("ERROR: %s is not a well-formed tensor", file_name);
+end:
+    tl_free(vals);
+    tl_text_reader_free(&r);
+    fclose(fp);
+    return t;
+}
@@ -38,7 +38,19 @@
 #define TL_TENSOR_DATA_ASSIGN(dst, di, src, si)                                                    \
     tl_convert(TL_TENSOR_DATA((dst), (di)), (dst)->dtype, TL_TENSOR_DATA((src), (si)), (src)->dtype)
 
+/* Affine quantization parameters: a stored value q stands for
+   scales[c] * (q - zero_points[c]). axis is -1 for one (scale, zero point)
+   pair for the whole tensor (len is 1), or the axis whose index c selects
+   the pair (len is dims[axis]). */
 /* clang-format off */
+struct tl_quant {
+    int               axis;
+    int               len;
+    float            *scales;
+    int32_t          *zero_points;
+};
+typedef struct tl_quant tl_quant;
+
 struct tl_tensor {
     tl_dtype          dtype;
     int               len;
@@ -47,8 +59,20 @@ struct tl_tensor {
     void             *data;
     struct tl_tensor *owner;         /* data owner, NULL if it's itself */
     void             *backend_data;  /* for other backend dependent data */
+    tl_quant         *quant;         /* owned, NULL if not quantized */
 };
 typedef struct tl_tensor tl_tensor;
+
+/* The dtype and shape of an op's result, as given by the op's
+   tl_tensor_*_out_shape companion. The companions take the op's arguments
+   that decide the result, check them like the op does, and touch no data,
+   so a caller can size and place every dst before running the ops. */
+struct tl_shape {
+    tl_dtype          dtype;
+    int               ndim;
+    int               dims[TL_MAXDIM];
+};
+typedef struct tl_shape tl_shape;
 /* clang-format on */
 
 #ifdef __cplusplus
@@ -62,34 +86,162 @@ tl_tensor *tl_tensor_create(void *data, int ndim, const int *dims, tl_dtype dtyp
 void tl_tensor_free(tl_tensor *t);
 void tl_tensor_free_data_too(tl_tensor *t);
 size_t tl_tensor_size(tl_tensor *t);
+void tl_tensor_shape(const tl_tensor *t, tl_shape *shape);
+size_t tl_shape_size(const tl_shape *shape);
+tl_tensor *tl_tensor_create_shape(void *data, const tl_shape *shape);
 tl_tensor *tl_tensor_zeros(int ndim, const int *dims, tl_dtype dtype);
+tl_tensor *tl_tensor_zeros_shape(const tl_shape *shape);
+tl_tensor *tl_tensor_full(int ndim, const int *dims, tl_dtype dtype, double value);
+tl_tensor *tl_tensor_fill(tl_tensor *dst, double value);
 tl_tensor *tl_tensor_clone(const tl_tensor *src);
 tl_tensor *tl_tensor_repeat(const tl_tensor *src, int times);
+tl_shape *tl_tensor_repeat_out_shape(const tl_tensor *src, int times, tl_shape *shape);
 tl_tensor *tl_tensor_arange(double start, double stop, double step, tl_dtype dtype);
+tl_shape *tl_tensor_arange_out_shape(double start, double stop, double step, tl_dtype dtype,
+                                     tl_shape *shape);
 void tl_tensor_rearange(tl_tensor *src, double start, double stop, double step);
+tl_tensor *tl_tensor_random_uniform(int ndim, const int *dims, tl_dtype dtype, double low,
+                                    double high, uint64_t seed);
+tl_tensor *tl_tensor_random_normal(int ndim, const int *dims, tl_dtype dtype, double mean,
+                                   double std, uint64_t seed);
+tl_tensor *tl_tensor_fill_uniform(tl_tensor *dst, double low, double high, uint64_t seed);
+tl_tensor *tl_tensor_fill_normal(tl_tensor *dst, double mean, double std, uint64_t seed);
 void tl_tensor_fprint(FILE *stream, const tl_tensor *t, const char *fmt);
+void tl_tensor_fprint_elided(FILE *stream, const tl_tensor *t, const char *fmt, int threshold,
+                             int edgeitems);
 void tl_tensor_print(const tl_tensor *t, const char *fmt);
 int tl_tensor_save(const char *file_name, const tl_tensor *t, const char *fmt);
+tl_tensor *tl_tensor_load(const char *file_name, tl_dtype dtype);
+int tl_tensor_save_compressed(const char *file_name, const tl_tensor *t, tl_shuffle shuffle);
+tl_tensor *tl_tensor_load_compressed(const char *file_name);
 tl_tensor *tl_tensor_create_slice(void *data, const tl_tensor *src, int axis, int len,
                                   tl_dtype dtype);
 tl_tensor *tl_tensor_zeros_slice(const tl_tensor *src, int axis, int len, tl_dtype dtype);
 tl_tensor *tl_tensor_slice(const tl_tensor *src, tl_tensor *dst, int axis, int start, int len);
+tl_shape *tl_tensor_slice_out_shape(const tl_tensor *src, int axis, int start, int len,
+                                    tl_shape *shape);
+tl_tensor *tl_tensor_slice_nd(const tl_tensor *src, tl_tensor *dst, const int *start,
+                              const int *stop, const int *step);
+tl_shape *tl_tensor_slice_nd_out_shape(const tl_tensor *src, const int *start, const int *stop,
+                                       const int *step, tl_shape *shape);
 tl_tensor *tl_tensor_slice_nocopy(tl_tensor *src, tl_tensor *dst, int axis, int start, int len);
+tl_tensor *tl_tensor_pad(const tl_tensor *src, tl_tensor *dst, const int *pads, tl_pad_mode mode,
+                         double value);
+tl_shape *tl_tensor_pad_out_shape(const tl_tensor *src, const int *pads, tl_shape *shape);
+tl_tensor *tl_tensor_pad_border(tl_tensor *dst, const int *pads, tl_pad_mode mode, double value);
 tl_tensor *tl_tensor_concat(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst, int axis);
+tl_shape *tl_tensor_concat_out_shape(const tl_tensor *src1, const tl_tensor *src2, int axis,
+                                     tl_shape *shape);
+tl_tensor *tl_tensor_concat_n(const tl_tensor **srcs, int n, tl_tensor *dst, int axis);
+tl_shape *tl_tensor_concat_n_out_shape(const tl_tensor **srcs, int n, int axis, tl_shape *shape);
+tl_tensor **tl_tensor_split_n(tl_tensor *src, tl_tensor **dsts, int n, const int *lens, int axis);
+tl_shape *tl_tensor_split_n_out_shape(const tl_tensor *src, int n, const int *lens, int axis,
+                                      tl_shape *shapes);
 tl_tensor *tl_tensor_reshape(tl_tensor *src, int ndim, const int *dims);
 void tl_tensor_reshape_src(tl_tensor *src, int ndim, const int *dims);
 tl_tensor *tl_tensor_maxreduce(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg, int axis);
+tl_shape *tl_tensor_maxreduce_out_shape(const tl_tensor *src, int axis, tl_shape *shape);
 tl_tensor *tl_tensor_elew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
                           tl_elew_op elew_op);
+tl_shape *tl_tensor_elew_out_shape(const tl_tensor *src1, const tl_tensor *src2, tl_shape *shape);
 tl_tensor *tl_tensor_elew_param(const tl_tensor *src, double param, tl_tensor *dst,
                                 tl_elew_op elew_op);
+tl_shape *tl_tensor_elew_param_out_shape(const tl_tensor *src, tl_shape *shape);
 tl_tensor *tl_tensor_dot_product(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst);
+tl_shape *tl_tensor_dot_product_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                          tl_shape *shape);
+tl_tensor *tl_tensor_norm(const tl_tensor *src, tl_tensor *dst, tl_norm_type ord);
+tl_shape *tl_tensor_norm_out_shape(const tl_tensor *src, tl_norm_type ord, tl_shape *shape);
+tl_tensor *tl_tensor_cosine_similarity(const tl_tensor *src1, const tl_tensor *src2,
+                                       tl_tensor *dst);
+tl_shape *tl_tensor_cosine_similarity_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                                tl_shape *shape);
+tl_tensor *tl_tensor_conv2d(const tl_tensor *src, const tl_tensor *weight, const tl_tensor *bias,
+                            tl_tensor *dst, const int *stride, const int *padding,
+                            const int *dilation, int groups, tl_layout layout, int lrelu,
+                            float negslope);
+tl_shape *tl_tensor_conv2d_out_shape(const tl_tensor *src, const tl_tensor *weight,
+                                     const int *stride, const int *padding, const int *dilation,
+                                     int groups, tl_layout layout, tl_shape *shape);
+tl_tensor *tl_tensor_maxpool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
+                               const int *kernel, const int *stride, const int *padding,
+                               int ceil_mode, tl_layout layout);
+tl_shape *tl_tensor_maxpool2d_out_shape(const tl_tensor *src, const int *kernel,
+                                        const int *stride, const int *padding, int ceil_mode,
+                                        tl_layout layout, tl_shape *shape);
+tl_tensor *tl_tensor_avgpool2d(const tl_tensor *src, tl_tensor *dst, const int *kernel,
+                               const int *stride, const int *padding, int ceil_mode,
+                               int count_include_pad, tl_layout layout);
+tl_shape *tl_tensor_avgpool2d_out_shape(const tl_tensor *src, const int *kernel,
+                                        const int *stride, const int *padding, int ceil_mode,
+                                        tl_layout layout, tl_shape *shape);
+tl_tensor *tl_tensor_global_maxpool(const tl_tensor *src, tl_tensor *dst, tl_layout layout);
+tl_shape *tl_tensor_global_maxpool_out_shape(const tl_tensor *src, tl_layout layout,
+                                             tl_shape *shape);
+tl_tensor *tl_tensor_global_avgpool(const tl_tensor *src, tl_tensor *dst, tl_layout layout);
+tl_shape *tl_tensor_global_avgpool_out_shape(const tl_tensor *src, tl_layout layout,
+                                             tl_shape *shape);
+tl_tensor *tl_tensor_matmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                            int trans1, int trans2);
+tl_shape *tl_tensor_matmul_out_shape(const tl_tensor *src1, const tl_tensor *src2, int trans1,
+                                     int trans2, tl_shape *shape);
 tl_tensor *tl_tensor_transpose(const tl_tensor *src, tl_tensor *dst, const int *axes);
+tl_shape *tl_tensor_transpose_out_shape(const tl_tensor *src, const int *axes, tl_shape *shape);
 tl_tensor *tl_tensor_lrelu(const tl_tensor *src, tl_tensor *dst, float negslope);
+tl_shape *tl_tensor_lrelu_out_shape(const tl_tensor *src, tl_shape *shape);
+tl_tensor *tl_tensor_softmax(const tl_tensor *src, tl_tensor *dst, int axis);
+tl_shape *tl_tensor_softmax_out_shape(const tl_tensor *src, int axis, tl_shape *shape);
+tl_tensor *tl_tensor_log_softmax(const tl_tensor *src, tl_tensor *dst, int axis);
+tl_shape *tl_tensor_log_softmax_out_shape(const tl_tensor *src, int axis, tl_shape *shape);
 tl_tensor *tl_tensor_convert(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype_d);
+tl_shape *tl_tensor_convert_out_shape(const tl_tensor *src, tl_dtype dtype_d, tl_shape *shape);
 tl_tensor *tl_tensor_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims,
                             tl_resize_type rtype);
+tl_shape *tl_tensor_resize_out_shape(const tl_tensor *src, const int *new_dims,
+                                     tl_resize_type rtype, tl_shape *shape);
 tl_tensor *tl_tensor_submean(const tl_tensor *src, tl_tensor *dst, const double *mean);
+tl_shape *tl_tensor_submean_out_shape(const tl_tensor *src, tl_shape *shape);
+tl_tensor *tl_tensor_preprocess(const tl_tensor *src, tl_tensor *dst, const int *new_hw,
+                                tl_resize_type rtype, const double *mean, const double *std,
+                                double scale, int reverse);
+tl_shape *tl_tensor_preprocess_out_shape(const tl_tensor *src, const int *new_hw,
+                                         tl_shape *shape);
+tl_tensor *tl_tensor_preprocess_batch(const tl_tensor **srcs, int n, tl_tensor *dst,
+                                      const int *new_hw, tl_resize_type rtype,
+                                      const double *mean, const double *std, double scale,
+                                      int reverse);
+tl_shape *tl_tensor_preprocess_batch_out_shape(const tl_tensor **srcs, int n, const int *new_hw,
+                                               tl_shape *shape);
+void tl_tensor_detect_yolov3(const tl_tensor *feature, const tl_tensor *anchors,
+                             tl_tensor *box_centers, tl_tensor *box_sizes, tl_tensor *boxes,
+                             tl_tensor *confs, tl_tensor *probs, int img_h, int img_w);
+void tl_tensor_detect_yolov3_out_shape(const tl_tensor *feature, const tl_tensor *anchors,
+                                       tl_shape *box_centers, tl_shape *box_sizes,
+                                       tl_shape *boxes, tl_shape *confs, tl_shape *probs);
+tl_tensor *tl_tensor_nms(const tl_tensor *boxes, const tl_tensor *scores, tl_tensor *dst,
+                         float iou_thresh, float score_thresh, int max_out);
+tl_shape *tl_tensor_nms_out_shape(const tl_tensor *boxes, const tl_tensor *scores, int max_out,
+                                  tl_shape *shape);
+tl_quant *tl_quant_create(int axis, int len, const float *scales, const int32_t *zero_points);
+tl_quant *tl_quant_clone(const tl_quant *q);
+void tl_quant_free(tl_quant *q);
+void tl_tensor_set_quant(tl_tensor *t, const tl_quant *q);
+tl_tensor *tl_tensor_quantize(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype,
+                              const tl_quant *q);
+tl_shape *tl_tensor_quantize_out_shape(const tl_tensor *src, tl_dtype dtype, tl_shape *shape);
+tl_tensor *tl_tensor_dequantize(const tl_tensor *src, tl_tensor *dst);
+tl_shape *tl_tensor_dequantize_out_shape(const tl_tensor *src, tl_shape *shape);
+tl_tensor *tl_tensor_qelew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                           tl_elew_op elew_op, const tl_quant *q);
+tl_shape *tl_tensor_qelew_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                    tl_shape *shape);
+tl_tensor *tl_tensor_qlrelu(const tl_tensor *src, tl_tensor *dst, float negslope,
+                            const tl_quant *q);
+tl_shape *tl_tensor_qlrelu_out_shape(const tl_tensor *src, tl_shape *shape);
+tl_tensor *tl_tensor_qmatmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                             int trans1, int trans2, const tl_quant *q);
+tl_shape *tl_tensor_qmatmul_out_shape(const tl_tensor *src1, const tl_tensor *src2, int trans1,
+                                      int trans2, const tl_quant *q, tl_shape *shape);
 
 #ifdef TL_CUDA
 
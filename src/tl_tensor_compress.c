@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "tl_tensor_internal.h"
+#include "tl_compress.h"
+
+/* Compressed binary tensor files, all in host byte order:
+
+   "TLCZ", u32 version, u32 dtype, u32 ndim, i32 dims[ndim],
+   u32 shuffle, u32 block bytes, u64 nblocks
+   u64 sizes[nblocks], the bytes each block takes in the file
+   the blocks
+
+   The elements are cut into blocks of `block bytes`, the last one shorter,
+   and each is compressed on its own with tl_compress_block, in parallel.
+   A block that doesn't get smaller is stored as it is, which shows as a
+   size equal to its length. */
+
+#define COMPRESS_MAGIC "TLCZ"
+#define COMPRESS_VERSION 1
+#define COMPRESS_BLOCK (256 * 1024) /* a multiple of every dtype size */
+
+struct compress_info {
+    const uint8_t *data; /* the elements */
+    size_t nbytes;
+    int esize;
+    tl_shuffle shuffle;
+    const uint8_t *in; /* blocks as in the file, at offsets */
+    const uint64_t *offsets;
+    uint8_t *out; /* block i at i * COMPRESS_BLOCK */
+    uint64_t *sizes;
+    uint8_t *failed; /* per block, when decompressing */
+};
+
+static size_t block_len(const struct compress_info *info, int i)
+{
+    size_t start = (size_t)i * COMPRESS_BLOCK;
+
+    return info->nbytes - start < COMPRESS_BLOCK ? info->nbytes - start : COMPRESS_BLOCK;
+}
+
+static void compress_worker(void *arg, int start, int end)
+{
+    struct compress_info *info = arg;
+    void *scratch = tl_alloc(TL_COMPRESS_SCRATCH(COMPRESS_BLOCK));
+    size_t n, c;
+    int i;
+
+    for (i = start; i < end; i++) {
+        n = block_len(info, i);
+        c = tl_compress_block(info->data + (size_t)i * COMPRESS_BLOCK, n, info->esize,
+                              info->shuffle, info->out + (size_t)i * COMPRESS_BLOCK, scratch);
+        info->sizes[i] = c ? c : n;
+    }
+    tl_free(scratch);
+}
+
+static void decompress_worker(void *arg, int start, int end)
+{
+    struct compress_info *info = arg;
+    void *scratch = tl_alloc(TL_COMPRESS_SCRATCH(COMPRESS_BLOCK));
+    uint8_t *dst;
+    size_t n;
+    int i;
+
+    for (i = start; i < end; i++) {
+        n = block_len(info, i);
+        dst = info->out + (size_t)i * COMPRESS_BLOCK;
+        if (info->sizes[i] == n)
+            memcpy(dst, info->in + info->offsets[i], n);
+        else
+            info->failed[i] = tl_decompress_block(info->in + info->offsets[i], info->sizes[i], n,
+                                                  info->esize, info->shuffle, dst, scratch) != 0;
+    }
+    tl_free(scratch);
+}
+
+/* Save t in a compressed binary format. shuffle reorders the bytes of each
+   block before compression: TL_SHUFFLE_BYTE usually suits floating point
+   data, TL_SHUFFLE_BIT suits integers of small magnitude and 8-bit types.
+   Returns 0, or -1 if the file can't be written. */
+TL_EXPORT int tl_tensor_save_compressed(const char *file_name, const tl_tensor *t,
+                                        tl_shuffle shuffle)
+{
+    struct compress_info info;
+    uint32_t u[3];
+    uint64_t nblocks;
+    FILE *fp;
+    int i, error;
+
+    TL_PROFILE_OP();
+
+    assert(file_name);
+    tl_check_tensor(t);
+    tl_check_shuffle(shuffle);
+
+    fp = fopen(file_name, "wb");
+    if (!fp) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return -1;
+    }
+    memset(&info, 0, sizeof(info));
+    info.data = t->data;
+    info.esize = tl_size_of(t->dtype);
+    info.nbytes = (size_t)t->len * info.esize;
+    info.shuffle = shuffle;
+    nblocks = (info.nbytes + COMPRESS_BLOCK - 1) / COMPRESS_BLOCK;
+    info.out = tl_alloc(info.nbytes);
+    info.sizes = tl_alloc(sizeof(uint64_t) * nblocks);
+    tl_parallel_for(nblocks, 1, compress_worker, &info);
+
+    u[0] = COMPRESS_VERSION;
+    u[1] = t->dtype;
+    u[2] = t->ndim;
+    error = fwrite(COMPRESS_MAGIC, 1, 4, fp) != 4 || fwrite(u, sizeof(u), 1, fp) != 1 ||
+            fwrite(t->dims, sizeof(int32_t), t->ndim, fp) != (size_t)t->ndim;
+    u[0] = shuffle;
+    u[1] = COMPRESS_BLOCK;
+    error = error || fwrite(u, sizeof(uint32_t), 2, fp) != 2 ||
+            fwrite(&nblocks, sizeof(nblocks), 1, fp) != 1 ||
+            fwrite(info.sizes, sizeof(uint64_t), nblocks, fp) != nblocks;
+    for (i = 0; i < (int)nblocks && !error; i++) {
+        if (info.sizes[i] == block_len(&info, i))
+            error = fwrite(info.data + (size_t)i * COMPRESS_BLOCK, 1, info.sizes[i], fp) !=
+                    info.sizes[i];
+        else
+            error = fwrite(info.out + (size_t)i * COMPRESS_BLOCK, 1, info.sizes[i], fp) !=
+                    info.sizes[i];
+    }
+    if (fclose(fp))
+        error = 1;
+    if (error)
+        tl_warn_ret("ERROR: failed to write %s", file_name);
+
+    tl_free(info.out);
+    tl_free(info.sizes);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(t), 0);
+    return error ? -1 : 0;
+}
+
+static int read_header(FILE *fp, int *ndim, int *dims, tl_dtype *dtype, tl_shuffle *shuffle,
+                       uint64_t *nblocks)
+{
+    char magic[4];
+    uint32_t u[3];
+    int64_t len = 1;
+    int i;
+
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, COMPRESS_MAGIC, 4) ||
+        fread(u, sizeof(u), 1, fp) != 1 || u[0] != COMPRESS_VERSION || u[1] >= TL_DTYPE_SIZE ||
+        u[2] == 0 || u[2] > TL_MAXDIM)
+        return -1;
+    *dtype = u[1];
+    *ndim = u[2];
+    if (fread(dims, sizeof(int32_t), *ndim, fp) != (size_t)*ndim)
+        return -1;
+    for (i = 0; i < *ndim; i++) {
+        if (dims[i] <= 0)
+            return -1;
+        len *= dims[i];
+        if (len > INT32_MAX)
+            return -1;
+    }
+    if (fread(u, sizeof(uint32_t), 2, fp) != 2 || u[0] >= TL_SHUFFLE_SIZE ||
+        u[1] != COMPRESS_BLOCK || fread(nblocks, sizeof(*nblocks), 1, fp) != 1 ||
+        *nblocks != (len * tl_size_of(*dtype) + COMPRESS_BLOCK - 1) / COMPRESS_BLOCK)
+        return -1;
+    *shuffle = u[0];
+    return 0;
+}
+
+/* Read a tensor saved by tl_tensor_save_compressed, decompressing its
+   blocks in parallel. Returns NULL if the file can't be opened or is
+   malformed. */
+TL_EXPORT tl_tensor *tl_tensor_load_compressed(const char *file_name)
+{
+    struct compress_info info;
+    int dims[TL_MAXDIM];
+    uint64_t nblocks, total = 0;
+    uint64_t *offsets = NULL;
+    uint8_t *in = NULL;
+    tl_tensor *t = NULL;
+    tl_dtype dtype;
+    int ndim, i, error;
+    FILE *fp;
+
+    TL_PROFILE_OP();
+
+    assert(file_name);
+    fp = fopen(file_name, "rb");
+    if (!fp) {
+        tl_warn_ret("ERROR: cannot open %s", file_name);
+        return NULL;
+    }
+    memset(&info, 0, sizeof(info));
+    if (read_header(fp, &ndim, dims, &dtype, &info.shuffle, &nblocks))
+        goto malformed;
+
+    t = tl_tensor_create(NULL, ndim, dims, dtype);
+    t->owner = t;
+    info.esize = tl_size_of(dtype);
+    info.nbytes = (size_t)t->len * info.esize;
+    t->data = tl_alloc(info.nbytes);
+    info.out = t->data;
+    info.sizes = tl_alloc(sizeof(uint64_t) * nblocks);
+    info.failed = tl_alloc(nblocks);
+    memset(info.failed, 0, nblocks);
+    offsets = tl_alloc(sizeof(uint64_t) * nblocks);
+    if (fread(info.sizes, sizeof(uint64_t), nblocks, fp) != nblocks)
+        goto malformed;
+    for (i = 0; i < (int)nblocks; i++) {
+        if (info.sizes[i] == 0 || info.sizes[i] > block_len(&info, i))
+            goto malformed;
+        offsets[i] = total;
+        total += info.sizes[i];
+    }
+    in = tl_alloc(total);
+    if (fread(in, 1, total, fp) != total)
+        goto malformed;
+    info.in = in;
+    info.offsets = offsets;
+    tl_parallel_for(nblocks, 1, decompress_worker, &info);
+    for (i = 0, error = 0; i < (int)nblocks; i++)
+        error |= info.failed[i];
+    if (error)
+        goto malformed;
+    goto done;
+
+malformed:
+    tl_warn_msg("ERROR: %s is not a well-formed compressed tensor", file_name);
+    tl_tensor_free_data_too(t);
+    t = NULL;
+done:
+    fclose(fp);
+    tl_free(in);
+    tl_free(offsets);
+    tl_free(info.sizes);
+    tl_free(info.failed);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(t));
+    return t;
+}
@@ -22,53 +22,239 @@
 
 #include "tl_tensor_internal.h"
 
+TL_EXPORT tl_shape *tl_tensor_concat_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                                int axis, tl_shape *shape)
+{
+    const tl_tensor *srcs[2] = { src1, src2 };
+
+    return tl_tensor_concat_n_out_shape(srcs, 2, axis, shape);
+}
+
+/* Copies between a big tensor and n pieces along an axis. Both are viewed
+   as [outer, len * vol], so each (outer index, piece) pair is one
+   contiguous run. */
+struct concat_info {
+    int n;
+    int outer;
+    size_t row_bytes;         /* bytes per outer index of the big tensor */
+    const size_t *run_bytes;  /* bytes per outer index of each piece */
+    const size_t *run_offset; /* offset of each piece in a big row */
+    void *big;
+    void **pieces;
+    int gather; /* pieces -> big if nonzero, big -> pieces otherwise */
+};
+
+static void concat_worker(void *arg, int start, int end)
+{
+    const struct concat_info *info = arg;
+    int item, o, i;
+    uint8_t *b, *p;
+
+    for (item = start; item < end; item++) {
+        o = item / info->n;
+        i = item % info->n;
+        b = (uint8_t *)info->big + o * info->row_bytes + info->run_offset[i];
+        p = (uint8_t *)info->pieces[i] + o * info->run_bytes[i];
+        if (info->gather)
+            memcpy(b, p, info->run_bytes[i]);
+        else
+            memcpy(p, b, info->run_bytes[i]);
+    }
+}
+
+static void concat_run(struct concat_info *info)
+{
+    size_t total = info->row_bytes * info->outer;
+    int nitems = info->outer * info->n;
+    int grain;
+
+    /* at least about 64KB per chunk */
+    grain = (int)((size_t)(1 << 16) * nitems / (total + 1)) + 1;
+    tl_parallel_for(nitems, grain, concat_worker, info);
+}
+
+TL_EXPORT tl_shape *tl_tensor_concat_n_out_shape(const tl_tensor **srcs, int n, int axis,
+                                                  tl_shape *shape)
+{
+    int i, j;
+
+    assert(srcs && n > 0 && shape);
+    assert(srcs[0]);
+    assert(axis >= 0 && axis < srcs[0]->ndim);
+    tl_tensor_shape(srcs[0], shape);
+    for (i = 1; i < n; i++) {
+        assert(srcs[i]);
+        assert(srcs[i]->dtype == srcs[0]->dtype);
+        assert(srcs[i]->ndim == srcs[0]->ndim);
+        for (j = 0; j < srcs[0]->ndim; j++)
+            assert(j == axis ? 1 : srcs[i]->dims[j] == srcs[0]->dims[j]);
+        shape->dims[axis] += srcs[i]->dims[axis];
+    }
+    return shape;
+}
+
+/* tl_tensor_concat_n() without the profiling scope, shared by
+   tl_tensor_concat() */
+static tl_tensor *concat_n(const tl_tensor **srcs, int n, tl_tensor *dst, int axis)
+{
+    struct concat_info info;
+    size_t *run_bytes, *run_offset;
+    void **pieces;
+    int i, j, vol, outer, len;
+    tl_shape shape;
+    size_t dsize;
+
+#ifndef NDEBUG
+    assert(srcs && n > 0);
+    for (i = 0; i < n; i++)
+        assert(srcs[i] && srcs[i]->data);
+#endif
+    tl_tensor_concat_n_out_shape(srcs, n, axis, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+    len = shape.dims[axis];
+
+    for (j = axis + 1, vol = 1; j < dst->ndim; j++)
+        vol *= dst->dims[j];
+    for (j = 0, outer = 1; j < axis; j++)
+        outer *= dst->dims[j];
+    dsize = tl_size_of(dst->dtype);
+
+    run_bytes = tl_alloc(sizeof(size_t) * n);
+    run_offset = tl_alloc(sizeof(size_t) * n);
+    pieces = tl_alloc(sizeof(void *) * n);
+    for (i = 0; i < n; i++) {
+        run_bytes[i] = dsize * vol * srcs[i]->dims[axis];
+        run_offset[i] = i ? run_offset[i - 1] + run_bytes[i - 1] : 0;
+        pieces[i] = srcs[i]->data;
+    }
+    info.n = n;
+    info.outer = outer;
+    info.row_bytes = dsize * vol * len;
+    info.run_bytes = run_bytes;
+    info.run_offset = run_offset;
+    info.big = dst->data;
+    info.pieces = pieces;
+    info.gather = 1;
+    concat_run(&info);
+
+    tl_free(run_bytes);
+    tl_free(run_offset);
+    tl_free(pieces);
+    return dst;
+}
+
+/* Concatenate n tensors along axis into a single output, copying each
+   source's contiguous runs once. */
+TL_EXPORT tl_tensor *tl_tensor_concat_n(const tl_tensor **srcs, int n, tl_tensor *dst, int axis)
+{
+    TL_PROFILE_OP();
+
+    dst = concat_n(srcs, n, dst, axis);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
 TL_EXPORT tl_tensor *tl_tensor_concat(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
                                       int axis)
 {
-    int i;
-    int s1_nvol, s2_nvol, vol;
-    int di, s1i, s2i;
-    int thread_num;
-    int *dims;
+    const tl_tensor *srcs[2] = { src1, src2 };
+
+    TL_PROFILE_OP();
+
+    dst = concat_n(srcs, 2, dst, axis);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+/* The shapes of the n pieces tl_tensor_split_n() makes, into shapes[0..n-1] */
+TL_EXPORT tl_shape *tl_tensor_split_n_out_shape(const tl_tensor *src, int n, const int *lens,
+                                                int axis, tl_shape *shapes)
+{
+    int i, sum;
+
+    assert(src && shapes && n > 0);
+    assert(axis >= 0 && axis < src->ndim);
+    assert(lens || src->dims[axis] % n == 0);
+    for (i = 0, sum = 0; i < n; i++) {
+        tl_tensor_shape(src, &shapes[i]);
+        shapes[i].dims[axis] = lens ? lens[i] : src->dims[axis] / n;
+        assert(shapes[i].dims[axis] > 0);
+        sum += shapes[i].dims[axis];
+    }
+    assert(sum == src->dims[axis]);
+    return shapes;
+}
+
+/* Split src along axis into n tensors with lens[i] elements along axis
+   each, or with equal lengths if lens is NULL. A NULL dsts[i] is created,
+   a non-NULL one must have data and is copied into. Created tensors are
+   views sharing src's data (with owner set to src) if all dims before axis
+   are 1, otherwise they own a copy. Returns dsts. */
+TL_EXPORT tl_tensor **tl_tensor_split_n(tl_tensor *src, tl_tensor **dsts, int n, const int *lens,
+                                        int axis)
+{
+    struct concat_info info;
+    size_t *run_bytes, *run_offset;
+    void **pieces;
+    int i, j, vol, outer, len, sum, ncopy;
     size_t dsize;
 
-    assert(src1 && src1->data);
-    assert(src2 && src2->data);
-    assert(src1->dtype == src2->dtype);
-    assert(src1->ndim == src2->ndim);
-    assert(axis >= 0 && axis < src1->ndim);
-    for (i = 0; i < src1->ndim; i++)
-        assert(i == axis ? 1 : src1->dims[i] == src2->dims[i]);
-
-    if (dst) {
-        assert(dst->data);
-        assert(src1->dtype == dst->dtype);
-        assert(src1->ndim == dst->ndim);
-        assert(dst->dims[axis] == src1->dims[axis] + src2->dims[axis]);
-    } else {
-        dims = tl_clone(src1->dims, sizeof(int) * src1->ndim);
-        dims[axis] = src1->dims[axis] + src2->dims[axis];
-        dst = tl_tensor_zeros(src1->ndim, dims, src1->dtype);
-        tl_free(dims);
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    assert(dsts && n > 0);
+    assert(axis >= 0 && axis < src->ndim);
+    assert(lens || src->dims[axis] % n == 0);
+
+    for (j = axis + 1, vol = 1; j < src->ndim; j++)
+        vol *= src->dims[j];
+    for (j = 0, outer = 1; j < axis; j++)
+        outer *= src->dims[j];
+    dsize = tl_size_of(src->dtype);
+
+    run_bytes = tl_alloc(sizeof(size_t) * n);
+    run_offset = tl_alloc(sizeof(size_t) * n);
+    pieces = tl_alloc(sizeof(void *) * n);
+    for (i = 0, sum = 0, ncopy = 0; i < n; i++) {
+        len = lens ? lens[i] : src->dims[axis] / n;
+        assert(len > 0);
+        run_bytes[i] = dsize * vol * len;
+        run_offset[i] = (size_t)dsize * vol * sum;
+        if (dsts[i]) {
+            assert(dsts[i]->data);
+            assert(dsts[i]->dtype == src->dtype);
+            assert(dsts[i]->ndim == src->ndim);
+            for (j = 0; j < src->ndim; j++)
+                assert(j == axis ? dsts[i]->dims[j] == len : dsts[i]->dims[j] == src->dims[j]);
+        } else if (outer == 1) {
+            dsts[i] = tl_tensor_create_slice(tl_padd(src->data, (size_t)vol * sum, dsize), src,
+                                             axis, len, src->dtype);
+            dsts[i]->owner = src;
+            run_bytes[i] = 0;
+        } else {
+            dsts[i] = tl_tensor_zeros_slice(src, axis, len, src->dtype);
+        }
+        pieces[i] = dsts[i]->data;
+        ncopy += run_bytes[i] > 0;
+        sum += len;
     }
+    assert(sum == src->dims[axis]);
 
-    for (i = axis + 1, vol = 1; i < dst->ndim; i++)
-        vol *= dst->dims[i];
-    s1_nvol = src1->dims[axis];
-    s2_nvol = src2->dims[axis];
-    thread_num = 1;
-    for (i = 0; i <= axis; i++)
-        thread_num *= dst->dims[i];
-
-    dsize = tl_size_of(src1->dtype) * vol;
-    for (di = 0, s1i = 0, s2i = 0; di < thread_num;) {
-        tl_pmove(dst->data, di, src1->data, s1i, dsize, s1_nvol);
-        di += s1_nvol;
-        s1i += s1_nvol;
-        tl_pmove(dst->data, di, src2->data, s2i, dsize, s2_nvol);
-        di += s2_nvol;
-        s2i += s2_nvol;
+    if (ncopy) {
+        info.n = n;
+        info.outer = outer;
+        info.row_bytes = dsize * vol * src->dims[axis];
+        info.run_bytes = run_bytes;
+        info.run_offset = run_offset;
+        info.big = src->data;
+        info.pieces = pieces;
+        info.gather = 0;
+        concat_run(&info);
     }
 
-    return dst;
+    tl_free(run_bytes);
+    tl_free(run_offset);
+    tl_free(pieces);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(src));
+    return dsts;
 }
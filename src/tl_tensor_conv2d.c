@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "tl_tensor_internal.h"
+#include "tl_gemm.h"
+
+/* Algorithms tl_tensor_conv2d can choose from. */
+enum conv_algo {
+    CONV_GEMM_1X1,  /* 1x1, stride 1, no padding: GEMM directly on the input */
+    CONV_DIRECT,    /* NCHW, small reduction size (depthwise, 3x3 on few channels) */
+    CONV_DEPTHWISE, /* NHWC depthwise, vectorized over channels */
+    CONV_IM2COL     /* everything else: im2col + GEMM */
+};
+
+/* Per-group reduction size under which CONV_DIRECT beats packing for GEMM. */
+#define CONV_DIRECT_MAX_K 64
+
+struct conv_shape {
+    int layout;
+    int N, C, H, W;
+    int OC, KH, KW;
+    int sh, sw, ph, pw, dh, dw;
+    int groups;
+};
+
+struct conv_plan {
+    struct conv_shape shape;
+    int valid;
+    int OH, OW;
+    enum conv_algo algo;
+};
+
+/* A small per-thread plan cache, so repeated calls with the same shapes
+   don't re-decide the algorithm, and no locking is needed. */
+#define CONV_PLAN_CACHE_SIZE 16
+static __thread struct conv_plan plan_cache[CONV_PLAN_CACHE_SIZE];
+static __thread int plan_cache_next = 0;
+
+static enum conv_algo choose_algo(const struct conv_shape *s)
+{
+    int Cg = s->C / s->groups;
+    int OCg = s->OC / s->groups;
+
+    if (s->KH == 1 && s->KW == 1 && s->sh == 1 && s->sw == 1 && s->ph == 0 && s->pw == 0)
+        return CONV_GEMM_1X1;
+    if (s->layout == TL_NCHW) {
+        if ((Cg == 1 && OCg == 1) || Cg * s->KH * s->KW <= CONV_DIRECT_MAX_K)
+            return CONV_DIRECT;
+        return CONV_IM2COL;
+    }
+    if (Cg == 1 && OCg == 1)
+        return CONV_DEPTHWISE;
+    return CONV_IM2COL;
+}
+
+static void conv_out_hw(const struct conv_shape *s, int *OH, int *OW)
+{
+    *OH = (s->H + 2 * s->ph - s->dh * (s->KH - 1) - 1) / s->sh + 1;
+    *OW = (s->W + 2 * s->pw - s->dw * (s->KW - 1) - 1) / s->sw + 1;
+}
+
+static const struct conv_plan *get_plan(const struct conv_shape *s)
+{
+    struct conv_plan *plan;
+    int i;
+
+    for (i = 0; i < CONV_PLAN_CACHE_SIZE; i++) {
+        plan = &plan_cache[i];
+        if (plan->valid && !memcmp(&plan->shape, s, sizeof(*s)))
+            return plan;
+    }
+
+    plan = &plan_cache[plan_cache_next];
+    plan_cache_next = (plan_cache_next + 1) % CONV_PLAN_CACHE_SIZE;
+    plan->shape = *s;
+    conv_out_hw(s, &plan->OH, &plan->OW);
+    plan->algo = choose_algo(s);
+    plan->valid = 1;
+    return plan;
+}
+
+struct conv_info {
+    const struct conv_shape *s;
+    int OH, OW;
+    const float *src, *weight, *bias;
+    float *dst;
+    float *col; /* im2col workspace */
+    int n, g;   /* current image and group for im2col */
+    int lrelu;
+    float negslope;
+};
+
+static inline void lrelu_inplace(float *p, int n, float negslope)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        p[i] = p[i] < 0 ? p[i] * negslope : p[i];
+}
+
+/* the range [*lo, *hi) of outputs o with 0 <= o * stride + off < size */
+static inline void valid_range(int off, int stride, int size, int nout, int *lo, int *hi)
+{
+    *lo = off < 0 ? (-off + stride - 1) / stride : 0;
+    *hi = size - 1 - off < 0 ? 0 : (size - 1 - off) / stride + 1;
+    if (*hi > nout)
+        *hi = nout;
+    if (*lo > *hi)
+        *lo = *hi;
+}
+
+/* one (image, output channel) plane per item */
+static void direct_nchw_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    const struct conv_shape *s = info->s;
+    int OH = info->OH, OW = info->OW;
+    int Cg = s->C / s->groups, OCg = s->OC / s->groups;
+    int item, n, oc, ic, kh, kw, oh, ow, ih, lo, hi, off, i;
+    const float *ip, *wp, *row;
+    float *o, *orow, wv;
+
+    for (item = start; item < end; item++) {
+        n = item / s->OC;
+        oc = item % s->OC;
+        o = info->dst + (size_t)item * OH * OW;
+        wv = info->bias ? info->bias[oc] : 0;
+        for (i = 0; i < OH * OW; i++)
+            o[i] = wv;
+
+        for (ic = 0; ic < Cg; ic++) {
+            ip = info->src + ((size_t)n * s->C + oc / OCg * Cg + ic) * s->H * s->W;
+            wp = info->weight + ((size_t)oc * Cg + ic) * s->KH * s->KW;
+            for (kh = 0; kh < s->KH; kh++) {
+                for (oh = 0; oh < OH; oh++) {
+                    ih = oh * s->sh - s->ph + kh * s->dh;
+                    if (ih < 0 || ih >= s->H)
+                        continue;
+                    row = ip + (size_t)ih * s->W;
+                    orow = o + (size_t)oh * OW;
+                    for (kw = 0; kw < s->KW; kw++) {
+                        wv = wp[kh * s->KW + kw];
+                        off = kw * s->dw - s->pw;
+                        valid_range(off, s->sw, s->W, OW, &lo, &hi);
+                        if (s->sw == 1) {
+                            for (ow = lo; ow < hi; ow++)
+                                orow[ow] += wv * row[ow + off];
+                        } else {
+                            for (ow = lo; ow < hi; ow++)
+                                orow[ow] += wv * row[ow * s->sw + off];
+                        }
+                    }
+                }
+            }
+        }
+        if (info->lrelu)
+            lrelu_inplace(o, OH * OW, info->negslope);
+    }
+}
+
+/* one (image, output row) per item, vectorized over channels */
+static void depthwise_nhwc_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    const struct conv_shape *s = info->s;
+    int OH = info->OH, OW = info->OW, C = s->C;
+    int item, n, oh, ow, kh, kw, ih, iw, c;
+    const float *ip, *wp;
+    float *o;
+
+    for (item = start; item < end; item++) {
+        n = item / OH;
+        oh = item % OH;
+        for (ow = 0; ow < OW; ow++) {
+            o = info->dst + ((size_t)item * OW + ow) * C;
+            if (info->bias)
+                memcpy(o, info->bias, sizeof(float) * C);
+            else
+                memset(o, 0, sizeof(float) * C);
+            for (kh = 0; kh < s->KH; kh++) {
+                ih = oh * s->sh - s->ph + kh * s->dh;
+                if (ih < 0 || ih >= s->H)
+                    continue;
+                for (kw = 0; kw < s->KW; kw++) {
+                    iw = ow * s->sw - s->pw + kw * s->dw;
+                    if (iw < 0 || iw >= s->W)
+                        continue;
+                    ip = info->src + (((size_t)n * s->H + ih) * s->W + iw) * C;
+                    wp = info->weight + (size_t)(kh * s->KW + kw) * C;
+                    for (c = 0; c < C; c++)
+                        o[c] += wp[c] * ip[c];
+                }
+            }
+            if (info->lrelu)
+                lrelu_inplace(o, C, info->negslope);
+        }
+    }
+}
+
+/* NCHW: col[(ic * KH + kh) * KW + kw][oh * OW + ow], one col row per item */
+static void im2col_nchw_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    const struct conv_shape *s = info->s;
+    int OH = info->OH, OW = info->OW, Cg = s->C / s->groups;
+    int item, ic, kh, kw, oh, ow, ih, lo, hi, off;
+    const float *ip, *row;
+    float *crow;
+
+    for (item = start; item < end; item++) {
+        ic = item / (s->KH * s->KW);
+        kh = item / s->KW % s->KH;
+        kw = item % s->KW;
+        ip = info->src + ((size_t)info->n * s->C + info->g * Cg + ic) * s->H * s->W;
+        off = kw * s->dw - s->pw;
+        valid_range(off, s->sw, s->W, OW, &lo, &hi);
+        for (oh = 0; oh < OH; oh++) {
+            crow = info->col + ((size_t)item * OH + oh) * OW;
+            ih = oh * s->sh - s->ph + kh * s->dh;
+            if (ih < 0 || ih >= s->H) {
+                memset(crow, 0, sizeof(float) * OW);
+                continue;
+            }
+            row = ip + (size_t)ih * s->W;
+            for (ow = 0; ow < lo; ow++)
+                crow[ow] = 0;
+            if (s->sw == 1) {
+                memcpy(crow + lo, row + lo + off, sizeof(float) * (hi - lo));
+            } else {
+                for (ow = lo; ow < hi; ow++)
+                    crow[ow] = row[ow * s->sw + off];
+            }
+            for (ow = hi; ow < OW; ow++)
+                crow[ow] = 0;
+        }
+    }
+}
+
+/* NHWC: col[oh * OW + ow][(kh * KW + kw) * Cg + ic], one output row per item */
+static void im2col_nhwc_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    const struct conv_shape *s = info->s;
+    int OW = info->OW, Cg = s->C / s->groups;
+    int K = s->KH * s->KW * Cg;
+    int oh, ow, kh, kw, ih, iw;
+    float *crow;
+
+    for (oh = start; oh < end; oh++) {
+        for (ow = 0; ow < OW; ow++) {
+            crow = info->col + ((size_t)oh * OW + ow) * K;
+            for (kh = 0; kh < s->KH; kh++) {
+                ih = oh * s->sh - s->ph + kh * s->dh;
+                for (kw = 0; kw < s->KW; kw++, crow += Cg) {
+                    iw = ow * s->sw - s->pw + kw * s->dw;
+                    if (ih < 0 || ih >= s->H || iw < 0 || iw >= s->W) {
+                        memset(crow, 0, sizeof(float) * Cg);
+                        continue;
+                    }
+                    memcpy(crow,
+                           info->src + (((size_t)info->n * s->H + ih) * s->W + iw) * s->C +
+                               info->g * Cg,
+                           sizeof(float) * Cg);
+                }
+            }
+        }
+    }
+}
+
+/* bias and lrelu after GEMM, one NCHW plane or NHWC pixel per item */
+static void epilogue_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    const struct conv_shape *s = info->s;
+    int plane = info->OH * info->OW;
+    int item, i;
+    float *o, b;
+
+    for (item = start; item < end; item++) {
+        if (s->layout == TL_NCHW) {
+            o = info->dst + (size_t)item * plane;
+            if (info->bias) {
+                b = info->bias[item % s->OC];
+                for (i = 0; i < plane; i++)
+                    o[i] += b;
+            }
+            if (info->lrelu)
+                lrelu_inplace(o, plane, info->negslope);
+        } else {
+            o = info->dst + (size_t)item * s->OC;
+            if (info->bias) {
+                for (i = 0; i < s->OC; i++)
+                    o[i] += info->bias[i];
+            }
+            if (info->lrelu)
+                lrelu_inplace(o, s->OC, info->negslope);
+        }
+    }
+}
+
+/* GEMM for image n, group g; A is the input itself (1x1) or info->col */
+static void conv_gemm(const struct conv_info *info, int n, int g)
+{
+    const struct conv_shape *s = info->s;
+    int Cg = s->C / s->groups, OCg = s->OC / s->groups;
+    int P = info->OH * info->OW;
+    int K = Cg * s->KH * s->KW;
+    const float *in;
+
+    if (s->layout == TL_NCHW) {
+        in = info->col ? info->col : info->src + ((size_t)n * s->C + g * Cg) * P;
+        tl_gemm_float(0, 0, OCg, P, K, info->weight + (size_t)g * OCg * K, K, in, P, 0,
+                      info->dst + ((size_t)n * s->OC + g * OCg) * P, P);
+    } else if (info->col) {
+        tl_gemm_float(0, 0, P, OCg, K, info->col, K, info->weight + g * OCg, s->OC, 0,
+                      info->dst + (size_t)n * P * s->OC + g * OCg, s->OC);
+    } else {
+        tl_gemm_float(0, 0, P, OCg, K, info->src + (size_t)n * P * s->C + g * Cg, s->C,
+                      info->weight + g * OCg, s->OC, 0,
+                      info->dst + (size_t)n * P * s->OC + g * OCg, s->OC);
+    }
+}
+
+static void gemm_1x1_worker(void *arg, int start, int end)
+{
+    const struct conv_info *info = arg;
+    int item;
+
+    for (item = start; item < end; item++)
+        conv_gemm(info, item / info->s->groups, item % info->s->groups);
+}
+
+static void conv_shape_init(struct conv_shape *s, const tl_tensor *src, const tl_tensor *weight,
+                            const int *stride, const int *padding, const int *dilation,
+                            int groups, tl_layout layout)
+{
+    assert(src && weight);
+    assert(src->dtype == TL_FLOAT && weight->dtype == TL_FLOAT);
+    assert(src->ndim == 4 && weight->ndim == 4);
+    tl_check_layout(layout);
+    assert(groups > 0);
+
+    memset(s, 0, sizeof(*s));
+    s->layout = layout;
+    s->N = src->dims[0];
+    if (layout == TL_NCHW) {
+        s->C = src->dims[1];
+        s->H = src->dims[2];
+        s->W = src->dims[3];
+        s->OC = weight->dims[0];
+        s->KH = weight->dims[2];
+        s->KW = weight->dims[3];
+        assert(weight->dims[1] * groups == s->C);
+    } else {
+        s->H = src->dims[1];
+        s->W = src->dims[2];
+        s->C = src->dims[3];
+        s->KH = weight->dims[0];
+        s->KW = weight->dims[1];
+        s->OC = weight->dims[3];
+        assert(weight->dims[2] * groups == s->C);
+    }
+    s->sh = stride ? stride[0] : 1;
+    s->sw = stride ? stride[1] : 1;
+    s->ph = padding ? padding[0] : 0;
+    s->pw = padding ? padding[1] : 0;
+    s->dh = dilation ? dilation[0] : 1;
+    s->dw = dilation ? dilation[1] : 1;
+    s->groups = groups;
+    assert(s->sh > 0 && s->sw > 0 && s->ph >= 0 && s->pw >= 0 && s->dh > 0 && s->dw > 0);
+    assert(s->OC % groups == 0);
+}
+
+static tl_shape *conv_out_shape(const struct conv_shape *s, int OH, int OW, tl_shape *shape)
+{
+    assert(OH > 0 && OW > 0);
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 4;
+    shape->dims[0] = s->N;
+    shape->dims[1] = s->layout == TL_NCHW ? s->OC : OH;
+    shape->dims[2] = s->layout == TL_NCHW ? OH : OW;
+    shape->dims[3] = s->layout == TL_NCHW ? OW : s->OC;
+    return shape;
+}
+
+TL_EXPORT tl_shape *tl_tensor_conv2d_out_shape(const tl_tensor *src, const tl_tensor *weight,
+                                               const int *stride, const int *padding,
+                                               const int *dilation, int groups,
+                                               tl_layout layout, tl_shape *shape)
+{
+    struct conv_shape s;
+    int OH, OW;
+
+    assert(shape);
+    conv_shape_init(&s, src, weight, stride, padding, dilation, groups, layout);
+    conv_out_hw(&s, &OH, &OW);
+    return conv_out_shape(&s, OH, OW, shape);
+}
+
+/* Weights are OIHW ([OC, C / groups, KH, KW]) for TL_NCHW and HWIO
+   ([KH, KW, C / groups, OC]) for TL_NHWC. stride, padding and dilation are
+   {h, w} pairs; NULL means 1, 0 and 1 respectively. Padding is symmetric.
+   bias ([OC]) is optional, and if lrelu is nonzero, a leaky ReLU with
+   negslope is applied to the output. Only TL_FLOAT is supported. */
+TL_EXPORT tl_tensor *tl_tensor_conv2d(const tl_tensor *src, const tl_tensor *weight,
+                                      const tl_tensor *bias, tl_tensor *dst, const int *stride,
+                                      const int *padding, const int *dilation, int groups,
+                                      tl_layout layout, int lrelu, float negslope)
+{
+    struct conv_shape s;
+    const struct conv_plan *plan;
+    struct conv_info info;
+    tl_shape shape;
+    int n, g, Cg, K, P;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    assert(weight && weight->data);
+    conv_shape_init(&s, src, weight, stride, padding, dilation, groups, layout);
+    if (bias) {
+        assert(bias->data);
+        assert(bias->dtype == TL_FLOAT);
+        assert(bias->ndim == 1 && bias->dims[0] == s.OC);
+    }
+
+    plan = get_plan(&s);
+    conv_out_shape(&s, plan->OH, plan->OW, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    info.s = &s;
+    info.OH = plan->OH;
+    info.OW = plan->OW;
+    info.src = src->data;
+    info.weight = weight->data;
+    info.bias = bias ? bias->data : NULL;
+    info.dst = dst->data;
+    info.col = NULL;
+    info.lrelu = lrelu;
+    info.negslope = negslope;
+    P = plan->OH * plan->OW;
+
+    switch (plan->algo) {
+    case CONV_DIRECT:
+        tl_parallel_for(s.N * s.OC, 1, direct_nchw_worker, &info);
+        break;
+    case CONV_DEPTHWISE:
+        tl_parallel_for(s.N * plan->OH, 1, depthwise_nhwc_worker, &info);
+        break;
+    case CONV_GEMM_1X1:
+        /* GEMMs run serially inside workers, threaded inside otherwise */
+        if (s.N * groups >= tl_get_num_threads())
+            tl_parallel_for(s.N * groups, 1, gemm_1x1_worker, &info);
+        else
+            gemm_1x1_worker(&info, 0, s.N * groups);
+        break;
+    case CONV_IM2COL:
+        Cg = s.C / groups;
+        K = Cg * s.KH * s.KW;
+        info.col = tl_alloc(sizeof(float) * K * P);
+        for (n = 0; n < s.N; n++) {
+            for (g = 0; g < groups; g++) {
+                info.n = n;
+                info.g = g;
+                if (layout == TL_NCHW)
+                    tl_parallel_for(K, 1, im2col_nchw_worker, &info);
+                else
+                    tl_parallel_for(plan->OH, 1, im2col_nhwc_worker, &info);
+                conv_gemm(&info, n, g);
+            }
+        }
+        tl_free(info.col);
+        info.col = NULL;
+        break;
+    }
+
+    /* the direct kernels apply bias and lrelu themselves */
+    if ((plan->algo == CONV_GEMM_1X1 || plan->algo == CONV_IM2COL) &&
+        (info.bias || info.lrelu)) {
+        if (layout == TL_NCHW)
+            tl_parallel_for(s.N * s.OC, 1, epilogue_worker, &info);
+        else
+            tl_parallel_for(s.N * P, 64, epilogue_worker, &info);
+    }
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src) + TL_PROFILE_TENSOR_BYTES(weight) +
+                      TL_PROFILE_TENSOR_BYTES(bias),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -21,32 +21,41 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
+TL_EXPORT tl_shape *tl_tensor_convert_out_shape(const tl_tensor *src, tl_dtype dtype_d,
+                                                tl_shape *shape)
+{
+    assert(src && shape);
+    tl_check_dtype(dtype_d);
+    tl_tensor_shape(src, shape);
+    shape->dtype = dtype_d;
+    return shape;
+}
+
+/* dst may share src's data for an in-place conversion between dtypes of the
+   same size, e.g. TL_FLOAT to TL_INT32 or TL_FLOAT16 to TL_BFLOAT16 */
 TL_EXPORT tl_tensor *tl_tensor_convert(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype_d)
 {
-    size_t dsize_d, dsize_s;
-    void *s_data, *d_data;
-    tl_dtype dtype_s;
-    int thread_num;
-    int di;
+    tl_shape shape;
+
+    TL_PROFILE_OP();
 
     assert(src && src->data);
+    tl_tensor_convert_out_shape(src, dtype_d, &shape);
     if (dst) {
         assert(dst->data);
         assert(tl_tensor_issameshape(src, dst));
         assert(dst->dtype == dtype_d);
+        tl_check_alias(src, dst);
+        assert((dst->data != src->data || tl_size_of(dst->dtype) == tl_size_of(src->dtype)) &&
+               "in-place convert needs dtypes of the same size");
     } else {
-        dst = tl_tensor_zeros(src->ndim, src->dims, dtype_d);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    dtype_s = src->dtype;
-    s_data = src->data;
-    d_data = dst->data;
-    dsize_d = tl_size_of(dtype_d);
-    dsize_s = tl_size_of(dtype_s);
-    thread_num = dst->len;
-    for (di = 0; di < thread_num; di++)
-        tl_convert(tl_padd(d_data, di, dsize_d), dtype_d, tl_padd(s_data, di, dsize_s), dtype_s);
+    tl_convert_n(dst->data, dtype_d, src->data, src->dtype, dst->len);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+
+struct yolo_info {
+    const tl_tensor *feature;
+    const float *anchors;
+    tl_tensor *box_centers;
+    tl_tensor *box_sizes;
+    tl_tensor *boxes;
+    tl_tensor *confs;
+    tl_tensor *probs;
+    int A, C, H, W;
+    float ratio_h, ratio_w;
+};
+
+static inline float sigmoid(float x)
+{
+    return 1.0f / (1.0f + expf(-x));
+}
+
+static void yolo_output_shape(tl_shape *shape, int N, int A, int K, int H, int W)
+{
+    if (!shape)
+        return;
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 5;
+    shape->dims[0] = N;
+    shape->dims[1] = A;
+    shape->dims[2] = K;
+    shape->dims[3] = H;
+    shape->dims[4] = W;
+}
+
+static void check_yolo_output(tl_tensor *t, int N, int A, int K, int H, int W)
+{
+    tl_shape shape;
+
+    if (!t)
+        return;
+    yolo_output_shape(&shape, N, A, K, H, W);
+    tl_tensor_dst(t, &shape);
+}
+
+/* N, A, C, H and W of a YOLOv3 layer */
+static void yolo_dims(const tl_tensor *feature, const tl_tensor *anchors, int *N, int *A, int *C,
+                      int *H, int *W)
+{
+    assert(feature && anchors);
+    assert(feature->dtype == TL_FLOAT && anchors->dtype == TL_FLOAT);
+    assert(feature->ndim == 4);
+    assert(anchors->ndim == 2 && anchors->dims[1] == 2);
+    *N = feature->dims[0];
+    *A = anchors->dims[0];
+    assert(feature->dims[1] % *A == 0 && feature->dims[1] / *A > 5);
+    *C = feature->dims[1] / *A - 5;
+    *H = feature->dims[2];
+    *W = feature->dims[3];
+}
+
+/* one job per (image, anchor) */
+static void yolo_worker(void *arg, int start, int end)
+{
+    const struct yolo_info *info = arg;
+    int H = info->H, W = info->W, C = info->C;
+    size_t plane = (size_t)H * W;
+    int job, a, k, x, y;
+    size_t i;
+
+    for (job = start; job < end; job++) {
+        const float *f = (const float *)info->feature->data + job * (5 + C) * plane;
+        float *bc = info->box_centers ? (float *)info->box_centers->data + job * 2 * plane : NULL;
+        float *bs = info->box_sizes ? (float *)info->box_sizes->data + job * 2 * plane : NULL;
+        float *b = info->boxes ? (float *)info->boxes->data + job * 4 * plane : NULL;
+        float *cf = info->confs ? (float *)info->confs->data + job * plane : NULL;
+        float *p = info->probs ? (float *)info->probs->data + job * C * plane : NULL;
+        float aw, ah;
+
+        a = job % info->A;
+        aw = info->anchors[a * 2];
+        ah = info->anchors[a * 2 + 1];
+        for (y = 0, i = 0; y < H; y++) {
+            for (x = 0; x < W; x++, i++) {
+                float cx = (sigmoid(f[i]) + x) * info->ratio_w;
+                float cy = (sigmoid(f[plane + i]) + y) * info->ratio_h;
+                float w = fminf(fmaxf(expf(f[2 * plane + i]), 1e-9f), 50.0f) * aw;
+                float h = fminf(fmaxf(expf(f[3 * plane + i]), 1e-9f), 50.0f) * ah;
+
+                if (bc) {
+                    bc[i] = cx;
+                    bc[plane + i] = cy;
+                }
+                if (bs) {
+                    bs[i] = w;
+                    bs[plane + i] = h;
+                }
+                if (b) {
+                    b[i] = cx - w / 2;
+                    b[plane + i] = cy - h / 2;
+                    b[2 * plane + i] = cx + w / 2;
+                    b[3 * plane + i] = cy + h / 2;
+                }
+            }
+        }
+        if (cf)
+            for (i = 0; i < plane; i++)
+                cf[i] = sigmoid(f[4 * plane + i]);
+        if (p)
+            for (k = 0; k < C; k++)
+                for (i = 0; i < plane; i++)
+                    p[k * plane + i] = sigmoid(f[(5 + k) * plane + i]);
+    }
+}
+
+/* The shapes of tl_tensor_detect_yolov3()'s outputs; any of them may be NULL. */
+TL_EXPORT void tl_tensor_detect_yolov3_out_shape(const tl_tensor *feature,
+                                                 const tl_tensor *anchors, tl_shape *box_centers,
+                                                 tl_shape *box_sizes, tl_shape *boxes,
+                                                 tl_shape *confs, tl_shape *probs)
+{
+    int N, A, C, H, W;
+
+    yolo_dims(feature, anchors, &N, &A, &C, &H, &W);
+    yolo_output_shape(box_centers, N, A, 2, H, W);
+    yolo_output_shape(box_sizes, N, A, 2, H, W);
+    yolo_output_shape(boxes, N, A, 4, H, W);
+    yolo_output_shape(confs, N, A, 1, H, W);
+    yolo_output_shape(probs, N, A, C, H, W);
+}
+
+/* Decodes a YOLOv3 output layer of a batch of images.
+   feature: N*(A*(5+C))*H*W, the channels of each anchor being x, y, w, h,
+   objectness and C class logits; anchors: A*2, (w, h) in image pixels.
+   Outputs, each N*A*K*H*W, may be NULL if not needed:
+   box_centers (K=2): (sigmoid(x|y) + grid x|y) * img_w|h / W|H
+   box_sizes (K=2): clip(exp(w|h), 1e-9, 50) * anchor w|h
+   boxes (K=4): xmin, ymin, xmax, ymax
+   confs (K=1): sigmoid(objectness)
+   probs (K=C): sigmoid(class logits) */
+TL_EXPORT void tl_tensor_detect_yolov3(const tl_tensor *feature, const tl_tensor *anchors,
+                                       tl_tensor *box_centers, tl_tensor *box_sizes,
+                                       tl_tensor *boxes, tl_tensor *confs, tl_tensor *probs,
+                                       int img_h, int img_w)
+{
+    struct yolo_info info;
+    int N;
+
+    TL_PROFILE_OP();
+
+    assert(feature && feature->data);
+    assert(anchors && anchors->data);
+    assert(img_h > 0 && img_w > 0);
+    yolo_dims(feature, anchors, &N, &info.A, &info.C, &info.H, &info.W);
+    check_yolo_output(box_centers, N, info.A, 2, info.H, info.W);
+    check_yolo_output(box_sizes, N, info.A, 2, info.H, info.W);
+    check_yolo_output(boxes, N, info.A, 4, info.H, info.W);
+    check_yolo_output(confs, N, info.A, 1, info.H, info.W);
+    check_yolo_output(probs, N, info.A, info.C, info.H, info.W);
+
+    info.feature = feature;
+    info.anchors = anchors->data;
+    info.box_centers = box_centers;
+    info.box_sizes = box_sizes;
+    info.boxes = boxes;
+    info.confs = confs;
+    info.probs = probs;
+    info.ratio_h = (float)img_h / info.H;
+    info.ratio_w = (float)img_w / info.W;
+    tl_parallel_for(N * info.A, 16384 / (info.H * info.W * (5 + info.C)) + 1, yolo_worker,
+                    &info);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(feature),
+                  TL_PROFILE_TENSOR_BYTES(box_centers) + TL_PROFILE_TENSOR_BYTES(box_sizes) +
+                      TL_PROFILE_TENSOR_BYTES(boxes) + TL_PROFILE_TENSOR_BYTES(confs) +
+                      TL_PROFILE_TENSOR_BYTES(probs));
+}
+
+struct nms_cand {
+    float score;
+    int index;
+};
+
+struct nms_info {
+    const float *boxes;
+    const float *scores;
+    int32_t *dst;
+    struct nms_cand *cands; /* M per image, shared by the batch */
+    int M;
+    int max_out;
+    float iou_thresh;
+    float score_thresh;
+};
+
+/* by descending score, then ascending index to be deterministic */
+static int nms_cand_cmp(const void *a, const void *b)
+{
+    const struct nms_cand *ca = a, *cb = b;
+
+    if (ca->score != cb->score)
+        return ca->score < cb->score ? 1 : -1;
+    return ca->index - cb->index;
+}
+
+static float iou(const float *b1, const float *b2)
+{
+    float w, h, inter, uni;
+
+    w = fminf(b1[2], b2[2]) - fmaxf(b1[0], b2[0]);
+    h = fminf(b1[3], b2[3]) - fmaxf(b1[1], b2[1]);
+    if (w <= 0 || h <= 0)
+        return 0;
+    inter = w * h;
+    uni = (b1[2] - b1[0]) * (b1[3] - b1[1]) + (b2[2] - b2[0]) * (b2[3] - b2[1]) - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+static void nms_worker(void *arg, int start, int end)
+{
+    const struct nms_info *info = arg;
+    int img, i, j, n, kept;
+
+    for (img = start; img < end; img++) {
+        const float *boxes = info->boxes + (size_t)img * info->M * 4;
+        const float *scores = info->scores + (size_t)img * info->M;
+        struct nms_cand *cands = info->cands + (size_t)img * info->M;
+        int32_t *dst = info->dst + (size_t)img * info->max_out;
+
+        for (i = 0, n = 0; i < info->M; i++) {
+            if (scores[i] >= info->score_thresh) {
+                cands[n].score = scores[i];
+                cands[n].index = i;
+                n++;
+            }
+        }
+        qsort(cands, n, sizeof(struct nms_cand), nms_cand_cmp);
+
+        for (i = 0, kept = 0; i < n && kept < info->max_out; i++) {
+            const float *b = boxes + (size_t)cands[i].index * 4;
+            for (j = 0; j < kept; j++)
+                if (iou(b, boxes + (size_t)dst[j] * 4) > info->iou_thresh)
+                    break;
+            if (j == kept)
+                dst[kept++] = cands[i].index;
+        }
+        for (; kept < info->max_out; kept++)
+            dst[kept] = -1;
+    }
+}
+
+TL_EXPORT tl_shape *tl_tensor_nms_out_shape(const tl_tensor *boxes, const tl_tensor *scores,
+                                             int max_out, tl_shape *shape)
+{
+    assert(boxes && scores && shape);
+    assert(boxes->dtype == TL_FLOAT && scores->dtype == TL_FLOAT);
+    assert(boxes->ndim == 3 && boxes->dims[2] == 4);
+    assert(scores->ndim == 2);
+    assert(scores->dims[0] == boxes->dims[0] && scores->dims[1] == boxes->dims[1]);
+    shape->dtype = TL_INT32;
+    shape->ndim = 2;
+    shape->dims[0] = boxes->dims[0];
+    shape->dims[1] = max_out > 0 ? max_out : boxes->dims[1];
+    return shape;
+}
+
+/* Greedy non-maximum suppression of a batch.
+   boxes: N*M*4 (xmin, ymin, xmax, ymax), scores: N*M, both TL_FLOAT.
+   dst: N*max_out TL_INT32, the indices of the kept boxes of each image by
+   descending score, padded with -1. Boxes scoring below score_thresh are
+   dropped, and a box is suppressed if its IoU with a kept box is above
+   iou_thresh. max_out <= 0 means M. */
+TL_EXPORT tl_tensor *tl_tensor_nms(const tl_tensor *boxes, const tl_tensor *scores,
+                                   tl_tensor *dst, float iou_thresh, float score_thresh,
+                                   int max_out)
+{
+    struct nms_info info;
+    tl_shape shape;
+    int N;
+
+    TL_PROFILE_OP();
+
+    assert(boxes && boxes->data);
+    assert(scores && scores->data);
+    tl_tensor_nms_out_shape(boxes, scores, max_out, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    N = shape.dims[0];
+    info.M = boxes->dims[1];
+    info.max_out = shape.dims[1];
+
+    info.boxes = boxes->data;
+    info.scores = scores->data;
+    info.dst = dst->data;
+    info.iou_thresh = iou_thresh;
+    info.score_thresh = score_thresh;
+    info.cands = tl_alloc(sizeof(struct nms_cand) * N * info.M);
+    tl_parallel_for(N, 1, nms_worker, &info);
+    tl_free(info.cands);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(boxes) + TL_PROFILE_TENSOR_BYTES(scores),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
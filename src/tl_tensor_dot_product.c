@@ -21,40 +21,212 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
-TL_EXPORT tl_tensor *tl_tensor_dot_product(const tl_tensor *src1, const tl_tensor *src2,
-                                           tl_tensor *dst)
+/* Eight independent accumulators break the add dependency chain, so the
+   loop can be vectorized without reassociating floating point sums.
+   Integers are summed in uint64_t, signed ones included: the sum wraps
+   around modulo 2^64, with no undefined overflow, and is cast back to
+   int64_t for the signed dtypes, as two's complement would give. */
+#define DOT_KERNEL(name, T, ACC)                                                                   \
+    static ACC name(const T *a, const T *b, int n)                                                 \
+    {                                                                                              \
+        ACC s[8] = { 0 };                                                                          \
+        int i, k;                                                                                  \
+                                                                                                   \
+        for (i = 0; i + 8 <= n; i += 8)                                                            \
+            for (k = 0; k < 8; k++)                                                                \
+                s[k] += (ACC)a[i + k] * (ACC)b[i + k];                                             \
+        for (; i < n; i++)                                                                         \
+            s[0] += (ACC)a[i] * (ACC)b[i];                                                         \
+        return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));                  \
+    }
+
+DOT_KERNEL(dot_double, double, double)
+DOT_KERNEL(dot_float, float, float)
+DOT_KERNEL(dot_float_wide, float, double)
+DOT_KERNEL(dot_int64, int64_t, uint64_t)
+DOT_KERNEL(dot_int32, int32_t, uint64_t)
+DOT_KERNEL(dot_int16, int16_t, uint64_t)
+DOT_KERNEL(dot_int8, int8_t, uint64_t)
+DOT_KERNEL(dot_uint64, uint64_t, uint64_t)
+DOT_KERNEL(dot_uint32, uint32_t, uint64_t)
+DOT_KERNEL(dot_uint16, uint16_t, uint64_t)
+DOT_KERNEL(dot_uint8, uint8_t, uint64_t)
+DOT_KERNEL(dot_bool, tl_bool_t, uint64_t)
+
+struct dot_info {
+    const tl_tensor *src1, *src2;
+    tl_dtype acc_dtype;
+    void *partials; /* one acc_dtype element per chunk */
+};
+
+/* the 16-bit float dtypes are converted to float a block at a time */
+#define DOT_HALF_BLOCK 1024
+
+static void dot_half(const struct dot_info *info, int off, int n, int c)
 {
-    int di;
-    size_t dsize;
-    tl_dtype dtype;
-    void *s1_data, *s2_data, *d_data;
-    char elew_prod[TL_DTYPE_MAX_SIZE];
-    tl_elew_func elew;
+    float a[DOT_HALF_BLOCK], b[DOT_HALF_BLOCK];
+    size_t dsize = tl_size_of(info->src1->dtype);
+    double sum_d = 0;
+    float sum_f = 0;
+    int i, m;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < DOT_HALF_BLOCK ? n - i : DOT_HALF_BLOCK;
+        tl_convert_n(a, TL_FLOAT, tl_padd(info->src1->data, off + i, dsize), info->src1->dtype, m);
+        tl_convert_n(b, TL_FLOAT, tl_padd(info->src2->data, off + i, dsize), info->src1->dtype, m);
+        if (info->acc_dtype == TL_DOUBLE)
+            sum_d += dot_float_wide(a, b, m);
+        else
+            sum_f += dot_float(a, b, m);
+    }
+    if (info->acc_dtype == TL_DOUBLE)
+        ((double *)info->partials)[c] = sum_d;
+    else
+        ((float *)info->partials)[c] = sum_f;
+}
+
+static void dot_worker(void *arg, int start, int end)
+{
+    const struct dot_info *info = arg;
+    int len = info->src1->len;
+    int c, off, n;
+
+    for (c = start; c < end; c++) {
+        off = c * TL_REDUCE_CHUNK;
+        n = len - off < TL_REDUCE_CHUNK ? len - off : TL_REDUCE_CHUNK;
+#define DOT_CASE(dtype, T, func, ACC)                                                              \
+    case dtype:                                                                                    \
+        ((ACC *)info->partials)[c] =                                                               \
+            (ACC)func((const T *)info->src1->data + off, (const T *)info->src2->data + off, n);    \
+        break
+        switch (info->src1->dtype) {
+            DOT_CASE(TL_DOUBLE, double, dot_double, double);
+        case TL_FLOAT: {
+            const float *a = (const float *)info->src1->data + off;
+            const float *b = (const float *)info->src2->data + off;
+            if (info->acc_dtype == TL_DOUBLE)
+                ((double *)info->partials)[c] = dot_float_wide(a, b, n);
+            else
+                ((float *)info->partials)[c] = dot_float(a, b, n);
+            break;
+        }
+            DOT_CASE(TL_INT64, int64_t, dot_int64, int64_t);
+            DOT_CASE(TL_INT32, int32_t, dot_int32, int64_t);
+            DOT_CASE(TL_INT16, int16_t, dot_int16, int64_t);
+            DOT_CASE(TL_INT8, int8_t, dot_int8, int64_t);
+            DOT_CASE(TL_UINT64, uint64_t, dot_uint64, uint64_t);
+            DOT_CASE(TL_UINT32, uint32_t, dot_uint32, uint64_t);
+            DOT_CASE(TL_UINT16, uint16_t, dot_uint16, uint64_t);
+            DOT_CASE(TL_UINT8, uint8_t, dot_uint8, uint64_t);
+            DOT_CASE(TL_BOOL, tl_bool_t, dot_bool, int64_t);
+        case TL_FLOAT16:
+        case TL_BFLOAT16:
+            dot_half(info, off, n, c);
+            break;
+        default:
+            assert(0 && "unsupported tl_dtype");
+            break;
+        }
+#undef DOT_CASE
+    }
+}
 
+/* dst's dtype may also be a wider one than the src1's given here */
+TL_EXPORT tl_shape *tl_tensor_dot_product_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                                     tl_shape *shape)
+{
     assert(tl_tensor_issameshape(src1, src2));
-    assert(src1->data && src2->data);
     assert(src1->dtype == src2->dtype);
+    assert(shape);
+    shape->dtype = src1->dtype;
+    shape->ndim = 1;
+    shape->dims[0] = 1;
+    return shape;
+}
+
+/* The accumulator is chosen by the src dtype: integers accumulate in 64 bits,
+   floats (including the 16-bit ones) in float, or in double if dst is
+   TL_DOUBLE. The result is then converted (saturated) to dst's dtype, which
+   may differ from src's dtype to get a wider result, e.g. a TL_INT32 dst for TL_INT8 srcs.
+   Partial sums are taken over fixed-size chunks, so the result does not
+   depend on the number of threads. */
+TL_EXPORT tl_tensor *tl_tensor_dot_product(const tl_tensor *src1, const tl_tensor *src2,
+                                           tl_tensor *dst)
+{
+    struct dot_info info;
+    int nchunks, c;
+    double sum_d;
+    float sum_f;
+    int64_t sum_i;
+    uint64_t sum_u;
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
+    assert(src1 && src2 && src1->data && src2->data);
+    tl_tensor_dot_product_out_shape(src1, src2, &shape);
     if (dst) {
         assert(dst->data);
         assert(dst->ndim == 1);
         assert(dst->dims[0] == 1);
-        assert(src1->dtype == dst->dtype);
     } else {
-        dst = tl_tensor_zeros(1, (int[]){ 1 }, src1->dtype);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    s1_data = src1->data;
-    s2_data = src2->data;
-    d_data = dst->data;
-    dtype = src1->dtype;
-    dsize = tl_size_of(dtype);
-    elew = tl_elew_getfunc(dtype);
-    memset(dst->data, 0, tl_tensor_size(dst));
-    for (di = 0; di < src1->len; di++) {
-        elew(tl_padd(s1_data, di, dsize), tl_padd(s2_data, di, dsize), elew_prod, TL_MUL);
-        elew(elew_prod, d_data, d_data, TL_SUM);
+    switch (src1->dtype) {
+    case TL_DOUBLE:
+        info.acc_dtype = TL_DOUBLE;
+        break;
+    case TL_FLOAT:
+    case TL_FLOAT16:
+    case TL_BFLOAT16:
+        info.acc_dtype = dst->dtype == TL_DOUBLE ? TL_DOUBLE : TL_FLOAT;
+        break;
+    case TL_UINT64:
+    case TL_UINT32:
+    case TL_UINT16:
+    case TL_UINT8:
+        info.acc_dtype = TL_UINT64;
+        break;
+    default:
+        info.acc_dtype = TL_INT64;
+        break;
+    }
+
+    nchunks = (src1->len + TL_REDUCE_CHUNK - 1) / TL_REDUCE_CHUNK;
+    info.src1 = src1;
+    info.src2 = src2;
+    info.partials = tl_alloc(tl_size_of(info.acc_dtype) * nchunks);
+    tl_parallel_for(nchunks, 1, dot_worker, &info);
+
+    switch (info.acc_dtype) {
+    case TL_DOUBLE:
+        for (c = 0, sum_d = 0; c < nchunks; c++)
+            sum_d += ((double *)info.partials)[c];
+        tl_convert(dst->data, dst->dtype, &sum_d, TL_DOUBLE);
+        break;
+    case TL_FLOAT:
+        for (c = 0, sum_f = 0; c < nchunks; c++)
+            sum_f += ((float *)info.partials)[c];
+        tl_convert(dst->data, dst->dtype, &sum_f, TL_FLOAT);
+        break;
+    case TL_INT64:
+        for (c = 0, sum_u = 0; c < nchunks; c++)
+            sum_u += (uint64_t)((int64_t *)info.partials)[c];
+        sum_i = (int64_t)sum_u;
+        tl_convert(dst->data, dst->dtype, &sum_i, TL_INT64);
+        break;
+    default:
+        for (c = 0, sum_u = 0; c < nchunks; c++)
+            sum_u += ((uint64_t *)info.partials)[c];
+        tl_convert(dst->data, dst->dtype, &sum_u, TL_UINT64);
+        break;
     }
+    tl_free(info.partials);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
@@ -21,81 +21,79 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
+TL_EXPORT tl_shape *tl_tensor_elew_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                              tl_shape *shape)
+{
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->dtype == src2->dtype);
+    assert(shape);
+    tl_tensor_shape(src1, shape);
+    return shape;
+}
+
+/* dst may be src1 and/or src2 for an in-place update */
 TL_EXPORT tl_tensor *tl_tensor_elew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
                                     tl_elew_op elew_op)
 {
-    int thread_num;
-    int di;
-    size_t dsize;
-    tl_dtype dtype;
-    void *s1_data, *s2_data, *d_data;
-    void *elew_res;
-    tl_elew_func elew;
+    tl_shape shape;
 
-    assert(tl_tensor_issameshape(src1, src2));
-    assert(src1->data && src2->data);
-    assert(src1->dtype == src2->dtype);
+    TL_PROFILE_OP();
+
+    assert(src1 && src2 && src1->data && src2->data);
+    tl_tensor_elew_out_shape(src1, src2, &shape);
     if (dst) {
         assert(dst->data);
         assert(tl_tensor_issameshape(src1, dst));
         assert(src1->dtype == dst->dtype);
+        tl_check_alias(src1, dst);
+        tl_check_alias(src2, dst);
     } else {
-        dst = tl_tensor_zeros(src1->ndim, src2->dims, src1->dtype);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    thread_num = dst->len;
-    s1_data = src1->data;
-    s2_data = src2->data;
-    d_data = dst->data;
-    dtype = src1->dtype;
-    dsize = tl_size_of(dtype);
-    elew = tl_elew_getfunc(dtype);
-    elew_res = tl_alloc(dsize);
-    for (di = 0; di < thread_num; di++) {
-        elew(tl_padd(s1_data, di, dsize), tl_padd(s2_data, di, dsize), elew_res, elew_op);
-        tl_passign(d_data, di, elew_res, 0, dsize);
-    }
-    tl_free(elew_res);
+    tl_elew_n(src1->data, src2->data, dst->data, dst->len, elew_op, src1->dtype);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
+TL_EXPORT tl_shape *tl_tensor_elew_param_out_shape(const tl_tensor *src, tl_shape *shape)
+{
+    assert(src && shape);
+    tl_tensor_shape(src, shape);
+    return shape;
+}
+
+/* dst may be src for an in-place update */
 TL_EXPORT tl_tensor *tl_tensor_elew_param(const tl_tensor *src, double param, tl_tensor *dst,
                                           tl_elew_op elew_op)
 {
-    int thread_num;
-    int di;
+    tl_shape shape;
     size_t dsize;
-    tl_dtype dtype;
-    void *s_data, *d_data;
-    void *elew_res, *param_data;
-    tl_elew_func elew;
+    void *param_data;
+
+    TL_PROFILE_OP();
 
     assert(src && src->data);
+    tl_tensor_elew_param_out_shape(src, &shape);
     if (dst) {
         assert(dst->data);
         assert(tl_tensor_issameshape(src, dst));
         assert(src->dtype == dst->dtype);
+        tl_check_alias(src, dst);
     } else {
-        dst = tl_tensor_zeros(src->ndim, src->dims, src->dtype);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    thread_num = dst->len;
-    s_data = src->data;
-    d_data = dst->data;
-    dtype = src->dtype;
-    dsize = tl_size_of(dtype);
-    elew = tl_elew_getfunc(dtype);
-    elew_res = tl_alloc(dsize);
+    dsize = tl_size_of(src->dtype);
     param_data = tl_alloc(dsize);
-    tl_convert(param_data, dtype, &param, TL_DOUBLE);
-    for (di = 0; di < thread_num; di++) {
-        elew(tl_padd(s_data, di, dsize), param_data, elew_res, elew_op);
-        tl_passign(d_data, di, elew_res, 0, dsize);
-    }
-    tl_free(elew_res);
+    tl_convert(param_data, src->dtype, &param, TL_DOUBLE);
+    tl_elew_scalar_n(src->data, param_data, dst->data, dst->len, elew_op, src->dtype);
     tl_free(param_data);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
@@ -33,6 +33,12 @@
 #include "tl_type.h"
 #include "tl_tensor.h"
 #include "tl_util.h"
+#include "tl_parallel.h"
+#include "tl_profile_internal.h"
+
+/* elements per partial result of full reductions, fixed so that results
+   don't depend on the number of threads */
+#define TL_REDUCE_CHUNK 65536
 
 static inline int tl_get_index(const int *ids, int ndim, const int *dims)
 {
@@ -79,4 +85,53 @@ static inline void tl_check_tensor(const tl_tensor *t)
     assert(t->len == tl_compute_length(t->ndim, t->dims));
 }
 
+/* dst is either src's data itself, for ops that can run in place, or
+   doesn't overlap it at all */
+static inline void tl_check_alias(const tl_tensor *src, const tl_tensor *dst)
+{
+    uintptr_t s = (uintptr_t)src->data, d = (uintptr_t)dst->data;
+    size_t s_size = (size_t)src->len * tl_size_of(src->dtype);
+    size_t d_size = (size_t)dst->len * tl_size_of(dst->dtype);
+
+    assert((s == d || s + s_size <= d || d + d_size <= s) && "src and dst partially overlap");
+    (void)s, (void)d, (void)s_size, (void)d_size;
+}
+
+/* The dst of an op whose result has the given shape: dst itself, which must
+   have it, or a new zeroed tensor of it if dst is NULL. */
+static inline tl_tensor *tl_tensor_dst(tl_tensor *dst, const tl_shape *shape)
+{
+    if (!dst)
+        return tl_tensor_zeros_shape(shape);
+#ifndef NDEBUG
+    assert(dst->data);
+    assert(dst->dtype == shape->dtype);
+    assert(dst->ndim == shape->ndim);
+    for (int i = 0; i < shape->ndim; i++)
+        assert(dst->dims[i] == shape->dims[i]);
+#endif
+    return dst;
+}
+
+void tl_preprocess_images(const tl_tensor **srcs, int n, tl_tensor *dst, const int *new_hw,
+                          tl_resize_type rtype, const double *mean, const double *std,
+                          double scale, int reverse);
+
+/* t is affine quantized, with parameters that fit its shape and dtype */
+static inline void tl_check_qtensor(const tl_tensor *t)
+{
+    int i, lo, hi;
+
+    assert(t && t->data);
+    assert(t->dtype == TL_INT8 || t->dtype == TL_UINT8);
+    assert(t->quant && "tensor has no quantization parameters");
+    assert(t->quant->axis < t->ndim);
+    assert(t->quant->axis < 0 || t->quant->len == t->dims[t->quant->axis]);
+    lo = t->dtype == TL_INT8 ? INT8_MIN : 0;
+    hi = t->dtype == TL_INT8 ? INT8_MAX : UINT8_MAX;
+    for (i = 0; i < t->quant->len; i++)
+        assert(t->quant->zero_points[i] >= lo && t->quant->zero_points[i] <= hi);
+    (void)lo, (void)hi;
+}
+
 #endif /* _TL_TENSOR_INTERNAL_H_ */
@@ -21,22 +21,35 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
+TL_EXPORT tl_shape *tl_tensor_lrelu_out_shape(const tl_tensor *src, tl_shape *shape)
+{
+    assert(src && shape);
+    tl_tensor_shape(src, shape);
+    return shape;
+}
+
+/* dst may be src for an in-place update */
 TL_EXPORT tl_tensor *tl_tensor_lrelu(const tl_tensor *src, tl_tensor *dst, float negslope)
 {
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
     assert(src && src->data);
+    tl_tensor_lrelu_out_shape(src, &shape);
     if (dst) {
         assert(dst && dst->data);
         assert(tl_tensor_issameshape(dst, src));
         assert(dst->dtype == src->dtype);
+        tl_check_alias(src, dst);
     } else {
-        dst = tl_tensor_zeros(src->ndim, src->dims, src->dtype);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    tl_dtype dtype = src->dtype;
-    size_t dsize = tl_size_of(dtype);
-    for (int i = 0; i < src->len; i++)
-        tl_lrelu(tl_padd(dst->data, i, dsize), tl_padd(src->data, i, dsize), negslope, dtype);
+    tl_lrelu_n(dst->data, src->data, negslope, src->len, src->dtype);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+#include "tl_gemm.h"
+
+struct matmul_info {
+    const tl_tensor *src1, *src2;
+    tl_tensor *dst;
+    int trans1, trans2;
+    int M, N, K;
+    int batch_ndim;
+    int batch_dims[TL_MAXDIM];
+    int s1_strides[TL_MAXDIM]; /* batch strides in matrices, 0 if broadcasted */
+    int s2_strides[TL_MAXDIM];
+    void (*one)(const struct matmul_info *info, int b);
+    /* quantized matmul: zero points of src1 and of each column of op(src2),
+       and the requantization of each column of dst if it isn't TL_INT32 */
+    int32_t za;
+    int32_t *zb;
+    int32_t *mult;
+    int *shift;
+    int32_t *zd;
+};
+
+/* offsets of the b-th matrices of src1 and src2, in matrices */
+static void matmul_offsets(const struct matmul_info *info, int b, int *s1_off, int *s2_off)
+{
+    int i, idx;
+
+    for (i = info->batch_ndim - 1, idx = b, *s1_off = 0, *s2_off = 0; i >= 0; i--) {
+        *s1_off += idx % info->batch_dims[i] * info->s1_strides[i];
+        *s2_off += idx % info->batch_dims[i] * info->s2_strides[i];
+        idx /= info->batch_dims[i];
+    }
+}
+
+static void matmul_one(const struct matmul_info *info, int b)
+{
+    int s1_off, s2_off;
+    size_t mat1, mat2, matd;
+    int lda, ldb;
+
+    matmul_offsets(info, b, &s1_off, &s2_off);
+    mat1 = (size_t)info->M * info->K;
+    mat2 = (size_t)info->K * info->N;
+    matd = (size_t)info->M * info->N;
+    lda = info->trans1 ? info->M : info->K;
+    ldb = info->trans2 ? info->K : info->N;
+
+    switch (info->dst->dtype) {
+    case TL_FLOAT:
+        tl_gemm_float(info->trans1, info->trans2, info->M, info->N, info->K,
+                      (float *)info->src1->data + s1_off * mat1, lda,
+                      (float *)info->src2->data + s2_off * mat2, ldb, 0,
+                      (float *)info->dst->data + b * matd, info->N);
+        break;
+    case TL_DOUBLE:
+        tl_gemm_double(info->trans1, info->trans2, info->M, info->N, info->K,
+                       (double *)info->src1->data + s1_off * mat1, lda,
+                       (double *)info->src2->data + s2_off * mat2, ldb, 0,
+                       (double *)info->dst->data + b * matd, info->N);
+        break;
+    case TL_INT32:
+        tl_gemm_int32(info->trans1, info->trans2, info->M, info->N, info->K,
+                      (int32_t *)info->src1->data + s1_off * mat1, lda,
+                      (int32_t *)info->src2->data + s2_off * mat2, ldb, 0,
+                      (int32_t *)info->dst->data + b * matd, info->N);
+        break;
+    default:
+        assert(0 && "unsupported tl_dtype");
+        break;
+    }
+}
+
+/* d[r][c] = s[r][c] - zero[r * zr + c * zc] */
+static void qwiden(int16_t *d, const void *s, tl_dtype dtype, int rows, int cols,
+                   const int32_t *zero, int zr, int zc)
+{
+    int r, c;
+
+#define QWIDEN(T)                                                                                  \
+    for (r = 0; r < rows; r++) {                                                                   \
+        const T *sr = (const T *)s + (size_t)r * cols;                                             \
+        int16_t *dr = d + (size_t)r * cols;                                                        \
+        const int32_t *z = zero + r * zr;                                                          \
+        for (c = 0; c < cols; c++)                                                                 \
+            dr[c] = (int16_t)(sr[c] - z[c * zc]);                                                  \
+    }
+    if (dtype == TL_INT8)
+        QWIDEN(int8_t)
+    else
+        QWIDEN(uint8_t)
+#undef QWIDEN
+}
+
+/* d[r][c] = saturate(zd[c] + round(acc[r][c] * mult[c] * 2^-shift[c])),
+   rounding half up */
+static void qrequantize(void *d, tl_dtype dtype, const int32_t *acc, int rows, int cols,
+                        const int32_t *mult, const int *shift, const int32_t *zd)
+{
+    int r, c;
+    int64_t v;
+
+#define QREQUANTIZE(T, lo, hi)                                                                     \
+    for (r = 0; r < rows; r++) {                                                                   \
+        const int32_t *ar = acc + (size_t)r * cols;                                                \
+        T *dr = (T *)d + (size_t)r * cols;                                                         \
+        for (c = 0; c < cols; c++) {                                                               \
+            v = ((int64_t)ar[c] * mult[c] + ((int64_t)1 << (shift[c] - 1))) >> shift[c];          \
+            v += zd[c];                                                                            \
+            dr[c] = (T)(v < (lo) ? (lo) : v > (hi) ? (hi) : v);                                    \
+        }                                                                                          \
+    }
+    if (dtype == TL_INT8)
+        QREQUANTIZE(int8_t, INT8_MIN, INT8_MAX)
+    else
+        QREQUANTIZE(uint8_t, 0, UINT8_MAX)
+#undef QREQUANTIZE
+}
+
+/* m = mult * 2^-shift with mult in [2^30, 2^31) and shift in [1, 62], so
+   that acc * mult never overflows 64 bits */
+static void quant_multiplier(double m, int32_t *mult, int *shift)
+{
+    long long q;
+    int e;
+
+    assert(m > 0);
+    q = llround(frexp(m, &e) * (1LL << 31));
+    if (q == 1LL << 31) {
+        q /= 2;
+        e++;
+    }
+    *shift = 31 - e;
+    assert(*shift >= 1 && "requantization multiplier too large");
+    if (*shift > 62) {
+        *mult = 0;
+        *shift = 1;
+        return;
+    }
+    *mult = (int32_t)q;
+}
+
+/* Zero points are subtracted while widening to int16, so the int16 gemm
+   accumulates (a - za) * (b - zb) directly. */
+static void qmatmul_one(const struct matmul_info *info, int b)
+{
+    int s1_off, s2_off;
+    size_t mat1, mat2, matd;
+    int16_t *a, *bw;
+    int32_t *acc;
+
+    matmul_offsets(info, b, &s1_off, &s2_off);
+    mat1 = (size_t)info->M * info->K;
+    mat2 = (size_t)info->K * info->N;
+    matd = (size_t)info->M * info->N;
+
+    a = tl_alloc(sizeof(int16_t) * mat1);
+    bw = tl_alloc(sizeof(int16_t) * mat2);
+    qwiden(a, tl_padd(info->src1->data, s1_off * mat1, 1), info->src1->dtype, 1, mat1, &info->za,
+           0, 0);
+    if (info->trans2)
+        qwiden(bw, tl_padd(info->src2->data, s2_off * mat2, 1), info->src2->dtype, info->N,
+               info->K, info->zb, 1, 0);
+    else
+        qwiden(bw, tl_padd(info->src2->data, s2_off * mat2, 1), info->src2->dtype, info->K,
+               info->N, info->zb, 0, 1);
+
+    if (info->dst->dtype == TL_INT32)
+        acc = (int32_t *)info->dst->data + b * matd;
+    else
+        acc = tl_alloc(sizeof(int32_t) * matd);
+    tl_gemm_int16(info->trans1, info->trans2, info->M, info->N, info->K, a,
+                  info->trans1 ? info->M : info->K, bw, info->trans2 ? info->K : info->N, 0, acc,
+                  info->N);
+    if (info->dst->dtype != TL_INT32) {
+        qrequantize(tl_padd(info->dst->data, b * matd, 1), info->dst->dtype, acc, info->M,
+                    info->N, info->mult, info->shift, info->zd);
+        tl_free(acc);
+    }
+    tl_free(a);
+    tl_free(bw);
+}
+
+static void matmul_worker(void *arg, int start, int end)
+{
+    const struct matmul_info *info = arg;
+
+    for (int b = start; b < end; b++)
+        info->one(info, b);
+}
+
+/* Fills the shape fields of info and the ndim and dims of dst's shape. */
+static void matmul_shape(struct matmul_info *info, const tl_tensor *src1, const tl_tensor *src2,
+                         int trans1, int trans2, tl_shape *shape)
+{
+    int i, d1, d2, ndim, nd1, nd2, s1_vol, s2_vol;
+
+    assert(src1->ndim >= 2 && src2->ndim >= 2);
+    nd1 = src1->ndim;
+    nd2 = src2->ndim;
+    info->M = trans1 ? src1->dims[nd1 - 1] : src1->dims[nd1 - 2];
+    info->K = trans1 ? src1->dims[nd1 - 2] : src1->dims[nd1 - 1];
+    info->N = trans2 ? src2->dims[nd2 - 2] : src2->dims[nd2 - 1];
+    assert(info->K == (trans2 ? src2->dims[nd2 - 1] : src2->dims[nd2 - 2]));
+
+    ndim = nd1 > nd2 ? nd1 : nd2;
+    info->batch_ndim = ndim - 2;
+    for (i = info->batch_ndim - 1, s1_vol = 1, s2_vol = 1; i >= 0; i--) {
+        d1 = i - (ndim - nd1) >= 0 ? src1->dims[i - (ndim - nd1)] : 1;
+        d2 = i - (ndim - nd2) >= 0 ? src2->dims[i - (ndim - nd2)] : 1;
+        assert((d1 == d2 || d1 == 1 || d2 == 1) && "batch dims can't be broadcasted");
+        info->batch_dims[i] = d1 > d2 ? d1 : d2;
+        info->s1_strides[i] = d1 == 1 ? 0 : s1_vol;
+        info->s2_strides[i] = d2 == 1 ? 0 : s2_vol;
+        s1_vol *= d1;
+        s2_vol *= d2;
+        shape->dims[i] = info->batch_dims[i];
+    }
+    shape->ndim = ndim;
+    shape->dims[ndim - 2] = info->M;
+    shape->dims[ndim - 1] = info->N;
+    info->src1 = src1;
+    info->src2 = src2;
+    info->trans1 = trans1;
+    info->trans2 = trans2;
+}
+
+static void matmul_run(struct matmul_info *info)
+{
+    int i, batch;
+
+    for (i = 0, batch = 1; i < info->batch_ndim; i++)
+        batch *= info->batch_dims[i];
+
+    /* with enough matrices, give each thread whole matrices; otherwise
+       the gemm itself is threaded over output tiles */
+    if (batch >= tl_get_num_threads())
+        tl_parallel_for(batch, (long long)info->M * info->N * info->K < (1 << 16) ? 16 : 1,
+                        matmul_worker, info);
+    else
+        for (i = 0; i < batch; i++)
+            info->one(info, i);
+}
+
+TL_EXPORT tl_shape *tl_tensor_matmul_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                                int trans1, int trans2, tl_shape *shape)
+{
+    struct matmul_info info;
+
+    assert(src1 && src2 && shape);
+    assert(src1->dtype == src2->dtype);
+    assert(src1->dtype == TL_FLOAT || src1->dtype == TL_DOUBLE || src1->dtype == TL_INT32);
+    matmul_shape(&info, src1, src2, trans1, trans2, shape);
+    shape->dtype = src1->dtype;
+    return shape;
+}
+
+/* dst[..., M, N] = op(src1)[..., M, K] * op(src2)[..., K, N], where op() transposes
+   the last two dims if trans1/trans2 is nonzero. The leading (batch) dims are
+   broadcasted like numpy: aligned to the right, and dims of size 1 are repeated. */
+TL_EXPORT tl_tensor *tl_tensor_matmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                                      int trans1, int trans2)
+{
+    struct matmul_info info;
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
+    assert(src1 && src1->data);
+    assert(src2 && src2->data);
+    assert(src1->dtype == src2->dtype);
+    assert(src1->dtype == TL_FLOAT || src1->dtype == TL_DOUBLE || src1->dtype == TL_INT32);
+    matmul_shape(&info, src1, src2, trans1, trans2, &shape);
+    shape.dtype = src1->dtype;
+    dst = tl_tensor_dst(dst, &shape);
+
+    info.dst = dst;
+    info.one = matmul_one;
+    matmul_run(&info);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+/* The shape of the NULL dst; a given dst may also be TL_INT8/TL_UINT8 of
+   these dims. The quantization parameters aren't part of the shape. */
+TL_EXPORT tl_shape *tl_tensor_qmatmul_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                                 int trans1, int trans2, const tl_quant *q,
+                                                 tl_shape *shape)
+{
+    struct matmul_info info;
+
+    assert(src1 && src2 && shape);
+    assert(src1->dtype == TL_INT8 || src1->dtype == TL_UINT8);
+    assert(src2->dtype == TL_INT8 || src2->dtype == TL_UINT8);
+    matmul_shape(&info, src1, src2, trans1, trans2, shape);
+    shape->dtype = q ? src1->dtype : TL_INT32;
+    return shape;
+}
+
+/* Quantized matmul of TL_INT8/TL_UINT8 tensors, accumulated in int32. src1
+   is quantized per tensor; src2 per tensor or per column of op(src2), as
+   for weights quantized per output channel. dst may be:
+   - TL_INT32, holding the accumulators sum((a - za) * (b - zb)), which are
+     in scale s1 * s2 with zero point 0, e.g. to add a quantized bias;
+   - TL_INT8/TL_UINT8, requantized with fixed-point multipliers to dst's
+     parameters (per tensor or per column).
+   A NULL dst is of src1's dtype with quantization q, or, if q is NULL too,
+   TL_INT32 with the accumulators' scales. */
+TL_EXPORT tl_tensor *tl_tensor_qmatmul(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                                       int trans1, int trans2, const tl_quant *q)
+{
+    struct matmul_info info;
+    const tl_quant *q2, *qd;
+    tl_shape shape;
+    float *scales;
+    int i, j, ndim, axis2;
+
+    TL_PROFILE_OP();
+
+    tl_check_qtensor(src1);
+    tl_check_qtensor(src2);
+    matmul_shape(&info, src1, src2, trans1, trans2, &shape);
+    shape.dtype = q ? src1->dtype : TL_INT32;
+    ndim = shape.ndim;
+    q2 = src2->quant;
+    axis2 = trans2 ? src2->ndim - 2 : src2->ndim - 1;
+    assert(src1->quant->axis < 0);
+    assert((q2->axis < 0 || q2->axis == axis2) && "src2 must be quantized per column");
+
+    if (dst) {
+        assert(dst->data);
+        assert(!q);
+        assert(dst->ndim == ndim);
+        for (i = 0; i < ndim; i++)
+            assert(dst->dims[i] == shape.dims[i]);
+        if (dst->dtype != TL_INT32)
+            tl_check_qtensor(dst);
+    } else if (q) {
+        dst = tl_tensor_zeros_shape(&shape);
+        tl_tensor_set_quant(dst, q);
+        tl_check_qtensor(dst);
+    } else {
+        dst = tl_tensor_zeros_shape(&shape);
+        scales = tl_alloc(sizeof(float) * q2->len);
+        for (j = 0; j < q2->len; j++)
+            scales[j] = src1->quant->scales[0] * q2->scales[j];
+        dst->quant = tl_quant_create(q2->axis < 0 ? -1 : ndim - 1, q2->len, scales, NULL);
+        tl_free(scales);
+    }
+    qd = dst->quant;
+    assert(dst->dtype == TL_INT32 || qd->axis < 0 || qd->axis == ndim - 1);
+
+    info.dst = dst;
+    info.one = qmatmul_one;
+    info.za = src1->quant->zero_points[0];
+    info.zb = tl_alloc(sizeof(int32_t) * info.N);
+    for (j = 0; j < info.N; j++)
+        info.zb[j] = q2->zero_points[q2->axis < 0 ? 0 : j];
+    info.mult = NULL;
+    info.shift = NULL;
+    info.zd = NULL;
+    if (dst->dtype != TL_INT32) {
+        info.mult = tl_alloc(sizeof(int32_t) * info.N);
+        info.shift = tl_alloc(sizeof(int) * info.N);
+        info.zd = tl_alloc(sizeof(int32_t) * info.N);
+        for (j = 0; j < info.N; j++) {
+            quant_multiplier((double)src1->quant->scales[0] * q2->scales[q2->axis < 0 ? 0 : j] /
+                                 qd->scales[qd->axis < 0 ? 0 : j],
+                             &info.mult[j], &info.shift[j]);
+            info.zd[j] = qd->zero_points[qd->axis < 0 ? 0 : j];
+        }
+    }
+    matmul_run(&info);
+    tl_free(info.zb);
+    tl_free(info.mult);
+    tl_free(info.shift);
+    tl_free(info.zd);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -21,32 +21,32 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+
+/* the shape of dst; arg has the same dims with TL_INT32 */
+TL_EXPORT tl_shape *tl_tensor_maxreduce_out_shape(const tl_tensor *src, int axis, tl_shape *shape)
+{
+    assert(src && shape);
+    assert(axis < src->ndim && axis >= 0);
+    tl_tensor_shape(src, shape);
+    shape->dims[axis] = 1;
+    return shape;
+}
 
 TL_EXPORT tl_tensor *tl_tensor_maxreduce(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
                                          int axis)
 {
-    /* suppose the shape of src is [N, C, H, W], dim = 1, then thread_num is N x H x W
-       reduce_vol is H x W, batch_vol is C x H x W */
-    int thread_num, reduce_vol, batch_vol;
-    int i, di, si, maxi;
-    int dim_size;
-    void *data_s, *data_d, *data_a, *nowp, *maxp;
-    size_t dsize;
-    tl_dtype dtype;
-    tl_cmp_func cmp;
+    /* suppose the shape of src is [N, C, H, W], axis = 1, then outer is N,
+       inner is H x W */
+    tl_shape shape;
+    int outer, inner;
+    int i;
+
+    TL_PROFILE_OP();
 
     assert(src && src->data);
-    assert(axis < src->ndim && axis >= 0);
-    if (dst) {
-#ifndef NDEBUG
-        assert(dst->data);
-        assert(src->dtype == dst->dtype);
-        for (i = 0; i < dst->ndim; i++)
-            assert(i == axis ? dst->dims[i] == 1 : dst->dims[i] == src->dims[i]);
-#endif
-    } else {
-        dst = tl_tensor_zeros_slice(src, axis, 1, src->dtype);
-    }
+    tl_tensor_maxreduce_out_shape(src, axis, &shape);
+    dst = tl_tensor_dst(dst, &shape);
     if (arg) {
 #ifndef NDEBUG
         assert(arg->data);
@@ -56,44 +56,16 @@ TL_EXPORT tl_tensor *tl_tensor_maxreduce(const tl_tensor *src, tl_tensor *dst, t
 #endif
     }
 
-    for (i = axis + 1, thread_num = 1; i < dst->ndim; i++)
-        thread_num *= dst->dims[i];
-    reduce_vol = thread_num;
-    batch_vol = thread_num * src->dims[axis];
-    for (i = 0; i < axis; i++)
-        thread_num *= dst->dims[i];
+    for (i = axis + 1, inner = 1; i < src->ndim; i++)
+        inner *= src->dims[i];
+    for (i = 0, outer = 1; i < axis; i++)
+        outer *= src->dims[i];
 
-    dtype = src->dtype;
-    cmp = tl_cmp_getfunc(dtype);
-    dsize = tl_size_of(dtype);
-    dim_size = src->dims[axis];
-    nowp = tl_alloc(dsize);
-    maxp = tl_alloc(dsize);
-    data_s = src->data;
-    data_d = dst->data;
-    if (arg)
-        data_a = arg->data;
-    for (di = 0; di < thread_num; di++) {
-        /* src[si] is the first element in this thread to be compared, then
-           si = batch_vol * batch + (di - reduce_vol * batch),
-           where batch = di / reduce_vol (in range [0, N-1] in [N, C, H, W]),
-           which is the same as the following code: */
-        si = (batch_vol - reduce_vol) * (di / reduce_vol) + di;
-        tl_passign(nowp, 0, data_s, si, dsize);
-        tl_passign(maxp, 0, nowp, 0, dsize);
-        for (i = 1, maxi = 0; i < dim_size; i++) {
-            tl_passign(nowp, 0, data_s, si + i * reduce_vol, dsize);
-            if (cmp(nowp, maxp) > 0) {
-                tl_passign(maxp, 0, nowp, 0, dsize);
-                maxi = i;
-            }
-        }
-        tl_passign(data_d, di, maxp, 0, dsize);
-        if (arg)
-            ((int32_t *)data_a)[di] = maxi;
-    }
-    tl_free(nowp);
-    tl_free(maxp);
+    tl_check_dtype(src->dtype);
+    tl_get_kernels()->maxreduce[src->dtype](src->data, dst->data, arg ? arg->data : NULL, outer,
+                                            src->dims[axis], inner);
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src),
+                  TL_PROFILE_TENSOR_BYTES(dst) + TL_PROFILE_TENSOR_BYTES(arg));
     return dst;
 }
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+
+#include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+
+/* Norms and cosine similarity accumulate in double, except for TL_FLOAT
+   sources, which accumulate in float unless dst is TL_DOUBLE. The 16-bit
+   float dtypes are converted to float a block at a time. Like
+   tl_tensor_dot_product, partial results are taken over fixed-size chunks
+   so the result doesn't depend on the number of threads. */
+
+#define NORM_ABS(x) ((x) < 0 ? -(x) : (x))
+
+#define NORM_KERNELS(suffix, T, ACC)                                                               \
+    static void norm_l1_##suffix(const T *a, int n, ACC *r)                                        \
+    {                                                                                              \
+        ACC s[8] = { 0 };                                                                          \
+        int i, k;                                                                                  \
+                                                                                                   \
+        for (i = 0; i + 8 <= n; i += 8)                                                            \
+            for (k = 0; k < 8; k++)                                                                \
+                s[k] += NORM_ABS((ACC)a[i + k]);                                                   \
+        for (; i < n; i++)                                                                         \
+            s[0] += NORM_ABS((ACC)a[i]);                                                           \
+        *r = ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));                    \
+    }                                                                                              \
+                                                                                                   \
+    static void norm_l2_##suffix(const T *a, int n, ACC *r)                                        \
+    {                                                                                              \
+        ACC s[8] = { 0 };                                                                          \
+        int i, k;                                                                                  \
+                                                                                                   \
+        for (i = 0; i + 8 <= n; i += 8)                                                            \
+            for (k = 0; k < 8; k++)                                                                \
+                s[k] += (ACC)a[i + k] * (ACC)a[i + k];                                             \
+        for (; i < n; i++)                                                                         \
+            s[0] += (ACC)a[i] * (ACC)a[i];                                                         \
+        *r = ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));                    \
+    }                                                                                              \
+                                                                                                   \
+    static void norm_linf_##suffix(const T *a, int n, ACC *r)                                      \
+    {                                                                                              \
+        ACC m = 0, v;                                                                              \
+        int i;                                                                                     \
+                                                                                                   \
+        for (i = 0; i < n; i++) {                                                                  \
+            v = NORM_ABS((ACC)a[i]);                                                               \
+            m = v > m ? v : m;                                                                     \
+        }                                                                                          \
+        *r = m;                                                                                    \
+    }                                                                                              \
+                                                                                                   \
+    /* r[0] = a.b, r[1] = a.a, r[2] = b.b */                                                       \
+    static void cosine_##suffix(const T *a, const T *b, int n, ACC *r)                             \
+    {                                                                                              \
+        ACC d[4] = { 0 }, sa[4] = { 0 }, sb[4] = { 0 };                                            \
+        ACC x, y;                                                                                  \
+        int i, k;                                                                                  \
+                                                                                                   \
+        for (i = 0; i + 4 <= n; i += 4) {                                                          \
+            for (k = 0; k < 4; k++) {                                                              \
+                x = a[i + k];                                                                      \
+                y = b[i + k];                                                                      \
+                d[k] += x * y;                                                                     \
+                sa[k] += x * x;                                                                    \
+                sb[k] += y * y;                                                                    \
+            }                                                                                      \
+        }                                                                                          \
+        for (; i < n; i++) {                                                                       \
+            x = a[i];                                                                              \
+            y = b[i];                                                                              \
+            d[0] += x * y;                                                                         \
+            sa[0] += x * x;                                                                        \
+            sb[0] += y * y;                                                                        \
+        }                                                                                          \
+        r[0] = (d[0] + d[2]) + (d[1] + d[3]);                                                      \
+        r[1] = (sa[0] + sa[2]) + (sa[1] + sa[3]);                                                  \
+        r[2] = (sb[0] + sb[2]) + (sb[1] + sb[3]);                                                  \
+    }
+
+NORM_KERNELS(double, double, double)
+NORM_KERNELS(float, float, float)
+NORM_KERNELS(float_wide, float, double)
+NORM_KERNELS(int64, int64_t, double)
+NORM_KERNELS(int32, int32_t, double)
+NORM_KERNELS(int16, int16_t, double)
+NORM_KERNELS(int8, int8_t, double)
+NORM_KERNELS(uint64, uint64_t, double)
+NORM_KERNELS(uint32, uint32_t, double)
+NORM_KERNELS(uint16, uint16_t, double)
+NORM_KERNELS(uint8, uint8_t, double)
+NORM_KERNELS(bool, tl_bool_t, double)
+
+struct norm_info {
+    const tl_tensor *src1, *src2; /* src2 is NULL for norms */
+    tl_norm_type ord;
+    int wide;       /* accumulate TL_FLOAT in double */
+    int nr;         /* results per chunk */
+    void *partials; /* nr float or double elements per chunk */
+};
+
+#define NORM_HALF_BLOCK 1024
+
+/* the float_wide kernels over float blocks of a 16-bit float chunk */
+static void norm_half(const struct norm_info *info, int off, int n, double *r)
+{
+    float a[NORM_HALF_BLOCK], b[NORM_HALF_BLOCK];
+    tl_dtype dtype = info->src1->dtype;
+    size_t dsize = tl_size_of(dtype);
+    double s[3] = { 0 }, t[3];
+    int i, k, m;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < NORM_HALF_BLOCK ? n - i : NORM_HALF_BLOCK;
+        tl_convert_n(a, TL_FLOAT, tl_padd(info->src1->data, off + i, dsize), dtype, m);
+        if (info->src2) {
+            tl_convert_n(b, TL_FLOAT, tl_padd(info->src2->data, off + i, dsize), dtype, m);
+            cosine_float_wide(a, b, m, t);
+        } else if (info->ord == TL_NORM_L1) {
+            norm_l1_float_wide(a, m, t);
+        } else if (info->ord == TL_NORM_L2) {
+            norm_l2_float_wide(a, m, t);
+        } else {
+            norm_linf_float_wide(a, m, t);
+        }
+        for (k = 0; k < info->nr; k++) {
+            if (!info->src2 && info->ord == TL_NORM_LINF)
+                s[k] = t[k] > s[k] ? t[k] : s[k];
+            else
+                s[k] += t[k];
+        }
+    }
+    for (k = 0; k < info->nr; k++)
+        r[k] = s[k];
+}
+
+static void norm_worker(void *arg, int start, int end)
+{
+    const struct norm_info *info = arg;
+    int len = info->src1->len;
+    int c, off, n;
+    void *r;
+
+    for (c = start; c < end; c++) {
+        off = c * TL_REDUCE_CHUNK;
+        n = len - off < TL_REDUCE_CHUNK ? len - off : TL_REDUCE_CHUNK;
+#define NORM_CALL(suffix, T, ACC)                                                                  \
+    do {                                                                                           \
+        const T *a = (const T *)info->src1->data + off;                                            \
+        r = (ACC *)info->partials + c * info->nr;                                                  \
+        if (info->src2)                                                                            \
+            cosine_##suffix(a, (const T *)info->src2->data + off, n, r);                           \
+        else if (info->ord == TL_NORM_L1)                                                          \
+            norm_l1_##suffix(a, n, r);                                                             \
+        else if (info->ord == TL_NORM_L2)                                                          \
+            norm_l2_##suffix(a, n, r);                                                             \
+        else                                                                                       \
+            norm_linf_##suffix(a, n, r);                                                           \
+    } while (0)
+        switch (info->src1->dtype) {
+        case TL_DOUBLE:
+            NORM_CALL(double, double, double);
+            break;
+        case TL_FLOAT:
+            if (info->wide)
+                NORM_CALL(float_wide, float, double);
+            else
+                NORM_CALL(float, float, float);
+            break;
+        case TL_INT64:
+            NORM_CALL(int64, int64_t, double);
+            break;
+        case TL_INT32:
+            NORM_CALL(int32, int32_t, double);
+            break;
+        case TL_INT16:
+            NORM_CALL(int16, int16_t, double);
+            break;
+        case TL_INT8:
+            NORM_CALL(int8, int8_t, double);
+            break;
+        case TL_UINT64:
+            NORM_CALL(uint64, uint64_t, double);
+            break;
+        case TL_UINT32:
+            NORM_CALL(uint32, uint32_t, double);
+            break;
+        case TL_UINT16:
+            NORM_CALL(uint16, uint16_t, double);
+            break;
+        case TL_UINT8:
+            NORM_CALL(uint8, uint8_t, double);
+            break;
+        case TL_BOOL:
+            NORM_CALL(bool, tl_bool_t, double);
+            break;
+        case TL_FLOAT16:
+        case TL_BFLOAT16:
+            norm_half(info, off, n, (double *)info->partials + c * info->nr);
+            break;
+        default:
+            assert(0 && "unsupported tl_dtype");
+            break;
+        }
+#undef NORM_CALL
+    }
+}
+
+/* reduce the partials in order, chunk by chunk, into r[0..nr) */
+#define NORM_REDUCE(ACC)                                                                           \
+    do {                                                                                           \
+        const ACC *p = info->partials;                                                             \
+        ACC s[3] = { 0 };                                                                          \
+        for (c = 0; c < nchunks; c++) {                                                            \
+            for (k = 0; k < info->nr; k++) {                                                       \
+                if (!info->src2 && info->ord == TL_NORM_LINF)                                      \
+                    s[k] = p[c * info->nr + k] > s[k] ? p[c * info->nr + k] : s[k];                \
+                else                                                                               \
+                    s[k] += p[c * info->nr + k];                                                   \
+            }                                                                                      \
+        }                                                                                          \
+        for (k = 0; k < info->nr; k++)                                                             \
+            r[k] = s[k];                                                                           \
+    } while (0)
+
+static void norm_run(struct norm_info *info, double *r)
+{
+    int nchunks, c, k;
+    size_t acc_size;
+
+    acc_size = info->src1->dtype == TL_FLOAT && !info->wide ? sizeof(float) : sizeof(double);
+    nchunks = (info->src1->len + TL_REDUCE_CHUNK - 1) / TL_REDUCE_CHUNK;
+    info->partials = tl_alloc(acc_size * info->nr * nchunks);
+    tl_parallel_for(nchunks, 1, norm_worker, info);
+    if (acc_size == sizeof(float))
+        NORM_REDUCE(float);
+    else
+        NORM_REDUCE(double);
+    tl_free(info->partials);
+}
+
+static tl_shape *scalar_shape(const tl_tensor *src, tl_shape *shape)
+{
+    shape->dtype = src->dtype == TL_FLOAT ? TL_FLOAT : TL_DOUBLE;
+    shape->ndim = 1;
+    shape->dims[0] = 1;
+    return shape;
+}
+
+static tl_tensor *alloc_scalar_dst(const tl_tensor *src, tl_tensor *dst)
+{
+    tl_shape shape;
+
+    if (dst) {
+        assert(dst->data);
+        assert(dst->ndim == 1);
+        assert(dst->dims[0] == 1);
+        return dst;
+    }
+    return tl_tensor_zeros_shape(scalar_shape(src, &shape));
+}
+
+TL_EXPORT tl_shape *tl_tensor_norm_out_shape(const tl_tensor *src, tl_norm_type ord,
+                                              tl_shape *shape)
+{
+    assert(src && shape);
+    tl_check_norm_type(ord);
+    return scalar_shape(src, shape);
+}
+
+/* A NULL dst is TL_FLOAT for TL_FLOAT src and TL_DOUBLE otherwise; a given dst
+   may be of any dtype and receives the converted (saturated) result. */
+TL_EXPORT tl_tensor *tl_tensor_norm(const tl_tensor *src, tl_tensor *dst, tl_norm_type ord)
+{
+    struct norm_info info;
+    double r;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    tl_check_norm_type(ord);
+    dst = alloc_scalar_dst(src, dst);
+
+    info.src1 = src;
+    info.src2 = NULL;
+    info.ord = ord;
+    info.wide = dst->dtype == TL_DOUBLE;
+    info.nr = 1;
+    norm_run(&info, &r);
+    if (ord == TL_NORM_L2)
+        r = sqrt(r);
+    tl_convert(dst->data, dst->dtype, &r, TL_DOUBLE);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_cosine_similarity_out_shape(const tl_tensor *src1,
+                                                           const tl_tensor *src2, tl_shape *shape)
+{
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->dtype == src2->dtype);
+    assert(shape);
+    return scalar_shape(src1, shape);
+}
+
+/* Cosine similarity of src1 and src2 as flattened vectors, computed in one
+   pass over both. It's 0 if either of them has zero norm. */
+TL_EXPORT tl_tensor *tl_tensor_cosine_similarity(const tl_tensor *src1, const tl_tensor *src2,
+                                                 tl_tensor *dst)
+{
+    struct norm_info info;
+    double r[3], sim;
+
+    TL_PROFILE_OP();
+
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->data && src2->data);
+    assert(src1->dtype == src2->dtype);
+    dst = alloc_scalar_dst(src1, dst);
+
+    info.src1 = src1;
+    info.src2 = src2;
+    info.ord = TL_NORM_L2;
+    info.wide = dst->dtype == TL_DOUBLE;
+    info.nr = 3;
+    norm_run(&info, r);
+    sim = r[1] > 0 && r[2] > 0 ? r[0] / sqrt(r[1] * r[2]) : 0;
+    tl_convert(dst->data, dst->dtype, &sim, TL_DOUBLE);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "tl_tensor_internal.h"
+
+/* pads holds a (before, after) pair for every axis. The border is filled
+   one axis at a time, from the innermost out: for axis i, every position
+   whose outer axes (< i) are in the interior gets its border slabs along i,
+   where a slab covers the whole (already padded) inner axes and is filled or
+   memcpy'ed as one block. */
+
+struct pad_info {
+    int ndim;
+    const int *dims; /* dst dims */
+    const int *pads;
+    int axis;
+    size_t slab;        /* bytes per index along axis */
+    tl_pad_mode mode;
+    const void *value; /* one element for TL_PAD_CONSTANT */
+    int value_is_zero;
+    size_t dsize;
+    uint8_t *data;
+    /* for copying the interior */
+    const uint8_t *src;
+    const int *src_dims;
+};
+
+static void fill_value(uint8_t *p, const void *value, int value_is_zero, size_t dsize,
+                       size_t bytes)
+{
+    size_t n;
+
+    if (value_is_zero) {
+        memset(p, 0, bytes);
+        return;
+    }
+    /* copy the element, then keep doubling the filled prefix */
+    memcpy(p, value, dsize);
+    for (n = dsize; n < bytes; n *= 2)
+        memcpy(p + n, p, n * 2 <= bytes ? n : bytes - n);
+}
+
+/* dst offset in elements of interior position item over axes [0, naxes),
+   counted over the interior extents, with axis naxes at index 0 */
+static size_t interior_offset(const struct pad_info *info, int item, int naxes)
+{
+    size_t off, mul;
+    int i, interior;
+
+    for (i = info->ndim - 1, mul = 1; i >= naxes; i--)
+        mul *= info->dims[i];
+    for (i = naxes - 1, off = 0; i >= 0; i--) {
+        interior = info->dims[i] - info->pads[2 * i] - info->pads[2 * i + 1];
+        off += (item % interior + info->pads[2 * i]) * mul;
+        item /= interior;
+        mul *= info->dims[i];
+    }
+    return off;
+}
+
+static void border_worker(void *arg, int start, int end)
+{
+    const struct pad_info *info = arg;
+    int before = info->pads[2 * info->axis];
+    int after = info->pads[2 * info->axis + 1];
+    int n = info->dims[info->axis] - before - after;
+    int item, p, from;
+    uint8_t *base;
+
+    for (item = start; item < end; item++) {
+        base = info->data + interior_offset(info, item, info->axis) * info->dsize;
+        for (p = 0; p < before + after; p++) {
+            int at = p < before ? p : n + p;
+            if (info->mode == TL_PAD_CONSTANT) {
+                fill_value(base + at * info->slab, info->value, info->value_is_zero,
+                           info->dsize, info->slab);
+                continue;
+            }
+            if (info->mode == TL_PAD_EDGE)
+                from = at < before ? before : before + n - 1;
+            else
+                from = at < before ? 2 * before - at : 2 * (before + n - 1) - at;
+            memcpy(base + at * info->slab, base + from * info->slab, info->slab);
+        }
+    }
+}
+
+/* one innermost src row per item */
+static void interior_worker(void *arg, int start, int end)
+{
+    const struct pad_info *info = arg;
+    int last = info->ndim - 1;
+    size_t row = info->src_dims[last] * info->dsize;
+    int item;
+
+    for (item = start; item < end; item++)
+        memcpy(info->data + (interior_offset(info, item, last) + info->pads[2 * last]) *
+                                info->dsize,
+               info->src + item * row, row);
+}
+
+/* tl_tensor_pad_border() without the profiling scope, shared by
+   tl_tensor_pad(); returns the bytes of border written */
+static size_t pad_border(tl_tensor *dst, const int *pads, tl_pad_mode mode, double value)
+{
+    struct pad_info info;
+    uint8_t elem[sizeof(double) * 2] = { 0 };
+    int i, j, interior, nitems, inner;
+    size_t slab;
+
+    assert(dst && dst->data);
+    assert(pads);
+    tl_check_pad_mode(mode);
+    for (i = 0, inner = 1; i < dst->ndim; i++) {
+        assert(pads[2 * i] >= 0 && pads[2 * i + 1] >= 0);
+        interior = dst->dims[i] - pads[2 * i] - pads[2 * i + 1];
+        assert(interior > 0);
+        if (mode == TL_PAD_REFLECT)
+            assert(pads[2 * i] < interior && pads[2 * i + 1] < interior);
+        inner *= interior;
+    }
+
+    info.ndim = dst->ndim;
+    info.dims = dst->dims;
+    info.pads = pads;
+    info.mode = mode;
+    info.dsize = tl_size_of(dst->dtype);
+    info.data = dst->data;
+    assert(info.dsize <= sizeof(elem));
+    if (mode == TL_PAD_CONSTANT)
+        tl_convert(elem, dst->dtype, &value, TL_DOUBLE);
+    info.value = elem;
+    for (i = 0, info.value_is_zero = 1; i < info.dsize; i++)
+        info.value_is_zero &= elem[i] == 0;
+
+    for (i = dst->ndim - 1, slab = info.dsize; i >= 0; slab *= dst->dims[i], i--) {
+        if (pads[2 * i] == 0 && pads[2 * i + 1] == 0)
+            continue;
+        for (j = 0, nitems = 1; j < i; j++)
+            nitems *= dst->dims[j] - pads[2 * j] - pads[2 * j + 1];
+        info.axis = i;
+        info.slab = slab;
+        tl_parallel_for(nitems, (1 << 14) / ((pads[2 * i] + pads[2 * i + 1]) * slab) + 1,
+                        border_worker, &info);
+    }
+
+    return (size_t)(dst->len - inner) * info.dsize;
+}
+
+/* Fill the border of dst in place, keeping the interior (inside pads) as the
+   data to pad. This lets e.g. a letterboxed image be resized straight into
+   the interior of its final buffer and then padded without another copy.
+   TL_PAD_REFLECT mirrors around the edge without repeating it and needs
+   pads smaller than the interior, TL_PAD_EDGE repeats the edge values and
+   TL_PAD_CONSTANT fills with value converted to dst's dtype. */
+TL_EXPORT tl_tensor *tl_tensor_pad_border(tl_tensor *dst, const int *pads, tl_pad_mode mode,
+                                          double value)
+{
+    size_t border;
+
+    TL_PROFILE_OP();
+
+    border = pad_border(dst, pads, mode, value);
+    TL_PROFILE_IO(mode == TL_PAD_CONSTANT ? 0 : border, border);
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_pad_out_shape(const tl_tensor *src, const int *pads,
+                                             tl_shape *shape)
+{
+    int i;
+
+    assert(src && pads && shape);
+    shape->dtype = src->dtype;
+    shape->ndim = src->ndim;
+    for (i = 0; i < src->ndim; i++) {
+        assert(pads[2 * i] >= 0 && pads[2 * i + 1] >= 0);
+        shape->dims[i] = src->dims[i] + pads[2 * i] + pads[2 * i + 1];
+    }
+    return shape;
+}
+
+/* Pad src by pads, a (before, after) pair for every axis. If dst is given it
+   must have the padded shape; see tl_tensor_pad_border for the modes. */
+TL_EXPORT tl_tensor *tl_tensor_pad(const tl_tensor *src, tl_tensor *dst, const int *pads,
+                                   tl_pad_mode mode, double value)
+{
+    struct pad_info info;
+    tl_shape shape;
+    size_t border;
+    int nrows;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    tl_tensor_pad_out_shape(src, pads, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    info.ndim = dst->ndim;
+    info.dims = dst->dims;
+    info.pads = pads;
+    info.dsize = tl_size_of(src->dtype);
+    info.data = dst->data;
+    info.src = src->data;
+    info.src_dims = src->dims;
+    nrows = src->len / src->dims[src->ndim - 1];
+    tl_parallel_for(nrows, (1 << 14) / (src->dims[src->ndim - 1] * info.dsize) + 1,
+                    interior_worker, &info);
+    border = pad_border(dst, pads, mode, value);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src) + (mode == TL_PAD_CONSTANT ? 0 : border),
+                  TL_PROFILE_TENSOR_BYTES(src) + border);
+    return dst;
+}
@@ -0,0 +1,547 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "tl_tensor_internal.h"
+
+/* 2D pooling is done separably: a 1D pass along each input row, then a 1D
+   pass down the columns of the row results, so every row result is shared
+   by all the vertically overlapping windows. Stride-1 max windows use the
+   van Herk/Gil-Werman algorithm, and stride-1 sums are running sums, both
+   O(1) per output regardless of kernel size.
+
+   Both layouts are handled as B images of H x W pixels with L lanes per
+   pixel: TL_NCHW is N * C images with L = 1, TL_NHWC is N images with
+   L = C. */
+
+struct pool_info {
+    int B, H, W, L;
+    int OH, OW;
+    int kh, kw, sh, sw, ph, pw;
+    int is_max;
+    int count_include_pad;
+    const float *src;
+    float *dst;
+    int32_t *arg; /* index h * W + w of the max in the input plane */
+};
+
+/* Value and index (pos * idx_mul + in_idx[pos], or -1 if pos is padding) of
+   position pos in a sequence of n vectors of width L, stored from position
+   base on. */
+static inline void max_elem(const float *in, const int32_t *in_idx, int base, int idx_mul, int n,
+                            int L, int pos, int l, float *v, int32_t *idx)
+{
+    if (pos < 0 || pos >= n) {
+        *v = -FLT_MAX;
+        if (idx)
+            *idx = -1;
+        return;
+    }
+    *v = in[(size_t)(pos - base) * L + l];
+    if (idx)
+        *idx = pos * idx_mul + (in_idx ? in_idx[(size_t)(pos - base) * L + l] : 0);
+}
+
+/* 1D max over windows [o * s - p, o * s - p + k) for outputs o in [o0, o1),
+   writing out[(o - o0) * L + l]. Ties go to the smallest position.
+   work holds 2 * (o1 - o0 + k - 1) * L floats and as many int32s. */
+static void max1d(const float *in, const int32_t *in_idx, int base, int idx_mul, int n, int L,
+                  int k, int s, int p, int o0, int o1, float *out, int32_t *out_idx,
+                  float *work, int32_t *work_idx)
+{
+    int o, e, E, e0, l, pos, end;
+    float v, best;
+    int32_t vi, besti;
+    int32_t *pvi = out_idx ? &vi : NULL;
+    float *g, *h;
+    int32_t *gi, *hi;
+
+    if (s != 1 || k < 3) {
+        for (o = o0; o < o1; o++) {
+            for (l = 0; l < L; l++) {
+                besti = -1;
+                best = -FLT_MAX;
+                for (pos = o * s - p, end = pos + k; pos < end; pos++) {
+                    max_elem(in, in_idx, base, idx_mul, n, L, pos, l, &v, pvi);
+                    if (v > best || besti < 0) {
+                        best = v;
+                        besti = out_idx ? vi : 0;
+                    }
+                }
+                out[(size_t)(o - o0) * L + l] = best;
+                if (out_idx)
+                    out_idx[(size_t)(o - o0) * L + l] = besti;
+            }
+        }
+        return;
+    }
+
+    /* van Herk/Gil-Werman over extended positions o0 - p + e, in blocks of k:
+       g is the running max from the start of each block, h from its end */
+    E = o1 - o0 + k - 1;
+    e0 = o0 - p;
+    g = work;
+    h = work + (size_t)E * L;
+    gi = work_idx;
+    hi = work_idx + (size_t)E * L;
+    for (e = 0; e < E; e++) {
+        for (l = 0; l < L; l++) {
+            max_elem(in, in_idx, base, idx_mul, n, L, e0 + e, l, &v, pvi);
+            if (e % k == 0 || v > g[(size_t)(e - 1) * L + l]) {
+                g[(size_t)e * L + l] = v;
+                if (out_idx)
+                    gi[(size_t)e * L + l] = vi;
+            } else {
+                g[(size_t)e * L + l] = g[(size_t)(e - 1) * L + l];
+                if (out_idx)
+                    gi[(size_t)e * L + l] = gi[(size_t)(e - 1) * L + l];
+            }
+        }
+    }
+    for (e = E - 1; e >= 0; e--) {
+        for (l = 0; l < L; l++) {
+            max_elem(in, in_idx, base, idx_mul, n, L, e0 + e, l, &v, pvi);
+            if (e % k == k - 1 || e == E - 1 || v >= h[(size_t)(e + 1) * L + l]) {
+                h[(size_t)e * L + l] = v;
+                if (out_idx)
+                    hi[(size_t)e * L + l] = vi;
+            } else {
+                h[(size_t)e * L + l] = h[(size_t)(e + 1) * L + l];
+                if (out_idx)
+                    hi[(size_t)e * L + l] = hi[(size_t)(e + 1) * L + l];
+            }
+        }
+    }
+    for (o = o0; o < o1; o++) {
+        e = o - o0;
+        for (l = 0; l < L; l++) {
+            size_t a = (size_t)e * L + l, b = (size_t)(e + k - 1) * L + l;
+            int take_g = g[b] > h[a] || (out_idx && hi[a] < 0);
+            out[a] = take_g ? g[b] : h[a];
+            if (out_idx)
+                out_idx[a] = take_g ? gi[b] : hi[a];
+        }
+    }
+}
+
+/* 1D window sums, clipped to [0, n), same conventions as max1d;
+   acc holds L doubles */
+static void sum1d(const float *in, int base, int n, int L, int k, int s, int p, int o0, int o1,
+                  float *out, double *acc)
+{
+    int o, l, pos, lo, hi, plo, phi;
+
+    for (o = o0; o < o1; o++) {
+        lo = o * s - p < 0 ? 0 : o * s - p;
+        hi = o * s - p + k > n ? n : o * s - p + k;
+        if (s == 1 && o > o0) {
+            /* slide the previous window [plo, phi) to [lo, hi) */
+            plo = o - 1 - p < 0 ? 0 : o - 1 - p;
+            phi = o - 1 - p + k > n ? n : o - 1 - p + k;
+            for (pos = plo; pos < lo; pos++)
+                for (l = 0; l < L; l++)
+                    acc[l] -= in[(size_t)(pos - base) * L + l];
+            for (pos = phi; pos < hi; pos++)
+                for (l = 0; l < L; l++)
+                    acc[l] += in[(size_t)(pos - base) * L + l];
+        } else {
+            for (l = 0; l < L; l++)
+                acc[l] = 0;
+            for (pos = lo; pos < hi; pos++)
+                for (l = 0; l < L; l++)
+                    acc[l] += in[(size_t)(pos - base) * L + l];
+        }
+        for (l = 0; l < L; l++)
+            out[(size_t)(o - o0) * L + l] = acc[l];
+    }
+}
+
+/* number of elements averaged over by window o */
+static inline int avg_count(int o, int k, int s, int p, int n, int include_pad)
+{
+    int lo = o * s - p, hi = o * s - p + k;
+
+    if (include_pad) {
+        hi = hi > n + p ? n + p : hi;
+    } else {
+        lo = lo < 0 ? 0 : lo;
+        hi = hi > n ? n : hi;
+    }
+    return hi - lo;
+}
+
+/* items are output rows, [b * OH + oh] */
+static void pool_worker(void *arg, int start, int end)
+{
+    const struct pool_info *info = arg;
+    int H = info->H, W = info->W, L = info->L, OH = info->OH, OW = info->OW;
+    int rowlen = OW * L;
+    int kmax = info->kh > info->kw ? info->kh : info->kw;
+    int seqmax = (OH > OW ? OH : OW) + kmax;
+    int b, oh0, oh1, ih0, ih1, ih, oh, ow, l, item, cnt_h;
+    size_t worklen;
+    float *hbuf, *work, *out;
+    int32_t *hidx = NULL, *work_idx = NULL, *out_idx;
+    double *acc = NULL;
+
+    worklen = 2 * (size_t)seqmax * (rowlen > L ? rowlen : L);
+    hbuf = tl_alloc(sizeof(float) * H * rowlen);
+    work = tl_alloc(sizeof(float) * worklen);
+    if (info->arg) {
+        hidx = tl_alloc(sizeof(int32_t) * H * rowlen);
+        work_idx = tl_alloc(sizeof(int32_t) * worklen);
+    }
+    if (!info->is_max)
+        acc = tl_alloc(sizeof(double) * rowlen);
+
+    for (item = start; item < end; item = b * OH + oh1) {
+        b = item / OH;
+        oh0 = item % OH;
+        oh1 = end - b * OH < OH ? end - b * OH : OH;
+        ih0 = oh0 * info->sh - info->ph;
+        ih0 = ih0 < 0 ? 0 : ih0;
+        ih1 = (oh1 - 1) * info->sh - info->ph + info->kh;
+        ih1 = ih1 > H ? H : ih1;
+
+        const float *img = info->src + (size_t)b * H * W * L;
+        out = info->dst + ((size_t)b * OH + oh0) * rowlen;
+        out_idx = info->arg ? info->arg + ((size_t)b * OH + oh0) * rowlen : NULL;
+
+        for (ih = ih0; ih < ih1; ih++) {
+            const float *row = img + (size_t)ih * W * L;
+            float *hrow = hbuf + (size_t)(ih - ih0) * rowlen;
+            if (info->is_max)
+                max1d(row, NULL, 0, 1, W, L, info->kw, info->sw, info->pw, 0, OW, hrow,
+                      hidx ? hidx + (size_t)(ih - ih0) * rowlen : NULL, work, work_idx);
+            else
+                sum1d(row, 0, W, L, info->kw, info->sw, info->pw, 0, OW, hrow, acc);
+        }
+
+        if (info->is_max) {
+            max1d(hbuf, hidx, ih0, W, H, rowlen, info->kh, info->sh, info->ph, oh0, oh1, out,
+                  out_idx, work, work_idx);
+            continue;
+        }
+        sum1d(hbuf, ih0, H, rowlen, info->kh, info->sh, info->ph, oh0, oh1, out, acc);
+        for (oh = oh0; oh < oh1; oh++) {
+            cnt_h = avg_count(oh, info->kh, info->sh, info->ph, H, info->count_include_pad);
+            for (ow = 0; ow < OW; ow++) {
+                float scale = 1.0f / (cnt_h * avg_count(ow, info->kw, info->sw, info->pw, W,
+                                                        info->count_include_pad));
+                float *o = out + (size_t)(oh - oh0) * rowlen + (size_t)ow * L;
+                for (l = 0; l < L; l++)
+                    o[l] *= scale;
+            }
+        }
+    }
+
+    tl_free(hbuf);
+    tl_free(work);
+    tl_free(hidx);
+    tl_free(work_idx);
+    tl_free(acc);
+}
+
+static int pool_out_size(int n, int k, int s, int p, int ceil_mode)
+{
+    int out = (n + 2 * p - k + (ceil_mode ? s - 1 : 0)) / s + 1;
+
+    /* the last window must start inside the input or the left padding */
+    if (ceil_mode && (out - 1) * s >= n + p)
+        out--;
+    return out;
+}
+
+/* Fill info's geometry from the arguments and shape with dst's shape. */
+static tl_shape *pool_init(struct pool_info *info, const tl_tensor *src, const int *kernel,
+                           const int *stride, const int *padding, int ceil_mode,
+                           tl_layout layout, tl_shape *shape)
+{
+    int N, C;
+
+    assert(src);
+    assert(src->dtype == TL_FLOAT);
+    assert(src->ndim == 4);
+    assert(kernel && kernel[0] > 0 && kernel[1] > 0);
+    tl_check_layout(layout);
+
+    info->kh = kernel[0];
+    info->kw = kernel[1];
+    info->sh = stride ? stride[0] : info->kh;
+    info->sw = stride ? stride[1] : info->kw;
+    info->ph = padding ? padding[0] : 0;
+    info->pw = padding ? padding[1] : 0;
+    assert(info->sh > 0 && info->sw > 0);
+    assert(info->ph >= 0 && info->ph <= info->kh / 2);
+    assert(info->pw >= 0 && info->pw <= info->kw / 2);
+
+    N = src->dims[0];
+    if (layout == TL_NCHW) {
+        C = src->dims[1];
+        info->H = src->dims[2];
+        info->W = src->dims[3];
+        info->B = N * C;
+        info->L = 1;
+    } else {
+        info->H = src->dims[1];
+        info->W = src->dims[2];
+        C = src->dims[3];
+        info->B = N;
+        info->L = C;
+    }
+    info->OH = pool_out_size(info->H, info->kh, info->sh, info->ph, ceil_mode);
+    info->OW = pool_out_size(info->W, info->kw, info->sw, info->pw, ceil_mode);
+    assert(info->OH > 0 && info->OW > 0);
+
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 4;
+    shape->dims[0] = N;
+    shape->dims[1] = layout == TL_NCHW ? C : info->OH;
+    shape->dims[2] = layout == TL_NCHW ? info->OH : info->OW;
+    shape->dims[3] = layout == TL_NCHW ? info->OW : C;
+    return shape;
+}
+
+static tl_tensor *pool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg, const int *kernel,
+                         const int *stride, const int *padding, int ceil_mode,
+                         int count_include_pad, tl_layout layout, int is_max)
+{
+    struct pool_info info;
+    tl_shape shape;
+
+    assert(src && src->data);
+    pool_init(&info, src, kernel, stride, padding, ceil_mode, layout, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+    if (arg) {
+        assert(arg->data);
+        assert(arg->dtype == TL_INT32);
+        assert(tl_tensor_issameshape(arg, dst));
+    }
+
+    info.is_max = is_max;
+    info.count_include_pad = count_include_pad;
+    info.src = src->data;
+    info.dst = dst->data;
+    info.arg = arg ? arg->data : NULL;
+    tl_parallel_for(info.B * info.OH, 1, pool_worker, &info);
+
+    return dst;
+}
+
+/* the shape of dst; arg has the same dims with TL_INT32 */
+TL_EXPORT tl_shape *tl_tensor_maxpool2d_out_shape(const tl_tensor *src, const int *kernel,
+                                                  const int *stride, const int *padding,
+                                                  int ceil_mode, tl_layout layout,
+                                                  tl_shape *shape)
+{
+    struct pool_info info;
+
+    assert(shape);
+    return pool_init(&info, src, kernel, stride, padding, ceil_mode, layout, shape);
+}
+
+/* kernel, stride and padding are {h, w} pairs; a NULL stride means the
+   kernel size, NULL padding means 0. Padding is at most half the kernel size.
+   If ceil_mode is nonzero, output sizes are rounded up instead of down.
+   If arg is not NULL, it receives (TL_INT32) the index h * W + w of the max
+   in its input plane. Only TL_FLOAT is supported. */
+TL_EXPORT tl_tensor *tl_tensor_maxpool2d(const tl_tensor *src, tl_tensor *dst, tl_tensor *arg,
+                                         const int *kernel, const int *stride,
+                                         const int *padding, int ceil_mode, tl_layout layout)
+{
+    TL_PROFILE_OP();
+
+    dst = pool2d(src, dst, arg, kernel, stride, padding, ceil_mode, 0, layout, 1);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src),
+                  TL_PROFILE_TENSOR_BYTES(dst) + TL_PROFILE_TENSOR_BYTES(arg));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_avgpool2d_out_shape(const tl_tensor *src, const int *kernel,
+                                                  const int *stride, const int *padding,
+                                                  int ceil_mode, tl_layout layout,
+                                                  tl_shape *shape)
+{
+    struct pool_info info;
+
+    assert(shape);
+    return pool_init(&info, src, kernel, stride, padding, ceil_mode, layout, shape);
+}
+
+/* Same parameters as tl_tensor_maxpool2d. If count_include_pad is nonzero,
+   padding elements count in the divisor. */
+TL_EXPORT tl_tensor *tl_tensor_avgpool2d(const tl_tensor *src, tl_tensor *dst, const int *kernel,
+                                         const int *stride, const int *padding, int ceil_mode,
+                                         int count_include_pad, tl_layout layout)
+{
+    TL_PROFILE_OP();
+
+    dst = pool2d(src, dst, NULL, kernel, stride, padding, ceil_mode, count_include_pad, layout, 0);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+#define GLOBAL_POOL_CBLOCK 64
+
+struct global_pool_info {
+    int N, C, HW;
+    tl_layout layout;
+    int is_max;
+    const float *src;
+    float *dst;
+};
+
+/* TL_NCHW items are planes, TL_NHWC items are blocks of channels of an image */
+static void global_pool_worker(void *arg, int start, int end)
+{
+    const struct global_pool_info *info = arg;
+    int nblocks = (info->C + GLOBAL_POOL_CBLOCK - 1) / GLOBAL_POOL_CBLOCK;
+    int item, i, c, c0, c1, n;
+    const float *p;
+    float m[GLOBAL_POOL_CBLOCK];
+    double s[GLOBAL_POOL_CBLOCK];
+
+    for (item = start; item < end; item++) {
+        if (info->layout == TL_NCHW) {
+            p = info->src + (size_t)item * info->HW;
+            if (info->is_max) {
+                for (i = 1, m[0] = p[0]; i < info->HW; i++)
+                    m[0] = p[i] > m[0] ? p[i] : m[0];
+                info->dst[item] = m[0];
+            } else {
+                for (i = 0, s[0] = 0; i < info->HW; i++)
+                    s[0] += p[i];
+                info->dst[item] = s[0] / info->HW;
+            }
+            continue;
+        }
+
+        n = item / nblocks;
+        c0 = item % nblocks * GLOBAL_POOL_CBLOCK;
+        c1 = c0 + GLOBAL_POOL_CBLOCK < info->C ? c0 + GLOBAL_POOL_CBLOCK : info->C;
+        p = info->src + (size_t)n * info->HW * info->C;
+        for (c = c0; c < c1; c++) {
+            m[c - c0] = p[c];
+            s[c - c0] = 0;
+        }
+        for (i = 0; i < info->HW; i++, p += info->C) {
+            if (info->is_max) {
+                for (c = c0; c < c1; c++)
+                    m[c - c0] = p[c] > m[c - c0] ? p[c] : m[c - c0];
+            } else {
+                for (c = c0; c < c1; c++)
+                    s[c - c0] += p[c];
+            }
+        }
+        for (c = c0; c < c1; c++)
+            info->dst[(size_t)n * info->C + c] =
+                info->is_max ? m[c - c0] : s[c - c0] / info->HW;
+    }
+}
+
+static tl_shape *global_pool_init(struct global_pool_info *info, const tl_tensor *src,
+                                  tl_layout layout, tl_shape *shape)
+{
+    assert(src);
+    assert(src->dtype == TL_FLOAT);
+    assert(src->ndim == 4);
+    tl_check_layout(layout);
+
+    info->N = src->dims[0];
+    info->C = layout == TL_NCHW ? src->dims[1] : src->dims[3];
+    info->HW = layout == TL_NCHW ? src->dims[2] * src->dims[3] : src->dims[1] * src->dims[2];
+    assert(info->HW > 0);
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 4;
+    shape->dims[0] = info->N;
+    shape->dims[1] = layout == TL_NCHW ? info->C : 1;
+    shape->dims[2] = 1;
+    shape->dims[3] = layout == TL_NCHW ? 1 : info->C;
+    return shape;
+}
+
+static tl_tensor *global_pool(const tl_tensor *src, tl_tensor *dst, tl_layout layout, int is_max)
+{
+    struct global_pool_info info;
+    tl_shape shape;
+    int nitems;
+
+    assert(src && src->data);
+    global_pool_init(&info, src, layout, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    info.layout = layout;
+    info.is_max = is_max;
+    info.src = src->data;
+    info.dst = dst->data;
+    if (layout == TL_NCHW)
+        nitems = info.N * info.C;
+    else
+        nitems = info.N * ((info.C + GLOBAL_POOL_CBLOCK - 1) / GLOBAL_POOL_CBLOCK);
+    tl_parallel_for(nitems, 1, global_pool_worker, &info);
+
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_global_maxpool_out_shape(const tl_tensor *src, tl_layout layout,
+                                                       tl_shape *shape)
+{
+    struct global_pool_info info;
+
+    assert(shape);
+    return global_pool_init(&info, src, layout, shape);
+}
+
+/* Max over the whole H x W plane of each channel; dst is [N, C, 1, 1] for
+   TL_NCHW and [N, 1, 1, C] for TL_NHWC. Only TL_FLOAT is supported. */
+TL_EXPORT tl_tensor *tl_tensor_global_maxpool(const tl_tensor *src, tl_tensor *dst,
+                                              tl_layout layout)
+{
+    TL_PROFILE_OP();
+
+    dst = global_pool(src, dst, layout, 1);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_global_avgpool_out_shape(const tl_tensor *src, tl_layout layout,
+                                                       tl_shape *shape)
+{
+    struct global_pool_info info;
+
+    assert(shape);
+    return global_pool_init(&info, src, layout, shape);
+}
+
+/* Average over the whole H x W plane of each channel, see
+   tl_tensor_global_maxpool. */
+TL_EXPORT tl_tensor *tl_tensor_global_avgpool(const tl_tensor *src, tl_tensor *dst,
+                                              tl_layout layout)
+{
+    TL_PROFILE_OP();
+
+    dst = global_pool(src, dst, layout, 0);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
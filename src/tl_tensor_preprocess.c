@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+
+/* Per-call lookup tables shared by all threads and all the images of a
+   batch. Source offsets are in elements of an HWC row/plane, so the inner
+   loops only do loads and FMAs. */
+struct preprocess_info {
+    const tl_tensor **srcs;
+    int n;
+    tl_tensor *dst;
+    tl_resize_type rtype;
+    int H, W, C, OH, OW;
+    int reverse;
+    float *alpha; /* per output channel, scale / std */
+    float *beta;  /* per output channel, -mean / std */
+    int *y0, *y1; /* source row of each output row */
+    int *x0, *x1; /* source column offset (x * C) of each output column */
+    float *wy, *wx;
+};
+
+static void nearest_table(int *idx, int src_len, int dst_len, int mul)
+{
+    float scale, rounded;
+    int i, s;
+
+    scale = (float)src_len / (float)dst_len;
+    for (i = 0; i < dst_len; i++) {
+        /* same rounding as nearest_resize() in tl_tensor_resize.c */
+        rounded = roundf(((float)i + 0.5) * scale - 0.5);
+        s = (int)rounded;
+        s = s < 0 ? 0 : s >= src_len ? src_len - 1 : s;
+        idx[i] = s * mul;
+    }
+}
+
+static void linear_table(int *idx0, int *idx1, float *w, int src_len, int dst_len, int mul)
+{
+    float scale, pos;
+    int i, s;
+
+    scale = (float)src_len / (float)dst_len;
+    for (i = 0; i < dst_len; i++) {
+        pos = ((float)i + 0.5f) * scale - 0.5f;
+        if (pos < 0)
+            pos = 0;
+        s = (int)pos;
+        if (s >= src_len - 1) {
+            s = src_len - 1;
+            pos = (float)s;
+        }
+        idx0[i] = s * mul;
+        idx1[i] = (s + 1 < src_len ? s + 1 : s) * mul;
+        w[i] = pos - (float)s;
+    }
+}
+
+#define PREPROCESS_ROWS(type)                                                                      \
+    static void preprocess_rows_##type(const struct preprocess_info *info, int img, int start,   \
+                                       int end)                                                   \
+    {                                                                                              \
+        const type *s = (const type *)info->srcs[img]->data;                                       \
+        int W = info->W, C = info->C, OW = info->OW;                                               \
+        size_t plane = (size_t)info->OH * OW;                                                      \
+        float *d = (float *)info->dst->data + plane * C * img;                                     \
+        int oy, ox, c, sc;                                                                         \
+                                                                                                   \
+        for (oy = start; oy < end; oy++) {                                                         \
+            const type *r0 = s + (size_t)info->y0[oy] * W * C;                                     \
+            if (info->rtype == TL_NEAREST) {                                                       \
+                for (c = 0; c < C; c++) {                                                          \
+                    const type *rc;                                                                \
+                    float *dp = d + c * plane + (size_t)oy * OW;                                   \
+                    float a = info->alpha[c], b = info->beta[c];                                   \
+                    sc = info->reverse ? C - 1 - c : c;                                            \
+                    rc = r0 + sc;                                                                  \
+                    for (ox = 0; ox < OW; ox++)                                                    \
+                        dp[ox] = (float)rc[info->x0[ox]] * a + b;                                  \
+                }                                                                                  \
+            } else {                                                                               \
+                const type *r1 = s + (size_t)info->y1[oy] * W * C;                                 \
+                float wy = info->wy[oy];                                                           \
+                for (c = 0; c < C; c++) {                                                          \
+                    const type *rc0, *rc1;                                                         \
+                    float *dp = d + c * plane + (size_t)oy * OW;                                   \
+                    float a = info->alpha[c], b = info->beta[c];                                   \
+                    sc = info->reverse ? C - 1 - c : c;                                            \
+                    rc0 = r0 + sc;                                                                 \
+                    rc1 = r1 + sc;                                                                 \
+                    for (ox = 0; ox < OW; ox++) {                                                  \
+                        float wx = info->wx[ox];                                                   \
+                        float top = (float)rc0[info->x0[ox]] +                                     \
+                                    wx * ((float)rc0[info->x1[ox]] - (float)rc0[info->x0[ox]]);    \
+                        float bot = (float)rc1[info->x0[ox]] +                                     \
+                                    wx * ((float)rc1[info->x1[ox]] - (float)rc1[info->x0[ox]]);    \
+                        dp[ox] = (top + wy * (bot - top)) * a + b;                                 \
+                    }                                                                              \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }
+
+PREPROCESS_ROWS(uint8_t)
+PREPROCESS_ROWS(float)
+
+/* without resize, walk each HWC row once and scatter to the C planes */
+#define PREPROCESS_ROWS_NORESIZE(type)                                                             \
+    static void preprocess_rows_noresize_##type(const struct preprocess_info *info, int img,     \
+                                                int start, int end)                               \
+    {                                                                                              \
+        const type *s = (const type *)info->srcs[img]->data;                                       \
+        int W = info->W, C = info->C;                                                              \
+        size_t plane = (size_t)info->H * W;                                                        \
+        float *d = (float *)info->dst->data + plane * C * img;                                     \
+        int y, x, c;                                                                               \
+                                                                                                   \
+        if (C == 3) {                                                                              \
+            int r = info->reverse ? 2 : 0, b = info->reverse ? 0 : 2;                              \
+            float a0 = info->alpha[0], a1 = info->alpha[1], a2 = info->alpha[2];                   \
+            float b0 = info->beta[0], b1 = info->beta[1], b2 = info->beta[2];                      \
+            for (y = start; y < end; y++) {                                                        \
+                const type *sp = s + (size_t)y * W * 3;                                            \
+                float *d0 = d + (size_t)y * W;                                                     \
+                float *d1 = d0 + plane;                                                            \
+                float *d2 = d1 + plane;                                                            \
+                for (x = 0; x < W; x++) {                                                          \
+                    d0[x] = (float)sp[x * 3 + r] * a0 + b0;                                        \
+                    d1[x] = (float)sp[x * 3 + 1] * a1 + b1;                                        \
+                    d2[x] = (float)sp[x * 3 + b] * a2 + b2;                                        \
+                }                                                                                  \
+            }                                                                                      \
+            return;                                                                                \
+        }                                                                                          \
+        for (y = start; y < end; y++) {                                                            \
+            const type *sp = s + (size_t)y * W * C;                                                \
+            for (c = 0; c < C; c++) {                                                              \
+                int sc = info->reverse ? C - 1 - c : c;                                            \
+                float *dp = d + c * plane + (size_t)y * W;                                         \
+                float a = info->alpha[c], b = info->beta[c];                                       \
+                for (x = 0; x < W; x++)                                                            \
+                    dp[x] = (float)sp[x * C + sc] * a + b;                                         \
+            }                                                                                      \
+        }                                                                                          \
+    }
+
+PREPROCESS_ROWS_NORESIZE(uint8_t)
+PREPROCESS_ROWS_NORESIZE(float)
+
+/* rows are counted across the batch, start and end may span images */
+static void preprocess_worker(void *arg, int start, int end)
+{
+    const struct preprocess_info *info = arg;
+    int resized = info->H != info->OH || info->W != info->OW;
+    int img, rs, re;
+
+    for (img = start / info->OH; img < info->n && img * info->OH < end; img++) {
+        rs = start > img * info->OH ? start - img * info->OH : 0;
+        re = end < (img + 1) * info->OH ? end - img * info->OH : info->OH;
+        if (info->srcs[img]->dtype == TL_UINT8) {
+            if (resized)
+                preprocess_rows_uint8_t(info, img, rs, re);
+            else
+                preprocess_rows_noresize_uint8_t(info, img, rs, re);
+        } else {
+            if (resized)
+                preprocess_rows_float(info, img, rs, re);
+            else
+                preprocess_rows_noresize_float(info, img, rs, re);
+        }
+    }
+}
+
+/* Builds the tables for src's shape and runs all the images of info. */
+static void preprocess_run(struct preprocess_info *info, const tl_tensor *src,
+                           const int *new_hw, tl_resize_type rtype, const double *mean,
+                           const double *std, double scale, int reverse)
+{
+    int c, rows_grain;
+
+    info->H = src->dims[0];
+    info->W = src->dims[1];
+    info->C = src->dims[2];
+    info->OH = new_hw ? new_hw[0] : info->H;
+    info->OW = new_hw ? new_hw[1] : info->W;
+    info->rtype = rtype;
+    info->reverse = reverse;
+    info->alpha = tl_alloc(sizeof(float) * info->C * 2);
+    info->beta = info->alpha + info->C;
+    for (c = 0; c < info->C; c++) {
+        double s = std ? std[c] : 1.0;
+        assert(s != 0);
+        info->alpha[c] = (float)(scale / s);
+        info->beta[c] = (float)(-(mean ? mean[c] : 0.0) / s);
+    }
+    info->y0 = tl_alloc(sizeof(int) * (info->OH + info->OW) * 2);
+    info->y1 = info->y0 + info->OH;
+    info->x0 = info->y1 + info->OH;
+    info->x1 = info->x0 + info->OW;
+    info->wy = tl_alloc(sizeof(float) * (info->OH + info->OW));
+    info->wx = info->wy + info->OH;
+    if (rtype == TL_NEAREST) {
+        nearest_table(info->y0, info->H, info->OH, 1);
+        nearest_table(info->x0, info->W, info->OW, info->C);
+    } else {
+        linear_table(info->y0, info->y1, info->wy, info->H, info->OH, 1);
+        linear_table(info->x0, info->x1, info->wx, info->W, info->OW, info->C);
+    }
+
+    rows_grain = 16384 / (info->OW * info->C) + 1;
+    tl_parallel_for(info->OH * info->n, rows_grain, preprocess_worker, info);
+
+    tl_free(info->alpha);
+    tl_free(info->y0);
+    tl_free(info->wy);
+}
+
+/* Preprocess the n images of srcs into dst, with all arguments checked.
+   Unprofiled, for the ops of this file and tl_tensor_submean(). */
+void tl_preprocess_images(const tl_tensor **srcs, int n, tl_tensor *dst, const int *new_hw,
+                          tl_resize_type rtype, const double *mean, const double *std,
+                          double scale, int reverse)
+{
+    struct preprocess_info info;
+
+    info.srcs = srcs;
+    info.n = n;
+    info.dst = dst;
+    preprocess_run(&info, srcs[0], new_hw, rtype, mean, std, scale, reverse);
+}
+
+TL_EXPORT tl_shape *tl_tensor_preprocess_out_shape(const tl_tensor *src, const int *new_hw,
+                                                   tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->ndim == 3);
+    assert(src->dtype == TL_UINT8 || src->dtype == TL_FLOAT);
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 3;
+    shape->dims[0] = src->dims[2];
+    shape->dims[1] = new_hw ? new_hw[0] : src->dims[0];
+    shape->dims[2] = new_hw ? new_hw[1] : src->dims[1];
+    assert(shape->dims[1] > 0 && shape->dims[2] > 0);
+    return shape;
+}
+
+/* src: H*W*C (TL_UINT8 or TL_FLOAT), dst: C*OH*OW (TL_FLOAT)
+   dst[c][y][x] = (src[y'][x'][c'] * scale - mean[c]) / std[c],
+   where (y', x') is sampled from (y, x) by rtype if new_hw differs from (H, W),
+   and c' is c, or C - 1 - c if reverse is nonzero (BGR <-> RGB).
+   mean and std are in dst channel order; NULL means all 0 and all 1. */
+TL_EXPORT tl_tensor *tl_tensor_preprocess(const tl_tensor *src, tl_tensor *dst, const int *new_hw,
+                                          tl_resize_type rtype, const double *mean,
+                                          const double *std, double scale, int reverse)
+{
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    tl_check_resize_type(rtype);
+    tl_tensor_preprocess_out_shape(src, new_hw, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+    tl_preprocess_images(&src, 1, dst, new_hw, rtype, mean, std, scale, reverse);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_preprocess_batch_out_shape(const tl_tensor **srcs, int n,
+                                                         const int *new_hw, tl_shape *shape)
+{
+    int i;
+
+    assert(srcs && n > 0 && shape);
+    for (i = 1; i < n; i++) {
+        assert(srcs[i]);
+        assert(srcs[i]->dtype == srcs[0]->dtype);
+        assert(tl_tensor_issameshape(srcs[i], srcs[0]));
+    }
+    tl_tensor_preprocess_out_shape(srcs[0], new_hw, shape);
+    shape->ndim = 4;
+    memmove(shape->dims + 1, shape->dims, sizeof(int) * 3);
+    shape->dims[0] = n;
+    return shape;
+}
+
+/* tl_tensor_preprocess() of n images of the same shape and dtype at once,
+   into dst: N*C*OH*OW. The lookup tables are built once for the batch, and
+   the rows of all the images are spread over the threads together. */
+TL_EXPORT tl_tensor *tl_tensor_preprocess_batch(const tl_tensor **srcs, int n, tl_tensor *dst,
+                                                const int *new_hw, tl_resize_type rtype,
+                                                const double *mean, const double *std,
+                                                double scale, int reverse)
+{
+    uint64_t read_bytes = 0;
+    tl_shape shape;
+    int i;
+
+    TL_PROFILE_OP();
+
+    assert(srcs && n > 0);
+    for (i = 0; i < n; i++) {
+        assert(srcs[i] && srcs[i]->data);
+        read_bytes += TL_PROFILE_TENSOR_BYTES(srcs[i]);
+    }
+    tl_check_resize_type(rtype);
+    tl_tensor_preprocess_batch_out_shape(srcs, n, new_hw, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    tl_preprocess_images(srcs, n, dst, new_hw, rtype, mean, std, scale, reverse);
+
+    TL_PROFILE_IO(read_bytes, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+
+/* zero_points may be NULL for all zeros (symmetric quantization) */
+TL_EXPORT tl_quant *tl_quant_create(int axis, int len, const float *scales,
+                                    const int32_t *zero_points)
+{
+    tl_quant *q;
+    int i;
+
+    assert(axis >= -1 && axis < TL_MAXDIM);
+    assert(axis >= 0 || len == 1);
+    assert(len > 0);
+    assert(scales);
+    for (i = 0; i < len; i++)
+        assert(scales[i] > 0);
+
+    q = tl_alloc(sizeof(tl_quant));
+    q->axis = axis;
+    q->len = len;
+    q->scales = tl_clone(scales, sizeof(float) * len);
+    q->zero_points = tl_alloc(sizeof(int32_t) * len);
+    if (zero_points)
+        memmove(q->zero_points, zero_points, sizeof(int32_t) * len);
+    else
+        memset(q->zero_points, 0, sizeof(int32_t) * len);
+    return q;
+}
+
+TL_EXPORT tl_quant *tl_quant_clone(const tl_quant *q)
+{
+    if (!q)
+        return NULL;
+    return tl_quant_create(q->axis, q->len, q->scales, q->zero_points);
+}
+
+TL_EXPORT void tl_quant_free(tl_quant *q)
+{
+    if (!q)
+        return;
+    tl_free(q->scales);
+    tl_free(q->zero_points);
+    tl_free(q);
+}
+
+/* t gets a copy of q, or loses its quantization if q is NULL */
+TL_EXPORT void tl_tensor_set_quant(tl_tensor *t, const tl_quant *q)
+{
+    tl_quant *old;
+
+    assert(t);
+    assert(!q || q->axis < t->ndim);
+    assert(!q || q->axis < 0 || q->len == t->dims[q->axis]);
+    old = t->quant;
+    t->quant = tl_quant_clone(q);
+    tl_quant_free(old);
+}
+
+/* a dst of shape; q is its quantization if it's created here, a given dst
+   must carry its own */
+static tl_tensor *qdst(tl_tensor *dst, const tl_shape *shape, const tl_quant *q)
+{
+    if (dst) {
+        assert(dst->quant && !q);
+        dst = tl_tensor_dst(dst, shape);
+    } else {
+        assert(q);
+        dst = tl_tensor_zeros_shape(shape);
+        tl_tensor_set_quant(dst, q);
+    }
+    tl_check_qtensor(dst);
+    return dst;
+}
+
+/* Per-channel parameters apply to runs of inner elements; when the channel
+   axis is the last one, the runs are single elements and the kernels take
+   one parameter per element of a row of channels instead. */
+static void quant_runs(const tl_tensor *t, const tl_quant *q, int *outer, int *inner)
+{
+    int i;
+
+    for (i = 0, *outer = 1; i < q->axis; i++)
+        *outer *= t->dims[i];
+    for (i = q->axis + 1, *inner = 1; i < t->ndim; i++)
+        *inner *= t->dims[i];
+}
+
+/* The companions of the quantized ops give dtypes and dims only, the
+   quantization parameters of a dst aren't part of its shape. */
+TL_EXPORT tl_shape *tl_tensor_quantize_out_shape(const tl_tensor *src, tl_dtype dtype,
+                                                 tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->dtype == TL_FLOAT);
+    assert(dtype == TL_INT8 || dtype == TL_UINT8);
+    tl_tensor_shape(src, shape);
+    shape->dtype = dtype;
+    return shape;
+}
+
+/* q = round(x / scale + zero_point), computed as x * (1 / scale), rounded
+   half to even and saturated to dtype, which is TL_INT8 or TL_UINT8.
+   src is TL_FLOAT. */
+TL_EXPORT tl_tensor *tl_tensor_quantize(const tl_tensor *src, tl_tensor *dst, tl_dtype dtype,
+                                        const tl_quant *q)
+{
+    const float *s;
+    float *inv;
+    int outer, inner, o, c, C;
+    tl_shape shape;
+    size_t dsize;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    tl_tensor_quantize_out_shape(src, dtype, &shape);
+    dst = qdst(dst, &shape, q);
+    q = dst->quant;
+
+    inv = tl_alloc(sizeof(float) * q->len);
+    for (c = 0; c < q->len; c++)
+        inv[c] = 1.0f / q->scales[c];
+    s = src->data;
+    dsize = tl_size_of(dtype);
+    if (q->axis < 0) {
+        tl_quantize_n(dst->data, dtype, s, inv, q->zero_points, dst->len, 0);
+    } else {
+        quant_runs(dst, q, &outer, &inner);
+        C = q->len;
+        for (o = 0; o < outer; o++) {
+            if (inner == 1) {
+                tl_quantize_n(tl_padd(dst->data, (size_t)o * C, dsize), dtype, s + (size_t)o * C,
+                              inv, q->zero_points, C, 1);
+                continue;
+            }
+            for (c = 0; c < C; c++)
+                tl_quantize_n(tl_padd(dst->data, ((size_t)o * C + c) * inner, dsize), dtype,
+                              s + ((size_t)o * C + c) * inner, &inv[c], &q->zero_points[c], inner,
+                              0);
+        }
+    }
+    tl_free(inv);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_dequantize_out_shape(const tl_tensor *src, tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->dtype == TL_INT8 || src->dtype == TL_UINT8);
+    tl_tensor_shape(src, shape);
+    shape->dtype = TL_FLOAT;
+    return shape;
+}
+
+/* x = scale * (q - zero_point) into a TL_FLOAT dst */
+TL_EXPORT tl_tensor *tl_tensor_dequantize(const tl_tensor *src, tl_tensor *dst)
+{
+    const tl_quant *q;
+    float *d;
+    int outer, inner, o, c, C;
+    tl_shape shape;
+    size_t dsize;
+
+    TL_PROFILE_OP();
+
+    tl_check_qtensor(src);
+    tl_tensor_dequantize_out_shape(src, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    q = src->quant;
+    d = dst->data;
+    dsize = tl_size_of(src->dtype);
+    if (q->axis < 0) {
+        tl_dequantize_n(d, src->data, src->dtype, q->scales, q->zero_points, src->len, 0);
+    } else {
+        quant_runs(src, q, &outer, &inner);
+        C = q->len;
+        for (o = 0; o < outer; o++) {
+            if (inner == 1) {
+                tl_dequantize_n(d + (size_t)o * C, tl_padd(src->data, (size_t)o * C, dsize),
+                                src->dtype, q->scales, q->zero_points, C, 1);
+                continue;
+            }
+            for (c = 0; c < C; c++)
+                tl_dequantize_n(d + ((size_t)o * C + c) * inner,
+                                tl_padd(src->data, ((size_t)o * C + c) * inner, dsize),
+                                src->dtype, &q->scales[c], &q->zero_points[c], inner, 0);
+        }
+    }
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_qelew_out_shape(const tl_tensor *src1, const tl_tensor *src2,
+                                              tl_shape *shape)
+{
+    assert(tl_tensor_issameshape(src1, src2));
+    assert(src1->dtype == src2->dtype);
+    assert(src1->dtype == TL_INT8 || src1->dtype == TL_UINT8);
+    assert(shape);
+    tl_tensor_shape(src1, shape);
+    return shape;
+}
+
+/* Quantized TL_SUM, TL_SUB or TL_MUL of tensors of the same quantized dtype,
+   requantized to dst's parameters. All of them are quantized per tensor. */
+TL_EXPORT tl_tensor *tl_tensor_qelew(const tl_tensor *src1, const tl_tensor *src2, tl_tensor *dst,
+                                     tl_elew_op elew_op, const tl_quant *q)
+{
+    struct tl_qparam qp;
+    double s1, s2, sd;
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
+    tl_check_qtensor(src1);
+    tl_check_qtensor(src2);
+    assert(elew_op == TL_SUM || elew_op == TL_SUB || elew_op == TL_MUL);
+    tl_tensor_qelew_out_shape(src1, src2, &shape);
+    dst = qdst(dst, &shape, q);
+    assert(src1->quant->axis < 0 && src2->quant->axis < 0 && dst->quant->axis < 0);
+
+    s1 = src1->quant->scales[0];
+    s2 = src2->quant->scales[0];
+    sd = dst->quant->scales[0];
+    qp.z1 = src1->quant->zero_points[0];
+    qp.z2 = src2->quant->zero_points[0];
+    qp.zd = dst->quant->zero_points[0];
+    if (elew_op == TL_MUL) {
+        qp.m1 = s1 * s2 / sd;
+        qp.m2 = 0;
+    } else {
+        qp.m1 = s1 / sd;
+        qp.m2 = elew_op == TL_SUB ? -s2 / sd : s2 / sd;
+    }
+    tl_qelew_n(src1->data, src2->data, dst->data, dst->len,
+               elew_op == TL_MUL ? TL_MUL : TL_SUM, &qp, dst->dtype);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src1) + TL_PROFILE_TENSOR_BYTES(src2),
+                  TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_qlrelu_out_shape(const tl_tensor *src, tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->dtype == TL_INT8 || src->dtype == TL_UINT8);
+    tl_tensor_shape(src, shape);
+    return shape;
+}
+
+/* Quantized leaky ReLU of a tensor quantized per tensor. A NULL dst gets the
+   quantization q, or src's if q is NULL too. */
+TL_EXPORT tl_tensor *tl_tensor_qlrelu(const tl_tensor *src, tl_tensor *dst, float negslope,
+                                      const tl_quant *q)
+{
+    struct tl_qparam qp;
+    tl_shape shape;
+    double m;
+
+    TL_PROFILE_OP();
+
+    tl_check_qtensor(src);
+    tl_tensor_qlrelu_out_shape(src, &shape);
+    dst = qdst(dst, &shape, dst || q ? q : src->quant);
+    assert(src->quant->axis < 0 && dst->quant->axis < 0);
+
+    m = (double)src->quant->scales[0] / dst->quant->scales[0];
+    qp.m1 = m;
+    qp.m2 = negslope * m;
+    qp.z1 = src->quant->zero_points[0];
+    qp.z2 = 0;
+    qp.zd = dst->quant->zero_points[0];
+    tl_qlrelu_n(dst->data, src->data, dst->len, &qp, dst->dtype);
+
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "tl_tensor_internal.h"
+#include "tl_kernel.h"
+
+/* Counter-based random fills. Elements 2k and 2k + 1 both come from the
+   Philox4x32-10 block with counter k and key seed: a uniform element takes
+   53 bits from two words of the block, and a normal pair is one Box-Muller
+   transform of the two uniforms in the block. Every element is a function of
+   (seed, index) only, so the result doesn't depend on how the fill is split
+   among threads, or on the CPU level. */
+
+#define RANDOM_BLOCK 256 /* pairs per philox_n call */
+#define RANDOM_GRAIN 2048
+
+struct random_info {
+    void *data;
+    tl_dtype dtype;
+    int len;
+    uint64_t seed;
+    int normal;
+    double a, b; /* low and high, or mean and std */
+};
+
+/* [0, 1) with 53 bits out of w0 and w1 */
+static inline double uniform53(uint32_t w0, uint32_t w1)
+{
+    return ((w0 >> 5) * 67108864.0 + (w1 >> 6)) * (1.0 / 9007199254740992.0);
+}
+
+static int is_integer_dtype(tl_dtype dtype)
+{
+    return dtype != TL_DOUBLE && dtype != TL_FLOAT && dtype != TL_FLOAT16 &&
+           dtype != TL_BFLOAT16;
+}
+
+static void random_worker(void *arg, int start, int end)
+{
+    const struct random_info *info = arg;
+    uint32_t w[4 * RANDOM_BLOCK];
+    double v[2 * RANDOM_BLOCK];
+    size_t dsize = tl_size_of(info->dtype);
+    int integer = is_integer_dtype(info->dtype);
+    int k, m, i, first, n;
+    double r, t;
+
+    for (k = start; k < end; k += m) {
+        m = end - k < RANDOM_BLOCK ? end - k : RANDOM_BLOCK;
+        tl_get_kernels()->philox_n(w, info->seed, (uint64_t)k, m);
+        if (info->normal) {
+            for (i = 0; i < m; i++) {
+                r = sqrt(-2.0 * log(1.0 - uniform53(w[4 * i], w[4 * i + 1])));
+                t = 2.0 * M_PI * uniform53(w[4 * i + 2], w[4 * i + 3]);
+                v[2 * i] = info->a + info->b * r * cos(t);
+                v[2 * i + 1] = info->a + info->b * r * sin(t);
+            }
+        } else {
+            for (i = 0; i < 2 * m; i++) {
+                if (integer) {
+                    /* a and b are already ceil(low) and ceil(high) */
+                    v[i] = info->a + floor((info->b - info->a) *
+                                           uniform53(w[2 * i], w[2 * i + 1]));
+                    if (v[i] >= info->b)
+                        v[i] = info->b - 1;
+                } else {
+                    v[i] = info->a + (info->b - info->a) * uniform53(w[2 * i], w[2 * i + 1]);
+                }
+            }
+        }
+        first = 2 * k;
+        n = first + 2 * m > info->len ? info->len - first : 2 * m;
+        tl_convert_n(tl_padd(info->data, first, dsize), info->dtype, v, TL_DOUBLE, n);
+    }
+}
+
+static void random_fill(tl_tensor *dst, int normal, double a, double b, uint64_t seed)
+{
+    struct random_info info;
+
+    info.data = dst->data;
+    info.dtype = dst->dtype;
+    info.len = dst->len;
+    info.seed = seed;
+    info.normal = normal;
+    info.a = a;
+    info.b = b;
+    tl_parallel_for(dst->len / 2 + dst->len % 2, RANDOM_GRAIN, random_worker, &info);
+}
+
+static tl_tensor *alloc_tensor(int ndim, const int *dims, tl_dtype dtype)
+{
+    tl_tensor *t;
+
+    t = tl_tensor_create(NULL, ndim, dims, dtype);
+    t->owner = t;
+    t->data = tl_alloc(t->len * tl_size_of(dtype));
+    return t;
+}
+
+static tl_tensor *fill_uniform(tl_tensor *dst, double low, double high, uint64_t seed)
+{
+    assert(dst && dst->data);
+    assert(low < high);
+    if (is_integer_dtype(dst->dtype)) {
+        low = ceil(low);
+        high = ceil(high);
+        assert(high > low);
+    }
+    random_fill(dst, 0, low, high, seed);
+    return dst;
+}
+
+static tl_tensor *fill_normal(tl_tensor *dst, double mean, double std, uint64_t seed)
+{
+    assert(dst && dst->data);
+    assert(std >= 0);
+    random_fill(dst, 1, mean, std, seed);
+    return dst;
+}
+
+/* Fill dst with values uniformly distributed in [low, high). Integer dtypes
+   get the floor of such values, i.e. integers in [ceil(low), ceil(high)).
+   Float results can round up to high. */
+TL_EXPORT tl_tensor *tl_tensor_fill_uniform(tl_tensor *dst, double low, double high,
+                                            uint64_t seed)
+{
+    TL_PROFILE_OP();
+
+    fill_uniform(dst, low, high, seed);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+/* Fill dst with normally distributed values, converted to dst's dtype. */
+TL_EXPORT tl_tensor *tl_tensor_fill_normal(tl_tensor *dst, double mean, double std, uint64_t seed)
+{
+    TL_PROFILE_OP();
+
+    fill_normal(dst, mean, std, seed);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_tensor *tl_tensor_random_uniform(int ndim, const int *dims, tl_dtype dtype,
+                                              double low, double high, uint64_t seed)
+{
+    tl_tensor *dst;
+
+    TL_PROFILE_OP();
+
+    dst = fill_uniform(alloc_tensor(ndim, dims, dtype), low, high, seed);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_tensor *tl_tensor_random_normal(int ndim, const int *dims, tl_dtype dtype,
+                                             double mean, double std, uint64_t seed)
+{
+    tl_tensor *dst;
+
+    TL_PROFILE_OP();
+
+    dst = fill_normal(alloc_tensor(ndim, dims, dtype), mean, std, seed);
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -27,6 +27,8 @@ TL_EXPORT tl_tensor *tl_tensor_reshape(tl_tensor *src, int ndim, const int *dims
 {
     tl_tensor *dst;
 
+    TL_PROFILE_OP();
+
     assert(src);
     assert(src->len == tl_compute_length(ndim, dims));
     dst = tl_tensor_create(src->data, ndim, dims, src->dtype);
@@ -36,6 +38,8 @@ TL_EXPORT tl_tensor *tl_tensor_reshape(tl_tensor *src, int ndim, const int *dims
 
 TL_EXPORT void tl_tensor_reshape_src(tl_tensor *src, int ndim, const int *dims)
 {
+    TL_PROFILE_OP();
+
     assert(src);
     assert(src->len == tl_compute_length(ndim, dims));
     src->ndim = ndim;
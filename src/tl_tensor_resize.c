@@ -21,25 +21,74 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
+struct nearest_info {
+    const tl_tensor *src;
+    tl_tensor *dst;
+    const int *new_dims;
+    int *offsets[TL_MAXDIM];
+};
+
+static void nearest_worker(void *arg, int start, int end)
+{
+    const struct nearest_info *info = arg;
+    const int *new_dims = info->new_dims;
+    int ndim = info->src->ndim;
+    int ids[TL_MAXDIM] = { 0 };
+    int i, row, rest, cols;
+    ptrdiff_t base;
+    size_t dsize = tl_size_of(info->src->dtype);
+    const struct tl_kernels *k = tl_get_kernels();
+
+    for (i = ndim - 2, rest = start; i >= 0; i--) {
+        ids[i] = rest % new_dims[i];
+        rest /= new_dims[i];
+    }
+    cols = new_dims[ndim - 1];
+    for (row = start; row < end; row++) {
+        for (i = 0, base = 0; i < ndim - 1; i++)
+            base += info->offsets[i][ids[i]];
+        k->gather[tl_size_index(dsize)](tl_padd(info->dst->data, (ptrdiff_t)row * cols, dsize),
+                                        tl_padd(info->src->data, base, dsize),
+                                        info->offsets[ndim - 1], cols);
+        for (i = ndim - 2; i >= 0; i--) {
+            if (++ids[i] < new_dims[i])
+                break;
+            ids[i] = 0;
+        }
+    }
+}
+
+/* Source offsets are computed once per axis; the last axis is then
+   gathered a row at a time. Rows are spread over the threads, so a batch
+   resized along a leading N dim runs in a single call. */
 static void nearest_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims)
 {
-    int src_id, dst_id, i;
-    int src_coords[TL_MAXDIM], dst_coords[TL_MAXDIM];
-    size_t dsize = tl_size_of(src->dtype);
-    float rounded, scales[TL_MAXDIM];
+    struct nearest_info info;
+    int ndim = src->ndim;
+    int i, j, stride, coord, cols;
+    float scale;
 
-    for (i = 0; i < src->ndim; i++)
-        scales[i] = (float)src->dims[i] / (float)new_dims[i];
-    for (dst_id = 0; dst_id < dst->len; dst_id++) {
-        tl_get_coords(dst_id, dst_coords, src->ndim, new_dims);
-        for (i = 0; i < src->ndim; i++) {
-            rounded = roundf(((float)dst_coords[i] + 0.5) * scales[i] - 0.5);
-            tl_convert(&src_coords[i], TL_INT32, &rounded, TL_FLOAT);
+    for (i = ndim - 1, stride = 1; i >= 0; i--) {
+        info.offsets[i] = tl_alloc(sizeof(int) * new_dims[i]);
+        scale = (float)src->dims[i] / (float)new_dims[i];
+        for (j = 0; j < new_dims[i]; j++) {
+            coord = (int)roundf(((float)j + 0.5) * scale - 0.5);
+            coord = coord < 0 ? 0 : coord >= src->dims[i] ? src->dims[i] - 1 : coord;
+            info.offsets[i][j] = coord * stride;
         }
-        src_id = tl_get_index(src_coords, src->ndim, src->dims);
-        tl_passign(dst->data, dst_id, src->data, src_id, dsize);
+        stride *= src->dims[i];
     }
+
+    info.src = src;
+    info.dst = dst;
+    info.new_dims = new_dims;
+    cols = new_dims[ndim - 1];
+    tl_parallel_for(dst->len / cols, 16384 / cols + 1, nearest_worker, &info);
+
+    for (i = 0; i < ndim; i++)
+        tl_free(info.offsets[i]);
 }
 
 static void linear_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims)
@@ -47,19 +96,27 @@ static void linear_resize(const tl_tensor *src, tl_tensor *dst, const int *new_d
     assert(0 && "not support TL_LINEAR yet");
 }
 
+TL_EXPORT tl_shape *tl_tensor_resize_out_shape(const tl_tensor *src, const int *new_dims,
+                                                tl_resize_type rtype, tl_shape *shape)
+{
+    assert(src && new_dims && shape);
+    tl_check_resize_type(rtype);
+    shape->dtype = src->dtype;
+    shape->ndim = src->ndim;
+    memcpy(shape->dims, new_dims, sizeof(int) * src->ndim);
+    return shape;
+}
+
 TL_EXPORT tl_tensor *tl_tensor_resize(const tl_tensor *src, tl_tensor *dst, const int *new_dims,
                                       tl_resize_type rtype)
 {
+    tl_shape shape;
+
+    TL_PROFILE_OP();
+
     assert(src && src->data);
-    assert(new_dims);
-    tl_check_resize_type(rtype);
-    if (dst) {
-        assert(dst->data);
-        assert(dst->dtype == src->dtype);
-        assert(dst->ndim == src->ndim);
-    } else {
-        dst = tl_tensor_zeros(src->ndim, new_dims, src->dtype);
-    }
+    tl_tensor_resize_out_shape(src, new_dims, rtype, &shape);
+    dst = tl_tensor_dst(dst, &shape);
 
     switch (rtype) {
     case TL_NEAREST:
@@ -72,5 +129,6 @@ TL_EXPORT tl_tensor *tl_tensor_resize(const tl_tensor *src, tl_tensor *dst, cons
         assert(0 && "unsupported tl_resize_type");
         break;
     }
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
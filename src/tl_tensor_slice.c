@@ -28,6 +28,8 @@ TL_EXPORT tl_tensor *tl_tensor_create_slice(void *data, const tl_tensor *src, in
     tl_tensor *dst;
     int *dims;
 
+    TL_PROFILE_OP();
+
     assert(src);
     assert(axis < src->ndim && axis >= 0);
     assert(len <= src->dims[axis] && len > 0);
@@ -45,6 +47,8 @@ TL_EXPORT tl_tensor *tl_tensor_zeros_slice(const tl_tensor *src, int axis, int l
     tl_tensor *dst;
     int *dims;
 
+    TL_PROFILE_OP();
+
     assert(src);
     assert(axis < src->ndim && axis >= 0);
     assert(len <= src->dims[axis] && len > 0);
@@ -54,47 +58,185 @@ TL_EXPORT tl_tensor *tl_tensor_zeros_slice(const tl_tensor *src, int axis, int l
     dst = tl_tensor_zeros(src->ndim, dims, dtype);
     tl_free(dims);
 
+    TL_PROFILE_IO(0, TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
-TL_EXPORT tl_tensor *tl_tensor_slice(const tl_tensor *src, tl_tensor *dst, int axis, int start,
-                                     int len)
-{
-    int i;
-    int d_vol, s_vol, vol;
-    int thread_num;
-    int si, di;
+/* A slice is copied as runs of contiguous src elements: the trailing axes
+   that are taken whole, plus the next axis if its step is 1. The remaining
+   outer axes are walked with an odometer, so there is no per-element index
+   math. */
+struct slice_info {
+    int ndim;                  /* number of outer axes */
+    int dims[TL_MAXDIM];       /* outer dst dims */
+    ptrdiff_t steps[TL_MAXDIM]; /* src element strides of outer dst indices */
+    ptrdiff_t base;            /* src element offset of the first run */
+    int run;                   /* elements per run */
     size_t dsize;
+    const uint8_t *src;
+    uint8_t *dst;
+};
+
+static inline void copy_run(uint8_t *d, const uint8_t *s, int run, size_t dsize)
+{
+    if (run > 1) {
+        memcpy(d, s, run * dsize);
+        return;
+    }
+    switch (dsize) {
+    case 1:
+        *d = *s;
+        break;
+    case 2:
+        *(uint16_t *)d = *(const uint16_t *)s;
+        break;
+    case 4:
+        *(uint32_t *)d = *(const uint32_t *)s;
+        break;
+    case 8:
+        *(uint64_t *)d = *(const uint64_t *)s;
+        break;
+    default:
+        memcpy(d, s, dsize);
+        break;
+    }
+}
+
+static void slice_worker(void *arg, int start, int end)
+{
+    const struct slice_info *info = arg;
+    int ids[TL_MAXDIM];
+    ptrdiff_t off;
+    size_t run_bytes = info->run * info->dsize;
+    int i, r, rem;
+
+    for (i = info->ndim - 1, rem = start, off = info->base; i >= 0; i--) {
+        ids[i] = rem % info->dims[i];
+        rem /= info->dims[i];
+        off += ids[i] * info->steps[i];
+    }
+    for (r = start; r < end; r++) {
+        copy_run(info->dst + r * run_bytes, info->src + off * info->dsize, info->run,
+                 info->dsize);
+        for (i = info->ndim - 1; i >= 0; i--) {
+            off += info->steps[i];
+            if (++ids[i] < info->dims[i])
+                break;
+            off -= ids[i] * info->steps[i];
+            ids[i] = 0;
+        }
+    }
+}
+
+TL_EXPORT tl_shape *tl_tensor_slice_nd_out_shape(const tl_tensor *src, const int *start,
+                                                  const int *stop, const int *step,
+                                                  tl_shape *shape)
+{
+    int i, b, e, st;
+
+    assert(src && shape);
+    shape->dtype = src->dtype;
+    shape->ndim = src->ndim;
+    for (i = 0; i < src->ndim; i++) {
+        b = start ? start[i] : 0;
+        e = stop ? stop[i] : src->dims[i];
+        st = step ? step[i] : 1;
+        assert(st > 0);
+        assert(b >= 0 && b < e && e <= src->dims[i]);
+        shape->dims[i] = (e - b + st - 1) / st;
+    }
+    return shape;
+}
+
+/* tl_tensor_slice_nd() without the profiling scope, shared by
+   tl_tensor_slice() */
+static tl_tensor *slice_nd(const tl_tensor *src, tl_tensor *dst, const int *start,
+                           const int *stop, const int *step)
+{
+    struct slice_info info;
+    tl_shape shape;
+    int *dims, b[TL_MAXDIM], st[TL_MAXDIM];
+    ptrdiff_t strides[TL_MAXDIM];
+    int i, k, nruns;
 
     assert(src && src->data);
+    tl_tensor_slice_nd_out_shape(src, start, stop, step, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+    dims = shape.dims;
+    for (i = src->ndim - 1; i >= 0; i--) {
+        b[i] = start ? start[i] : 0;
+        st[i] = step ? step[i] : 1;
+        strides[i] = i == src->ndim - 1 ? 1 : strides[i + 1] * src->dims[i + 1];
+    }
+
+    info.run = 1;
+    for (k = src->ndim - 1; k >= 0 && dims[k] == src->dims[k]; k--)
+        info.run *= dims[k];
+    if (k >= 0 && st[k] == 1) {
+        info.run *= dims[k];
+        k--;
+    }
+    info.ndim = k + 1;
+    info.base = 0;
+    for (i = 0, nruns = 1; i < src->ndim; i++) {
+        info.base += b[i] * strides[i];
+        if (i < info.ndim) {
+            info.dims[i] = dims[i];
+            info.steps[i] = st[i] * strides[i];
+            nruns *= dims[i];
+        }
+    }
+    info.dsize = tl_size_of(src->dtype);
+    info.src = src->data;
+    info.dst = dst->data;
+    tl_parallel_for(nruns, (1 << 14) / (info.run * info.dsize) + 1, slice_worker, &info);
+
+    return dst;
+}
+
+/* Slice every axis i from start[i] (inclusive) to stop[i] (exclusive) with
+   a positive step[i]. A NULL start means 0s, a NULL stop means src's dims and
+   a NULL step means 1s. */
+TL_EXPORT tl_tensor *tl_tensor_slice_nd(const tl_tensor *src, tl_tensor *dst, const int *start,
+                                        const int *stop, const int *step)
+{
+    TL_PROFILE_OP();
+
+    dst = slice_nd(src, dst, start, stop, step);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_slice_out_shape(const tl_tensor *src, int axis, int start, int len,
+                                               tl_shape *shape)
+{
+    assert(src && shape);
     assert(axis < src->ndim && axis >= 0);
     assert(len <= src->dims[axis] && len > 0);
     assert(start < src->dims[axis] && start >= 0);
     assert(len + start <= src->dims[axis]);
-    if (dst) {
-#ifndef NDEBUG
-        assert(dst->data);
-        assert(src->dtype == dst->dtype);
-        assert(dst->ndim == src->ndim);
-        for (i = 0; i < src->ndim; i++)
-            assert(i == axis ? dst->dims[i] == len : dst->dims[i] == src->dims[i]);
-#endif
-    } else {
-        dst = tl_tensor_zeros_slice(src, axis, len, src->dtype);
-    }
+    tl_tensor_shape(src, shape);
+    shape->dims[axis] = len;
+    return shape;
+}
 
-    for (i = axis + 1, vol = 1; i < dst->ndim; i++)
-        vol *= dst->dims[i];
-    d_vol = vol * dst->dims[axis];
-    s_vol = vol * src->dims[axis];
-    thread_num = dst->len;
+TL_EXPORT tl_tensor *tl_tensor_slice(const tl_tensor *src, tl_tensor *dst, int axis, int start,
+                                     int len)
+{
+    int starts[TL_MAXDIM] = { 0 };
+    int stops[TL_MAXDIM];
+    tl_shape shape;
 
-    dsize = tl_size_of(src->dtype);
-    for (di = 0; di < thread_num; di++) {
-        si = di / d_vol * s_vol + di % d_vol + start * vol;
-        tl_passign(dst->data, di, src->data, si, dsize);
-    }
+    TL_PROFILE_OP();
 
+    assert(src && src->data);
+    tl_tensor_slice_out_shape(src, axis, start, len, &shape);
+
+    memmove(stops, src->dims, sizeof(int) * src->ndim);
+    starts[axis] = start;
+    stops[axis] = start + len;
+    dst = slice_nd(src, dst, starts, stops, NULL);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
 
@@ -103,6 +245,8 @@ TL_EXPORT tl_tensor *tl_tensor_slice_nocopy(tl_tensor *src, tl_tensor *dst, int
 {
     int i, volumn;
 
+    TL_PROFILE_OP();
+
     assert(src && src->data);
     assert(axis == 0);
     assert(len <= src->dims[axis] && len > 0);
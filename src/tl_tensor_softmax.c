@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "tl_tensor_internal.h"
+
+/* Softmax along an axis is done in one read pass, keeping a running max m
+   and a running sum s of exp(x - m) that is rescaled whenever m grows, and
+   one write pass. The src is viewed as [outer, dim, inner]: with inner == 1
+   each row is split into interleaved lanes with their own (m, s), merged at
+   the end of the row, otherwise a block of neighboring inner positions is
+   processed together. TL_FLOAT uses GCC vector extensions and a polynomial
+   exp, so it doesn't depend on auto-vectorization. */
+
+#define SOFTMAX_LANES 8
+#define SOFTMAX_BLOCK 64
+
+/* 16-byte vectors map to SSE and NEON registers */
+#define SOFTMAX_VLEN 4
+typedef float softmax_vf __attribute__((vector_size(SOFTMAX_VLEN * sizeof(float))));
+typedef int32_t softmax_vi __attribute__((vector_size(SOFTMAX_VLEN * sizeof(int32_t))));
+
+#define VF(c) ((softmax_vf){ c, c, c, c })
+#define VI(c) ((softmax_vi){ c, c, c, c })
+
+/* Cephes-style expf: round x / ln2 to n with the 1.5 * 2^23 trick, take a
+   polynomial of the remainder and scale by 2^n through the exponent bits.
+   Inputs below the float range return 0, relative error is about 2 ulp.
+   softmax_expf and softmax_vexpf compute the same thing. */
+#define EXPF_LO -87.0f
+#define EXPF_HI 88.0f
+#define EXPF_MAGIC 12582912.0f
+
+static inline float softmax_expf(float x)
+{
+    float xc, t, n, r, p;
+    union {
+        int32_t i;
+        float f;
+    } u;
+
+    xc = x < EXPF_LO ? EXPF_LO : x;
+    xc = xc > EXPF_HI ? EXPF_HI : xc;
+    u.f = xc * 1.44269504088896341f + EXPF_MAGIC;
+    n = u.f - EXPF_MAGIC;
+    u.i = (u.i - 0x4B400000 + 127) << 23;
+    r = xc - n * 0.693359375f + n * 2.12194440e-4f;
+    p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    p = p * r * r + r + 1.0f;
+    t = p * u.f;
+    return x < EXPF_LO ? 0.0f : t;
+}
+
+static inline softmax_vf vselect(softmax_vi mask, softmax_vf a, softmax_vf b)
+{
+    return (softmax_vf)((mask & (softmax_vi)a) | (~mask & (softmax_vi)b));
+}
+
+static inline softmax_vf vmax(softmax_vf a, softmax_vf b)
+{
+    return vselect(a > b, a, b);
+}
+
+static inline softmax_vf softmax_vexpf(softmax_vf x)
+{
+    softmax_vf xc, t, n, r, p;
+    softmax_vi e;
+
+    xc = vselect(x < VF(EXPF_LO), VF(EXPF_LO), x);
+    xc = vselect(xc > VF(EXPF_HI), VF(EXPF_HI), xc);
+    t = xc * VF(1.44269504088896341f) + VF(EXPF_MAGIC);
+    n = t - VF(EXPF_MAGIC);
+    e = ((softmax_vi)t - VI(0x4B400000) + VI(127)) << 23;
+    r = xc - n * VF(0.693359375f) + n * VF(2.12194440e-4f);
+    p = VF(1.9875691500e-4f);
+    p = p * r + VF(1.3981999507e-3f);
+    p = p * r + VF(8.3334519073e-3f);
+    p = p * r + VF(4.1665795894e-2f);
+    p = p * r + VF(1.6666665459e-1f);
+    p = p * r + VF(5.0000001201e-1f);
+    p = p * r * r + r + VF(1.0f);
+    t = p * (softmax_vf)e;
+    return vselect(x < VF(EXPF_LO), VF(0.0f), t);
+}
+
+static inline softmax_vf vload(const float *p)
+{
+    softmax_vf v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vstore(float *p, softmax_vf v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static void softmax_row_float(const float *x, float *y, int n, int is_log)
+{
+    softmax_vf m0 = VF(-FLT_MAX), m1 = VF(-FLT_MAX), s0 = VF(0.0f), s1 = VF(0.0f);
+    softmax_vf x0, x1, mn0, mn1;
+    float M, S, mk[SOFTMAX_LANES], sk[SOFTMAX_LANES], mn;
+    int i, k;
+
+    for (i = 0; i + SOFTMAX_LANES <= n; i += SOFTMAX_LANES) {
+        x0 = vload(x + i);
+        x1 = vload(x + i + SOFTMAX_VLEN);
+        mn0 = vmax(m0, x0);
+        mn1 = vmax(m1, x1);
+        s0 = s0 * softmax_vexpf(m0 - mn0) + softmax_vexpf(x0 - mn0);
+        s1 = s1 * softmax_vexpf(m1 - mn1) + softmax_vexpf(x1 - mn1);
+        m0 = mn0;
+        m1 = mn1;
+    }
+    vstore(mk, m0);
+    vstore(mk + SOFTMAX_VLEN, m1);
+    vstore(sk, s0);
+    vstore(sk + SOFTMAX_VLEN, s1);
+    for (; i < n; i++) {
+        mn = x[i] > mk[0] ? x[i] : mk[0];
+        sk[0] = sk[0] * softmax_expf(mk[0] - mn) + softmax_expf(x[i] - mn);
+        mk[0] = mn;
+    }
+    for (k = 1, M = mk[0]; k < SOFTMAX_LANES; k++)
+        M = mk[k] > M ? mk[k] : M;
+    for (k = 0, S = 0; k < SOFTMAX_LANES; k++)
+        S += sk[k] * softmax_expf(mk[k] - M);
+
+    if (is_log) {
+        S = M + logf(S);
+        for (i = 0; i < n; i++)
+            y[i] = x[i] - S;
+        return;
+    }
+    S = 1 / S;
+    for (i = 0; i + SOFTMAX_VLEN <= n; i += SOFTMAX_VLEN)
+        vstore(y + i, softmax_vexpf(vload(x + i) - VF(M)) * VF(S));
+    for (; i < n; i++)
+        y[i] = softmax_expf(x[i] - M) * S;
+}
+
+/* nb neighboring columns of a [dim, inner] matrix */
+static void softmax_cols_float(const float *x, float *y, int dim, int inner, int nb, int is_log)
+{
+    float m[SOFTMAX_BLOCK], s[SOFTMAX_BLOCK], mn;
+    softmax_vf mv, sv, xv, mnv;
+    const float *xr;
+    float *yr;
+    int d, b, nv = nb / SOFTMAX_VLEN * SOFTMAX_VLEN;
+
+    for (b = 0; b < nb; b++) {
+        m[b] = -FLT_MAX;
+        s[b] = 0;
+    }
+    for (d = 0; d < dim; d++) {
+        xr = x + (size_t)d * inner;
+        for (b = 0; b < nv; b += SOFTMAX_VLEN) {
+            xv = vload(xr + b);
+            mv = vload(m + b);
+            mnv = vmax(mv, xv);
+            sv = vload(s + b) * softmax_vexpf(mv - mnv) + softmax_vexpf(xv - mnv);
+            vstore(m + b, mnv);
+            vstore(s + b, sv);
+        }
+        for (; b < nb; b++) {
+            mn = xr[b] > m[b] ? xr[b] : m[b];
+            s[b] = s[b] * softmax_expf(m[b] - mn) + softmax_expf(xr[b] - mn);
+            m[b] = mn;
+        }
+    }
+
+    for (b = 0; b < nb; b++)
+        s[b] = is_log ? m[b] + logf(s[b]) : 1 / s[b];
+    for (d = 0; d < dim; d++) {
+        xr = x + (size_t)d * inner;
+        yr = y + (size_t)d * inner;
+        if (is_log) {
+            for (b = 0; b < nb; b++)
+                yr[b] = xr[b] - s[b];
+            continue;
+        }
+        for (b = 0; b < nv; b += SOFTMAX_VLEN)
+            vstore(yr + b, softmax_vexpf(vload(xr + b) - vload(m + b)) * vload(s + b));
+        for (; b < nb; b++)
+            yr[b] = softmax_expf(xr[b] - m[b]) * s[b];
+    }
+}
+
+static void softmax_row_double(const double *x, double *y, int n, int is_log)
+{
+    double m[SOFTMAX_LANES], s[SOFTMAX_LANES], mn, M, S;
+    int i, k;
+
+    for (k = 0; k < SOFTMAX_LANES; k++) {
+        m[k] = -DBL_MAX;
+        s[k] = 0;
+    }
+    for (i = 0; i + SOFTMAX_LANES <= n; i += SOFTMAX_LANES) {
+        for (k = 0; k < SOFTMAX_LANES; k++) {
+            mn = x[i + k] > m[k] ? x[i + k] : m[k];
+            s[k] = s[k] * exp(m[k] - mn) + exp(x[i + k] - mn);
+            m[k] = mn;
+        }
+    }
+    for (; i < n; i++) {
+        mn = x[i] > m[0] ? x[i] : m[0];
+        s[0] = s[0] * exp(m[0] - mn) + exp(x[i] - mn);
+        m[0] = mn;
+    }
+    for (k = 1, M = m[0]; k < SOFTMAX_LANES; k++)
+        M = m[k] > M ? m[k] : M;
+    for (k = 0, S = 0; k < SOFTMAX_LANES; k++)
+        S += s[k] * exp(m[k] - M);
+
+    if (is_log) {
+        S = M + log(S);
+        for (i = 0; i < n; i++)
+            y[i] = x[i] - S;
+    } else {
+        S = 1 / S;
+        for (i = 0; i < n; i++)
+            y[i] = exp(x[i] - M) * S;
+    }
+}
+
+static void softmax_cols_double(const double *x, double *y, int dim, int inner, int nb,
+                                int is_log)
+{
+    double m[SOFTMAX_BLOCK], s[SOFTMAX_BLOCK], mn;
+    const double *xr;
+    double *yr;
+    int d, b;
+
+    for (b = 0; b < nb; b++) {
+        m[b] = -DBL_MAX;
+        s[b] = 0;
+    }
+    for (d = 0; d < dim; d++) {
+        xr = x + (size_t)d * inner;
+        for (b = 0; b < nb; b++) {
+            mn = xr[b] > m[b] ? xr[b] : m[b];
+            s[b] = s[b] * exp(m[b] - mn) + exp(xr[b] - mn);
+            m[b] = mn;
+        }
+    }
+
+    for (b = 0; b < nb; b++)
+        s[b] = is_log ? m[b] + log(s[b]) : 1 / s[b];
+    for (d = 0; d < dim; d++) {
+        xr = x + (size_t)d * inner;
+        yr = y + (size_t)d * inner;
+        for (b = 0; b < nb; b++)
+            yr[b] = is_log ? xr[b] - s[b] : exp(xr[b] - m[b]) * s[b];
+    }
+}
+
+struct softmax_info {
+    const tl_tensor *src;
+    tl_tensor *dst;
+    int dim, inner;
+    int nblocks; /* blocks of inner per outer index, 0 if inner == 1 */
+    int is_log;
+};
+
+static void softmax_worker(void *arg, int start, int end)
+{
+    const struct softmax_info *info = arg;
+    int item, o, b0, nb;
+    size_t off;
+
+    for (item = start; item < end; item++) {
+        if (info->nblocks) {
+            o = item / info->nblocks;
+            b0 = item % info->nblocks * SOFTMAX_BLOCK;
+            nb = info->inner - b0 < SOFTMAX_BLOCK ? info->inner - b0 : SOFTMAX_BLOCK;
+            off = (size_t)o * info->dim * info->inner + b0;
+        } else {
+            off = (size_t)item * info->dim;
+        }
+
+        if (info->src->dtype == TL_FLOAT) {
+            const float *x = (const float *)info->src->data + off;
+            float *y = (float *)info->dst->data + off;
+            if (info->nblocks)
+                softmax_cols_float(x, y, info->dim, info->inner, nb, info->is_log);
+            else
+                softmax_row_float(x, y, info->dim, info->is_log);
+        } else {
+            const double *x = (const double *)info->src->data + off;
+            double *y = (double *)info->dst->data + off;
+            if (info->nblocks)
+                softmax_cols_double(x, y, info->dim, info->inner, nb, info->is_log);
+            else
+                softmax_row_double(x, y, info->dim, info->is_log);
+        }
+    }
+}
+
+TL_EXPORT tl_shape *tl_tensor_softmax_out_shape(const tl_tensor *src, int axis, tl_shape *shape)
+{
+    assert(src && shape);
+    assert(src->dtype == TL_FLOAT || src->dtype == TL_DOUBLE);
+    assert(axis >= 0 && axis < src->ndim);
+    tl_tensor_shape(src, shape);
+    return shape;
+}
+
+static tl_tensor *softmax(const tl_tensor *src, tl_tensor *dst, int axis, int is_log)
+{
+    struct softmax_info info;
+    tl_shape shape;
+    int i, outer, nitems, per_item;
+
+    assert(src && src->data);
+    tl_tensor_softmax_out_shape(src, axis, &shape);
+    dst = tl_tensor_dst(dst, &shape);
+
+    for (i = 0, outer = 1; i < axis; i++)
+        outer *= src->dims[i];
+    for (i = axis + 1, info.inner = 1; i < src->ndim; i++)
+        info.inner *= src->dims[i];
+    info.src = src;
+    info.dst = dst;
+    info.dim = src->dims[axis];
+    info.is_log = is_log;
+    if (info.inner == 1) {
+        info.nblocks = 0;
+        nitems = outer;
+        per_item = info.dim;
+    } else {
+        info.nblocks = (info.inner + SOFTMAX_BLOCK - 1) / SOFTMAX_BLOCK;
+        nitems = outer * info.nblocks;
+        per_item = info.dim * SOFTMAX_BLOCK;
+    }
+    tl_parallel_for(nitems, 4096 / per_item + 1, softmax_worker, &info);
+
+    return dst;
+}
+
+/* Softmax along axis, for TL_FLOAT and TL_DOUBLE. dst may be src. */
+TL_EXPORT tl_tensor *tl_tensor_softmax(const tl_tensor *src, tl_tensor *dst, int axis)
+{
+    TL_PROFILE_OP();
+
+    dst = softmax(src, dst, axis, 0);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
+
+TL_EXPORT tl_shape *tl_tensor_log_softmax_out_shape(const tl_tensor *src, int axis,
+                                                     tl_shape *shape)
+{
+    return tl_tensor_softmax_out_shape(src, axis, shape);
+}
+
+/* Log of the softmax along axis, computed as x - max - log(sum(exp(x - max))),
+   for TL_FLOAT and TL_DOUBLE. dst may be src. */
+TL_EXPORT tl_tensor *tl_tensor_log_softmax(const tl_tensor *src, tl_tensor *dst, int axis)
+{
+    TL_PROFILE_OP();
+
+    dst = softmax(src, dst, axis, 1);
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+    return dst;
+}
@@ -22,23 +22,47 @@
 
 #include "tl_tensor_internal.h"
 
-/* src: H*W*C, dst: C*H*W */
-TL_EXPORT tl_tensor *tl_tensor_submean(const tl_tensor *src, tl_tensor *dst, const double *mean)
+/* the shape of a NULL dst; a given dst may be of any dtype */
+TL_EXPORT tl_shape *tl_tensor_submean_out_shape(const tl_tensor *src, tl_shape *shape)
 {
-    assert(src && src->data);
-    assert(mean);
+    assert(src && shape);
     assert(src->ndim == 3);
     assert(src->dims[2] == 3);
-    int new_dims[] = { src->dims[2], src->dims[0], src->dims[1] };
+    shape->dtype = TL_FLOAT;
+    shape->ndim = 3;
+    shape->dims[0] = src->dims[2];
+    shape->dims[1] = src->dims[0];
+    shape->dims[2] = src->dims[1];
+    return shape;
+}
+
+/* src: H*W*C, dst: C*H*W. A TL_FLOAT dst of a TL_UINT8 or TL_FLOAT src is
+   computed in float by the preprocess kernels, the others in double. */
+TL_EXPORT tl_tensor *tl_tensor_submean(const tl_tensor *src, tl_tensor *dst, const double *mean)
+{
+    tl_shape shape;
     int c, i, H, W, C;
     double data;
 
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    assert(mean);
+    tl_tensor_submean_out_shape(src, &shape);
+
     if (dst) {
         assert(dst->data);
         assert(dst->ndim == src->ndim);
         assert(dst->dims[0] == 3);
     } else {
-        dst = tl_tensor_zeros(src->ndim, new_dims, TL_FLOAT);
+        dst = tl_tensor_zeros_shape(&shape);
+    }
+
+    if (dst->dtype == TL_FLOAT && (src->dtype == TL_UINT8 || src->dtype == TL_FLOAT)) {
+        assert(dst->dims[1] == src->dims[0] && dst->dims[2] == src->dims[1]);
+        tl_preprocess_images(&src, 1, dst, NULL, TL_NEAREST, mean, NULL, 1.0, 0);
+        TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
+        return dst;
     }
 
     H = src->dims[0];
@@ -52,5 +76,6 @@ TL_EXPORT tl_tensor *tl_tensor_submean(const tl_tensor *src, tl_tensor *dst, con
         }
     }
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
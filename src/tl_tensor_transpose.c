@@ -21,48 +21,236 @@
  */
 
 #include "tl_tensor_internal.h"
+#include "tl_kernel.h"
 
-TL_EXPORT tl_tensor *tl_tensor_transpose(const tl_tensor *src, tl_tensor *dst, const int *axes)
+/* tile of the in-place square transpose, swapped pairs of tiles stay in L1 */
+#define SQUARE_TILE 32
+
+/* Square matrices: swap each element above the diagonal with its mirror,
+   tile by tile. */
+#define SQUARE_TRANSPOSE(type)                                                                     \
+    static void square_transpose_##type(type *p, int nmat, int n)                                 \
+    {                                                                                              \
+        int m, bi, bj, i, j, ie, je;                                                               \
+        type t;                                                                                    \
+                                                                                                   \
+        for (m = 0; m < nmat; m++, p += (size_t)n * n) {                                           \
+            for (bi = 0; bi < n; bi += SQUARE_TILE) {                                              \
+                ie = bi + SQUARE_TILE < n ? bi + SQUARE_TILE : n;                                  \
+                for (bj = bi; bj < n; bj += SQUARE_TILE) {                                         \
+                    je = bj + SQUARE_TILE < n ? bj + SQUARE_TILE : n;                              \
+                    for (i = bi; i < ie; i++) {                                                    \
+                        for (j = bj > i + 1 ? bj : i + 1; j < je; j++) {                           \
+                            t = p[(size_t)i * n + j];                                              \
+                            p[(size_t)i * n + j] = p[(size_t)j * n + i];                           \
+                            p[(size_t)j * n + i] = t;                                              \
+                        }                                                                          \
+                    }                                                                              \
+                }                                                                                  \
+            }                                                                                      \
+        }                                                                                          \
+    }
+
+/* Any permutation: every dst position takes the element at its source
+   position, following each cycle of the permutation once from its first
+   position; visited marks the positions already written. */
+#define CYCLE_TRANSPOSE(type)                                                                      \
+    static void cycle_transpose_##type(type *p, int len, int ndim, const int *d_dims,             \
+                                       const int *strides, uint8_t *visited)                     \
+    {                                                                                              \
+        int start, cur, next, i, id;                                                               \
+        type t;                                                                                    \
+                                                                                                   \
+        for (start = 0; start < len; start++) {                                                    \
+            if (visited[start >> 3] & (1 << (start & 7)))                                          \
+                continue;                                                                          \
+            t = p[start];                                                                          \
+            for (cur = start;; cur = next) {                                                       \
+                visited[cur >> 3] |= 1 << (cur & 7);                                               \
+                for (i = ndim - 1, id = cur, next = 0; i >= 0; i--) {                              \
+                    next += id % d_dims[i] * strides[i];                                           \
+                    id /= d_dims[i];                                                               \
+                }                                                                                  \
+                if (next == start)                                                                 \
+                    break;                                                                         \
+                p[cur] = p[next];                                                                  \
+            }                                                                                      \
+            p[cur] = t;                                                                            \
+        }                                                                                          \
+    }
+
+SQUARE_TRANSPOSE(uint8_t)
+SQUARE_TRANSPOSE(uint16_t)
+SQUARE_TRANSPOSE(uint32_t)
+SQUARE_TRANSPOSE(uint64_t)
+CYCLE_TRANSPOSE(uint8_t)
+CYCLE_TRANSPOSE(uint16_t)
+CYCLE_TRANSPOSE(uint32_t)
+CYCLE_TRANSPOSE(uint64_t)
+
+/* Transposes t's data in place with O(len / 8) bytes of extra memory.
+   s_dims is the shape before the transpose. */
+static void transpose_inplace(tl_tensor *t, const int *s_dims, const int *axes)
+{
+    int ndim = t->ndim;
+    int s_strides[TL_MAXDIM], strides[TL_MAXDIM], d_dims[TL_MAXDIM];
+    int i, identity, square;
+    uint8_t *visited;
+
+    for (i = 0, identity = 1; i < ndim; i++)
+        identity &= axes[i] == i;
+    if (identity)
+        return;
+
+    /* swapping the last two axes of square matrices */
+    square = ndim >= 2 && axes[ndim - 2] == ndim - 1 && axes[ndim - 1] == ndim - 2 &&
+             s_dims[ndim - 2] == s_dims[ndim - 1];
+    for (i = 0; i < ndim - 2 && square; i++)
+        square = axes[i] == i;
+    if (square) {
+        int n = s_dims[ndim - 1];
+        int nmat = t->len / (n * n);
+
+        switch (tl_size_of(t->dtype)) {
+        case 1:
+            square_transpose_uint8_t(t->data, nmat, n);
+            break;
+        case 2:
+            square_transpose_uint16_t(t->data, nmat, n);
+            break;
+        case 4:
+            square_transpose_uint32_t(t->data, nmat, n);
+            break;
+        case 8:
+            square_transpose_uint64_t(t->data, nmat, n);
+            break;
+        default:
+            assert(0 && "unsupported element size");
+            break;
+        }
+        return;
+    }
+
+    s_strides[ndim - 1] = 1;
+    for (i = ndim - 2; i >= 0; i--)
+        s_strides[i] = s_strides[i + 1] * s_dims[i + 1];
+    for (i = 0; i < ndim; i++) {
+        strides[i] = s_strides[axes[i]];
+        d_dims[i] = s_dims[axes[i]];
+    }
+    visited = tl_alloc((t->len + 7) / 8);
+    memset(visited, 0, (t->len + 7) / 8);
+    switch (tl_size_of(t->dtype)) {
+    case 1:
+        cycle_transpose_uint8_t(t->data, t->len, ndim, d_dims, strides, visited);
+        break;
+    case 2:
+        cycle_transpose_uint16_t(t->data, t->len, ndim, d_dims, strides, visited);
+        break;
+    case 4:
+        cycle_transpose_uint32_t(t->data, t->len, ndim, d_dims, strides, visited);
+        break;
+    case 8:
+        cycle_transpose_uint64_t(t->data, t->len, ndim, d_dims, strides, visited);
+        break;
+    default:
+        assert(0 && "unsupported element size");
+        break;
+    }
+    tl_free(visited);
+}
+
+TL_EXPORT tl_shape *tl_tensor_transpose_out_shape(const tl_tensor *src, const int *axes,
+                                                  tl_shape *shape)
 {
     int i;
 
+    assert(src && axes && shape);
 #ifndef NDEBUG
     int tmp[TL_MAXDIM] = { 0 };
     for (i = 0; i < src->ndim; i++)
         tmp[axes[i]] = 1;
     for (i = 0; i < src->ndim; i++)
         assert(tmp[i] && "axes don't match src tensor's shape");
-    assert(src && src->data);
 #endif
+    shape->dtype = src->dtype;
+    shape->ndim = src->ndim;
+    for (i = 0; i < src->ndim; i++)
+        shape->dims[i] = src->dims[axes[i]];
+    return shape;
+}
+
+/* dst may be src, or share src's data, to transpose in place; dst == src
+   gets the transposed shape. */
+TL_EXPORT tl_tensor *tl_tensor_transpose(const tl_tensor *src, tl_tensor *dst, const int *axes)
+{
+    tl_shape shape;
+    int i;
+
+    TL_PROFILE_OP();
+
+    assert(src && src->data);
+    tl_tensor_transpose_out_shape(src, axes, &shape);
+    if (dst == src) {
+        int s_dims[TL_MAXDIM];
+
+        memmove(s_dims, src->dims, sizeof(int) * src->ndim);
+        transpose_inplace(dst, s_dims, axes);
+        for (i = 0; i < dst->ndim; i++)
+            dst->dims[i] = s_dims[axes[i]];
+        TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+        return dst;
+    }
     if (dst) {
 #ifndef NDEBUG
         assert(dst->data);
-        assert(src->dtype == dst->dtype);
-        assert(src->len == dst->len);
-        assert(src->ndim == dst->ndim);
+        assert(shape.dtype == dst->dtype);
+        assert(shape.ndim == dst->ndim);
         for (i = 0; i < dst->ndim; i++)
-            assert(src->dims[axes[i]] == dst->dims[i]);
+            assert(shape.dims[i] == dst->dims[i]);
 #endif
+        tl_check_alias(src, dst);
+        if (dst->data == src->data) {
+            transpose_inplace(dst, src->dims, axes);
+            TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(dst), TL_PROFILE_TENSOR_BYTES(dst));
+            return dst;
+        }
     } else {
-        int d_dims[TL_MAXDIM];
-        for (i = 0; i < src->ndim; i++)
-            d_dims[i] = src->dims[axes[i]];
-        dst = tl_tensor_zeros(src->ndim, d_dims, src->dtype);
+        dst = tl_tensor_zeros_shape(&shape);
     }
 
-    int di, si;
-    int s_ids[TL_MAXDIM], d_ids[TL_MAXDIM];
-    size_t dsize = tl_size_of(src->dtype);
+    /* the last two axes of dst are copied as a 2D strided block, the
+       others are walked with an odometer */
     int ndim = dst->ndim;
+    int s_strides[TL_MAXDIM], strides[TL_MAXDIM] = { 0 }, ids[TL_MAXDIM] = { 0 };
+    int rows, cols, nblocks, b;
+    ptrdiff_t rs, cs, si;
+    size_t dsize = tl_size_of(src->dtype);
+    const struct tl_kernels *k = tl_get_kernels();
 
-    for (di = 0; di < dst->len; di++) {
-        tl_get_coords(di, d_ids, ndim, dst->dims);
-        for (i = 0; i < ndim; i++)
-            s_ids[axes[i]] = d_ids[i];
-        si = tl_get_index(s_ids, ndim, src->dims);
+    s_strides[ndim - 1] = 1;
+    for (i = ndim - 2; i >= 0; i--)
+        s_strides[i] = s_strides[i + 1] * src->dims[i + 1];
+    for (i = 0; i < ndim; i++)
+        strides[i] = s_strides[axes[i]];
 
-        tl_passign(dst->data, di, src->data, si, dsize);
+    cols = dst->dims[ndim - 1];
+    cs = strides[ndim - 1];
+    rows = ndim > 1 ? dst->dims[ndim - 2] : 1;
+    rs = ndim > 1 ? strides[ndim - 2] : 0;
+    nblocks = dst->len / (rows * cols);
+    for (b = 0, si = 0; b < nblocks; b++) {
+        k->transpose2d[tl_size_index(dsize)](tl_padd(dst->data, (ptrdiff_t)b * rows * cols, dsize),
+                                             tl_padd(src->data, si, dsize), rows, cols, rs, cs);
+        for (i = ndim - 3; i >= 0; i--) {
+            si += strides[i];
+            if (++ids[i] < dst->dims[i])
+                break;
+            si -= (ptrdiff_t)strides[i] * dst->dims[i];
+            ids[i] = 0;
+        }
     }
 
+    TL_PROFILE_IO(TL_PROFILE_TENSOR_BYTES(src), TL_PROFILE_TENSOR_BYTES(dst));
     return dst;
 }
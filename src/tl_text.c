@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <math.h>
+#include <float.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tl_util.h"
+#include "tl_type.h"
+#include "tl_type_generic.h"
+#include "tl_text.h"
+
+#define TEXT_BUF_SIZE (1 << 16)
+
+enum { TEXT_FIXED, TEXT_INT, TEXT_PRINTF };
+
+static const double pow10_double[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                       1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                       1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+void tl_text_writer_init(struct tl_text_writer *w, FILE *fp)
+{
+    w->fp = fp;
+    w->cap = TEXT_BUF_SIZE;
+    w->buf = tl_alloc(w->cap);
+    w->len = 0;
+    w->error = 0;
+}
+
+void tl_text_flush(struct tl_text_writer *w)
+{
+    if (w->len && fwrite(w->buf, 1, w->len, w->fp) != w->len)
+        w->error = 1;
+    w->len = 0;
+}
+
+int tl_text_writer_finish(struct tl_text_writer *w)
+{
+    tl_text_flush(w);
+    tl_free(w->buf);
+    return w->error ? -1 : 0;
+}
+
+void tl_text_write(struct tl_text_writer *w, const char *s, size_t n)
+{
+    if (n > w->cap - w->len)
+        tl_text_flush(w);
+    if (n > w->cap) {
+        if (fwrite(s, 1, n, w->fp) != n)
+            w->error = 1;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+void tl_text_repeat(struct tl_text_writer *w, char c, size_t n)
+{
+    size_t m;
+
+    for (; n > 0; n -= m) {
+        if (w->len == w->cap)
+            tl_text_flush(w);
+        m = n < w->cap - w->len ? n : w->cap - w->len;
+        memset(w->buf + w->len, c, m);
+        w->len += m;
+    }
+}
+
+/* the decimal digits of v at d, returning their count */
+static size_t format_u64(char *d, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+
+    do {
+        tmp[sizeof(tmp) - ++n] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    memcpy(d, tmp + sizeof(tmp) - n, n);
+    return n;
+}
+
+/* printf("%.<prec>f", x) for the values where it can be done exactly in
+   double: |x| * 10^prec below 1e9 leaves an error far below 1e-6 in the
+   scaled value, so rounding it gives printf's digits unless it is that
+   close to a tie. Returns 0 for the other values. */
+static size_t format_fixed(char *d, double x, int prec)
+{
+    double s = fabs(x) * pow10_double[prec];
+    uint64_t q, scale;
+    size_t n = 0;
+    int i;
+
+    if (!(s < 1e9) || fabs(s - floor(s) - 0.5) < 1e-6)
+        return 0;
+    q = (uint64_t)(s + 0.5);
+    scale = (uint64_t)pow10_double[prec];
+    if (signbit(x))
+        d[n++] = '-';
+    n += format_u64(d + n, q / scale);
+    if (prec > 0) {
+        d[n++] = '.';
+        for (i = prec - 1, q %= scale; i >= 0; i--, q /= 10)
+            d[n + i] = '0' + q % 10;
+        n += prec;
+    }
+    return n;
+}
+
+void tl_text_format_init(struct tl_text_format *f, tl_dtype dtype, const char *fmt)
+{
+    const char *dfmt = tl_dtype_fmt(dtype);
+
+    f->dtype = dtype;
+    f->fmt = fmt ? fmt : dfmt;
+    f->prec = 0;
+    if (dtype == TL_DOUBLE || dtype == TL_FLOAT || dtype == TL_FLOAT16 || dtype == TL_BFLOAT16) {
+        /* "%.<digit>f" */
+        if (f->fmt[0] == '%' && f->fmt[1] == '.' && f->fmt[2] >= '0' && f->fmt[2] <= '9' &&
+            f->fmt[3] == 'f' && f->fmt[4] == '\0') {
+            f->mode = TEXT_FIXED;
+            f->prec = f->fmt[2] - '0';
+            return;
+        }
+    } else if (!strcmp(f->fmt, dfmt)) {
+        /* the defaults print integer dtypes with their own signedness */
+        f->mode = TEXT_INT;
+        return;
+    }
+    f->mode = TEXT_PRINTF;
+}
+
+static double load_double(const void *p, tl_dtype dtype)
+{
+    switch (dtype) {
+    case TL_DOUBLE:
+        return *(const double *)p;
+    case TL_FLOAT:
+        return *(const float *)p;
+    case TL_FLOAT16:
+        return tl_f16_to_f32(*(const uint16_t *)p);
+    case TL_BFLOAT16:
+        return tl_bf16_to_f32(*(const uint16_t *)p);
+    default:
+        assert(0 && "not a floating point dtype");
+        return 0;
+    }
+}
+
+static size_t format_int(char *d, const void *p, tl_dtype dtype)
+{
+    int64_t v;
+
+    switch (dtype) {
+    case TL_UINT64:
+        return format_u64(d, *(const uint64_t *)p);
+    case TL_UINT32:
+        return format_u64(d, *(const uint32_t *)p);
+    case TL_UINT16:
+        return format_u64(d, *(const uint16_t *)p);
+    case TL_UINT8:
+        return format_u64(d, *(const uint8_t *)p);
+    case TL_BOOL:
+        return format_u64(d, *(const tl_bool_t *)p);
+    case TL_INT64:
+        v = *(const int64_t *)p;
+        break;
+    case TL_INT32:
+        v = *(const int32_t *)p;
+        break;
+    case TL_INT16:
+        v = *(const int16_t *)p;
+        break;
+    case TL_INT8:
+        v = *(const int8_t *)p;
+        break;
+    default:
+        assert(0 && "not an integer dtype");
+        return 0;
+    }
+    if (v >= 0)
+        return format_u64(d, (uint64_t)v);
+    *d = '-';
+    return format_u64(d + 1, (uint64_t)-(v + 1) + 1) + 1;
+}
+
+static int format_printf(char *d, size_t cap, const char *fmt, const void *p, tl_dtype dtype)
+{
+#define PRINTF_CASE(dtype, type, name, kind, lo, hi)                                               \
+    case dtype:                                                                                    \
+        return snprintf(d, cap, fmt, *(const type *)p);
+
+    switch (dtype) {
+        TL_FOREACH_DTYPE(PRINTF_CASE)
+    case TL_FLOAT16:
+    case TL_BFLOAT16:
+        return snprintf(d, cap, fmt, load_double(p, dtype));
+    default:
+        assert(0 && "unsupported tl_dtype");
+        return 0;
+    }
+#undef PRINTF_CASE
+}
+
+void tl_text_write_elem(struct tl_text_writer *w, const struct tl_text_format *f, const void *p)
+{
+    size_t n = 0;
+    char *big;
+    int m;
+
+    if (w->cap - w->len < TL_TEXT_TOKEN_MAX)
+        tl_text_flush(w);
+    if (f->mode == TEXT_FIXED)
+        n = format_fixed(w->buf + w->len, load_double(p, f->dtype), f->prec);
+    else if (f->mode == TEXT_INT)
+        n = format_int(w->buf + w->len, p, f->dtype);
+    if (n) {
+        w->len += n;
+        return;
+    }
+
+    m = format_printf(w->buf + w->len, w->cap - w->len, f->fmt, p, f->dtype);
+    if (m < 0) {
+        w->error = 1;
+        return;
+    }
+    if ((size_t)m < w->cap - w->len) {
+        w->len += m;
+        return;
+    }
+    /* longer than the buffer left */
+    big = tl_alloc(m + 1);
+    format_printf(big, m + 1, f->fmt, p, f->dtype);
+    tl_text_write(w, big, m);
+    tl_free(big);
+}
+
+void tl_text_reader_init(struct tl_text_reader *r, FILE *fp)
+{
+    r->fp = fp;
+    r->cap = TEXT_BUF_SIZE;
+    r->buf = tl_alloc(r->cap);
+    r->pos = 0;
+    r->len = 0;
+    r->eof = 0;
+}
+
+void tl_text_reader_free(struct tl_text_reader *r)
+{
+    tl_free(r->buf);
+}
+
+/* make at least need bytes available after pos, unless the input ends */
+static void reader_fill(struct tl_text_reader *r, size_t need)
+{
+    size_t n;
+
+    if (r->len - r->pos >= need || r->eof)
+        return;
+    memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+    while (r->len < need && !r->eof) {
+        n = fread(r->buf + r->len, 1, r->cap - r->len, r->fp);
+        if (n == 0)
+            r->eof = 1;
+        r->len += n;
+    }
+}
+
+int tl_text_peek(struct tl_text_reader *r)
+{
+    if (r->pos == r->len)
+        reader_fill(r, 1);
+    return r->pos < r->len ? (unsigned char)r->buf[r->pos] : -1;
+}
+
+static int match_word(const char *p, const char *end, const char *word)
+{
+    for (; *word; p++, word++)
+        if (p >= end || (*p | 0x20) != *word)
+            return 0;
+    return 1;
+}
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* Parse the number at [s, end) into *v and return where it stops, or NULL.
+   Up to 19 significant digits are collected in an integer; when there are
+   at most 2^53 of them and the power of ten is exact in double as well, one
+   multiplication or division rounds correctly. Only the rest goes to strtod. */
+static const char *parse_number(const char *s, const char *end, double *v)
+{
+    const char *p = s, *q;
+    uint64_t mant = 0;
+    long exp10 = 0, e;
+    int neg = 0, nd = 0, dropped = 0, any = 0, eneg;
+    char tmp[TL_TEXT_TOKEN_MAX + 1];
+
+    if (p < end && (*p == '+' || *p == '-'))
+        neg = *p++ == '-';
+    if (match_word(p, end, "nan")) {
+        *v = neg ? -NAN : NAN;
+        return p + 3;
+    }
+    if (match_word(p, end, "inf")) {
+        *v = neg ? -INFINITY : INFINITY;
+        return match_word(p + 3, end, "inity") ? p + 8 : p + 3;
+    }
+
+    for (; p < end && is_digit(*p); p++, any = 1) {
+        if (nd < 19) {
+            mant = mant * 10 + (*p - '0');
+            nd += mant != 0;
+        } else {
+            exp10++;
+            dropped |= *p != '0';
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && is_digit(*p); p++, any = 1) {
+            if (nd < 19) {
+                mant = mant * 10 + (*p - '0');
+                nd += mant != 0;
+                exp10--;
+            } else {
+                dropped |= *p != '0';
+            }
+        }
+    }
+    if (!any)
+        return NULL;
+    if (p < end && (*p | 0x20) == 'e') {
+        q = p + 1;
+        eneg = 0;
+        if (q < end && (*q == '+' || *q == '-'))
+            eneg = *q++ == '-';
+        if (q < end && is_digit(*q)) {
+            for (e = 0; q < end && is_digit(*q); q++)
+                if (e < 100000)
+                    e = e * 10 + (*q - '0');
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (mant == 0)
+        *v = 0;
+    else if (!dropped && mant <= (UINT64_C(1) << 53) && exp10 >= -22 && exp10 <= 22)
+        *v = exp10 < 0 ? (double)mant / pow10_double[-exp10] : (double)mant * pow10_double[exp10];
+    else {
+        assert(p - s <= TL_TEXT_TOKEN_MAX);
+        memcpy(tmp, s, p - s);
+        tmp[p - s] = '\0';
+        *v = fabs(strtod(tmp, NULL));
+    }
+    if (neg)
+        *v = -*v;
+    return p;
+}
+
+int tl_text_read_number(struct tl_text_reader *r, double *v)
+{
+    const char *end;
+
+    reader_fill(r, TL_TEXT_TOKEN_MAX);
+    end = r->buf + (r->len - r->pos < TL_TEXT_TOKEN_MAX ? r->len : r->pos + TL_TEXT_TOKEN_MAX);
+    end = parse_number(r->buf + r->pos, end, v);
+    if (!end)
+        return 0;
+    r->pos = end - r->buf;
+    return 1;
+}
+
+int tl_text_read_integer(struct tl_text_reader *r, int is_unsigned, void *v)
+{
+    char tmp[32], *stop;
+    const char *p, *end;
+    size_t n = 0;
+
+    reader_fill(r, sizeof(tmp));
+    p = r->buf + r->pos;
+    end = r->buf + r->len;
+    if (p < end && (*p == '+' || *p == '-'))
+        tmp[n++] = *p++;
+    while (p < end && is_digit(*p) && n < sizeof(tmp) - 1)
+        tmp[n++] = *p++;
+    tmp[n] = '\0';
+    if (!is_digit(tmp[n - (n > 0)]) || (is_unsigned && tmp[0] == '-'))
+        return 0;
+    if (p < end && (is_digit(*p) || *p == '.' || (*p | 0x20) == 'e'))
+        return 0;
+
+    errno = 0;
+    if (is_unsigned)
+        *(uint64_t *)v = strtoull(tmp, &stop, 10);
+    else
+        *(int64_t *)v = strtoll(tmp, &stop, 10);
+    if (errno == ERANGE)
+        return 0;
+    r->pos += stop - tmp;
+    return 1;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_TEXT_H_
+#define _TL_TEXT_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "tl_type.h"
+
+/* Text I/O helpers shared by the tensor printer and the parsers. Output is
+   collected in a large buffer and handed to the FILE in few big fwrite
+   calls; elements are formatted without printf when the format allows it.
+   Input is read in big blocks and numbers are parsed in place. */
+
+/* the longest number the reader parses in one piece */
+#define TL_TEXT_TOKEN_MAX 512
+
+struct tl_text_writer {
+    FILE *fp;
+    char *buf;
+    size_t len, cap;
+    int error;
+};
+
+/* How elements of one dtype are formatted: fmt is a printf format for a
+   single element, or NULL for tl_dtype_fmt(dtype). */
+struct tl_text_format {
+    tl_dtype dtype;
+    const char *fmt;
+    int mode; /* TEXT_FIXED, TEXT_INT or TEXT_PRINTF in tl_text.c */
+    int prec;
+};
+
+struct tl_text_reader {
+    FILE *fp;
+    char *buf;
+    size_t pos, len, cap;
+    int eof;
+};
+
+#ifdef __cplusplus
+TL_CPPSTART
+#endif
+
+void tl_text_writer_init(struct tl_text_writer *w, FILE *fp);
+/* flush and free w; returns 0, or -1 if a write failed */
+int tl_text_writer_finish(struct tl_text_writer *w);
+void tl_text_flush(struct tl_text_writer *w);
+void tl_text_write(struct tl_text_writer *w, const char *s, size_t n);
+void tl_text_repeat(struct tl_text_writer *w, char c, size_t n);
+
+void tl_text_format_init(struct tl_text_format *f, tl_dtype dtype, const char *fmt);
+void tl_text_write_elem(struct tl_text_writer *w, const struct tl_text_format *f, const void *p);
+
+void tl_text_reader_init(struct tl_text_reader *r, FILE *fp);
+void tl_text_reader_free(struct tl_text_reader *r);
+/* the next byte without consuming it, or -1 at the end of the input */
+int tl_text_peek(struct tl_text_reader *r);
+/* Parse a number at the current position, like strtod without locale or hex
+   floats: [+-](digits[.digits]|.digits)[(e|E)[+-]digits], nan or inf.
+   Returns 1 and consumes it, or returns 0 and consumes nothing. */
+int tl_text_read_number(struct tl_text_reader *r, double *v);
+/* Parse a plain [+-]digits integer at the current position into *v, an
+   int64_t or, if is_unsigned, a uint64_t, exactly over the whole range.
+   Returns 0 and consumes nothing if the number has a fraction or exponent,
+   doesn't fit or isn't an integer at all; tl_text_read_number() reads those. */
+int tl_text_read_integer(struct tl_text_reader *r, int is_unsigned, void *v);
+
+#ifdef __cplusplus
+TL_CPPEND
+#endif
+
+static inline void tl_text_putc(struct tl_text_writer *w, char c)
+{
+    if (w->len == w->cap)
+        tl_text_flush(w);
+    w->buf[w->len++] = c;
+}
+
+static inline void tl_text_advance(struct tl_text_reader *r)
+{
+    r->pos++;
+}
+
+#endif /* _TL_TEXT_H_ */
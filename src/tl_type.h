@@ -34,6 +34,12 @@
 enum tl_bool_t { TL_FALSE = 0, TL_TRUE = 1 };
 typedef enum tl_bool_t tl_bool_t;
 
+/* IEEE 754 binary16 and bfloat16 (the upper half of a binary32) are storage
+   only: their bits are kept in a uint16_t, and arithmetic on them is done in
+   float. */
+typedef uint16_t tl_float16_t;
+typedef uint16_t tl_bfloat16_t;
+
 /* keep the size and the enum order in sync with tl_type.c */
 enum tl_dtype {
     TL_DTYPE_INVALID = -1,
@@ -48,6 +54,8 @@ enum tl_dtype {
     TL_UINT16,
     TL_UINT8,
     TL_BOOL,
+    TL_FLOAT16,
+    TL_BFLOAT16,
     TL_DTYPE_SIZE
 };
 typedef enum tl_dtype tl_dtype;
@@ -83,6 +91,54 @@ enum tl_sort_dir {
     TL_SORT_DIR_SIZE
 };
 typedef enum tl_sort_dir tl_sort_dir;
+
+enum tl_norm_type {
+    TL_NORM_TYPE_INVALID = -1,
+    TL_NORM_L1 = 0,
+    TL_NORM_L2,
+    TL_NORM_LINF,
+    TL_NORM_TYPE_SIZE
+};
+typedef enum tl_norm_type tl_norm_type;
+
+enum tl_layout {
+    TL_LAYOUT_INVALID = -1,
+    TL_NCHW = 0,
+    TL_NHWC,
+    TL_LAYOUT_SIZE
+};
+typedef enum tl_layout tl_layout;
+
+enum tl_pad_mode {
+    TL_PAD_MODE_INVALID = -1,
+    TL_PAD_CONSTANT = 0,
+    TL_PAD_REFLECT,
+    TL_PAD_EDGE,
+    TL_PAD_MODE_SIZE
+};
+typedef enum tl_pad_mode tl_pad_mode;
+
+/* filters applied before compression; keep in sync with tl_type.c */
+enum tl_shuffle {
+    TL_SHUFFLE_INVALID = -1,
+    TL_SHUFFLE_NONE = 0,
+    TL_SHUFFLE_BYTE,
+    TL_SHUFFLE_BIT,
+    TL_SHUFFLE_SIZE
+};
+typedef enum tl_shuffle tl_shuffle;
+
+/* instruction sets the element-wise kernels are compiled for */
+enum tl_cpu_level {
+    TL_CPU_LEVEL_INVALID = -1,
+    TL_CPU_GENERIC = 0,
+    TL_CPU_SSE2,
+    TL_CPU_AVX2,
+    TL_CPU_AVX512,
+    TL_CPU_NEON,
+    TL_CPU_LEVEL_SIZE
+};
+typedef enum tl_cpu_level tl_cpu_level;
 /* clang-format on */
 
 #define tl_check_resize_type(rtype) assert(rtype >= 0 && rtype < TL_RESIZE_TYPE_SIZE)
@@ -97,6 +153,16 @@ typedef void (*tl_elew_func)(void *p1, void *p2, void *r, tl_elew_op elew_op);
 
 #define tl_check_sort_dir(dir) assert(dir >= 0 && dir < TL_SORT_DIR_SIZE)
 
+#define tl_check_norm_type(ord) assert(ord >= 0 && ord < TL_NORM_TYPE_SIZE)
+
+#define tl_check_layout(layout) assert(layout >= 0 && layout < TL_LAYOUT_SIZE)
+
+#define tl_check_pad_mode(mode) assert(mode >= 0 && mode < TL_PAD_MODE_SIZE)
+
+#define tl_check_shuffle(shuffle) assert(shuffle >= 0 && shuffle < TL_SHUFFLE_SIZE)
+
+#define tl_check_cpu_level(level) assert(level >= 0 && level < TL_CPU_LEVEL_SIZE)
+
 #ifdef __cplusplus
 TL_CPPSTART
 #endif
@@ -134,6 +200,10 @@ double tl_dtype_max_double(tl_dtype dtype);
 double tl_dtype_min_double(tl_dtype dtype);
 void tl_lrelu(void *pd, const void *ps, float negslope, tl_dtype dtype);
 void tl_convert(void *pd, tl_dtype dtype_d, const void *ps, tl_dtype dtype_s);
+float tl_float16_to_float(tl_float16_t h);
+tl_float16_t tl_float_to_float16(float f);
+float tl_bfloat16_to_float(tl_bfloat16_t h);
+tl_bfloat16_t tl_float_to_bfloat16(float f);
 
 int tl_fprintf(FILE *fp, const char *fmt, void *p, tl_dtype dtype);
 tl_fprintf_func tl_fprintf_getfunc(tl_dtype dtype);
@@ -150,6 +220,24 @@ tl_resize_type tl_resize_type_from_str(const char *str);
 const char *tl_sort_dir_name(tl_sort_dir dir);
 tl_sort_dir tl_sort_dir_from_str(const char *str);
 
+const char *tl_norm_type_name(tl_norm_type ord);
+tl_norm_type tl_norm_type_from_str(const char *str);
+
+const char *tl_layout_name(tl_layout layout);
+tl_layout tl_layout_from_str(const char *str);
+
+const char *tl_pad_mode_name(tl_pad_mode mode);
+tl_pad_mode tl_pad_mode_from_str(const char *str);
+
+const char *tl_shuffle_name(tl_shuffle shuffle);
+tl_shuffle tl_shuffle_from_str(const char *str);
+
+const char *tl_cpu_level_name(tl_cpu_level level);
+tl_cpu_level tl_cpu_level_from_str(const char *str);
+int tl_cpu_level_supported(tl_cpu_level level);
+void tl_set_cpu_level(tl_cpu_level level);
+tl_cpu_level tl_get_cpu_level(void);
+
 static inline ptrdiff_t tl_pointer_sub(void *p1, void *p2, tl_dtype dtype)
 {
     return tl_psub((p1), (p2), tl_size_of(dtype));
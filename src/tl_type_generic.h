@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TL_TYPE_GENERIC_H_
+#define _TL_TYPE_GENERIC_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "tl_type.h"
+
+/* Type-generic kernels. A kernel is written once as a macro taking the
+   arguments below and instantiated for every dtype with TL_FOREACH_DTYPE,
+   which yields one monomorphic function per dtype. Callers pick the
+   function from a table indexed by tl_dtype once, outside the element loop.
+
+   X(DTYPE, TYPE, NAME, KIND, MIN, MAX)
+     DTYPE   tl_dtype enum value
+     TYPE    C element type
+     NAME    suffix for generated identifiers
+     KIND    F (floating point), S (signed), U (unsigned) or B (bool)
+     MIN/MAX value range of TYPE */
+#define TL_FOREACH_DTYPE(X)                                                                        \
+    X(TL_DOUBLE, double, double, F, -DBL_MAX, DBL_MAX)                                             \
+    X(TL_FLOAT, float, float, F, -FLT_MAX, FLT_MAX)                                                \
+    X(TL_INT64, int64_t, int64, S, INT64_MIN, INT64_MAX)                                           \
+    X(TL_INT32, int32_t, int32, S, INT32_MIN, INT32_MAX)                                           \
+    X(TL_INT16, int16_t, int16, S, INT16_MIN, INT16_MAX)                                           \
+    X(TL_INT8, int8_t, int8, S, INT8_MIN, INT8_MAX)                                                \
+    X(TL_UINT64, uint64_t, uint64, U, 0, UINT64_MAX)                                               \
+    X(TL_UINT32, uint32_t, uint32, U, 0, UINT32_MAX)                                               \
+    X(TL_UINT16, uint16_t, uint16, U, 0, UINT16_MAX)                                               \
+    X(TL_UINT8, uint8_t, uint8, U, 0, UINT8_MAX)                                                   \
+    X(TL_BOOL, tl_bool_t, bool, B, TL_FALSE, TL_TRUE)
+
+/* X(DTYPE_D, TYPE_D, NAME_D, KIND_D, MIN_D, MAX_D,
+     DTYPE_S, TYPE_S, NAME_S, KIND_S, MIN_S, MAX_S) for every pair of dtypes.
+   The preprocessor can't expand TL_FOREACH_DTYPE inside itself, so the
+   inner list is a copy which must be kept in sync with the one above. */
+#define TL_FOREACH_DTYPE_PAIR(X)                                                                   \
+    TL_FOREACH_DTYPE_SRC_(X, TL_DOUBLE, double, double, F, -DBL_MAX, DBL_MAX)                      \
+    TL_FOREACH_DTYPE_SRC_(X, TL_FLOAT, float, float, F, -FLT_MAX, FLT_MAX)                         \
+    TL_FOREACH_DTYPE_SRC_(X, TL_INT64, int64_t, int64, S, INT64_MIN, INT64_MAX)                    \
+    TL_FOREACH_DTYPE_SRC_(X, TL_INT32, int32_t, int32, S, INT32_MIN, INT32_MAX)                    \
+    TL_FOREACH_DTYPE_SRC_(X, TL_INT16, int16_t, int16, S, INT16_MIN, INT16_MAX)                    \
+    TL_FOREACH_DTYPE_SRC_(X, TL_INT8, int8_t, int8, S, INT8_MIN, INT8_MAX)                         \
+    TL_FOREACH_DTYPE_SRC_(X, TL_UINT64, uint64_t, uint64, U, 0, UINT64_MAX)                        \
+    TL_FOREACH_DTYPE_SRC_(X, TL_UINT32, uint32_t, uint32, U, 0, UINT32_MAX)                        \
+    TL_FOREACH_DTYPE_SRC_(X, TL_UINT16, uint16_t, uint16, U, 0, UINT16_MAX)                        \
+    TL_FOREACH_DTYPE_SRC_(X, TL_UINT8, uint8_t, uint8, U, 0, UINT8_MAX)                            \
+    TL_FOREACH_DTYPE_SRC_(X, TL_BOOL, tl_bool_t, bool, B, TL_FALSE, TL_TRUE)
+
+#define TL_FOREACH_DTYPE_SRC_(X, ...)                                                              \
+    X(__VA_ARGS__, TL_DOUBLE, double, double, F, -DBL_MAX, DBL_MAX)                                \
+    X(__VA_ARGS__, TL_FLOAT, float, float, F, -FLT_MAX, FLT_MAX)                                   \
+    X(__VA_ARGS__, TL_INT64, int64_t, int64, S, INT64_MIN, INT64_MAX)                              \
+    X(__VA_ARGS__, TL_INT32, int32_t, int32, S, INT32_MIN, INT32_MAX)                              \
+    X(__VA_ARGS__, TL_INT16, int16_t, int16, S, INT16_MIN, INT16_MAX)                              \
+    X(__VA_ARGS__, TL_INT8, int8_t, int8, S, INT8_MIN, INT8_MAX)                                   \
+    X(__VA_ARGS__, TL_UINT64, uint64_t, uint64, U, 0, UINT64_MAX)                                  \
+    X(__VA_ARGS__, TL_UINT32, uint32_t, uint32, U, 0, UINT32_MAX)                                  \
+    X(__VA_ARGS__, TL_UINT16, uint16_t, uint16, U, 0, UINT16_MAX)                                  \
+    X(__VA_ARGS__, TL_UINT8, uint8_t, uint8, U, 0, UINT8_MAX)                                      \
+    X(__VA_ARGS__, TL_BOOL, tl_bool_t, bool, B, TL_FALSE, TL_TRUE)
+
+/* X(DTYPE, TYPE, NAME, MIN, MAX) for the 16-bit floating point dtypes.
+   They have no C arithmetic type, so they are kept out of the lists above:
+   kernels convert them to float with the functions below, compute in float
+   and convert back. MIN/MAX are the bit patterns of the range limits. */
+#define TL_FOREACH_HALF_DTYPE(X)                                                                   \
+    X(TL_FLOAT16, tl_float16_t, float16, 0xFBFF, 0x7BFF)                                           \
+    X(TL_BFLOAT16, tl_bfloat16_t, bfloat16, 0xFF7F, 0x7F7F)
+
+/* X(DTYPE, TYPE, NAME, MIN, MAX) for the dtypes that affine quantized
+   tensors are stored in (see struct tl_quant) */
+#define TL_FOREACH_QUANT_DTYPE(X)                                                                  \
+    X(TL_INT8, int8_t, int8, INT8_MIN, INT8_MAX)                                                   \
+    X(TL_UINT8, uint8_t, uint8, 0, UINT8_MAX)
+
+#define TL_FLOAT16_MAX 65504.0f
+#define TL_BFLOAT16_MAX 3.38953139e38f
+
+static inline float tl_f16_to_f32(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF, bits;
+    float f;
+
+    if (exp == 0x1F) {
+        /* NaNs come out quiet, as from F16C */
+        bits = sign | 0x7F800000 | (mant ? 0x400000 : 0) | mant << 13;
+    } else if (exp) {
+        bits = sign | (exp + 112) << 23 | mant << 13;
+    } else {
+        /* subnormal: mant * 2^-24, exact in float */
+        f = (float)mant * 5.9604644775390625e-8f;
+        return sign ? -f : f;
+    }
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* Rounds to nearest even and saturates to +-TL_FLOAT16_MAX like the other
+   conversions; NaNs are quieted with the payload truncated, as F16C does. */
+static inline uint16_t tl_f32_to_f16(float f)
+{
+    uint32_t bits, abs, sign;
+    float t;
+
+    memcpy(&bits, &f, sizeof(bits));
+    sign = (bits >> 16) & 0x8000;
+    abs = bits & 0x7FFFFFFF;
+    if (abs > 0x7F800000)
+        return sign | 0x7E00 | ((abs >> 13) & 0x3FF);
+    if (abs >= 0x477FE000)
+        return sign | 0x7BFF;
+    if (abs >= 0x38800000) {
+        abs -= 112 << 23;
+        abs += 0xFFF + ((abs >> 13) & 1);
+        return sign | abs >> 13;
+    }
+    /* below 2^-14: adding 0.5 leaves the value in units of 2^-24 in the low
+       mantissa bits, rounded to nearest even by the FPU */
+    memcpy(&t, &abs, sizeof(t));
+    t += 0.5f;
+    memcpy(&bits, &t, sizeof(bits));
+    return sign | (bits - 0x3F000000);
+}
+
+static inline float tl_bf16_to_f32(uint16_t h)
+{
+    uint32_t bits = (uint32_t)h << 16;
+    float f;
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* rounds to nearest even and saturates to +-TL_BFLOAT16_MAX */
+static inline uint16_t tl_f32_to_bf16(float f)
+{
+    uint32_t bits, abs;
+
+    memcpy(&bits, &f, sizeof(bits));
+    abs = bits & 0x7FFFFFFF;
+    if (abs > 0x7F800000)
+        return (bits >> 16) | 0x40;
+    if (abs >= 0x7F7F8000)
+        return ((bits >> 16) & 0x8000) | 0x7F7F;
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return bits >> 16;
+}
+
+/* TL_SAT_<KIND_D><KIND_S>(TYPE_D, MIN_D, MAX_D, TYPE_S, v): convert v of
+   TYPE_S to TYPE_D, saturating to [MIN_D, MAX_D]. Bool destinations take
+   any nonzero value as TL_TRUE. Branches on sizeof() are compile-time
+   constants and fold away. */
+#define TL_SAT_FF(td, lo, hi, ts, v)                                                               \
+    (sizeof(ts) > sizeof(td) ? ((v) >= (hi) ? (td)(hi) : (v) <= (lo) ? (td)(lo) : (td)(v)) : (td)(v))
+#define TL_SAT_FS(td, lo, hi, ts, v) ((td)(v))
+#define TL_SAT_FU(td, lo, hi, ts, v) ((td)(v))
+#define TL_SAT_FB(td, lo, hi, ts, v) ((td)(v))
+
+#define TL_SAT_SF(td, lo, hi, ts, v) ((v) >= (hi) ? (td)(hi) : (v) <= (lo) ? (td)(lo) : (td)(v))
+#define TL_SAT_SS(td, lo, hi, ts, v)                                                               \
+    (sizeof(ts) > sizeof(td)                                                                       \
+         ? ((int64_t)(v) >= (int64_t)(hi) ? (td)(hi)                                               \
+                                          : (int64_t)(v) <= (int64_t)(lo) ? (td)(lo) : (td)(v))    \
+         : (td)(v))
+#define TL_SAT_SU(td, lo, hi, ts, v) ((uint64_t)(v) >= (uint64_t)(hi) ? (td)(hi) : (td)(v))
+#define TL_SAT_SB(td, lo, hi, ts, v) ((td)(v))
+
+#define TL_SAT_UF(td, lo, hi, ts, v) ((v) >= (hi) ? (td)(hi) : (v) < 0 ? (td)0 : (td)(v))
+#define TL_SAT_US(td, lo, hi, ts, v)                                                               \
+    ((v) < 0 ? (td)0 : (uint64_t)(v) >= (uint64_t)(hi) ? (td)(hi) : (td)(v))
+#define TL_SAT_UU(td, lo, hi, ts, v) ((uint64_t)(v) >= (uint64_t)(hi) ? (td)(hi) : (td)(v))
+#define TL_SAT_UB(td, lo, hi, ts, v) ((td)(v))
+
+#define TL_SAT_BF(td, lo, hi, ts, v) ((v) > 0 || (v) < 0 ? TL_TRUE : TL_FALSE)
+#define TL_SAT_BS(td, lo, hi, ts, v) ((v) ? TL_TRUE : TL_FALSE)
+#define TL_SAT_BU(td, lo, hi, ts, v) ((v) ? TL_TRUE : TL_FALSE)
+#define TL_SAT_BB(td, lo, hi, ts, v) ((v) ? TL_TRUE : TL_FALSE)
+
+#define TL_SAT(kd, ks, td, lo, hi, ts, v) TL_SAT_##kd##ks(td, lo, hi, ts, v)
+
+/* TL_WRAP_<KIND>(TYPE, v): store an arithmetic result as TYPE with C
+   wrap-around semantics; bool results are normalized to TL_TRUE/TL_FALSE */
+#define TL_WRAP_F(t, v) ((t)(v))
+#define TL_WRAP_S(t, v) ((t)(v))
+#define TL_WRAP_U(t, v) ((t)(v))
+#define TL_WRAP_B(t, v) ((v) != 0 ? TL_TRUE : TL_FALSE)
+
+/* TL_POW_<KIND>(TYPE, MIN, MAX, a, b): integer powers are computed in
+   double and saturated to the range of TYPE */
+#define TL_POW_F(t, lo, hi, a, b)                                                                  \
+    (sizeof(t) == sizeof(float) ? (t)powf((a), (b)) : (t)pow((a), (b)))
+#define TL_POW_S(t, lo, hi, a, b) TL_SAT_SF(t, lo, hi, double, pow((double)(a), (double)(b)))
+#define TL_POW_U(t, lo, hi, a, b) TL_SAT_UF(t, lo, hi, double, pow((double)(a), (double)(b)))
+#define TL_POW_B(t, lo, hi, a, b) TL_SAT_BF(t, lo, hi, double, pow((double)(a), (double)(b)))
+
+#define TL_GENERIC_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define TL_GENERIC_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+#endif /* _TL_TYPE_GENERIC_H_ */
@@ -27,12 +27,15 @@
 #include <stdarg.h>
 
 #include "tl_util.h"
+#include "tl_profile_internal.h"
+#include "tl_text.h"
 
 TL_EXPORT void *tl_alloc(size_t size)
 {
     void *p;
 
     assert(size > 0);
+    TL_PROFILE_ALLOC(size);
     p = malloc(size);
     if (p == NULL)
         tl_err_dump("malloc(%lu) failed", size);
@@ -86,17 +89,26 @@ TL_EXPORT int tl_compute_length(int ndim, const int *dims)
     return len;
 }
 
+/* Read up to num floats from filename into buf and return how many were
+   read. Anything that can't be part of a number separates them. */
 TL_EXPORT int tl_read_floats(const char *filename, int num, float *buf)
 {
+    struct tl_text_reader r;
     FILE *fp;
-    int count = 0;
+    int count = 0, c;
+    double v;
 
     if (!(fp = fopen(filename, "r")))
         tl_err_dump("fopen(%s) failed", filename);
 
-    for (int i = 0; i < num; i++) {
-        count += fscanf(fp, "%*[^0-9eE.+-]%f", buf++);
+    tl_text_reader_init(&r, fp);
+    while (count < num && (c = tl_text_peek(&r)) >= 0) {
+        if (strchr("0123456789eE.+-", c) && tl_text_read_number(&r, &v))
+            buf[count++] = (float)v;
+        else
+            tl_text_advance(&r);
     }
+    tl_text_reader_free(&r);
     fclose(fp);
     return count;
 }
@@ -52,6 +52,8 @@ void tl_err_bt(const char *fmt, ...);
 void tl_err_exit(int error, const char *fmt, ...);
 void tl_err_sys(const char *fmt, ...);
 void tl_err_dump(const char *fmt, ...);
+void tl_set_num_threads(int num);
+int tl_get_num_threads(void);
 
 /* CUDA support removed */
 
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <unistd.h>
+
+#include "test_tensorlight.h"
+#include "lightnettest/ln_test.h"
+#include "tl_tensor.h"
+#include "tl_check.h"
+#include "tl_chunk.h"
+
+#define FILE1 "__test_chunk_tmp1"
+#define FILE2 "__test_chunk_tmp2"
+#define FILE3 "__test_chunk_tmp3"
+
+static void checked_setup(void)
+{
+}
+
+static void checked_teardown(void)
+{
+     remove(FILE1);
+     remove(FILE2);
+     remove(FILE3);
+}
+
+/* t appended to file_name in pieces of uneven sizes */
+static void write_chunked(const char *file_name, const tl_tensor *t, int tile_rows)
+{
+     int tile_dims[TL_MAXDIM];
+     tl_chunk_writer *w;
+     tl_tensor *part;
+     int start, n;
+
+     memcpy(tile_dims, t->dims, sizeof(int) * t->ndim);
+     tile_dims[0] = tile_rows;
+     w = tl_chunk_writer_create(file_name, t->ndim, tile_dims, t->dtype);
+     ck_assert_ptr_ne(w, NULL);
+     for (start = 0, n = 1; start < t->dims[0]; start += n, n = n * 2 + 1) {
+          if (n > t->dims[0] - start)
+               n = t->dims[0] - start;
+          part = tl_tensor_slice(t, NULL, 0, start, n);
+          ck_assert_int_eq(tl_chunk_writer_append(w, part), 0);
+          tl_tensor_free_data_too(part);
+     }
+     ck_assert_int_eq(tl_chunk_writer_close(w), 0);
+}
+
+LN_TEST_START(test_tl_chunk_read)
+{
+     const struct tl_chunk_info *info;
+     tl_chunk_reader *r;
+     const tl_tensor *tile;
+     tl_tensor *t, *part, *t1;
+     int prefetch, pass, i, start;
+
+     t = tl_tensor_random_uniform(3, (int[]){50, 3, 7}, TL_INT16, -1000, 1000, 1);
+     write_chunked(FILE1, t, 8);
+
+     for (prefetch = 0; prefetch <= 3; prefetch++) {
+          r = tl_chunk_reader_open(FILE1, prefetch);
+          ck_assert_ptr_ne(r, NULL);
+          info = tl_chunk_reader_info(r);
+          ck_assert_int_eq(info->dtype, TL_INT16);
+          ck_assert_int_eq(info->ndim, 3);
+          ck_assert_array_int_eq(info->dims, t->dims, 3);
+          ck_assert_int_eq(info->tile_rows, 8);
+          ck_assert_int_eq(info->ntiles, 7);
+
+          /* twice, the second time after a rewind */
+          for (pass = 0; pass < 2; pass++) {
+               for (i = 0, start = 0; (tile = tl_chunk_reader_next(r)); i++) {
+                    ck_assert_int_eq(tile->dims[0], i < 6 ? 8 : 2);
+                    part = tl_tensor_slice(t, NULL, 0, start, tile->dims[0]);
+                    tl_assert_tensor_eq((tl_tensor *)tile, part);
+                    tl_tensor_free_data_too(part);
+                    start += tile->dims[0];
+                    if (pass == 1 && i == 2) {
+                         /* random access in the middle of streaming */
+                         t1 = tl_chunk_reader_read(r, 6, NULL);
+                         part = tl_tensor_slice(t, NULL, 0, 48, 2);
+                         tl_assert_tensor_eq(t1, part);
+                         tl_tensor_free_data_too(part);
+                         tl_tensor_free_data_too(t1);
+                    }
+               }
+               ck_assert_int_eq(i, 7);
+               ck_assert_int_eq(start, 50);
+               tl_chunk_reader_rewind(r);
+          }
+          ck_assert_int_eq(tl_chunk_reader_failed(r), 0);
+          tl_chunk_reader_close(r);
+     }
+
+     tl_tensor_free_data_too(t);
+
+     /* a read failing after the index was loaded isn't the end of the file;
+        the tiles are bigger than stdio's buffer of the index */
+     t = tl_tensor_zeros(2, (int[]){64, 256}, TL_FLOAT);
+     write_chunked(FILE1, t, 8);
+     r = tl_chunk_reader_open(FILE1, 0);
+     ck_assert_ptr_ne(r, NULL);
+     ck_assert_int_eq(truncate(FILE1, 64), 0);
+     ck_assert_ptr_eq(tl_chunk_reader_next(r), NULL);
+     ck_assert_int_eq(tl_chunk_reader_failed(r), 1);
+     ck_assert_ptr_eq(tl_chunk_reader_next(r), NULL);
+     tl_chunk_reader_rewind(r);
+     ck_assert_int_eq(tl_chunk_reader_failed(r), 0);
+     tl_chunk_reader_close(r);
+     tl_tensor_free_data_too(t);
+
+     /* not a chunked file */
+     t = tl_tensor_zeros(1, (int[]){4}, TL_FLOAT);
+     tl_tensor_save(FILE2, t, NULL);
+     ck_assert_ptr_eq(tl_chunk_reader_open(FILE2, 1), NULL);
+     tl_tensor_free_data_too(t);
+}
+LN_TEST_END
+
+/* size bytes of data over file_name at offset, from the end if whence is
+   SEEK_END */
+static void patch_file(const char *file_name, long offset, int whence, const void *data,
+                       size_t size)
+{
+     FILE *fp = fopen(file_name, "r+b");
+
+     ck_assert_ptr_ne(fp, NULL);
+     ck_assert_int_eq(fseek(fp, offset, whence), 0);
+     ck_assert_int_eq(fwrite(data, 1, size, fp), size);
+     fclose(fp);
+}
+
+LN_TEST_START(test_tl_chunk_corrupt)
+{
+     tl_tensor *t;
+     int32_t i32;
+     uint64_t u64;
+
+     /* header: "TLCK", 3 u32, dims[2], tile_rows; trailer: u64 index
+        offset, u64 ntiles, "TLCI" */
+     t = tl_tensor_zeros(2, (int[]){10, 7}, TL_INT32);
+
+     /* rows or tiles with more than INT32_MAX elements */
+     write_chunked(FILE1, t, 4);
+     i32 = INT32_MAX;
+     patch_file(FILE1, 20, SEEK_SET, &i32, sizeof(i32));
+     ck_assert_ptr_eq(tl_chunk_reader_open(FILE1, 0), NULL);
+     write_chunked(FILE1, t, 4);
+     i32 = INT32_MAX / 4;
+     patch_file(FILE1, 24, SEEK_SET, &i32, sizeof(i32));
+     ck_assert_ptr_eq(tl_chunk_reader_open(FILE1, 0), NULL);
+
+     /* an index that doesn't fit in the file */
+     write_chunked(FILE1, t, 4);
+     u64 = INT32_MAX;
+     patch_file(FILE1, -12, SEEK_END, &u64, sizeof(u64));
+     ck_assert_ptr_eq(tl_chunk_reader_open(FILE1, 0), NULL);
+     write_chunked(FILE1, t, 4);
+     u64 = UINT64_MAX - 8;
+     patch_file(FILE1, -20, SEEK_END, &u64, sizeof(u64));
+     ck_assert_ptr_eq(tl_chunk_reduce(FILE1, NULL, TL_SUM, 1), NULL);
+
+     tl_tensor_free_data_too(t);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_chunk_reduce)
+{
+     tl_tensor *t, *dst, *row, *expect;
+     tl_chunk_writer *w;
+     int i;
+
+     t = tl_tensor_random_uniform(2, (int[]){37, 1000}, TL_FLOAT, -1, 1, 2);
+     write_chunked(FILE1, t, 5);
+
+     expect = tl_tensor_slice(t, NULL, 0, 0, 1);
+     tl_tensor_reshape_src(expect, 1, (int[]){1000});
+     for (i = 1; i < 37; i++) {
+          row = tl_tensor_slice(t, NULL, 0, i, 1);
+          tl_tensor_reshape_src(row, 1, (int[]){1000});
+          tl_tensor_elew(expect, row, expect, TL_MAX);
+          tl_tensor_free_data_too(row);
+     }
+     dst = tl_chunk_reduce(FILE1, NULL, TL_MAX, 2);
+     ck_assert_ptr_ne(dst, NULL);
+     ck_assert_int_eq(dst->ndim, 1);
+     tl_assert_tensor_eq(dst, expect);
+
+     /* into a given dst, a row at a time being exact for sums of integers */
+     tl_tensor_free_data_too(t);
+     t = tl_tensor_arange(0, 12, 1, TL_INT32);
+     write_chunked(FILE2, t, 5);
+     tl_tensor_free_data_too(dst);
+     dst = tl_tensor_zeros(1, (int[]){1}, TL_INT32);
+     ck_assert_ptr_eq(tl_chunk_reduce(FILE2, dst, TL_SUM, 0), dst);
+     ck_assert_int_eq(((int32_t *)dst->data)[0], 66);
+
+     /* a file with no rows */
+     w = tl_chunk_writer_create(FILE3, 1, (int[]){5}, TL_INT32);
+     ck_assert_ptr_ne(w, NULL);
+     ck_assert_int_eq(tl_chunk_writer_close(w), 0);
+     ck_assert_ptr_eq(tl_chunk_reduce(FILE3, NULL, TL_MAX, 0), NULL);
+     ck_assert_ptr_eq(tl_chunk_reduce(FILE3, dst, TL_SUM, 1), NULL);
+
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free_data_too(expect);
+     tl_tensor_free_data_too(t);
+}
+LN_TEST_END
+
+/* the whole tensor in file_name */
+static tl_tensor *read_all(const char *file_name)
+{
+     const struct tl_chunk_info *info;
+     tl_chunk_reader *r;
+     const tl_tensor *tile;
+     tl_tensor *t;
+     size_t off = 0;
+
+     r = tl_chunk_reader_open(file_name, 1);
+     ck_assert_ptr_ne(r, NULL);
+     info = tl_chunk_reader_info(r);
+     t = tl_tensor_zeros(info->ndim, info->dims, info->dtype);
+     while ((tile = tl_chunk_reader_next(r))) {
+          memcpy((char *)t->data + off, tile->data, tl_tensor_size((tl_tensor *)tile));
+          off += tl_tensor_size((tl_tensor *)tile);
+     }
+     ck_assert_int_eq(off, tl_tensor_size(t));
+     tl_chunk_reader_close(r);
+     return t;
+}
+
+LN_TEST_START(test_tl_chunk_elew)
+{
+     tl_tensor *t1, *t2, *expect, *result;
+
+     t1 = tl_tensor_random_uniform(2, (int[]){21, 33}, TL_FLOAT, -1, 1, 3);
+     t2 = tl_tensor_random_uniform(2, (int[]){21, 33}, TL_FLOAT, -1, 1, 4);
+     write_chunked(FILE1, t1, 4);
+     write_chunked(FILE2, t2, 4);
+
+     ck_assert_int_eq(tl_chunk_elew(FILE1, FILE2, FILE3, TL_MUL, 1), 0);
+     expect = tl_tensor_elew(t1, t2, NULL, TL_MUL);
+     result = read_all(FILE3);
+     tl_assert_tensor_eq(result, expect);
+     tl_tensor_free_data_too(result);
+     tl_tensor_free_data_too(expect);
+
+     ck_assert_int_eq(tl_chunk_elew_param(FILE1, 0.5, FILE3, TL_SUM, 0), 0);
+     expect = tl_tensor_elew_param(t1, 0.5, NULL, TL_SUM);
+     result = read_all(FILE3);
+     tl_assert_tensor_eq(result, expect);
+     tl_tensor_free_data_too(result);
+     tl_tensor_free_data_too(expect);
+
+     /* tiles that don't line up */
+     write_chunked(FILE2, t2, 5);
+     ck_assert_int_eq(tl_chunk_elew(FILE1, FILE2, FILE3, TL_MUL, 1), -1);
+
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+}
+LN_TEST_END
+/* end of tests */
+
+LN_TEST_TCASE_START(chunk, checked_setup, checked_teardown)
+{
+     LN_TEST_ADD_TEST(test_tl_chunk_read);
+     LN_TEST_ADD_TEST(test_tl_chunk_corrupt);
+     LN_TEST_ADD_TEST(test_tl_chunk_reduce);
+     LN_TEST_ADD_TEST(test_tl_chunk_elew);
+}
+LN_TEST_TCASE_END
+
+LN_TEST_ADD_TCASE(chunk);
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "test_tensorlight.h"
+#include "lightnettest/ln_test.h"
+#include "tl_tensor.h"
+#include "tl_graph.h"
+#include "tl_profile.h"
+
+static uint64_t rng_state;
+
+static void checked_setup(void)
+{
+     rng_state = 0x2545F4914F6CDD1DULL;
+}
+
+static void checked_teardown(void)
+{
+}
+
+static void fill_rand(tl_tensor *t)
+{
+     for (int i = 0; i < t->len; i++) {
+          rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+          ((float *)t->data)[i] = (int)(rng_state >> 40) / (float)(1 << 22) - 2.0f;
+     }
+}
+
+static void assert_same(const tl_tensor *t1, const tl_tensor *t2)
+{
+     ck_assert(tl_tensor_issameshape(t1, t2));
+     ck_assert_int_eq(t1->dtype, t2->dtype);
+     ck_assert(!memcmp(t1->data, t2->data, tl_size_of(t1->dtype) * t1->len));
+}
+
+LN_TEST_START(test_tl_graph_run)
+{
+     int x_dims[] = {4, 8, 300};
+     int w_dims[] = {300, 16};
+     int axes[] = {0, 2, 1};
+     const tl_tensor *inputs[2];
+     tl_tensor *x, *y, *w, *t1, *t2, *t3, *t4, *t5, *t6;
+     tl_graph *g;
+     int ix, iy, iw, a, b, c, d, e, f, h, s, r1, r2, r3;
+
+     x = tl_tensor_zeros(3, x_dims, TL_FLOAT);
+     y = tl_tensor_zeros(3, x_dims, TL_FLOAT);
+     w = tl_tensor_zeros(2, w_dims, TL_FLOAT);
+     fill_rand(w);
+
+     g = tl_graph_create();
+     ix = tl_graph_input(g, 3, x_dims, TL_FLOAT);
+     iy = tl_graph_input(g, 3, x_dims, TL_FLOAT);
+     iw = tl_graph_const(g, w);
+     a = tl_graph_elew(g, ix, iy, TL_MUL);
+     b = tl_graph_elew_param(g, a, 0.5, TL_SUM);
+     c = tl_graph_lrelu(g, b, 0.1);
+     d = tl_graph_matmul(g, c, iw, 0, 0);
+     e = tl_graph_transpose(g, d, axes);
+     f = tl_graph_elew_param(g, e, 2, TL_MUL);
+     h = tl_graph_lrelu(g, f, 0.2);
+     s = tl_graph_softmax(g, h, 2);
+     r1 = tl_graph_elew(g, ix, iy, TL_SUB);
+     r2 = tl_graph_convert(g, r1, TL_DOUBLE);
+     r3 = tl_graph_maxreduce(g, r2, 1);
+     tl_graph_elew(g, ix, ix, TL_SUM); /* dead */
+     ck_assert_int_eq(tl_graph_output(g, s), 0);
+     ck_assert_int_eq(tl_graph_output(g, r3), 1);
+     ck_assert_int_eq(tl_graph_output(g, iy), 2);
+
+     ck_assert_int_eq(tl_graph_tensor(g, e)->dims[1], 16);
+     ck_assert_int_eq(tl_graph_tensor(g, r3)->dims[1], 1);
+     ck_assert_int_eq(tl_graph_tensor(g, r3)->dtype, TL_DOUBLE);
+
+     tl_graph_compile(g);
+     /* {a, b, c}, d, e, {f, h}, s, {r1, r2, r3}, copy of iy */
+     ck_assert_int_eq(tl_graph_num_steps(g), 7);
+     /* c and e don't live at the same time, h is written over e */
+     ck_assert_int_eq(tl_graph_arena_size(g), 4 * 8 * 300 * 4 + 4 * 16 * 8 * 4);
+     ck_assert_ptr_eq(tl_graph_tensor(g, h)->data, tl_graph_tensor(g, e)->data);
+     ck_assert_ptr_eq(tl_graph_tensor(g, c)->data, tl_graph_tensor(g, e)->data);
+
+     for (int run = 0; run < 2; run++) {
+          fill_rand(x);
+          fill_rand(y);
+          inputs[0] = x;
+          inputs[1] = y;
+          tl_graph_run(g, inputs);
+
+          t1 = tl_tensor_elew(x, y, NULL, TL_MUL);
+          tl_tensor_elew_param(t1, 0.5, t1, TL_SUM);
+          tl_tensor_lrelu(t1, t1, 0.1);
+          t2 = tl_tensor_matmul(t1, w, NULL, 0, 0);
+          t3 = tl_tensor_transpose(t2, NULL, axes);
+          tl_tensor_elew_param(t3, 2, t3, TL_MUL);
+          tl_tensor_lrelu(t3, t3, 0.2);
+          t4 = tl_tensor_softmax(t3, NULL, 2);
+          assert_same(tl_graph_get_output(g, 0), t4);
+
+          t5 = tl_tensor_elew(x, y, NULL, TL_SUB);
+          t6 = tl_tensor_convert(t5, NULL, TL_DOUBLE);
+          tl_tensor_free_data_too(t5);
+          t5 = tl_tensor_maxreduce(t6, NULL, NULL, 1);
+          assert_same(tl_graph_get_output(g, 1), t5);
+          assert_same(tl_graph_get_output(g, 2), y);
+
+          tl_tensor_free_data_too(t1);
+          tl_tensor_free_data_too(t2);
+          tl_tensor_free_data_too(t3);
+          tl_tensor_free_data_too(t4);
+          tl_tensor_free_data_too(t5);
+          tl_tensor_free_data_too(t6);
+     }
+
+     tl_graph_free(g);
+     tl_tensor_free_data_too(x);
+     tl_tensor_free_data_too(y);
+     tl_tensor_free_data_too(w);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_graph_fusion)
+{
+     int dims[] = {3, 5000};
+     const tl_tensor *inputs[1];
+     tl_profile_stats stats[16];
+     tl_tensor *x, *t1, *t2;
+     tl_graph *g;
+     int ix, a, b, c, i, n;
+
+     x = tl_tensor_zeros(2, dims, TL_FLOAT);
+     fill_rand(x);
+
+     /* a diamond: a is read twice, so it can't be fused into its consumers,
+        but b and c still fuse, and c is written over a */
+     g = tl_graph_create();
+     ix = tl_graph_input(g, 2, dims, TL_FLOAT);
+     a = tl_graph_elew_param(g, ix, 3, TL_MUL);
+     b = tl_graph_lrelu(g, a, 0.5);
+     c = tl_graph_elew(g, a, b, TL_SUM);
+     tl_graph_output(g, tl_graph_maxreduce(g, c, 1));
+     tl_graph_output(g, tl_graph_maxreduce(g, c, 0));
+     tl_graph_compile(g);
+     /* a, {b, c}, both maxreduces */
+     ck_assert_int_eq(tl_graph_num_steps(g), 4);
+     ck_assert_ptr_eq(tl_graph_tensor(g, c)->data, tl_graph_tensor(g, a)->data);
+     /* rounded up to 64 bytes */
+     ck_assert_int_eq(tl_graph_arena_size(g), (3 * 5000 * 4 + 63) / 64 * 64);
+
+     inputs[0] = x;
+     tl_graph_run(g, inputs);
+
+     /* a compiled graph runs without allocating */
+     tl_profile_reset();
+     tl_profile_start(0);
+     tl_graph_run(g, inputs);
+     tl_profile_stop();
+     n = tl_profile_get_stats(stats, 16);
+     for (i = 0; i < n; i++)
+          ck_assert_int_eq(stats[i].allocs, 0);
+     tl_profile_reset();
+
+     t1 = tl_tensor_elew_param(x, 3, NULL, TL_MUL);
+     t2 = tl_tensor_lrelu(t1, NULL, 0.5);
+     tl_tensor_elew(t1, t2, t2, TL_SUM);
+     tl_tensor_free_data_too(t1);
+     t1 = tl_tensor_maxreduce(t2, NULL, NULL, 1);
+     assert_same(tl_graph_get_output(g, 0), t1);
+     tl_tensor_free_data_too(t1);
+     t1 = tl_tensor_maxreduce(t2, NULL, NULL, 0);
+     assert_same(tl_graph_get_output(g, 1), t1);
+
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+     tl_graph_free(g);
+     tl_tensor_free_data_too(x);
+}
+LN_TEST_END
+/* end of tests */
+
+LN_TEST_TCASE_START(graph, checked_setup, checked_teardown)
+{
+     LN_TEST_ADD_TEST(test_tl_graph_run);
+     LN_TEST_ADD_TEST(test_tl_graph_fusion);
+}
+LN_TEST_TCASE_END
+
+LN_TEST_ADD_TCASE(graph);
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test_tensorlight.h"
+#include "lightnettest/ln_test.h"
+#include "tl_tensor.h"
+#include "tl_profile.h"
+
+static void checked_setup(void)
+{
+     tl_profile_stop();
+     tl_profile_reset();
+}
+
+static void checked_teardown(void)
+{
+     tl_profile_stop();
+     tl_profile_reset();
+}
+
+static const tl_profile_stats *find_stats(const tl_profile_stats *stats, int n,
+                                          const char *name)
+{
+     for (int i = 0; i < n; i++)
+          if (!strcmp(stats[i].name, name))
+               return &stats[i];
+     return NULL;
+}
+
+static int file_contains(const char *file_name, const char *str)
+{
+     char buf[8192];
+     size_t n;
+     FILE *fp;
+
+     if (!(fp = fopen(file_name, "r")))
+          return 0;
+     n = fread(buf, 1, sizeof(buf) - 1, fp);
+     buf[n] = '\0';
+     fclose(fp);
+     return strstr(buf, str) != NULL;
+}
+
+LN_TEST_START(test_tl_profile_stats)
+{
+     tl_profile_stats stats[64];
+     const tl_profile_stats *s;
+     tl_tensor *t1, *t2, *t3;
+     int dims[2] = {3, 100};
+     int n;
+
+     t1 = tl_tensor_zeros(2, dims, TL_FLOAT);
+     t2 = tl_tensor_zeros(2, dims, TL_FLOAT);
+
+     /* nothing is recorded before tl_profile_start */
+     t3 = tl_tensor_elew(t1, t2, NULL, TL_MUL);
+     tl_tensor_free_data_too(t3);
+     ck_assert_int_eq(tl_profile_get_stats(stats, 64), 0);
+
+     tl_profile_start(0);
+     t3 = tl_tensor_elew(t1, t2, NULL, TL_MUL);
+     tl_tensor_elew(t1, t2, t3, TL_SUM);
+     tl_profile_stop();
+     tl_tensor_elew(t1, t2, t3, TL_SUB);
+
+     n = tl_profile_get_stats(stats, 64);
+     if (!tl_profile_available()) {
+          ck_assert_int_eq(n, 0);
+          goto end;
+     }
+
+     s = find_stats(stats, n, "tl_tensor_elew");
+     ck_assert_ptr_ne(s, NULL);
+     ck_assert_int_eq(s->calls, 2);
+     ck_assert_int_eq(s->bytes_read, 2 * 2 * 300 * sizeof(float));
+     ck_assert_int_eq(s->bytes_written, 2 * 300 * sizeof(float));
+     ck_assert(s->max_ns <= s->total_ns);
+     ck_assert_int_eq(s->allocs, 0);
+
+     /* the dst allocation belongs to the nested tl_tensor_zeros */
+     s = find_stats(stats, n, "tl_tensor_zeros");
+     ck_assert_ptr_ne(s, NULL);
+     ck_assert_int_eq(s->calls, 1);
+     ck_assert_int_eq(s->allocs, 1);
+     ck_assert_int_eq(s->alloc_bytes, 300 * sizeof(float));
+     ck_assert_int_eq(s->bytes_written, 300 * sizeof(float));
+
+     s = find_stats(stats, n, "tl_alloc");
+     ck_assert_ptr_ne(s, NULL);
+     ck_assert(s->allocs >= 3); /* the tensor, its dims and its data */
+
+     /* sorted by total time */
+     for (int i = 1; i < n; i++)
+          ck_assert(stats[i - 1].total_ns >= stats[i].total_ns);
+
+     tl_profile_reset();
+     ck_assert_int_eq(tl_profile_get_stats(stats, 64), 0);
+
+end:
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+     tl_tensor_free_data_too(t3);
+}
+LN_TEST_END
+
+/* the stats snapshot may be the first tl_alloc since the start */
+LN_TEST_START(test_tl_profile_no_alloc)
+{
+     tl_profile_stats stats[8];
+     tl_tensor *t1, *t2, *t3;
+     int dims[2] = {3, 100};
+     int n;
+
+     t1 = tl_tensor_zeros(2, dims, TL_FLOAT);
+     t2 = tl_tensor_zeros(2, dims, TL_FLOAT);
+     t3 = tl_tensor_zeros(2, dims, TL_FLOAT);
+
+     tl_profile_start(0);
+     ck_assert_int_eq(tl_profile_get_stats(stats, 8), 0);
+     tl_profile_reset();
+     tl_tensor_elew(t1, t2, t3, TL_SUM);
+     n = tl_profile_get_stats(stats, 8);
+     tl_profile_stop();
+     if (tl_profile_available())
+          ck_assert_ptr_ne(find_stats(stats, n, "tl_tensor_elew"), NULL);
+     else
+          ck_assert_int_eq(n, 0);
+
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+     tl_tensor_free_data_too(t3);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_profile_dump)
+{
+     const char *json = LN_BUILD_TEST_DIR "/profile.json";
+     const char *trace = LN_BUILD_TEST_DIR "/profile_trace.json";
+     tl_tensor *t1, *t2;
+     int dims[2] = {4, 8};
+
+     t1 = tl_tensor_zeros(2, dims, TL_INT32);
+     tl_profile_start(1);
+     t2 = tl_tensor_transpose(t1, NULL, (int[]){1, 0});
+     tl_profile_stop();
+
+     if (!tl_profile_available()) {
+          ck_assert_int_lt(tl_profile_dump_json(json), 0);
+          ck_assert_int_lt(tl_profile_dump_trace(trace), 0);
+          goto end;
+     }
+
+     ck_assert_int_eq(tl_profile_dump_json(json), 0);
+     ck_assert(file_contains(json, "\"name\": \"tl_tensor_transpose\", \"calls\": 1,"));
+     ck_assert_int_eq(tl_profile_dump_trace(trace), 0);
+     ck_assert(file_contains(trace, "\"traceEvents\""));
+     ck_assert(file_contains(trace, "\"name\": \"tl_tensor_transpose\", \"cat\": \"tensorlight\", "
+                             "\"ph\": \"X\""));
+     /* nested ops get their own events */
+     ck_assert(file_contains(trace, "\"name\": \"tl_tensor_zeros\""));
+
+end:
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+}
+LN_TEST_END
+/* end of tests */
+
+LN_TEST_TCASE_START(profile, checked_setup, checked_teardown)
+{
+     LN_TEST_ADD_TEST(test_tl_profile_stats);
+     LN_TEST_ADD_TEST(test_tl_profile_no_alloc);
+     LN_TEST_ADD_TEST(test_tl_profile_dump);
+}
+LN_TEST_TCASE_END
+
+LN_TEST_ADD_TCASE(profile);
@@ -0,0 +1,665 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/* Differential tests: every optimized op is run against its tl_ref_*
+   counterpart on random shapes, axes and dtypes, with tensors placed at odd
+   element offsets so that vector loops see unaligned heads and tails. The
+   summed run times of both are printed as a speedup per op. */
+
+#include <float.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "test_tensorlight.h"
+#include "lightnettest/ln_test.h"
+#include "tl_tensor.h"
+#include "tl_util.h"
+#include "tl_check.h"
+#include "tl_ref.h"
+
+#define NCASES 24
+#define MAX_MADE 32
+
+struct speed {
+     const char *name;
+     int cases;
+     uint64_t ref_ns;
+     uint64_t opt_ns;
+};
+
+static uint64_t rng_state;
+static tl_tensor *made[MAX_MADE];
+static void *made_bufs[MAX_MADE];
+static int nmade;
+
+static void checked_setup(void)
+{
+     rng_state = 0x2545F4914F6CDD1DULL;
+     nmade = 0;
+}
+
+static void checked_teardown(void)
+{
+}
+
+static uint64_t now_ns(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define TIMED(acc, expr)                        \
+     do {                                       \
+          uint64_t _t0 = now_ns();              \
+          expr;                                 \
+          (acc) += now_ns() - _t0;              \
+     } while (0)
+
+static void report(const struct speed *s)
+{
+     printf("ref %-16s %3d cases  ref %9.3f ms  opt %9.3f ms  speedup %7.2fx\n",
+            s->name, s->cases, s->ref_ns / 1e6, s->opt_ns / 1e6,
+            s->opt_ns ? (double)s->ref_ns / s->opt_ns : 0.0);
+}
+
+/* uniform in [lo, hi) */
+static int rnd(int lo, int hi)
+{
+     rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+     return lo + (int)((rng_state >> 33) % (uint64_t)(hi - lo));
+}
+
+static void rnd_dims(int ndim, int *dims, int max_dim)
+{
+     for (int i = 0; i < ndim; i++)
+          dims[i] = rnd(1, max_dim + 1);
+}
+
+/* A tensor whose data starts at a random element offset into its buffer.
+   Values are small enough that integer sums and products don't overflow,
+   and are never zero if nonzero is set (divisors). */
+static tl_tensor *rnd_tensor(int ndim, const int *dims, tl_dtype dtype, int nonzero)
+{
+     size_t dsize = tl_size_of(dtype);
+     int off = rnd(0, 8);
+     tl_tensor *t;
+     double v;
+     void *buf;
+
+     assert(nmade < MAX_MADE);
+     buf = tl_alloc((tl_compute_length(ndim, dims) + off) * dsize);
+     t = tl_tensor_create((char *)buf + off * dsize, ndim, dims, dtype);
+     for (int i = 0; i < t->len; i++) {
+          switch (dtype) {
+          case TL_FLOAT:
+          case TL_DOUBLE:
+               v = rnd(-(1 << 20), 1 << 20) / (double)(1 << 18);
+               break;
+          case TL_BOOL:
+               v = rnd(0, 2);
+               break;
+          case TL_UINT64:
+          case TL_UINT32:
+          case TL_UINT16:
+          case TL_UINT8:
+               v = rnd(0, 16);
+               break;
+          default:
+               v = rnd(-8, 8);
+               break;
+          }
+          if (nonzero && v == 0)
+               v = 1;
+          tl_convert(tl_padd(t->data, i, dsize), dtype, &v, TL_DOUBLE);
+     }
+     made[nmade] = t;
+     made_bufs[nmade++] = buf;
+     return t;
+}
+
+/* an unaligned dst shaped like ref */
+static tl_tensor *dst_like(const tl_tensor *ref)
+{
+     return rnd_tensor(ref->ndim, ref->dims, ref->dtype, 0);
+}
+
+static void free_made(void)
+{
+     for (int i = 0; i < nmade; i++) {
+          tl_tensor_free(made[i]);
+          tl_free(made_bufs[i]);
+     }
+     nmade = 0;
+}
+
+static double get_val(const tl_tensor *t)
+{
+     double v;
+
+     tl_convert(&v, TL_DOUBLE, t->data, t->dtype);
+     return v;
+}
+
+static tl_dtype rnd_dtype(void)
+{
+     return rnd(0, TL_DTYPE_SIZE);
+}
+
+static tl_dtype rnd_float_dtype(void)
+{
+     return rnd(0, 2) ? TL_FLOAT : TL_DOUBLE;
+}
+
+LN_TEST_START(test_tl_ref_elew)
+{
+     struct speed s = { "elew" };
+     tl_tensor *a, *b, *r, *o;
+     int dims[TL_MAXDIM], ndim;
+     tl_elew_op op;
+     tl_dtype dtype;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 17);
+          dtype = rnd_dtype();
+          op = rnd(0, TL_ELEW_OP_SIZE);
+          if (op == TL_POW && dtype != TL_FLOAT && dtype != TL_DOUBLE)
+               op = TL_MUL;
+          a = rnd_tensor(ndim, dims, dtype, 0);
+          b = rnd_tensor(ndim, dims, dtype, op == TL_DIV);
+          TIMED(s.ref_ns, r = tl_ref_elew(a, b, NULL, op));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_elew(a, b, o, op));
+          tl_assert_tensor_eq_ulp(o, r, 4);
+
+          TIMED(s.ref_ns, tl_ref_elew_param(a, 3, r, op));
+          TIMED(s.opt_ns, tl_tensor_elew_param(a, 3, o, op));
+          tl_assert_tensor_eq_ulp(o, r, 4);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_convert)
+{
+     struct speed s = { "convert" };
+     tl_tensor *a, *r, *o;
+     int dims[TL_MAXDIM], ndim;
+     tl_dtype dtype_s, dtype_d;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 17);
+          dtype_s = rnd_dtype();
+          dtype_d = rnd_dtype();
+          a = rnd_tensor(ndim, dims, dtype_s, 0);
+          TIMED(s.ref_ns, r = tl_ref_convert(a, NULL, dtype_d));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_convert(a, o, dtype_d));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_lrelu)
+{
+     struct speed s = { "lrelu" };
+     tl_tensor *a, *r, *o;
+     int dims[TL_MAXDIM], ndim;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 17);
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          TIMED(s.ref_ns, r = tl_ref_lrelu(a, NULL, 0.1));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_lrelu(a, o, 0.1));
+          tl_assert_tensor_eq_ulp(o, r, 0);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_maxreduce)
+{
+     struct speed s = { "maxreduce" };
+     tl_tensor *a, *r, *o, *ra, *oa;
+     int dims[TL_MAXDIM], ndim, axis;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 13);
+          axis = rnd(0, ndim);
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          dims[axis] = 1;
+          ra = tl_tensor_zeros(ndim, dims, TL_INT32);
+          TIMED(s.ref_ns, r = tl_ref_maxreduce(a, NULL, ra, axis));
+          o = dst_like(r);
+          oa = dst_like(ra);
+          TIMED(s.opt_ns, tl_tensor_maxreduce(a, o, oa, axis));
+          tl_assert_tensor_eq(o, r);
+          tl_assert_tensor_eq(oa, ra);
+          tl_tensor_free_data_too(r);
+          tl_tensor_free_data_too(ra);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_transpose)
+{
+     struct speed s = { "transpose" };
+     tl_tensor *a, *r, *o;
+     int dims[TL_MAXDIM], axes[TL_MAXDIM], ndim, j, tmp;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 6);
+          rnd_dims(ndim, dims, 11);
+          for (int i = 0; i < ndim; i++)
+               axes[i] = i;
+          for (int i = ndim - 1; i > 0; i--) {
+               j = rnd(0, i + 1);
+               tmp = axes[i];
+               axes[i] = axes[j];
+               axes[j] = tmp;
+          }
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          TIMED(s.ref_ns, r = tl_ref_transpose(a, NULL, axes));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_transpose(a, o, axes));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_resize)
+{
+     struct speed s = { "resize" };
+     tl_tensor *a, *r, *o;
+     int dims[TL_MAXDIM], new_dims[TL_MAXDIM], ndim;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 13);
+          rnd_dims(ndim, new_dims, 25);
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          TIMED(s.ref_ns, r = tl_ref_resize(a, NULL, new_dims, TL_NEAREST));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_resize(a, o, new_dims, TL_NEAREST));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_slice_nd)
+{
+     struct speed s = { "slice_nd" };
+     int dims[TL_MAXDIM], start[TL_MAXDIM], stop[TL_MAXDIM], step[TL_MAXDIM], ndim;
+     tl_tensor *a, *r, *o;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 6);
+          rnd_dims(ndim, dims, 13);
+          for (int i = 0; i < ndim; i++) {
+               start[i] = rnd(0, dims[i]);
+               stop[i] = rnd(start[i] + 1, dims[i] + 1);
+               step[i] = rnd(1, 4);
+          }
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          TIMED(s.ref_ns, r = tl_ref_slice_nd(a, NULL, start, stop, step));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_slice_nd(a, o, start, stop, step));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_concat_n)
+{
+     struct speed s = { "concat_n" };
+     int dims[TL_MAXDIM], ndim, axis, n;
+     const tl_tensor *srcs[4];
+     tl_tensor *r, *o;
+     tl_dtype dtype;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 11);
+          axis = rnd(0, ndim);
+          n = rnd(1, 5);
+          dtype = rnd_dtype();
+          for (int k = 0; k < n; k++) {
+               dims[axis] = rnd(1, 9);
+               srcs[k] = rnd_tensor(ndim, dims, dtype, 0);
+          }
+          TIMED(s.ref_ns, r = tl_ref_concat_n(srcs, n, NULL, axis));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_concat_n(srcs, n, o, axis));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_pad)
+{
+     struct speed s = { "pad" };
+     int dims[TL_MAXDIM], pads[2 * TL_MAXDIM], ndim;
+     tl_tensor *a, *r, *o;
+     tl_pad_mode mode;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 11);
+          mode = rnd(0, TL_PAD_MODE_SIZE);
+          for (int i = 0; i < ndim; i++) {
+               /* reflection can't reach past the opposite edge */
+               int max_pad = mode == TL_PAD_REFLECT ? dims[i] - 1 : 4;
+               pads[2 * i] = rnd(0, max_pad + 1);
+               pads[2 * i + 1] = rnd(0, max_pad + 1);
+          }
+          a = rnd_tensor(ndim, dims, rnd_dtype(), 0);
+          TIMED(s.ref_ns, r = tl_ref_pad(a, NULL, pads, mode, 1));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_pad(a, o, pads, mode, 1));
+          tl_assert_tensor_eq(o, r);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_reduce)
+{
+     struct speed s = { "dot/norm" };
+     tl_tensor *a, *b, *r, *o;
+     int dims[1];
+     tl_dtype dtype;
+     double tol;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          dims[0] = rnd(1, 1 << rnd(1, 18));
+          dtype = rnd_dtype();
+          a = rnd_tensor(1, dims, dtype, 0);
+          b = rnd_tensor(1, dims, dtype, 0);
+          /* summation order differs, so bound the error by the length */
+          tol = dtype == TL_FLOAT ? 1e-5 * dims[0] : 1e-12 * dims[0];
+          tol = dtype == TL_FLOAT || dtype == TL_DOUBLE ? tol : 0;
+
+          TIMED(s.ref_ns, r = tl_ref_dot_product(a, b, NULL));
+          TIMED(s.opt_ns, o = tl_tensor_dot_product(a, b, NULL));
+          ck_assert_double_eq_tol(get_val(o), get_val(r), tol + 1e-300);
+          tl_tensor_free_data_too(r);
+          tl_tensor_free_data_too(o);
+
+          for (tl_norm_type ord = 0; ord < TL_NORM_TYPE_SIZE; ord++) {
+               TIMED(s.ref_ns, r = tl_ref_norm(a, NULL, ord));
+               TIMED(s.opt_ns, o = tl_tensor_norm(a, NULL, ord));
+               ck_assert_int_eq(o->dtype, r->dtype);
+               ck_assert_double_eq_tol(get_val(o), get_val(r), tol + 1e-300);
+               tl_tensor_free_data_too(r);
+               tl_tensor_free_data_too(o);
+          }
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_softmax)
+{
+     struct speed s = { "softmax" };
+     tl_tensor *a, *r, *o;
+     int dims[TL_MAXDIM], ndim, axis, is_log;
+     double tol;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          ndim = rnd(1, 5);
+          rnd_dims(ndim, dims, 13);
+          axis = rnd(0, ndim);
+          is_log = rnd(0, 2);
+          a = rnd_tensor(ndim, dims, rnd_float_dtype(), 0);
+          tol = a->dtype == TL_FLOAT ? 1e-5 : 1e-12;
+          if (is_log) {
+               TIMED(s.ref_ns, r = tl_ref_log_softmax(a, NULL, axis));
+               o = dst_like(r);
+               TIMED(s.opt_ns, tl_tensor_log_softmax(a, o, axis));
+          } else {
+               TIMED(s.ref_ns, r = tl_ref_softmax(a, NULL, axis));
+               o = dst_like(r);
+               TIMED(s.opt_ns, tl_tensor_softmax(a, o, axis));
+          }
+          tl_assert_tensor_eq_tol(o, r, tol);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_matmul)
+{
+     struct speed s = { "matmul" };
+     int dims1[TL_MAXDIM], dims2[TL_MAXDIM], nd1, nd2, M, N, K, t1, t2, d;
+     tl_tensor *a, *b, *r, *o;
+     tl_dtype dtype;
+     double tol;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          nd1 = rnd(2, 5);
+          nd2 = rnd(2, 5);
+          for (int i = 1; i <= 2; i++) {
+               /* batch dims, right-aligned, equal or broadcast from 1 */
+               d = rnd(1, 4);
+               if (nd1 - 2 - i >= 0)
+                    dims1[nd1 - 2 - i] = rnd(0, 3) ? d : 1;
+               if (nd2 - 2 - i >= 0)
+                    dims2[nd2 - 2 - i] = rnd(0, 3) ? d : 1;
+          }
+          M = rnd(1, 40);
+          N = rnd(1, 40);
+          K = rnd(1, 70);
+          t1 = rnd(0, 2);
+          t2 = rnd(0, 2);
+          dims1[nd1 - 2] = t1 ? K : M;
+          dims1[nd1 - 1] = t1 ? M : K;
+          dims2[nd2 - 2] = t2 ? N : K;
+          dims2[nd2 - 1] = t2 ? K : N;
+          d = rnd(0, 3);
+          dtype = d == 0 ? TL_FLOAT : d == 1 ? TL_DOUBLE : TL_INT32;
+          a = rnd_tensor(nd1, dims1, dtype, 0);
+          b = rnd_tensor(nd2, dims2, dtype, 0);
+          tol = dtype == TL_FLOAT ? 1e-5 * K : dtype == TL_DOUBLE ? 1e-12 * K : 0;
+          TIMED(s.ref_ns, r = tl_ref_matmul(a, b, NULL, t1, t2));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_matmul(a, b, o, t1, t2));
+          tl_assert_tensor_eq_tol(o, r, tol);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_conv2d)
+{
+     struct speed s = { "conv2d" };
+     int sdims[4], wdims[4], stride[2], padding[2], dilation[2];
+     int N, C, H, W, OC, KH, KW, groups, lrelu;
+     tl_tensor *a, *w, *bias, *r, *o;
+     tl_layout layout;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          groups = rnd(0, 3) ? 1 : rnd(2, 4);
+          N = rnd(1, 3);
+          C = groups * rnd(1, 5);
+          OC = groups * rnd(1, 6);
+          KH = rnd(1, 4);
+          KW = rnd(1, 4);
+          stride[0] = rnd(1, 3);
+          stride[1] = rnd(1, 3);
+          padding[0] = rnd(0, KH);
+          padding[1] = rnd(0, KW);
+          dilation[0] = rnd(1, 3);
+          dilation[1] = rnd(1, 3);
+          H = rnd(dilation[0] * (KH - 1) + 1, 16);
+          W = rnd(dilation[1] * (KW - 1) + 1, 16);
+          layout = rnd(0, 2) ? TL_NCHW : TL_NHWC;
+          lrelu = rnd(0, 2);
+          if (layout == TL_NCHW) {
+               memmove(sdims, (int[]){ N, C, H, W }, sizeof(sdims));
+               memmove(wdims, (int[]){ OC, C / groups, KH, KW }, sizeof(wdims));
+          } else {
+               memmove(sdims, (int[]){ N, H, W, C }, sizeof(sdims));
+               memmove(wdims, (int[]){ KH, KW, C / groups, OC }, sizeof(wdims));
+          }
+          a = rnd_tensor(4, sdims, TL_FLOAT, 0);
+          w = rnd_tensor(4, wdims, TL_FLOAT, 0);
+          bias = rnd(0, 2) ? rnd_tensor(1, &OC, TL_FLOAT, 0) : NULL;
+          TIMED(s.ref_ns, r = tl_ref_conv2d(a, w, bias, NULL, stride, padding, dilation,
+                                            groups, layout, lrelu, 0.1));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_conv2d(a, w, bias, o, stride, padding, dilation, groups,
+                                           layout, lrelu, 0.1));
+          tl_assert_tensor_eq_tol(o, r, 1e-5 * C * KH * KW);
+          tl_tensor_free_data_too(r);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_pool2d)
+{
+     struct speed s = { "pool2d" };
+     int sdims[4], kernel[2], stride[2], padding[2], N, C, H, W, ceil_mode, include_pad;
+     tl_tensor *a, *r, *o, *ra, *oa;
+     tl_layout layout;
+
+     for (int c = 0; c < NCASES; c++, s.cases++) {
+          N = rnd(1, 3);
+          C = rnd(1, 9);
+          kernel[0] = rnd(1, 5);
+          kernel[1] = rnd(1, 5);
+          stride[0] = rnd(1, 4);
+          stride[1] = rnd(1, 4);
+          padding[0] = rnd(0, kernel[0] / 2 + 1);
+          padding[1] = rnd(0, kernel[1] / 2 + 1);
+          H = rnd(kernel[0], 24);
+          W = rnd(kernel[1], 24);
+          ceil_mode = rnd(0, 2);
+          include_pad = rnd(0, 2);
+          layout = rnd(0, 2) ? TL_NCHW : TL_NHWC;
+          if (layout == TL_NCHW)
+               memmove(sdims, (int[]){ N, C, H, W }, sizeof(sdims));
+          else
+               memmove(sdims, (int[]){ N, H, W, C }, sizeof(sdims));
+          a = rnd_tensor(4, sdims, TL_FLOAT, 0);
+
+          TIMED(s.ref_ns, r = tl_ref_avgpool2d(a, NULL, kernel, stride, padding, ceil_mode,
+                                               include_pad, layout));
+          o = dst_like(r);
+          TIMED(s.opt_ns, tl_tensor_avgpool2d(a, o, kernel, stride, padding, ceil_mode,
+                                              include_pad, layout));
+          tl_assert_tensor_eq_tol(o, r, 1e-5);
+          tl_tensor_free_data_too(r);
+
+          ra = tl_tensor_zeros(4, o->dims, TL_INT32);
+          TIMED(s.ref_ns, r = tl_ref_maxpool2d(a, NULL, ra, kernel, stride, padding, ceil_mode,
+                                               layout));
+          oa = dst_like(ra);
+          TIMED(s.opt_ns, tl_tensor_maxpool2d(a, o, oa, kernel, stride, padding, ceil_mode,
+                                              layout));
+          tl_assert_tensor_eq(o, r);
+          tl_assert_tensor_eq(oa, ra);
+          tl_tensor_free_data_too(r);
+          tl_tensor_free_data_too(ra);
+          free_made();
+     }
+     report(&s);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_ref_ulp)
+{
+     float f[4] = { 1.0f, 0, -0.0f, -1.0f };
+     tl_tensor *x, *y;
+
+     ck_assert_uint_eq(_tl_ulp_diff_float(0.0f, -0.0f), 0);
+     ck_assert_uint_eq(_tl_ulp_diff_float(1.0f, nextafterf(1.0f, 2.0f)), 1);
+     ck_assert_uint_eq(_tl_ulp_diff_float(-FLT_MIN, FLT_MIN), 2 * 0x00800000ULL);
+     ck_assert_uint_eq(_tl_ulp_diff_double(-1.0, nextafter(-1.0, 0.0)), 1);
+     ck_assert_uint_eq(_tl_ulp_diff_double(NAN, NAN), 0);
+
+     x = tl_tensor_create(f, 1, (int[]){ 4 }, TL_FLOAT);
+     y = tl_tensor_clone(x);
+     ((float *)y->data)[0] = nextafterf(nextafterf(1.0f, 2.0f), 2.0f);
+     tl_assert_tensor_eq_ulp(x, y, 2);
+     tl_tensor_free(x);
+     tl_tensor_free_data_too(y);
+}
+LN_TEST_END
+
+LN_TEST_TCASE_START(ref, checked_setup, checked_teardown)
+{
+     LN_TEST_ADD_TEST(test_tl_ref_elew);
+     LN_TEST_ADD_TEST(test_tl_ref_convert);
+     LN_TEST_ADD_TEST(test_tl_ref_lrelu);
+     LN_TEST_ADD_TEST(test_tl_ref_maxreduce);
+     LN_TEST_ADD_TEST(test_tl_ref_transpose);
+     LN_TEST_ADD_TEST(test_tl_ref_resize);
+     LN_TEST_ADD_TEST(test_tl_ref_slice_nd);
+     LN_TEST_ADD_TEST(test_tl_ref_concat_n);
+     LN_TEST_ADD_TEST(test_tl_ref_pad);
+     LN_TEST_ADD_TEST(test_tl_ref_reduce);
+     LN_TEST_ADD_TEST(test_tl_ref_softmax);
+     LN_TEST_ADD_TEST(test_tl_ref_matmul);
+     LN_TEST_ADD_TEST(test_tl_ref_conv2d);
+     LN_TEST_ADD_TEST(test_tl_ref_pool2d);
+     LN_TEST_ADD_TEST(test_tl_ref_ulp);
+}
+LN_TEST_TCASE_END
+
+LN_TEST_ADD_TCASE(ref);
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2018-2020 Zhixu Zhao
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "test_tensorlight.h"
+#include "lightnettest/ln_test.h"
+#include "tl_tensor.h"
+#include "tl_check.h"
+#include "tl_stream.h"
+
+#define NTASKS 64
+
+static int order[NTASKS];
+static int norder;
+static volatile int flag;
+
+static void checked_setup(void)
+{
+     norder = 0;
+     flag = 0;
+}
+
+static void checked_teardown(void)
+{
+}
+
+static void *append_func(void *arg)
+{
+     order[norder++] = (int)(long)arg;
+     return (char *)arg + 1;
+}
+
+static void *slow_set_flag_func(void *arg)
+{
+     usleep(50000);
+     flag = (int)(long)arg;
+     return NULL;
+}
+
+static void *get_flag_func(void *arg)
+{
+     (void)arg;
+     return (void *)(long)flag;
+}
+
+LN_TEST_START(test_tl_stream_order)
+{
+     tl_future *futures[NTASKS];
+     tl_stream *s;
+     int i;
+
+     s = tl_stream_create();
+     for (i = 0; i < NTASKS; i++)
+          futures[i] = tl_stream_enqueue(s, append_func, (void *)(long)i);
+     ck_assert_ptr_eq(tl_future_get(futures[NTASKS - 1]), (void *)(long)NTASKS);
+     for (i = 0; i < NTASKS; i++) {
+          ck_assert(tl_future_ready(futures[i]));
+          ck_assert_ptr_eq(tl_future_get(futures[i]), (void *)(long)(i + 1));
+          ck_assert_int_eq(order[i], i);
+          tl_future_free(futures[i]);
+     }
+
+     /* futures can be dropped before they're ready */
+     tl_future_free(tl_stream_enqueue(s, slow_set_flag_func, (void *)1L));
+     tl_stream_synchronize(s);
+     ck_assert_int_eq(flag, 1);
+
+     /* freeing a stream finishes its work */
+     tl_future_free(tl_stream_enqueue(s, slow_set_flag_func, (void *)2L));
+     tl_stream_free(s);
+     ck_assert_int_eq(flag, 2);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_stream_event)
+{
+     tl_stream *s1, *s2;
+     tl_future *f;
+     tl_event *e;
+
+     s1 = tl_stream_create();
+     s2 = tl_stream_create();
+     e = tl_event_create();
+     ck_assert(tl_event_query(e));
+
+     /* s2 must not read the flag before s1 has set it */
+     tl_future_free(tl_stream_enqueue(s1, slow_set_flag_func, (void *)1L));
+     tl_event_record(e, s1);
+     tl_stream_wait_event(s2, e);
+     f = tl_stream_enqueue(s2, get_flag_func, NULL);
+     ck_assert_int_eq((int)(long)tl_future_get(f), 1);
+     ck_assert(tl_event_query(e));
+     tl_future_free(f);
+
+     tl_future_free(tl_stream_enqueue(s1, slow_set_flag_func, (void *)3L));
+     tl_event_record(e, s1);
+     ck_assert(!tl_event_query(e));
+     tl_event_synchronize(e);
+     ck_assert(tl_event_query(e));
+     ck_assert_int_eq(flag, 3);
+
+     /* waiting for a freed event still works */
+     tl_future_free(tl_stream_enqueue(s1, slow_set_flag_func, (void *)4L));
+     tl_event_record(e, s1);
+     tl_stream_wait_event(s2, e);
+     tl_event_free(e);
+     f = tl_stream_enqueue(s2, get_flag_func, NULL);
+     ck_assert_int_eq((int)(long)tl_future_get(f), 4);
+     tl_future_free(f);
+
+     tl_stream_free(s1);
+     tl_stream_free(s2);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_stream_ops)
+{
+     int dims[] = {2, 3};
+     int axes[] = {1, 0};
+     float x_data[] = {1, -2, 3, -4, 5, -6};
+     float y_data[] = {1, 2, 3, 4, 5, 6};
+     float t1_data[] = {2, 0, 6, 0, 10, 0};
+     float t3_data[] = {2, 0, 0, 10, 6, 0};
+     float t4_data[] = {40, 0, 0, 100};
+     int t4_dims[] = {2, 2};
+     tl_tensor *x, *y, *t1, *t2, *t3, *t4;
+     tl_future *f1, *f2, *f3, *f4;
+     tl_stream *s1, *s2;
+     tl_event *e;
+
+     x = tl_tensor_create(x_data, 2, dims, TL_FLOAT);
+     y = tl_tensor_create(y_data, 2, dims, TL_FLOAT);
+     s1 = tl_stream_create();
+     s2 = tl_stream_create();
+     e = tl_event_create();
+
+     /* a two-stage pipeline: s2 starts on t1 once s1 has computed it */
+     f1 = tl_stream_elew(s1, x, y, NULL, TL_SUM);
+     t1 = tl_future_get(f1);
+     f2 = tl_stream_lrelu(s1, t1, t1, 0);
+     tl_event_record(e, s1);
+     tl_stream_wait_event(s2, e);
+     f3 = tl_stream_transpose(s2, t1, NULL, axes);
+     f4 = tl_stream_matmul(s2, t1, t1, NULL, 0, 1);
+
+     ck_assert_ptr_eq(tl_future_get(f2), t1);
+     ck_assert_array_float_eq_tol((float *)t1->data, t1_data, 6, 0);
+     t3 = tl_future_get(f3);
+     ck_assert_array_float_eq_tol((float *)t3->data, t3_data, 6, 0);
+     t4 = tl_future_get(f4);
+     ck_assert_array_int_eq(t4->dims, t4_dims, 2);
+     ck_assert_array_float_eq_tol((float *)t4->data, t4_data, 4, 0);
+
+     tl_future_free(f1);
+     tl_future_free(f2);
+     tl_future_free(f3);
+     tl_future_free(f4);
+     t2 = tl_future_get(f4 = tl_stream_convert(s1, t1, NULL, TL_INT32));
+     ck_assert_int_eq(((int32_t *)t2->data)[4], 10);
+     tl_future_free(f4);
+
+     tl_event_free(e);
+     tl_stream_free(s1);
+     tl_stream_free(s2);
+     tl_tensor_free(x);
+     tl_tensor_free(y);
+     tl_tensor_free_data_too(t1);
+     tl_tensor_free_data_too(t2);
+     tl_tensor_free_data_too(t3);
+     tl_tensor_free_data_too(t4);
+}
+LN_TEST_END
+/* end of tests */
+
+LN_TEST_TCASE_START(stream, checked_setup, checked_teardown)
+{
+     LN_TEST_ADD_TEST(test_tl_stream_order);
+     LN_TEST_ADD_TEST(test_tl_stream_event);
+     LN_TEST_ADD_TEST(test_tl_stream_ops);
+}
+LN_TEST_TCASE_END
+
+LN_TEST_ADD_TCASE(stream);
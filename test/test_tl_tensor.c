@@ -20,6 +20,9 @@
  * SOFTWARE.
  */
 
+#include <math.h>
+#include <unistd.h>
+
 #include "test_tensorlight.h"
 #include "lightnettest/ln_test.h"
 #include "tl_tensor.h"
@@ -193,6 +196,112 @@ LN_TEST_START(test_tl_tensor_rearange)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_arange_large)
+{
+    tl_dtype dtypes[] = { TL_DOUBLE, TL_FLOAT, TL_INT32, TL_UINT8, TL_FLOAT16, TL_BFLOAT16 };
+    uint8_t elem[sizeof(double)];
+    tl_tensor *dst;
+    size_t dsize;
+    double v;
+    int i, j;
+
+    /* split among threads and vector loops, but still what tl_convert gives */
+    for (i = 0; i < sizeof(dtypes) / sizeof(dtypes[0]); i++) {
+        dst = tl_tensor_arange(-300.5, 70000, 0.37, dtypes[i]);
+        ck_assert_int_eq(dst->len, 190002);
+        dsize = tl_size_of(dtypes[i]);
+        for (j = 0; j < dst->len; j++) {
+            v = -300.5 + 0.37 * j;
+            tl_convert(elem, dtypes[i], &v, TL_DOUBLE);
+            ck_assert(!memcmp(elem, tl_padd(dst->data, j, dsize), dsize));
+        }
+        tl_tensor_free_data_too(dst);
+    }
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_full)
+{
+    int dims[] = { 3, 70001 };
+    tl_tensor *t;
+    int i;
+
+    t = tl_tensor_full(2, dims, TL_INT16, -7.6);
+    ck_assert_int_eq(t->len, 3 * 70001);
+    for (i = 0; i < t->len; i++)
+        ck_assert_int_eq(((int16_t *)t->data)[i], -7);
+
+    tl_tensor_fill(t, 40000); /* saturated */
+    for (i = 0; i < t->len; i++)
+        ck_assert_int_eq(((int16_t *)t->data)[i], INT16_MAX);
+    tl_tensor_free_data_too(t);
+
+    t = tl_tensor_full(1, ARR(int, 5), TL_DOUBLE, 2.5);
+    ck_assert_array_float_eq_tol((double *)t->data, ARR(double, 2.5, 2.5, 2.5, 2.5, 2.5), 5, 0);
+    tl_tensor_free_data_too(t);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_random)
+{
+    int dims[] = { 1001, 1001 };
+    tl_tensor *t1, *t2;
+    double v, sum, sum2, mean, std;
+    int i, counts[8] = { 0 };
+    int nthreads = tl_get_num_threads();
+
+    /* element 0 takes the first two words of Philox4x32-10 with a zero counter
+       and key, 0x6627e8d5 and 0xe169c58d in the Random123 known answers */
+    t1 = tl_tensor_random_uniform(1, ARR(int, 3), TL_DOUBLE, 0, 1, 0);
+    v = ((0x6627e8d5u >> 5) * 67108864.0 + (0xe169c58du >> 6)) / 9007199254740992.0;
+    ck_assert(((double *)t1->data)[0] == v);
+    tl_tensor_free_data_too(t1);
+
+    /* the same whatever the number of threads */
+    tl_set_num_threads(1);
+    t1 = tl_tensor_random_normal(2, dims, TL_FLOAT, 2, 0.5, 7);
+    tl_set_num_threads(4);
+    t2 = tl_tensor_random_normal(2, dims, TL_FLOAT, 2, 0.5, 7);
+    tl_set_num_threads(nthreads);
+    tl_assert_tensor_eq(t1, t2);
+    for (i = 0, sum = 0, sum2 = 0; i < t1->len; i++) {
+        v = ((float *)t1->data)[i];
+        sum += v;
+        sum2 += v * v;
+    }
+    mean = sum / t1->len;
+    std = sqrt(sum2 / t1->len - mean * mean);
+    ck_assert(fabs(mean - 2) < 0.005 && fabs(std - 0.5) < 0.005);
+
+    /* an in-place fill with the same seed gives the same values */
+    tl_tensor_fill_normal(t2, 0, 1, 8);
+    tl_tensor_fill_normal(t2, 2, 0.5, 7);
+    tl_assert_tensor_eq(t1, t2);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t2);
+
+    t1 = tl_tensor_random_uniform(2, dims, TL_INT32, -3, 5, 9);
+    for (i = 0; i < t1->len; i++) {
+        ck_assert(((int32_t *)t1->data)[i] >= -3 && ((int32_t *)t1->data)[i] < 5);
+        counts[((int32_t *)t1->data)[i] + 3]++;
+    }
+    for (i = 0; i < 8; i++)
+        ck_assert(abs(counts[i] - t1->len / 8) < t1->len / 100);
+    tl_tensor_free_data_too(t1);
+
+    /* integers in [ceil(low), ceil(high)) for non-integer bounds */
+    memset(counts, 0, sizeof(counts));
+    t1 = tl_tensor_random_uniform(2, dims, TL_INT32, -3.5, 4.2, 10);
+    for (i = 0; i < t1->len; i++) {
+        ck_assert(((int32_t *)t1->data)[i] >= -3 && ((int32_t *)t1->data)[i] < 5);
+        counts[((int32_t *)t1->data)[i] + 3]++;
+    }
+    for (i = 0; i < 8; i++)
+        ck_assert(abs(counts[i] - t1->len / 8) < t1->len / 100);
+    tl_tensor_free_data_too(t1);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_issameshape)
 {
      tl_tensor *t1;
@@ -266,6 +375,199 @@ LN_TEST_START(test_tl_tensor_save)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_fprint_elided)
+{
+    tl_tensor *t;
+    FILE *fp;
+    char s[BUFSIZ];
+    size_t n;
+
+    t = tl_tensor_arange(0, 1000, 1, TL_INT32);
+    fp = tmpfile();
+    ck_assert_ptr_ne(fp, NULL);
+    tl_tensor_fprint_elided(fp, t, NULL, 100, 3);
+    rewind(fp);
+    n = fread(s, 1, sizeof(s) - 1, fp);
+    s[n] = '\0';
+    ck_assert_str_eq(s, "[0 1 2 ... 997 998 999]\n");
+    fclose(fp);
+    tl_tensor_free_data_too(t);
+
+    t = tl_tensor_arange(0, 5 * 2 * 6, 1, TL_FLOAT);
+    tl_tensor_reshape_src(t, 3, (int[]){5, 2, 6});
+    fp = tmpfile();
+    ck_assert_ptr_ne(fp, NULL);
+    tl_tensor_fprint_elided(fp, t, "%.1f", 10, 2);
+    /* not elided below the threshold */
+    tl_tensor_fprint_elided(fp, t, "%.1f", 60, 2);
+    rewind(fp);
+    n = fread(s, 1, sizeof(s) - 1, fp);
+    s[n] = '\0';
+    ck_assert_str_eq(s, "[[[0.0 1.0 ... 4.0 5.0]\n"
+                        "  [6.0 7.0 ... 10.0 11.0]]\n"
+                        " [[12.0 13.0 ... 16.0 17.0]\n"
+                        "  [18.0 19.0 ... 22.0 23.0]]\n"
+                        " ...\n"
+                        " [[36.0 37.0 ... 40.0 41.0]\n"
+                        "  [42.0 43.0 ... 46.0 47.0]]\n"
+                        " [[48.0 49.0 ... 52.0 53.0]\n"
+                        "  [54.0 55.0 ... 58.0 59.0]]]\n"
+                        "[[[0.0 1.0 2.0 3.0 4.0 5.0]\n"
+                        "  [6.0 7.0 8.0 9.0 10.0 11.0]]\n"
+                        " [[12.0 13.0 14.0 15.0 16.0 17.0]\n"
+                        "  [18.0 19.0 20.0 21.0 22.0 23.0]]\n"
+                        " [[24.0 25.0 26.0 27.0 28.0 29.0]\n"
+                        "  [30.0 31.0 32.0 33.0 34.0 35.0]]\n"
+                        " [[36.0 37.0 38.0 39.0 40.0 41.0]\n"
+                        "  [42.0 43.0 44.0 45.0 46.0 47.0]]\n"
+                        " [[48.0 49.0 50.0 51.0 52.0 53.0]\n"
+                        "  [54.0 55.0 56.0 57.0 58.0 59.0]]]\n");
+    fclose(fp);
+    tl_tensor_free_data_too(t);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_load)
+{
+    tl_tensor *t, *t1;
+    FILE *fp;
+
+    /* round trip through the fast formatter and parser */
+    t = tl_tensor_random_normal(3, (int[]){3, 4, 5}, TL_DOUBLE, 0, 1000, 1);
+    ck_assert_int_eq(tl_tensor_save("__test_tensor_load_tmp", t, "%.17g"), 0);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_DOUBLE);
+    ck_assert_ptr_ne(t1, NULL);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t);
+
+    t = tl_tensor_arange(-6, 6, 1, TL_INT8);
+    tl_tensor_reshape_src(t, 2, (int[]){3, 4});
+    tl_tensor_save("__test_tensor_load_tmp", t, NULL);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_INT8);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t);
+
+    /* 64-bit integers beyond 2^53 are read exactly */
+    t = tl_tensor_create(ARR(int64_t, INT64_MAX, INT64_MIN, INT64_MAX - 1, 9007199254740993),
+                         1, ARR(int, 4), TL_INT64);
+    ck_assert_int_eq(tl_tensor_save("__test_tensor_load_tmp", t, NULL), 0);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_INT64);
+    ck_assert_ptr_ne(t1, NULL);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free(t);
+    t = tl_tensor_create(ARR(uint64_t, UINT64_MAX, 0), 1, ARR(int, 2), TL_UINT64);
+    ck_assert_int_eq(tl_tensor_save("__test_tensor_load_tmp", t, NULL), 0);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_UINT64);
+    ck_assert_ptr_ne(t1, NULL);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free(t);
+
+    /* commas and converting to another dtype */
+    fp = fopen("__test_tensor_load_tmp", "w");
+    fputs("[[1.5, -2e1],\n [+.25, 3]]\n", fp);
+    fclose(fp);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_FLOAT);
+    ck_assert_int_eq(t1->ndim, 2);
+    ck_assert_array_int_eq(t1->dims, ARR(int, 2, 2), 2);
+    ck_assert_array_float_eq_tol((float *)t1->data, ARR(float, 1.5, -20, 0.25, 3), 4, 0);
+    tl_tensor_free_data_too(t1);
+    t1 = tl_tensor_load("__test_tensor_load_tmp", TL_INT32);
+    ck_assert_array_int_eq((int32_t *)t1->data, ARR(int32_t, 1, -20, 0, 3), 4);
+    tl_tensor_free_data_too(t1);
+
+    /* ragged rows */
+    fp = fopen("__test_tensor_load_tmp", "w");
+    fputs("[[1 2]\n [3]]\n", fp);
+    fclose(fp);
+    ck_assert_ptr_eq(tl_tensor_load("__test_tensor_load_tmp", TL_FLOAT), NULL);
+    ck_assert_int_eq(remove("__test_tensor_load_tmp"), 0);
+}
+LN_TEST_END
+
+static long file_size(const char *file_name)
+{
+    FILE *fp = fopen(file_name, "rb");
+    long size;
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+LN_TEST_START(test_tl_tensor_load_compressed)
+{
+    const char *file = "__test_tensor_compressed_tmp";
+    tl_tensor *t, *t1;
+    tl_dtype dtype;
+    tl_shuffle shuffle;
+    FILE *fp;
+    long size;
+    int i;
+
+    /* several blocks of every dtype, with every filter */
+    for (dtype = 0; dtype < TL_DTYPE_SIZE; dtype++) {
+        t = tl_tensor_random_uniform(3, (int[]){3, 300, 301}, dtype, 0, 100, 7);
+        for (shuffle = 0; shuffle < TL_SHUFFLE_SIZE; shuffle++) {
+            ck_assert_int_eq(tl_tensor_save_compressed(file, t, shuffle), 0);
+            t1 = tl_tensor_load_compressed(file);
+            ck_assert_ptr_ne(t1, NULL);
+            tl_assert_tensor_eq(t1, t);
+            tl_tensor_free_data_too(t1);
+        }
+        tl_tensor_free_data_too(t);
+    }
+
+    /* regular data shrinks a lot, a single element doesn't */
+    t = tl_tensor_arange(0, 100000, 1, TL_INT32);
+    ck_assert_int_eq(tl_tensor_save_compressed(file, t, TL_SHUFFLE_BYTE), 0);
+    ck_assert_int_lt(file_size(file), 100000 * 4 / 20);
+    t1 = tl_tensor_load_compressed(file);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t);
+
+    t = tl_tensor_full(1, (int[]){1}, TL_DOUBLE, -1.5);
+    ck_assert_int_eq(tl_tensor_save_compressed(file, t, TL_SHUFFLE_BIT), 0);
+    t1 = tl_tensor_load_compressed(file);
+    tl_assert_tensor_eq(t1, t);
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t);
+
+    /* damaged blocks may load as wrong data, but never overrun */
+    t = tl_tensor_arange(0, 100000, 1, TL_INT32);
+    for (i = 0; i < 64; i++) {
+        tl_tensor_save_compressed(file, t, i % 2 ? TL_SHUFFLE_BIT : TL_SHUFFLE_BYTE);
+        size = file_size(file);
+        fp = fopen(file, "r+b");
+        fseek(fp, size - 1 - (i * 7919) % 600, SEEK_SET);
+        fputc(i * 37, fp);
+        fclose(fp);
+        tl_tensor_free_data_too(tl_tensor_load_compressed(file));
+    }
+    tl_tensor_free_data_too(t);
+
+    /* truncated and foreign files */
+    t = tl_tensor_arange(0, 1000, 1, TL_FLOAT);
+    tl_tensor_save_compressed(file, t, TL_SHUFFLE_BYTE);
+    size = file_size(file);
+    ck_assert_int_eq(truncate(file, size - 1), 0);
+    ck_assert_ptr_eq(tl_tensor_load_compressed(file), NULL);
+    tl_tensor_save(file, t, NULL);
+    ck_assert_ptr_eq(tl_tensor_load_compressed(file), NULL);
+    fp = fopen(file, "w");
+    fclose(fp);
+    ck_assert_ptr_eq(tl_tensor_load_compressed(file), NULL);
+    tl_tensor_free_data_too(t);
+    ck_assert_int_eq(remove(file), 0);
+    ck_assert_ptr_eq(tl_tensor_load_compressed(file), NULL);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_zeros_slice)
 {
      tl_tensor *t1, *t2;
@@ -337,6 +639,40 @@ LN_TEST_START(test_tl_tensor_slice)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_slice_nd)
+{
+     tl_tensor *t1, *t2;
+     int32_t data[24];
+     int32_t data_slice1[] = {5, 7, 17, 19};
+     int32_t data_slice2[] = {12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23};
+     int32_t data_slice3[] = {0, 3, 12, 15};
+     int i;
+
+     for (i = 0; i < 24; i++)
+          data[i] = i;
+     t1 = tl_tensor_create(data, 3, ARR(int,2,3,4), TL_INT32);
+
+     t2 = tl_tensor_slice_nd(t1, NULL, ARR(int,0,1,1), ARR(int,2,2,4), ARR(int,1,1,2));
+     ck_assert_int_eq(t2->ndim, 3);
+     ck_assert_int_eq(t2->dims[0], 2);
+     ck_assert_int_eq(t2->dims[1], 1);
+     ck_assert_int_eq(t2->dims[2], 2);
+     ck_assert_array_int_eq((int32_t *)t2->data, data_slice1, t2->len);
+     tl_tensor_free_data_too(t2);
+
+     t2 = tl_tensor_zeros(3, ARR(int,1,3,4), TL_INT32);
+     t2 = tl_tensor_slice_nd(t1, t2, ARR(int,1,0,0), NULL, NULL);
+     ck_assert_array_int_eq((int32_t *)t2->data, data_slice2, t2->len);
+     tl_tensor_free_data_too(t2);
+
+     t2 = tl_tensor_slice_nd(t1, NULL, NULL, ARR(int,2,2,4), ARR(int,1,2,3));
+     ck_assert_array_int_eq((int32_t *)t2->data, data_slice3, t2->len);
+     tl_tensor_free_data_too(t2);
+
+     tl_tensor_free(t1);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_slice_nocopy)
 {
      tl_tensor *t1, *t2;
@@ -423,6 +759,119 @@ LN_TEST_START(test_tl_tensor_concat)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_pad)
+{
+     tl_tensor *t1, *t2, *t3;
+     uint8_t data[6] = {1, 2, 3, 4, 5, 6};
+     uint8_t data_const[20] = {9, 9, 9, 9, 9,
+                               9, 1, 2, 3, 9,
+                               9, 4, 5, 6, 9,
+                               9, 9, 9, 9, 9};
+     uint8_t data_reflect[10] = {2, 1, 2, 3, 2,
+                                 5, 4, 5, 6, 5};
+     uint8_t data_edge[16] = {1, 1, 2, 3,
+                              1, 1, 2, 3,
+                              4, 4, 5, 6,
+                              4, 4, 5, 6};
+
+     t1 = tl_tensor_create(data, 2, ARR(int,2,3), TL_UINT8);
+
+     t2 = tl_tensor_pad(t1, NULL, ARR(int,1,1,1,1), TL_PAD_CONSTANT, 9);
+     t3 = tl_tensor_create(data_const, 2, ARR(int,4,5), TL_UINT8);
+     tl_assert_tensor_eq(t2, t3);
+     tl_tensor_free(t3);
+     tl_tensor_free_data_too(t2);
+
+     t2 = tl_tensor_zeros(2, ARR(int,2,5), TL_UINT8);
+     t2 = tl_tensor_pad(t1, t2, ARR(int,0,0,1,1), TL_PAD_REFLECT, 0);
+     t3 = tl_tensor_create(data_reflect, 2, ARR(int,2,5), TL_UINT8);
+     tl_assert_tensor_eq(t2, t3);
+     tl_tensor_free(t3);
+     tl_tensor_free_data_too(t2);
+
+     t2 = tl_tensor_pad(t1, NULL, ARR(int,1,1,1,0), TL_PAD_EDGE, 0);
+     t3 = tl_tensor_create(data_edge, 2, ARR(int,4,4), TL_UINT8);
+     tl_assert_tensor_eq(t2, t3);
+
+     /* padding in place keeps the interior */
+     memset(t2->data, 0, 4);
+     memset((uint8_t *)t2->data + 12, 0, 4);
+     t2 = tl_tensor_pad_border(t2, ARR(int,1,1,0,0), TL_PAD_EDGE, 0);
+     tl_assert_tensor_eq(t2, t3);
+     tl_tensor_free(t3);
+     tl_tensor_free_data_too(t2);
+
+     tl_tensor_free(t1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_concat_n)
+{
+     tl_tensor *t, *srcs[3];
+     uint16_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+     uint16_t data_slice1[] = {1, 4, 7, 10};
+     uint16_t data_slice2[] = {2, 5, 8, 11};
+     uint16_t data_slice3[] = {3, 6, 9, 12};
+     uint16_t data_slice4[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+     srcs[0] = tl_tensor_create(data_slice1, 3, ARR(int,2,2,1), TL_UINT16);
+     srcs[1] = tl_tensor_create(data_slice2, 3, ARR(int,2,2,1), TL_UINT16);
+     srcs[2] = tl_tensor_create(data_slice3, 3, ARR(int,2,2,1), TL_UINT16);
+     t = tl_tensor_concat_n((const tl_tensor **)srcs, 3, NULL, 2);
+     ck_assert_int_eq(t->ndim, 3);
+     ck_assert_int_eq(t->dims[2], 3);
+     ck_assert_array_uint_eq((uint16_t*)t->data, data, t->len);
+     tl_tensor_free_data_too(t);
+     tl_tensor_free(srcs[0]);
+     tl_tensor_free(srcs[1]);
+     tl_tensor_free(srcs[2]);
+
+     srcs[0] = tl_tensor_create(data_slice4, 2, ARR(int,1,3), TL_UINT16);
+     srcs[1] = tl_tensor_create(data_slice4 + 3, 2, ARR(int,2,3), TL_UINT16);
+     t = tl_tensor_zeros(2, ARR(int,3,3), TL_UINT16);
+     t = tl_tensor_concat_n((const tl_tensor **)srcs, 2, t, 0);
+     ck_assert_array_uint_eq((uint16_t*)t->data, data_slice4, t->len);
+     tl_tensor_free_data_too(t);
+     tl_tensor_free(srcs[0]);
+     tl_tensor_free(srcs[1]);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_split_n)
+{
+     tl_tensor *t, *dsts[3];
+     uint16_t data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+     uint16_t data_slice1[] = {1, 4, 7, 10};
+     uint16_t data_slice2[] = {2, 3, 5, 6, 8, 9, 11, 12};
+     int i;
+
+     /* copies */
+     t = tl_tensor_create(data, 3, ARR(int,2,2,3), TL_UINT16);
+     dsts[0] = NULL;
+     dsts[1] = tl_tensor_zeros(3, ARR(int,2,2,2), TL_UINT16);
+     tl_tensor_split_n(t, dsts, 2, ARR(int,1,2), 2);
+     ck_assert(dsts[0]->owner != t);
+     ck_assert_int_eq(dsts[0]->dims[2], 1);
+     ck_assert_array_uint_eq((uint16_t*)dsts[0]->data, data_slice1, dsts[0]->len);
+     ck_assert_array_uint_eq((uint16_t*)dsts[1]->data, data_slice2, dsts[1]->len);
+     tl_tensor_free_data_too(dsts[0]);
+     tl_tensor_free_data_too(dsts[1]);
+     tl_tensor_free(t);
+
+     /* views */
+     t = tl_tensor_create(data, 3, ARR(int,1,3,4), TL_UINT16);
+     dsts[0] = dsts[1] = dsts[2] = NULL;
+     tl_tensor_split_n(t, dsts, 3, NULL, 1);
+     for (i = 0; i < 3; i++) {
+          ck_assert(dsts[i]->owner == t);
+          ck_assert_int_eq(dsts[i]->dims[1], 1);
+          ck_assert(dsts[i]->data == data + 4 * i);
+          tl_tensor_free(dsts[i]);
+     }
+     tl_tensor_free(t);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_reshape)
 {
      tl_tensor *t1, *t2;
@@ -503,6 +952,23 @@ LN_TEST_START(test_tl_tensor_maxreduce)
      tl_tensor_free_data_too(arg);
 
      tl_tensor_free(src);
+
+     /* values closer than 1 apart */
+     float data_f[6] = {0.25f, 0.75f, 0.5f, -0.5f, -0.25f, -0.75f};
+     float dst_data_f[2] = {0.75f, -0.25f};
+     int arg_data_f[2] = {1, 1};
+     int dims_f[2] = {2, 3};
+
+     src = tl_tensor_create(data_f, 2, dims_f, TL_FLOAT);
+     arg = tl_tensor_zeros_slice(src, 1, 1, TL_INT32);
+     dst = tl_tensor_maxreduce(src, NULL, arg, 1);
+     for (i = 0; i < dst->len; i++) {
+          ck_assert(((float *)dst->data)[i] == dst_data_f[i]);
+          ck_assert(((int32_t *)arg->data)[i] == arg_data_f[i]);
+     }
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free_data_too(arg);
+     tl_tensor_free(src);
 }
 LN_TEST_END
 
@@ -612,6 +1078,414 @@ LN_TEST_START(test_tl_tensor_dot_product)
 
      tl_tensor_free(src1);
      tl_tensor_free(src2);
+
+     /* a wider dst gets a wider result */
+     {
+          int8_t big1[4] = {100, 100, -100, 127};
+          int8_t big2[4] = {100, 100, -100, -128};
+          int32_t wide_data[1] = {30000 - 16256};
+
+          src1 = tl_tensor_create(big1, 1, ARR(int,4), TL_INT8);
+          src2 = tl_tensor_create(big2, 1, ARR(int,4), TL_INT8);
+          dst = tl_tensor_zeros(1, ARR(int,1), TL_INT32);
+          dst = tl_tensor_dot_product(src1, src2, dst);
+          ck_assert_array_int_eq((int32_t *)dst->data, wide_data, dst->len);
+          tl_tensor_free_data_too(dst);
+          tl_tensor_free(src1);
+          tl_tensor_free(src2);
+     }
+
+     /* integer sums wrap around modulo 2^64 */
+     {
+          int64_t wrap1[3] = {INT64_MAX, 2, -1};
+          int64_t wrap2[3] = {1, 1, 1};
+          int64_t wrap_data[1] = {INT64_MIN};
+
+          src1 = tl_tensor_create(wrap1, 1, ARR(int,3), TL_INT64);
+          src2 = tl_tensor_create(wrap2, 1, ARR(int,3), TL_INT64);
+          dst = tl_tensor_dot_product(src1, src2, NULL);
+          ck_assert(((int64_t *)dst->data)[0] == wrap_data[0]);
+          tl_tensor_free_data_too(dst);
+          tl_tensor_free(src1);
+          tl_tensor_free(src2);
+     }
+
+     /* long float vectors split into several chunks */
+     {
+          int i, n = 3 * 65536 + 7;
+          float *a = tl_alloc(sizeof(float) * n);
+          float *b = tl_alloc(sizeof(float) * n);
+          double expect = 0;
+
+          for (i = 0; i < n; i++) {
+               a[i] = (i % 17) * 0.25f;
+               b[i] = (i % 5) - 2.0f;
+               expect += (double)a[i] * b[i];
+          }
+          src1 = tl_tensor_create(a, 1, &n, TL_FLOAT);
+          src2 = tl_tensor_create(b, 1, &n, TL_FLOAT);
+          dst = tl_tensor_zeros(1, ARR(int,1), TL_DOUBLE);
+          dst = tl_tensor_dot_product(src1, src2, dst);
+          ck_assert(*(double *)dst->data == expect);
+          tl_tensor_free_data_too(dst);
+          tl_tensor_free_data_too(src1);
+          tl_tensor_free_data_too(src2);
+     }
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_norm)
+{
+     tl_tensor *src, *dst;
+     float data[6] = {3, -4, 0, 0, 0, 0};
+     int16_t idata[3] = {-7, 2, 5};
+     int8_t sat_data[1] = {127};
+     int dims[2] = {2, 3};
+
+     src = tl_tensor_create(data, 2, dims, TL_FLOAT);
+     dst = tl_tensor_norm(src, NULL, TL_NORM_L1);
+     ck_assert_int_eq(dst->dtype, TL_FLOAT);
+     ck_assert_int_eq(dst->ndim, 1);
+     ck_assert_int_eq(dst->dims[0], 1);
+     ck_assert(*(float *)dst->data == 7);
+     dst = tl_tensor_norm(src, dst, TL_NORM_L2);
+     ck_assert(*(float *)dst->data == 5);
+     dst = tl_tensor_norm(src, dst, TL_NORM_LINF);
+     ck_assert(*(float *)dst->data == 4);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+
+     src = tl_tensor_create(idata, 1, ARR(int,3), TL_INT16);
+     dst = tl_tensor_norm(src, NULL, TL_NORM_L1);
+     ck_assert_int_eq(dst->dtype, TL_DOUBLE);
+     ck_assert(*(double *)dst->data == 14);
+     dst = tl_tensor_norm(src, dst, TL_NORM_LINF);
+     ck_assert(*(double *)dst->data == 7);
+     tl_tensor_free_data_too(dst);
+
+     dst = tl_tensor_zeros(1, ARR(int,1), TL_INT8);
+     idata[0] = -1000;
+     dst = tl_tensor_norm(src, dst, TL_NORM_L1);
+     ck_assert_array_int_eq((int8_t *)dst->data, sat_data, 1);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_cosine_similarity)
+{
+     tl_tensor *src1, *src2, *dst;
+     double data1[4] = {1, 2, 3, 4};
+     double data2[4] = {-2, -4, -6, -8};
+     double zeros[4] = {0, 0, 0, 0};
+
+     src1 = tl_tensor_create(data1, 1, ARR(int,4), TL_DOUBLE);
+     src2 = tl_tensor_create(data2, 1, ARR(int,4), TL_DOUBLE);
+     dst = tl_tensor_cosine_similarity(src1, src2, NULL);
+     ck_assert_int_eq(dst->dtype, TL_DOUBLE);
+     ck_assert(fabs(*(double *)dst->data + 1) < 1e-12);
+     dst = tl_tensor_cosine_similarity(src1, src1, dst);
+     ck_assert(fabs(*(double *)dst->data - 1) < 1e-12);
+     tl_tensor_free(src2);
+
+     src2 = tl_tensor_create(zeros, 1, ARR(int,4), TL_DOUBLE);
+     dst = tl_tensor_cosine_similarity(src1, src2, dst);
+     ck_assert(*(double *)dst->data == 0);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src1);
+     tl_tensor_free(src2);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_conv2d)
+{
+     tl_tensor *src, *weight, *bias, *dst, *true_dst;
+     float src_data[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+     float ones[9] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+     float bias_data[1] = {1};
+     float dst_data[9] = {13, 22, 17, 28, 46, 34, 25, 40, 29};
+     float dst_data_s2[4] = {13, 17, 25, 29};
+     float dst_data_lrelu[9] = {-6, -10.5, -8, -13.5, -22.5, -16.5, -12, -19.5, -14};
+     int i, n;
+
+     /* single channel, NCHW and NHWC */
+     src = tl_tensor_create(src_data, 4, ARR(int,1,1,3,3), TL_FLOAT);
+     weight = tl_tensor_create(ones, 4, ARR(int,1,1,3,3), TL_FLOAT);
+     bias = tl_tensor_create(bias_data, 1, ARR(int,1), TL_FLOAT);
+     dst = tl_tensor_conv2d(src, weight, bias, NULL, NULL, ARR(int,1,1), NULL, 1,
+                            TL_NCHW, 0, 0);
+     true_dst = tl_tensor_create(dst_data, 4, ARR(int,1,1,3,3), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+
+     dst = tl_tensor_zeros(4, ARR(int,1,1,2,2), TL_FLOAT);
+     dst = tl_tensor_conv2d(src, weight, bias, dst, ARR(int,2,2), ARR(int,1,1), NULL, 1,
+                            TL_NCHW, 0, 0);
+     true_dst = tl_tensor_create(dst_data_s2, 4, ARR(int,1,1,2,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+     tl_tensor_free(weight);
+
+     for (i = 0; i < 9; i++)
+          ones[i] = -1;
+     src = tl_tensor_create(src_data, 4, ARR(int,1,3,3,1), TL_FLOAT);
+     weight = tl_tensor_create(ones, 4, ARR(int,3,3,1,1), TL_FLOAT);
+     dst = tl_tensor_conv2d(src, weight, NULL, NULL, NULL, ARR(int,1,1), NULL, 1,
+                            TL_NHWC, 1, 0.5);
+     true_dst = tl_tensor_create(dst_data_lrelu, 4, ARR(int,1,3,3,1), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+     tl_tensor_free(weight);
+     tl_tensor_free(bias);
+
+     /* NCHW and NHWC agree on the GEMM paths */
+     {
+          struct {
+               int C, OC, K, stride, pad, dilation, groups;
+          } cases[] = {
+               {16, 8, 3, 1, 1, 1, 1},
+               {16, 8, 3, 2, 2, 2, 2},
+               {8, 12, 1, 1, 0, 1, 2},
+          };
+          tl_tensor *src_nhwc, *weight_hwio, *dst_nhwc, *dst_nchw;
+
+          for (n = 0; n < sizeof(cases) / sizeof(cases[0]); n++) {
+               int C = cases[n].C, OC = cases[n].OC, K = cases[n].K;
+               int *st = ARR(int, cases[n].stride, cases[n].stride);
+               int *pd = ARR(int, cases[n].pad, cases[n].pad);
+               int *dl = ARR(int, cases[n].dilation, cases[n].dilation);
+
+               src = tl_tensor_zeros(4, ARR(int,2,C,7,9), TL_FLOAT);
+               weight = tl_tensor_zeros(4, ARR(int,OC,C/cases[n].groups,K,K), TL_FLOAT);
+               bias = tl_tensor_zeros(1, &OC, TL_FLOAT);
+               for (i = 0; i < src->len; i++)
+                    ((float *)src->data)[i] = (i * 7 % 13) / 13.0f - 0.5f;
+               for (i = 0; i < weight->len; i++)
+                    ((float *)weight->data)[i] = (i * 5 % 11) / 11.0f - 0.5f;
+               for (i = 0; i < OC; i++)
+                    ((float *)bias->data)[i] = i * 0.1f;
+               src_nhwc = tl_tensor_transpose(src, NULL, ARR(int,0,2,3,1));
+               weight_hwio = tl_tensor_transpose(weight, NULL, ARR(int,2,3,1,0));
+
+               dst = tl_tensor_conv2d(src, weight, bias, NULL, st, pd, dl,
+                                      cases[n].groups, TL_NCHW, 1, 0.1);
+               dst_nhwc = tl_tensor_conv2d(src_nhwc, weight_hwio, bias, NULL, st, pd, dl,
+                                           cases[n].groups, TL_NHWC, 1, 0.1);
+               dst_nchw = tl_tensor_transpose(dst_nhwc, NULL, ARR(int,0,3,1,2));
+               tl_assert_tensor_eq_tol(dst, dst_nchw, 1e-5);
+
+               tl_tensor_free_data_too(src);
+               tl_tensor_free_data_too(weight);
+               tl_tensor_free_data_too(bias);
+               tl_tensor_free_data_too(src_nhwc);
+               tl_tensor_free_data_too(weight_hwio);
+               tl_tensor_free_data_too(dst);
+               tl_tensor_free_data_too(dst_nhwc);
+               tl_tensor_free_data_too(dst_nchw);
+          }
+     }
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_maxpool2d)
+{
+     tl_tensor *src, *dst, *arg, *true_dst, *true_arg;
+     float src_data[16];
+     float dst_data1[4] = {5, 7, 13, 15};
+     int32_t arg_data1[4] = {5, 7, 13, 15};
+     float dst_data2[16] = {5, 6, 7, 7, 9, 10, 11, 11, 13, 14, 15, 15, 13, 14, 15, 15};
+     int32_t arg_data2[16] = {5, 6, 7, 7, 9, 10, 11, 11, 13, 14, 15, 15, 13, 14, 15, 15};
+     float dst_data3[4] = {10, 11, 14, 15};
+     float nhwc_data[8] = {1, -1, 2, -2, 3, -3, 4, -4};
+     float dst_data4[2] = {4, -1};
+     int32_t arg_data4[2] = {3, 0};
+     int i;
+
+     for (i = 0; i < 16; i++)
+          src_data[i] = i;
+     src = tl_tensor_create(src_data, 4, ARR(int,1,1,4,4), TL_FLOAT);
+
+     arg = tl_tensor_zeros(4, ARR(int,1,1,2,2), TL_INT32);
+     dst = tl_tensor_maxpool2d(src, NULL, arg, ARR(int,2,2), NULL, NULL, 0, TL_NCHW);
+     true_dst = tl_tensor_create(dst_data1, 4, ARR(int,1,1,2,2), TL_FLOAT);
+     true_arg = tl_tensor_create(arg_data1, 4, ARR(int,1,1,2,2), TL_INT32);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_assert_tensor_eq(arg, true_arg);
+     tl_tensor_free(true_dst);
+     tl_tensor_free(true_arg);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free_data_too(arg);
+
+     arg = tl_tensor_zeros(4, ARR(int,1,1,4,4), TL_INT32);
+     dst = tl_tensor_zeros(4, ARR(int,1,1,4,4), TL_FLOAT);
+     dst = tl_tensor_maxpool2d(src, dst, arg, ARR(int,3,3), ARR(int,1,1), ARR(int,1,1), 0,
+                               TL_NCHW);
+     true_dst = tl_tensor_create(dst_data2, 4, ARR(int,1,1,4,4), TL_FLOAT);
+     true_arg = tl_tensor_create(arg_data2, 4, ARR(int,1,1,4,4), TL_INT32);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_assert_tensor_eq(arg, true_arg);
+     tl_tensor_free(true_dst);
+     tl_tensor_free(true_arg);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free_data_too(arg);
+
+     dst = tl_tensor_maxpool2d(src, NULL, NULL, ARR(int,3,3), ARR(int,2,2), NULL, 1, TL_NCHW);
+     true_dst = tl_tensor_create(dst_data3, 4, ARR(int,1,1,2,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+
+     src = tl_tensor_create(nhwc_data, 4, ARR(int,1,2,2,2), TL_FLOAT);
+     arg = tl_tensor_zeros(4, ARR(int,1,1,1,2), TL_INT32);
+     dst = tl_tensor_maxpool2d(src, NULL, arg, ARR(int,2,2), NULL, NULL, 0, TL_NHWC);
+     true_dst = tl_tensor_create(dst_data4, 4, ARR(int,1,1,1,2), TL_FLOAT);
+     true_arg = tl_tensor_create(arg_data4, 4, ARR(int,1,1,1,2), TL_INT32);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_assert_tensor_eq(arg, true_arg);
+     tl_tensor_free(true_dst);
+     tl_tensor_free(true_arg);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free_data_too(arg);
+     tl_tensor_free(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_avgpool2d)
+{
+     tl_tensor *src, *dst, *true_dst;
+     float src_data[16];
+     float dst_data1[4] = {2.5, 4.5, 10.5, 12.5};
+     float nhwc_data[8] = {1, -1, 2, -2, 3, -3, 4, -4};
+     float dst_data2[2] = {2.5, -2.5};
+     int i;
+
+     for (i = 0; i < 16; i++)
+          src_data[i] = i;
+     src = tl_tensor_create(src_data, 4, ARR(int,1,1,4,4), TL_FLOAT);
+
+     dst = tl_tensor_avgpool2d(src, NULL, ARR(int,2,2), NULL, NULL, 0, 0, TL_NCHW);
+     true_dst = tl_tensor_create(dst_data1, 4, ARR(int,1,1,2,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+
+     dst = tl_tensor_avgpool2d(src, NULL, ARR(int,3,3), ARR(int,1,1), ARR(int,1,1), 0, 0,
+                               TL_NCHW);
+     ck_assert(fabs(((float *)dst->data)[0] - 2.5) < 1e-6);
+     ck_assert(fabs(((float *)dst->data)[5] - 5) < 1e-6);
+     dst = tl_tensor_avgpool2d(src, dst, ARR(int,3,3), ARR(int,1,1), ARR(int,1,1), 0, 1,
+                               TL_NCHW);
+     ck_assert(fabs(((float *)dst->data)[0] - 10.0 / 9) < 1e-6);
+     ck_assert(fabs(((float *)dst->data)[5] - 5) < 1e-6);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+
+     src = tl_tensor_create(nhwc_data, 4, ARR(int,1,2,2,2), TL_FLOAT);
+     dst = tl_tensor_avgpool2d(src, NULL, ARR(int,2,2), NULL, NULL, 0, 0, TL_NHWC);
+     true_dst = tl_tensor_create(dst_data2, 4, ARR(int,1,1,1,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_global_pool)
+{
+     tl_tensor *src, *dst, *true_dst;
+     float data[8] = {1, -1, 2, -2, 3, -3, 4, -4};
+     float max_nhwc[2] = {4, -1};
+     float avg_nhwc[2] = {2.5, -2.5};
+     float max_nchw[2] = {2, 4};
+     float avg_nchw[2] = {0, 0};
+
+     src = tl_tensor_create(data, 4, ARR(int,1,2,2,2), TL_FLOAT);
+     dst = tl_tensor_global_maxpool(src, NULL, TL_NHWC);
+     true_dst = tl_tensor_create(max_nhwc, 4, ARR(int,1,1,1,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     dst = tl_tensor_global_avgpool(src, dst, TL_NHWC);
+     true_dst = tl_tensor_create(avg_nhwc, 4, ARR(int,1,1,1,2), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+
+     dst = tl_tensor_global_maxpool(src, NULL, TL_NCHW);
+     true_dst = tl_tensor_create(max_nchw, 4, ARR(int,1,2,1,1), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     dst = tl_tensor_global_avgpool(src, dst, TL_NCHW);
+     true_dst = tl_tensor_create(avg_nchw, 4, ARR(int,1,2,1,1), TL_FLOAT);
+     tl_assert_tensor_eq(dst, true_dst);
+     tl_tensor_free(true_dst);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_matmul)
+{
+     float data1[] = {1, 2, 3, 4, 5, 6};
+     float data2[] = {1, 2, 3, 4, 5, 6};
+     float true_data[] = {22, 28, 49, 64};
+     float true_data_t1[] = {17, 22, 27, 22, 29, 36, 27, 36, 45};
+     float true_data_t2[] = {14, 32, 32, 77};
+     int32_t data3[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+     int32_t data4[] = {1, 0, 0, 1, 1, 1};
+     int32_t true_data_b[] = {4, 5, 10, 11, 16, 17, 22, 23};
+     double data5[] = {1, 2, 3, 4};
+     double data6[] = {1, 0, 0, 1, 2, 0, 0, 2};
+     double true_data_bc[] = {1, 2, 3, 4, 2, 4, 6, 8};
+     tl_tensor *src1, *src2, *dst, *true_tensor;
+
+     src1 = tl_tensor_create(data1, 2, ARR(int,2,3), TL_FLOAT);
+     src2 = tl_tensor_create(data2, 2, ARR(int,3,2), TL_FLOAT);
+     true_tensor = tl_tensor_create(true_data, 2, ARR(int,2,2), TL_FLOAT);
+     dst = tl_tensor_matmul(src1, src2, NULL, 0, 0);
+     tl_assert_tensor_eq(dst, true_tensor);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(true_tensor);
+
+     true_tensor = tl_tensor_create(true_data_t1, 2, ARR(int,3,3), TL_FLOAT);
+     dst = tl_tensor_zeros(2, ARR(int,3,3), TL_FLOAT);
+     tl_tensor_matmul(src1, src1, dst, 1, 0);
+     tl_assert_tensor_eq(dst, true_tensor);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(true_tensor);
+
+     true_tensor = tl_tensor_create(true_data_t2, 2, ARR(int,2,2), TL_FLOAT);
+     dst = tl_tensor_matmul(src1, src1, NULL, 0, 1);
+     tl_assert_tensor_eq(dst, true_tensor);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(true_tensor);
+     tl_tensor_free(src1);
+     tl_tensor_free(src2);
+
+     src1 = tl_tensor_create(data3, 3, ARR(int,2,2,3), TL_INT32);
+     src2 = tl_tensor_create(data4, 2, ARR(int,3,2), TL_INT32);
+     true_tensor = tl_tensor_create(true_data_b, 3, ARR(int,2,2,2), TL_INT32);
+     dst = tl_tensor_matmul(src1, src2, NULL, 0, 0);
+     tl_assert_tensor_eq(dst, true_tensor);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(true_tensor);
+     tl_tensor_free(src1);
+     tl_tensor_free(src2);
+
+     src1 = tl_tensor_create(data5, 3, ARR(int,1,2,2), TL_DOUBLE);
+     src2 = tl_tensor_create(data6, 4, ARR(int,2,1,2,2), TL_DOUBLE);
+     true_tensor = tl_tensor_create(true_data_bc, 4, ARR(int,2,1,2,2), TL_DOUBLE);
+     dst = tl_tensor_matmul(src1, src2, NULL, 0, 0);
+     tl_assert_tensor_eq(dst, true_tensor);
+     tl_tensor_free_data_too(dst);
+     tl_tensor_free(true_tensor);
+     tl_tensor_free(src1);
+     tl_tensor_free(src2);
 }
 LN_TEST_END
 
@@ -656,6 +1530,46 @@ LN_TEST_START(test_tl_tensor_transpose)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_transpose_inplace)
+{
+    int shapes[][4] = {{7, 5}, {64, 64}, {3, 70, 70}, {4, 3, 5}, {2, 3, 4, 5}, {1, 9, 1, 6}};
+    int perms[][4] = {{1, 0}, {1, 0}, {0, 2, 1}, {2, 0, 1}, {3, 1, 0, 2}, {2, 3, 0, 1}};
+    int ndims[] = {2, 2, 3, 3, 4, 4};
+    tl_dtype dtypes[] = {TL_UINT8, TL_FLOAT16, TL_FLOAT, TL_DOUBLE};
+    uint8_t data2[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    uint8_t true_data2[12] = {1, 7, 2, 8, 3, 9, 4, 10, 5, 11, 6, 12};
+    tl_tensor *src, *dst, *t;
+    int i, j, k;
+
+    for (i = 0; i < 6; i++) {
+        for (j = 0; j < 4; j++) {
+            src = tl_tensor_zeros(ndims[i], shapes[i], dtypes[j]);
+            for (k = 0; k < src->len * (int)tl_size_of(src->dtype); k++)
+                ((uint8_t *)src->data)[k] = (uint8_t)(k * 13 + k / 256);
+            dst = tl_tensor_transpose(src, NULL, perms[i]);
+
+            t = tl_tensor_clone(src);
+            ck_assert_ptr_eq(tl_tensor_transpose(t, t, perms[i]), t);
+            ck_assert_array_int_eq(t->dims, dst->dims, ndims[i]);
+            ck_assert(!memcmp(t->data, dst->data, dst->len * tl_size_of(dst->dtype)));
+            tl_tensor_free_data_too(t);
+
+            tl_tensor_free_data_too(src);
+            tl_tensor_free_data_too(dst);
+        }
+    }
+
+    /* a dst header sharing src's data */
+    src = tl_tensor_create(data2, 3, ARR(int,2,3,2), TL_UINT8);
+    dst = tl_tensor_create(data2, 3, ARR(int,3,2,2), TL_UINT8);
+    tl_tensor_transpose(src, dst, ARR(int,1,2,0));
+    ck_assert_array_int_eq(src->dims, ARR(int,2,3,2), 3);
+    ck_assert(!memcmp(data2, true_data2, 12));
+    tl_tensor_free(src);
+    tl_tensor_free(dst);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_lrelu)
 {
     float data_f[5] = {-1, 0, 1, 255, -256};
@@ -679,6 +1593,55 @@ LN_TEST_START(test_tl_tensor_lrelu)
 }
 LN_TEST_END
 
+LN_TEST_START(test_tl_tensor_softmax)
+{
+    float data_f[6] = {1, 2, 3, 1000, 1000, -1000};
+    double data_d[30];
+    double expect_d[30];
+    float expect_f[6] = {0.09003057, 0.24472847, 0.66524096, 0.5, 0.5, 0};
+    tl_tensor *t1, *t2, *t3;
+    double s;
+    int i, j, k;
+
+    t1 = tl_tensor_create(data_f, 2, (int[]){2, 3}, TL_FLOAT);
+    t2 = tl_tensor_softmax(t1, NULL, 1);
+    ck_assert(tl_tensor_issameshape(t1, t2));
+    ck_assert(t1->dtype == t2->dtype);
+    ck_assert_array_float_eq_tol((float *)t2->data, expect_f, t2->len, 1e-6);
+    ck_assert(((float *)t2->data)[5] == 0);
+
+    t3 = tl_tensor_log_softmax(t1, NULL, 0);
+    ck_assert_array_float_eq_tol((float *)t3->data,
+                                 ((float[]){-999, -998, 0, 0, 0, -1003}), t3->len, 1e-3);
+    tl_tensor_free_data_too(t3);
+
+    /* in place */
+    t2 = tl_tensor_softmax(t2, t2, 0);
+    ck_assert_float_eq_tol(((float *)t2->data)[0] + ((float *)t2->data)[3], 1, 1e-6);
+    tl_tensor_free_data_too(t2);
+    tl_tensor_free(t1);
+
+    /* an inner axis, against a direct computation */
+    for (i = 0; i < 30; i++)
+        data_d[i] = sin(i) * 10;
+    for (i = 0; i < 2; i++) {
+        for (k = 0; k < 5; k++) {
+            for (j = 0, s = 0; j < 3; j++)
+                s += exp(data_d[(i * 3 + j) * 5 + k]);
+            for (j = 0; j < 3; j++)
+                expect_d[(i * 3 + j) * 5 + k] = data_d[(i * 3 + j) * 5 + k] - log(s);
+        }
+    }
+    t1 = tl_tensor_create(data_d, 3, (int[]){2, 3, 5}, TL_DOUBLE);
+    t2 = tl_tensor_log_softmax(t1, NULL, 1);
+    t3 = tl_tensor_create(expect_d, 3, (int[]){2, 3, 5}, TL_DOUBLE);
+    tl_assert_tensor_eq_tol(t2, t3, 1e-12);
+    tl_tensor_free_data_too(t2);
+    tl_tensor_free(t3);
+    tl_tensor_free(t1);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_convert)
 {
      float data_f[5] = {-1, 0, 1, 255, 256};
@@ -710,6 +1673,88 @@ LN_TEST_START(test_tl_tensor_convert)
 }
 LN_TEST_END
 
+/* in-place results must match the out-of-place ones, across the vector
+   heads and tails of every kernel */
+LN_TEST_START(test_tl_tensor_inplace)
+{
+    tl_dtype dtypes[] = {TL_FLOAT, TL_INT32, TL_INT8, TL_FLOAT16, TL_BFLOAT16};
+    tl_tensor *a, *b, *t, *expect, *alias;
+    double v;
+    int i, j;
+
+    for (j = 0; j < 5; j++) {
+        a = tl_tensor_zeros(1, ARR(int,1037), dtypes[j]);
+        b = tl_tensor_zeros(1, ARR(int,1037), dtypes[j]);
+        for (i = 0; i < a->len; i++) {
+            v = (i % 23) - 11;
+            tl_convert(tl_padd(a->data, i, tl_size_of(a->dtype)), a->dtype, &v, TL_DOUBLE);
+            v = (i % 5) + 1;
+            tl_convert(tl_padd(b->data, i, tl_size_of(b->dtype)), b->dtype, &v, TL_DOUBLE);
+        }
+
+        expect = tl_tensor_elew(a, b, NULL, TL_MUL);
+        t = tl_tensor_clone(a);
+        tl_tensor_elew(t, b, t, TL_MUL);
+        tl_assert_tensor_eq(t, expect);
+        tl_tensor_free_data_too(t);
+        t = tl_tensor_clone(b);
+        tl_tensor_elew(a, t, t, TL_MUL);
+        tl_assert_tensor_eq(t, expect);
+        tl_tensor_free_data_too(t);
+        tl_tensor_free_data_too(expect);
+
+        expect = tl_tensor_elew(a, a, NULL, TL_SUM);
+        t = tl_tensor_clone(a);
+        tl_tensor_elew(t, t, t, TL_SUM);
+        tl_assert_tensor_eq(t, expect);
+        tl_tensor_free_data_too(t);
+        tl_tensor_free_data_too(expect);
+
+        expect = tl_tensor_elew_param(a, 3, NULL, TL_SUB);
+        t = tl_tensor_clone(a);
+        tl_tensor_elew_param(t, 3, t, TL_SUB);
+        tl_assert_tensor_eq(t, expect);
+        tl_tensor_free_data_too(t);
+        tl_tensor_free_data_too(expect);
+
+        expect = tl_tensor_lrelu(a, NULL, 0.5);
+        t = tl_tensor_clone(a);
+        tl_tensor_lrelu(t, t, 0.5);
+        tl_assert_tensor_eq(t, expect);
+        tl_tensor_free_data_too(t);
+        tl_tensor_free_data_too(expect);
+
+        tl_tensor_free_data_too(a);
+        tl_tensor_free_data_too(b);
+    }
+
+    /* converting between dtypes of the same size over the same data */
+    a = tl_tensor_zeros(1, ARR(int,1037), TL_FLOAT);
+    for (i = 0; i < a->len; i++)
+        ((float *)a->data)[i] = (i % 101) * 0.75f - 37;
+    expect = tl_tensor_convert(a, NULL, TL_INT32);
+    alias = tl_tensor_create(a->data, 1, ARR(int,1037), TL_INT32);
+    tl_tensor_convert(a, alias, TL_INT32);
+    tl_assert_tensor_eq(alias, expect);
+    tl_tensor_free(alias);
+    tl_tensor_free_data_too(expect);
+    tl_tensor_free_data_too(a);
+
+    a = tl_tensor_zeros(1, ARR(int,1037), TL_FLOAT16);
+    for (i = 0; i < a->len; i++) {
+        v = (i % 101) * 0.75 - 37;
+        tl_convert(tl_padd(a->data, i, 2), TL_FLOAT16, &v, TL_DOUBLE);
+    }
+    expect = tl_tensor_convert(a, NULL, TL_BFLOAT16);
+    alias = tl_tensor_create(a->data, 1, ARR(int,1037), TL_BFLOAT16);
+    tl_tensor_convert(a, alias, TL_BFLOAT16);
+    tl_assert_tensor_eq(alias, expect);
+    tl_tensor_free(alias);
+    tl_tensor_free_data_too(expect);
+    tl_tensor_free_data_too(a);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_resize)
 {
      float src_data[] = {1, 2, 3, 4};
@@ -733,6 +1778,62 @@ LN_TEST_START(test_tl_tensor_resize)
 }
 LN_TEST_END
 
+/* every kernel variant the CPU can run gives the generic results */
+LN_TEST_START(test_tl_tensor_cpu_level)
+{
+     tl_dtype dtypes[] = {TL_FLOAT, TL_INT16, TL_UINT8};
+     tl_tensor *src1, *src2, *ref[7], *res[7], *arg_ref = NULL, *arg_res;
+     int dims[3] = {3, 37, 41};
+     int axes[3] = {2, 0, 1};
+     int new_dims[3] = {5, 19, 67};
+     tl_cpu_level level, saved;
+     int d, i, k, n;
+
+     saved = tl_get_cpu_level();
+     for (d = 0; d < 3; d++) {
+          src1 = tl_tensor_zeros(3, dims, dtypes[d]);
+          src2 = tl_tensor_zeros(3, dims, dtypes[d]);
+          for (i = 0; i < src1->len; i++) {
+               double v1 = (i * 7 % 23) - 11, v2 = (i * 5 % 13) + 1;
+               tl_convert(tl_padd(src1->data, i, tl_size_of(dtypes[d])), dtypes[d], &v1, TL_DOUBLE);
+               tl_convert(tl_padd(src2->data, i, tl_size_of(dtypes[d])), dtypes[d], &v2, TL_DOUBLE);
+          }
+          for (level = TL_CPU_GENERIC; level < TL_CPU_LEVEL_SIZE; level++) {
+               if (!tl_cpu_level_supported(level))
+                    continue;
+               tl_set_cpu_level(level);
+               arg_res = tl_tensor_zeros_slice(src1, 1, 1, TL_INT32);
+               n = 0;
+               res[n++] = tl_tensor_elew(src1, src2, NULL, TL_MUL);
+               res[n++] = tl_tensor_elew(src1, src2, NULL, TL_MAX);
+               res[n++] = tl_tensor_elew_param(src1, 3, NULL, TL_SUB);
+               res[n++] = tl_tensor_convert(src1, NULL, TL_INT8);
+               res[n++] = tl_tensor_maxreduce(src1, NULL, arg_res, 1);
+               res[n++] = tl_tensor_transpose(src1, NULL, axes);
+               res[n++] = tl_tensor_resize(src1, NULL, new_dims, TL_NEAREST);
+               if (level == TL_CPU_GENERIC) {
+                    for (k = 0; k < n; k++)
+                         ref[k] = res[k];
+                    arg_ref = arg_res;
+                    continue;
+               }
+               for (k = 0; k < n; k++) {
+                    tl_assert_tensor_eq(res[k], ref[k]);
+                    tl_tensor_free_data_too(res[k]);
+               }
+               tl_assert_tensor_eq(arg_res, arg_ref);
+               tl_tensor_free_data_too(arg_res);
+          }
+          for (k = 0; k < n; k++)
+               tl_tensor_free_data_too(ref[k]);
+          tl_tensor_free_data_too(arg_ref);
+          tl_tensor_free_data_too(src1);
+          tl_tensor_free_data_too(src2);
+     }
+     tl_set_cpu_level(saved);
+}
+LN_TEST_END
+
 LN_TEST_START(test_tl_tensor_submean)
 {
     uint8_t src_data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
@@ -757,6 +1858,572 @@ LN_TEST_START(test_tl_tensor_submean)
 
     tl_tensor_free(src);
     tl_tensor_free(true_tensor);
+
+    /* the TL_FLOAT path is computed in float, within an ulp or so of double */
+    double mean_f[] = {0.1, -2.7, 1e3 / 3};
+    double v;
+    int c, i;
+    src = tl_tensor_zeros(3, ARR(int,7,5,3), TL_FLOAT);
+    for (i = 0; i < src->len; i++)
+        ((float *)src->data)[i] = (i * 37 % 101) * 0.731f - 20;
+    dst = tl_tensor_submean(src, NULL, mean_f);
+    for (c = 0; c < 3; c++) {
+        for (i = 0; i < 35; i++) {
+            v = ((float *)src->data)[i * 3 + c] - mean_f[c];
+            ck_assert_float_eq_tol(((float *)dst->data)[c * 35 + i], v, 1e-6 * (fabs(v) + 400));
+        }
+    }
+    tl_tensor_free_data_too(dst);
+    tl_tensor_free_data_too(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_preprocess)
+{
+    uint8_t src_data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    float true_data1[] = {5, 11, 17, 23, 1, 4, 7, 10, -0.25, 1.25, 2.75, 4.25};
+    float true_data2[] = {1, 1, 4, 4, 1, 1, 4, 4, 7, 7, 10, 10, 7, 7, 10, 10,
+                          2, 2, 5, 5, 2, 2, 5, 5, 8, 8, 11, 11, 8, 8, 11, 11,
+                          3, 3, 6, 6, 3, 3, 6, 6, 9, 9, 12, 12, 9, 9, 12, 12};
+    float src_data3[] = {0, 10};
+    float true_data3[] = {0, 2.5, 7.5, 10};
+    float dst_data[12];
+    double mean[] = {1, 2, 3};
+    double std[] = {1, 2, 4};
+    tl_tensor *src, *dst, *true_tensor;
+
+    src = tl_tensor_create(src_data, 3, ARR(int,2,2,3), TL_UINT8);
+    true_tensor = tl_tensor_create(true_data1, 3, ARR(int,3,2,2), TL_FLOAT);
+    dst = tl_tensor_preprocess(src, NULL, NULL, TL_NEAREST, mean, std, 2, 1);
+    tl_assert_tensor_eq(dst, true_tensor);
+    tl_tensor_free_data_too(dst);
+
+    dst = tl_tensor_create(dst_data, 3, ARR(int,3,2,2), TL_FLOAT);
+    tl_tensor_preprocess(src, dst, ARR(int,2,2), TL_LINEAR, mean, std, 2, 1);
+    tl_assert_tensor_eq(dst, true_tensor);
+    tl_tensor_free(dst);
+    tl_tensor_free(true_tensor);
+
+    true_tensor = tl_tensor_create(true_data2, 3, ARR(int,3,4,4), TL_FLOAT);
+    dst = tl_tensor_preprocess(src, NULL, ARR(int,4,4), TL_NEAREST, NULL, NULL, 1, 0);
+    tl_assert_tensor_eq(dst, true_tensor);
+    tl_tensor_free_data_too(dst);
+    tl_tensor_free(true_tensor);
+    tl_tensor_free(src);
+
+    src = tl_tensor_create(src_data3, 3, ARR(int,1,2,1), TL_FLOAT);
+    true_tensor = tl_tensor_create(true_data3, 3, ARR(int,1,1,4), TL_FLOAT);
+    dst = tl_tensor_preprocess(src, NULL, ARR(int,1,4), TL_LINEAR, NULL, NULL, 1, 0);
+    tl_assert_tensor_eq_tol(dst, true_tensor, 1e-5);
+    tl_tensor_free_data_too(dst);
+    tl_tensor_free(true_tensor);
+    tl_tensor_free(src);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_preprocess_batch)
+{
+    const tl_tensor *srcs[5];
+    tl_tensor *imgs[5], *dst, *one;
+    double mean[] = {1, 2, 3};
+    double std[] = {1, 2, 4};
+    size_t plane = 3 * 20 * 30;
+    int i, j;
+
+    /* rows of different images end up in the same thread chunks */
+    for (i = 0; i < 5; i++) {
+        imgs[i] = tl_tensor_zeros(3, ARR(int,37,53,3), TL_UINT8);
+        for (j = 0; j < imgs[i]->len; j++)
+            ((uint8_t *)imgs[i]->data)[j] = (uint8_t)(j * 7 + i * 31);
+        srcs[i] = imgs[i];
+    }
+    dst = tl_tensor_preprocess_batch(srcs, 5, NULL, ARR(int,20,30), TL_LINEAR, mean, std,
+                                     0.5, 1);
+    ck_assert_int_eq(dst->ndim, 4);
+    ck_assert_array_int_eq(dst->dims, ARR(int,5,3,20,30), 4);
+    for (i = 0; i < 5; i++) {
+        one = tl_tensor_preprocess(imgs[i], NULL, ARR(int,20,30), TL_LINEAR, mean, std, 0.5, 1);
+        ck_assert(!memcmp((float *)dst->data + plane * i, one->data, plane * sizeof(float)));
+        tl_tensor_free_data_too(one);
+    }
+    tl_tensor_free_data_too(dst);
+
+    dst = tl_tensor_zeros(4, ARR(int,5,3,37,53), TL_FLOAT);
+    tl_tensor_preprocess_batch(srcs, 5, dst, NULL, TL_NEAREST, mean, NULL, 1, 0);
+    one = tl_tensor_submean(imgs[3], NULL, mean);
+    ck_assert(!memcmp((float *)dst->data + one->len * 3, one->data, one->len * sizeof(float)));
+    tl_tensor_free_data_too(one);
+    tl_tensor_free_data_too(dst);
+
+    for (i = 0; i < 5; i++)
+        tl_tensor_free_data_too(imgs[i]);
+}
+LN_TEST_END
+
+static tl_tensor *read_batch(const char *file_name, int batch, int ndim, const int *dims)
+{
+    tl_tensor *t;
+    int i, len;
+
+    t = tl_tensor_zeros(ndim, dims, TL_FLOAT);
+    len = t->len / batch;
+    ck_assert_int_eq(tl_read_floats(file_name, len, t->data), len);
+    for (i = 1; i < batch; i++)
+        memmove((float *)t->data + len * i, t->data, len * sizeof(float));
+    return t;
+}
+
+/* expected values are from test_yolo.py */
+LN_TEST_START(test_tl_tensor_detect_yolov3)
+{
+    tl_tensor *feature, *anchors, *box_centers, *box_sizes, *boxes, *confs, *probs;
+    tl_tensor *true_tensor;
+
+    feature = read_batch("data/feature.txt", 2, 4, ARR(int,2,24,5,5));
+    anchors = read_batch("data/anchors.txt", 1, 2, ARR(int,3,2));
+    box_centers = tl_tensor_zeros(5, ARR(int,2,3,2,5,5), TL_FLOAT);
+    box_sizes = tl_tensor_zeros(5, ARR(int,2,3,2,5,5), TL_FLOAT);
+    boxes = tl_tensor_zeros(5, ARR(int,2,3,4,5,5), TL_FLOAT);
+    confs = tl_tensor_zeros(5, ARR(int,2,3,1,5,5), TL_FLOAT);
+    probs = tl_tensor_zeros(5, ARR(int,2,3,3,5,5), TL_FLOAT);
+    tl_tensor_detect_yolov3(feature, anchors, box_centers, box_sizes, boxes, confs, probs, 160,
+                            160);
+
+    true_tensor = read_batch("data/box_centers.txt", 2, 5, ARR(int,2,3,2,5,5));
+    tl_assert_tensor_eq_tol(box_centers, true_tensor, 1e-3);
+    tl_tensor_free_data_too(true_tensor);
+    true_tensor = read_batch("data/box_sizes.txt", 2, 5, ARR(int,2,3,2,5,5));
+    tl_assert_tensor_eq_tol(box_sizes, true_tensor, 1e-3);
+    tl_tensor_free_data_too(true_tensor);
+    true_tensor = read_batch("data/boxes.txt", 2, 5, ARR(int,2,3,4,5,5));
+    tl_assert_tensor_eq_tol(boxes, true_tensor, 1e-3);
+    tl_tensor_free_data_too(true_tensor);
+    true_tensor = read_batch("data/confs.txt", 2, 5, ARR(int,2,3,1,5,5));
+    tl_assert_tensor_eq_tol(confs, true_tensor, 1e-5);
+    tl_tensor_free_data_too(true_tensor);
+    true_tensor = read_batch("data/probs.txt", 2, 5, ARR(int,2,3,3,5,5));
+    tl_assert_tensor_eq_tol(probs, true_tensor, 1e-5);
+    tl_tensor_free_data_too(true_tensor);
+
+    /* unneeded outputs can be skipped */
+    tl_tensor_detect_yolov3(feature, anchors, NULL, NULL, NULL, confs, NULL, 160, 160);
+
+    tl_tensor_free_data_too(feature);
+    tl_tensor_free_data_too(anchors);
+    tl_tensor_free_data_too(box_centers);
+    tl_tensor_free_data_too(box_sizes);
+    tl_tensor_free_data_too(boxes);
+    tl_tensor_free_data_too(confs);
+    tl_tensor_free_data_too(probs);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_nms)
+{
+    /* box 1 overlaps box 0 by 81/119, box 2 overlaps box 0 by 1/199,
+       box 3 scores too low */
+    float boxes_data[] = {0, 0, 10, 10, 1, 1, 11, 11, 9, 9, 19, 19, 0, 0, 10, 10,
+                          0, 0, 1, 1, 0, 0, 1, 1, 5, 5, 6, 6, 0, 0, 2, 2};
+    float scores_data[] = {0.9, 0.8, 0.7, 0.1, 0.5, 0.5, 0.6, 0.7};
+    int32_t true_data1[] = {0, 2, -1, -1, 3, 2, 0, -1};
+    int32_t true_data2[] = {0, 1, 3, 2};
+    tl_tensor *boxes, *scores, *dst, *true_tensor;
+
+    boxes = tl_tensor_create(boxes_data, 3, ARR(int,2,4,4), TL_FLOAT);
+    scores = tl_tensor_create(scores_data, 2, ARR(int,2,4), TL_FLOAT);
+
+    /* in image 1, boxes 0 and 1 tie, so 0 goes first by index and
+       suppresses its duplicate 1; both overlap box 3 by only 1/4 */
+    dst = tl_tensor_nms(boxes, scores, NULL, 0.3, 0.2, 0);
+    true_tensor = tl_tensor_create(true_data1, 2, ARR(int,2,4), TL_INT32);
+    tl_assert_tensor_eq(dst, true_tensor);
+    tl_tensor_free_data_too(dst);
+    tl_tensor_free(true_tensor);
+
+    dst = tl_tensor_zeros(2, ARR(int,2,2), TL_INT32);
+    tl_tensor_nms(boxes, scores, dst, 0.9, 0, 2);
+    true_tensor = tl_tensor_create(true_data2, 2, ARR(int,2,2), TL_INT32);
+    tl_assert_tensor_eq(dst, true_tensor);
+    tl_tensor_free_data_too(dst);
+    tl_tensor_free(true_tensor);
+
+    tl_tensor_free(boxes);
+    tl_tensor_free(scores);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_quantize)
+{
+    float data_f[8] = {-1, 0, 0.5, 1, 100, -100, 0.25, 0.75};
+    int8_t expect_i8[8] = {8, 10, 11, 12, 127, -128, 10, 12};
+    float expect_f[8] = {-1, 0, 0.5, 1, 58.5, -69, 0, 1};
+    float data_c[6] = {1, 2, 3, 1, 2, 3};
+    uint8_t expect_c0[6] = {1, 2, 3, 3, 5, 7};
+    uint8_t expect_c1[6] = {1, 3, 8, 1, 3, 8};
+    tl_quant *q;
+    tl_tensor *t1, *t2, *t3;
+
+    q = tl_quant_create(-1, 1, ARR(float, 0.5), ARR(int32_t, 10));
+    t1 = tl_tensor_create(data_f, 1, ARR(int, 8), TL_FLOAT);
+    t2 = tl_tensor_quantize(t1, NULL, TL_INT8, q);
+    ck_assert_int_eq(t2->dtype, TL_INT8);
+    ck_assert(t2->quant && t2->quant != q);
+    ck_assert_int_eq(t2->quant->axis, -1);
+    ck_assert(!memcmp(t2->data, expect_i8, sizeof(expect_i8)));
+
+    t3 = tl_tensor_dequantize(t2, NULL);
+    ck_assert_int_eq(t3->dtype, TL_FLOAT);
+    ck_assert_array_float_eq_tol((float *)t3->data, expect_f, 8, 0);
+    tl_tensor_free_data_too(t3);
+
+    t3 = tl_tensor_clone(t2);
+    ck_assert(t3->quant && t3->quant != t2->quant);
+    ck_assert(t3->quant->scales[0] == 0.5f && t3->quant->zero_points[0] == 10);
+    tl_tensor_set_quant(t3, NULL);
+    ck_assert_ptr_eq(t3->quant, NULL);
+    tl_tensor_free_data_too(t3);
+    tl_tensor_free_data_too(t2);
+    tl_tensor_free(t1);
+    tl_quant_free(q);
+
+    /* per channel, on the outer and on the inner axis */
+    t1 = tl_tensor_create(data_c, 2, ARR(int, 2, 3), TL_FLOAT);
+    q = tl_quant_create(0, 2, ARR(float, 1, 0.5), ARR(int32_t, 0, 1));
+    t2 = tl_tensor_quantize(t1, NULL, TL_UINT8, q);
+    ck_assert(!memcmp(t2->data, expect_c0, sizeof(expect_c0)));
+    t3 = tl_tensor_dequantize(t2, NULL);
+    tl_assert_tensor_eq(t3, t1);
+    tl_tensor_free_data_too(t3);
+    tl_tensor_free_data_too(t2);
+    tl_quant_free(q);
+
+    q = tl_quant_create(1, 3, ARR(float, 1, 1, 0.5), ARR(int32_t, 0, 1, 2));
+    t2 = tl_tensor_quantize(t1, NULL, TL_UINT8, q);
+    ck_assert(!memcmp(t2->data, expect_c1, sizeof(expect_c1)));
+    t3 = tl_tensor_zeros(2, ARR(int, 2, 3), TL_FLOAT);
+    tl_tensor_dequantize(t2, t3);
+    tl_assert_tensor_eq(t3, t1);
+    tl_tensor_free_data_too(t3);
+    tl_tensor_free_data_too(t2);
+    tl_quant_free(q);
+    tl_tensor_free(t1);
+}
+LN_TEST_END
+
+/* |a - b| <= 1 for quantized tensors of the same dtype */
+static void assert_qtensor_near(const tl_tensor *a, const tl_tensor *b)
+{
+    int32_t x, y;
+    int i;
+
+    ck_assert(tl_tensor_issameshape(a, b));
+    ck_assert_int_eq(a->dtype, b->dtype);
+    for (i = 0; i < a->len; i++) {
+        TL_TENSOR_DATA_TO(a, i, x, TL_INT32);
+        TL_TENSOR_DATA_TO(b, i, y, TL_INT32);
+        ck_assert_msg(abs(x - y) <= 1, "element %d: %d vs %d", i, x, y);
+    }
+}
+
+/* the float result of op, quantized with q */
+static tl_tensor *qexpect(const tl_tensor *f, tl_dtype dtype, const tl_quant *q)
+{
+    return tl_tensor_quantize(f, NULL, dtype, q);
+}
+
+LN_TEST_START(test_tl_tensor_qelew)
+{
+    tl_quant *q1, *q2, *qd;
+    tl_tensor *f1, *f2, *t1, *t2, *t3, *fr, *fd, *expect;
+    tl_elew_op ops[3] = {TL_SUM, TL_SUB, TL_MUL};
+    int i, k;
+
+    f1 = tl_tensor_zeros(1, ARR(int, 300), TL_FLOAT);
+    f2 = tl_tensor_zeros(1, ARR(int, 300), TL_FLOAT);
+    for (i = 0; i < 300; i++) {
+        ((float *)f1->data)[i] = (i % 37 - 18) * 0.11f;
+        ((float *)f2->data)[i] = (i % 23 - 11) * 0.07f;
+    }
+    q1 = tl_quant_create(-1, 1, ARR(float, 0.02), ARR(int32_t, 3));
+    q2 = tl_quant_create(-1, 1, ARR(float, 0.01), ARR(int32_t, -5));
+    qd = tl_quant_create(-1, 1, ARR(float, 0.03), ARR(int32_t, 1));
+    t1 = tl_tensor_quantize(f1, NULL, TL_INT8, q1);
+    t2 = tl_tensor_quantize(f2, NULL, TL_INT8, q2);
+    for (k = 0; k < 3; k++) {
+        t3 = tl_tensor_qelew(t1, t2, NULL, ops[k], qd);
+        fr = tl_tensor_dequantize(t1, NULL);
+        fd = tl_tensor_dequantize(t2, NULL);
+        tl_tensor_elew(fr, fd, fr, ops[k]);
+        expect = qexpect(fr, TL_INT8, qd);
+        assert_qtensor_near(t3, expect);
+        tl_tensor_free_data_too(expect);
+        tl_tensor_free_data_too(fd);
+        tl_tensor_free_data_too(fr);
+        tl_tensor_free_data_too(t3);
+    }
+
+    /* lrelu, requantized or keeping src's parameters */
+    fr = tl_tensor_dequantize(t1, NULL);
+    tl_tensor_lrelu(fr, fr, 0.1);
+    t3 = tl_tensor_qlrelu(t1, NULL, 0.1, NULL);
+    ck_assert(t3->quant->scales[0] == 0.02f && t3->quant->zero_points[0] == 3);
+    expect = qexpect(fr, TL_INT8, q1);
+    assert_qtensor_near(t3, expect);
+    tl_tensor_free_data_too(expect);
+    tl_tensor_free_data_too(t3);
+    t3 = tl_tensor_qlrelu(t1, NULL, 0.1, qd);
+    expect = qexpect(fr, TL_INT8, qd);
+    assert_qtensor_near(t3, expect);
+    tl_tensor_free_data_too(expect);
+    tl_tensor_free_data_too(t3);
+    tl_tensor_free_data_too(fr);
+
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(t2);
+    tl_tensor_free_data_too(f1);
+    tl_tensor_free_data_too(f2);
+    tl_quant_free(q1);
+    tl_quant_free(q2);
+    tl_quant_free(qd);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_tensor_qmatmul)
+{
+    tl_quant *q1, *q2, *q2c, *qd;
+    tl_tensor *f1, *f2, *t1, *t2, *acc, *t3, *fa, *fb, *fr, *expect;
+    int32_t sum;
+    int i, j, p, b, trans2;
+
+    f1 = tl_tensor_zeros(3, ARR(int, 2, 5, 70), TL_FLOAT);
+    for (i = 0; i < f1->len; i++)
+        ((float *)f1->data)[i] = (i * 7 % 31) * 0.05f;
+    q1 = tl_quant_create(-1, 1, ARR(float, 0.01), ARR(int32_t, 7));
+    q2 = tl_quant_create(-1, 1, ARR(float, 0.02), ARR(int32_t, -3));
+    qd = tl_quant_create(-1, 1, ARR(float, 1), ARR(int32_t, 128));
+    t1 = tl_tensor_quantize(f1, NULL, TL_UINT8, q1);
+
+    for (trans2 = 0; trans2 < 2; trans2++) {
+        f2 = tl_tensor_zeros(2, trans2 ? ARR(int, 6, 70) : ARR(int, 70, 6), TL_FLOAT);
+        for (i = 0; i < f2->len; i++)
+            ((float *)f2->data)[i] = (i * 11 % 29 - 14) * 0.1f;
+        q2c = tl_quant_create(trans2 ? 0 : 1, 6, ARR(float, 0.01, 0.02, 0.03, 0.04, 0.05, 0.06),
+                              NULL);
+
+        /* the accumulators are exact */
+        t2 = tl_tensor_quantize(f2, NULL, TL_INT8, q2);
+        acc = tl_tensor_qmatmul(t1, t2, NULL, 0, trans2, NULL);
+        ck_assert_int_eq(acc->dtype, TL_INT32);
+        ck_assert(acc->ndim == 3 && acc->dims[0] == 2 && acc->dims[1] == 5 && acc->dims[2] == 6);
+        ck_assert(fabsf(acc->quant->scales[0] - 0.0002f) < 1e-9);
+        for (b = 0; b < 2; b++) {
+            for (i = 0; i < 5; i++) {
+                for (j = 0; j < 6; j++) {
+                    for (p = 0, sum = 0; p < 70; p++)
+                        sum += (((uint8_t *)t1->data)[(b * 5 + i) * 70 + p] - 7) *
+                               (((int8_t *)t2->data)[trans2 ? j * 70 + p : p * 6 + j] + 3);
+                    ck_assert_int_eq(((int32_t *)acc->data)[(b * 5 + i) * 6 + j], sum);
+                }
+            }
+        }
+        tl_tensor_free_data_too(acc);
+
+        /* requantized, with src2 per tensor and per column */
+        for (p = 0; p < 2; p++) {
+            tl_tensor_free_data_too(t2);
+            t2 = tl_tensor_quantize(f2, NULL, TL_INT8, p ? q2c : q2);
+            t3 = tl_tensor_qmatmul(t1, t2, NULL, 0, trans2, qd);
+            ck_assert_int_eq(t3->dtype, TL_UINT8);
+            fa = tl_tensor_dequantize(t1, NULL);
+            fb = tl_tensor_dequantize(t2, NULL);
+            fr = tl_tensor_matmul(fa, fb, NULL, 0, trans2);
+            expect = qexpect(fr, TL_UINT8, qd);
+            assert_qtensor_near(t3, expect);
+            tl_tensor_free_data_too(expect);
+            tl_tensor_free_data_too(fr);
+            tl_tensor_free_data_too(fa);
+            tl_tensor_free_data_too(fb);
+            tl_tensor_free_data_too(t3);
+        }
+        tl_tensor_free_data_too(t2);
+        tl_tensor_free_data_too(f2);
+        tl_quant_free(q2c);
+    }
+
+    tl_tensor_free_data_too(t1);
+    tl_tensor_free_data_too(f1);
+    tl_quant_free(q1);
+    tl_quant_free(q2);
+    tl_quant_free(qd);
+}
+LN_TEST_END
+/* the companion's shape is the one of the dst the op allocates itself */
+static void assert_out_shape(const tl_shape *shape, const tl_tensor *t)
+{
+    tl_shape expect;
+    int i;
+
+    tl_tensor_shape(t, &expect);
+    ck_assert_int_eq(shape->dtype, expect.dtype);
+    ck_assert_int_eq(shape->ndim, expect.ndim);
+    for (i = 0; i < shape->ndim; i++)
+        ck_assert_int_eq(shape->dims[i], expect.dims[i]);
+}
+
+LN_TEST_START(test_tl_tensor_out_shape)
+{
+    tl_tensor *a, *b, *img, *w, *boxes, *scores, *feature, *anchors, *q8, *t, *ts[3];
+    tl_tensor *outs[5];
+    const tl_tensor *srcs[2];
+    tl_shape shape, shapes[5];
+    tl_quant *q;
+    void *buf;
+    int i;
+
+    a = tl_tensor_zeros(3, ARR(int, 2, 6, 4), TL_FLOAT);
+    b = tl_tensor_zeros(3, ARR(int, 2, 6, 4), TL_FLOAT);
+    for (i = 0; i < a->len; i++)
+        ((float *)a->data)[i] = (i % 13) * 0.25f - 1;
+
+    /* the shape is all a caller needs to place a dst before running the op */
+    tl_tensor_pad_out_shape(a, ARR(int, 0, 1, 2, 0, 1, 1), &shape);
+    ck_assert_int_eq(tl_shape_size(&shape), 3 * 8 * 6 * sizeof(float));
+    buf = tl_alloc(tl_shape_size(&shape));
+    t = tl_tensor_create_shape(buf, &shape);
+    ck_assert_ptr_eq(tl_tensor_pad(a, t, ARR(int, 0, 1, 2, 0, 1, 1), TL_PAD_CONSTANT, 0), t);
+    tl_tensor_free(t);
+    tl_free(buf);
+
+#define CHECK_OUT_SHAPE(op, out_shape)          \
+    do {                                        \
+        ck_assert_ptr_eq(out_shape, &shape);    \
+        t = op;                                 \
+        assert_out_shape(&shape, t);            \
+        tl_tensor_free_data_too(t);             \
+    } while (0)
+
+    CHECK_OUT_SHAPE(tl_tensor_repeat(a, 3), tl_tensor_repeat_out_shape(a, 3, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_arange(1, 10, 2, TL_INT16),
+                    tl_tensor_arange_out_shape(1, 10, 2, TL_INT16, &shape));
+    ck_assert_ptr_eq(tl_tensor_arange_out_shape(0, 3e9, 1, TL_INT8, &shape), NULL);
+    CHECK_OUT_SHAPE(tl_tensor_slice(a, NULL, 1, 2, 3),
+                    tl_tensor_slice_out_shape(a, 1, 2, 3, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_slice_nd(a, NULL, ARR(int, 0, 1, 1), NULL, ARR(int, 1, 2, 3)),
+                    tl_tensor_slice_nd_out_shape(a, ARR(int, 0, 1, 1), NULL, ARR(int, 1, 2, 3),
+                                                 &shape));
+    CHECK_OUT_SHAPE(tl_tensor_pad(a, NULL, ARR(int, 1, 0, 0, 2, 3, 3), TL_PAD_EDGE, 0),
+                    tl_tensor_pad_out_shape(a, ARR(int, 1, 0, 0, 2, 3, 3), &shape));
+    CHECK_OUT_SHAPE(tl_tensor_concat(a, b, NULL, 1), tl_tensor_concat_out_shape(a, b, 1, &shape));
+    srcs[0] = a;
+    srcs[1] = b;
+    CHECK_OUT_SHAPE(tl_tensor_concat_n(srcs, 2, NULL, 2),
+                    tl_tensor_concat_n_out_shape(srcs, 2, 2, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_maxreduce(a, NULL, NULL, 1),
+                    tl_tensor_maxreduce_out_shape(a, 1, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_elew(a, b, NULL, TL_MUL), tl_tensor_elew_out_shape(a, b, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_elew_param(a, 2, NULL, TL_POW),
+                    tl_tensor_elew_param_out_shape(a, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_dot_product(a, b, NULL),
+                    tl_tensor_dot_product_out_shape(a, b, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_norm(a, NULL, TL_NORM_L1),
+                    tl_tensor_norm_out_shape(a, TL_NORM_L1, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_cosine_similarity(a, b, NULL),
+                    tl_tensor_cosine_similarity_out_shape(a, b, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_matmul(a, b, NULL, 0, 1),
+                    tl_tensor_matmul_out_shape(a, b, 0, 1, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_transpose(a, NULL, ARR(int, 2, 0, 1)),
+                    tl_tensor_transpose_out_shape(a, ARR(int, 2, 0, 1), &shape));
+    CHECK_OUT_SHAPE(tl_tensor_lrelu(a, NULL, 0.1), tl_tensor_lrelu_out_shape(a, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_softmax(a, NULL, 1), tl_tensor_softmax_out_shape(a, 1, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_log_softmax(a, NULL, 2),
+                    tl_tensor_log_softmax_out_shape(a, 2, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_convert(a, NULL, TL_BFLOAT16),
+                    tl_tensor_convert_out_shape(a, TL_BFLOAT16, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_resize(a, NULL, ARR(int, 4, 3, 8), TL_NEAREST),
+                    tl_tensor_resize_out_shape(a, ARR(int, 4, 3, 8), TL_NEAREST, &shape));
+
+    tl_tensor_split_n_out_shape(a, 3, ARR(int, 1, 3, 2), 1, shapes);
+    memset(ts, 0, sizeof(ts));
+    tl_tensor_split_n(a, ts, 3, ARR(int, 1, 3, 2), 1);
+    for (i = 0; i < 3; i++) {
+        assert_out_shape(&shapes[i], ts[i]);
+        tl_tensor_free_data_too(ts[i]);
+    }
+
+    img = tl_tensor_zeros(4, ARR(int, 2, 3, 11, 9), TL_FLOAT);
+    w = tl_tensor_zeros(4, ARR(int, 6, 1, 3, 3), TL_FLOAT);
+    CHECK_OUT_SHAPE(tl_tensor_conv2d(img, w, NULL, NULL, ARR(int, 2, 1), ARR(int, 1, 0),
+                                     ARR(int, 1, 2), 3, TL_NCHW, 0, 0),
+                    tl_tensor_conv2d_out_shape(img, w, ARR(int, 2, 1), ARR(int, 1, 0),
+                                               ARR(int, 1, 2), 3, TL_NCHW, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_maxpool2d(img, NULL, NULL, ARR(int, 3, 2), NULL, ARR(int, 1, 1), 1,
+                                        TL_NHWC),
+                    tl_tensor_maxpool2d_out_shape(img, ARR(int, 3, 2), NULL, ARR(int, 1, 1), 1,
+                                                  TL_NHWC, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_avgpool2d(img, NULL, ARR(int, 2, 2), ARR(int, 1, 2), NULL, 0, 0,
+                                        TL_NCHW),
+                    tl_tensor_avgpool2d_out_shape(img, ARR(int, 2, 2), ARR(int, 1, 2), NULL, 0,
+                                                  TL_NCHW, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_global_maxpool(img, NULL, TL_NHWC),
+                    tl_tensor_global_maxpool_out_shape(img, TL_NHWC, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_global_avgpool(img, NULL, TL_NCHW),
+                    tl_tensor_global_avgpool_out_shape(img, TL_NCHW, &shape));
+    tl_tensor_free_data_too(img);
+    tl_tensor_free_data_too(w);
+
+    img = tl_tensor_zeros(3, ARR(int, 5, 7, 3), TL_UINT8);
+    CHECK_OUT_SHAPE(tl_tensor_submean(img, NULL, ARR(double, 1, 2, 3)),
+                    tl_tensor_submean_out_shape(img, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_preprocess(img, NULL, ARR(int, 4, 6), TL_LINEAR, NULL, NULL, 1, 1),
+                    tl_tensor_preprocess_out_shape(img, ARR(int, 4, 6), &shape));
+    srcs[0] = img;
+    srcs[1] = img;
+    CHECK_OUT_SHAPE(tl_tensor_preprocess_batch(srcs, 2, NULL, NULL, TL_NEAREST, NULL, NULL, 1, 0),
+                    tl_tensor_preprocess_batch_out_shape(srcs, 2, NULL, &shape));
+    tl_tensor_free_data_too(img);
+
+    boxes = tl_tensor_zeros(3, ARR(int, 2, 10, 4), TL_FLOAT);
+    scores = tl_tensor_zeros(2, ARR(int, 2, 10), TL_FLOAT);
+    CHECK_OUT_SHAPE(tl_tensor_nms(boxes, scores, NULL, 0.5, 0.1, 4),
+                    tl_tensor_nms_out_shape(boxes, scores, 4, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_nms(boxes, scores, NULL, 0.5, 0.1, 0),
+                    tl_tensor_nms_out_shape(boxes, scores, 0, &shape));
+    tl_tensor_free_data_too(boxes);
+    tl_tensor_free_data_too(scores);
+
+    feature = tl_tensor_zeros(4, ARR(int, 1, 2 * (5 + 3), 4, 5), TL_FLOAT);
+    anchors = tl_tensor_zeros(2, ARR(int, 2, 2), TL_FLOAT);
+    tl_tensor_detect_yolov3_out_shape(feature, anchors, &shapes[0], &shapes[1], &shapes[2],
+                                      &shapes[3], &shapes[4]);
+    for (i = 0; i < 5; i++)
+        outs[i] = tl_tensor_zeros_shape(&shapes[i]);
+    tl_tensor_detect_yolov3(feature, anchors, outs[0], outs[1], outs[2], outs[3], outs[4], 64,
+                            80);
+    ck_assert_int_eq(shapes[2].dims[2], 4);
+    ck_assert_int_eq(shapes[4].dims[2], 3);
+    for (i = 0; i < 5; i++)
+        tl_tensor_free_data_too(outs[i]);
+    tl_tensor_free_data_too(feature);
+    tl_tensor_free_data_too(anchors);
+
+    q = tl_quant_create(-1, 1, ARR(float, 0.05), ARR(int32_t, 3));
+    CHECK_OUT_SHAPE(tl_tensor_quantize(a, NULL, TL_INT8, q),
+                    tl_tensor_quantize_out_shape(a, TL_INT8, &shape));
+    q8 = tl_tensor_quantize(b, NULL, TL_INT8, q);
+    CHECK_OUT_SHAPE(tl_tensor_dequantize(q8, NULL), tl_tensor_dequantize_out_shape(q8, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_qelew(q8, q8, NULL, TL_SUM, q),
+                    tl_tensor_qelew_out_shape(q8, q8, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_qlrelu(q8, NULL, 0.1, NULL), tl_tensor_qlrelu_out_shape(q8, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_qmatmul(q8, q8, NULL, 0, 1, NULL),
+                    tl_tensor_qmatmul_out_shape(q8, q8, 0, 1, NULL, &shape));
+    CHECK_OUT_SHAPE(tl_tensor_qmatmul(q8, q8, NULL, 1, 0, q),
+                    tl_tensor_qmatmul_out_shape(q8, q8, 1, 0, q, &shape));
+    tl_tensor_free_data_too(q8);
+    tl_quant_free(q);
+
+#undef CHECK_OUT_SHAPE
+    tl_tensor_free_data_too(a);
+    tl_tensor_free_data_too(b);
 }
 LN_TEST_END
 /* end of tests */
@@ -769,24 +2436,53 @@ LN_TEST_TCASE_START(tensor, checked_setup, checked_teardown)
     LN_TEST_ADD_TEST(test_tl_tensor_repeat);
     LN_TEST_ADD_TEST(test_tl_tensor_arange);
     LN_TEST_ADD_TEST(test_tl_tensor_rearange);
+    LN_TEST_ADD_TEST(test_tl_tensor_arange_large);
+    LN_TEST_ADD_TEST(test_tl_tensor_full);
+    LN_TEST_ADD_TEST(test_tl_tensor_random);
     LN_TEST_ADD_TEST(test_tl_tensor_issameshape);
     LN_TEST_ADD_TEST(test_tl_tensor_fprint);
     LN_TEST_ADD_TEST(test_tl_tensor_print);
     LN_TEST_ADD_TEST(test_tl_tensor_save);
+    LN_TEST_ADD_TEST(test_tl_tensor_fprint_elided);
+    LN_TEST_ADD_TEST(test_tl_tensor_load);
+    LN_TEST_ADD_TEST(test_tl_tensor_load_compressed);
     LN_TEST_ADD_TEST(test_tl_tensor_zeros_slice);
     LN_TEST_ADD_TEST(test_tl_tensor_slice);
+    LN_TEST_ADD_TEST(test_tl_tensor_slice_nd);
     LN_TEST_ADD_TEST(test_tl_tensor_slice_nocopy);
     LN_TEST_ADD_TEST(test_tl_tensor_concat);
+    LN_TEST_ADD_TEST(test_tl_tensor_pad);
+    LN_TEST_ADD_TEST(test_tl_tensor_concat_n);
+    LN_TEST_ADD_TEST(test_tl_tensor_split_n);
     LN_TEST_ADD_TEST(test_tl_tensor_reshape);
     LN_TEST_ADD_TEST(test_tl_tensor_maxreduce);
     LN_TEST_ADD_TEST(test_tl_tensor_elew);
     LN_TEST_ADD_TEST(test_tl_tensor_elew_param);
     LN_TEST_ADD_TEST(test_tl_tensor_dot_product);
+    LN_TEST_ADD_TEST(test_tl_tensor_norm);
+    LN_TEST_ADD_TEST(test_tl_tensor_cosine_similarity);
+    LN_TEST_ADD_TEST(test_tl_tensor_conv2d);
+    LN_TEST_ADD_TEST(test_tl_tensor_maxpool2d);
+    LN_TEST_ADD_TEST(test_tl_tensor_avgpool2d);
+    LN_TEST_ADD_TEST(test_tl_tensor_global_pool);
+    LN_TEST_ADD_TEST(test_tl_tensor_matmul);
     LN_TEST_ADD_TEST(test_tl_tensor_transpose);
+    LN_TEST_ADD_TEST(test_tl_tensor_transpose_inplace);
     LN_TEST_ADD_TEST(test_tl_tensor_lrelu);
+    LN_TEST_ADD_TEST(test_tl_tensor_softmax);
     LN_TEST_ADD_TEST(test_tl_tensor_convert);
+    LN_TEST_ADD_TEST(test_tl_tensor_inplace);
     LN_TEST_ADD_TEST(test_tl_tensor_resize);
+    LN_TEST_ADD_TEST(test_tl_tensor_cpu_level);
     LN_TEST_ADD_TEST(test_tl_tensor_submean);
+    LN_TEST_ADD_TEST(test_tl_tensor_preprocess);
+    LN_TEST_ADD_TEST(test_tl_tensor_preprocess_batch);
+    LN_TEST_ADD_TEST(test_tl_tensor_detect_yolov3);
+    LN_TEST_ADD_TEST(test_tl_tensor_nms);
+    LN_TEST_ADD_TEST(test_tl_tensor_quantize);
+    LN_TEST_ADD_TEST(test_tl_tensor_qelew);
+    LN_TEST_ADD_TEST(test_tl_tensor_qmatmul);
+    LN_TEST_ADD_TEST(test_tl_tensor_out_shape);
 }
 LN_TEST_TCASE_END
 
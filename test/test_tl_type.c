@@ -26,6 +26,7 @@
 #include "tl_type.h"
 #include "tl_util.h"
 #include "tl_check.h"
+#include "tl_kernel.h"
 
 static void checked_setup(void)
 {
@@ -46,6 +47,8 @@ LN_TEST_START(test_tl_size_of)
     ck_assert_int_eq(tl_size_of(TL_UINT16), sizeof(uint16_t));
     ck_assert_int_eq(tl_size_of(TL_UINT8), sizeof(uint8_t));
     ck_assert_int_eq(tl_size_of(TL_BOOL), sizeof(tl_bool_t));
+    ck_assert_int_eq(tl_size_of(TL_FLOAT16), sizeof(tl_float16_t));
+    ck_assert_int_eq(tl_size_of(TL_BFLOAT16), sizeof(tl_bfloat16_t));
 }
 LN_TEST_END
 
@@ -811,6 +814,10 @@ LN_TEST_START(test_tl_cmp)
     ck_assert(tl_cmp(&val1_float, &val2_float, TL_FLOAT) < 0);
     ck_assert(tl_cmp(&val2_float, &val1_float, TL_FLOAT) > 0);
     ck_assert(tl_cmp(&val1_float, &val1_float, TL_FLOAT) == 0);
+    val1_float = 0.25;
+    val2_float = 0.5;
+    ck_assert(tl_cmp(&val1_float, &val2_float, TL_FLOAT) < 0);
+    ck_assert(tl_cmp(&val2_float, &val1_float, TL_FLOAT) > 0);
 
     ck_assert(tl_cmp(&val1_int32, &val2_int32, TL_INT32) < 0);
     ck_assert(tl_cmp(&val2_int32, &val1_int32, TL_INT32) > 0);
@@ -1633,6 +1640,26 @@ LN_TEST_START(test_tl_convert)
     ck_assert(val_b == val_b_true);
     tl_convert(&val_b, TL_BOOL, &val_b_false, TL_BOOL);
     ck_assert(val_b == val_b_false);
+
+    /* TL_INT64 and TL_UINT64 */
+    int64_t val_i64;
+    uint64_t val_u64;
+    const int64_t val_i64_max = INT64_MAX;
+    const int64_t val_i64_min = INT64_MIN;
+    const uint64_t val_u64_max = UINT64_MAX;
+
+    tl_convert(&val_i32, TL_INT32, &val_i64_max, TL_INT64);
+    ck_assert(val_i32 == val_i32_max);
+    tl_convert(&val_i32, TL_INT32, &val_i64_min, TL_INT64);
+    ck_assert(val_i32 == val_i32_min);
+    tl_convert(&val_i64, TL_INT64, &val_u64_max, TL_UINT64);
+    ck_assert(val_i64 == val_i64_max);
+    tl_convert(&val_u64, TL_UINT64, &val_i64_min, TL_INT64);
+    ck_assert(val_u64 == 0);
+    tl_convert(&val_u64, TL_UINT64, &val_i32_max, TL_INT32);
+    ck_assert(val_u64 == (uint64_t)val_i32_max);
+    tl_convert(&val_u8, TL_UINT8, &val_u64_max, TL_UINT64);
+    ck_assert(val_u8 == val_u8_max);
 }
 LN_TEST_END
 
@@ -1654,6 +1681,174 @@ LN_TEST_START(test_tl_sort_dir_from_str)
     ck_assert_int_eq(tl_sort_dir_from_str("sdf"), -1);
 }
 LN_TEST_END
+
+LN_TEST_START(test_tl_norm_type_name)
+{
+    ck_assert_str_eq(tl_norm_type_name(TL_NORM_L1), "TL_NORM_L1");
+    ck_assert_str_eq(tl_norm_type_name(TL_NORM_L2), "TL_NORM_L2");
+    ck_assert_str_eq(tl_norm_type_name(TL_NORM_LINF), "TL_NORM_LINF");
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_norm_type_from_str)
+{
+    ck_assert_int_eq(tl_norm_type_from_str("TL_NORM_L1"), TL_NORM_L1);
+    ck_assert_int_eq(tl_norm_type_from_str("TL_NORM_L2"), TL_NORM_L2);
+    ck_assert_int_eq(tl_norm_type_from_str("TL_NORM_LINF"), TL_NORM_LINF);
+    ck_assert_int_eq(tl_norm_type_from_str("sdf"), -1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_layout_name)
+{
+    ck_assert_str_eq(tl_layout_name(TL_NCHW), "TL_NCHW");
+    ck_assert_str_eq(tl_layout_name(TL_NHWC), "TL_NHWC");
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_layout_from_str)
+{
+    ck_assert_int_eq(tl_layout_from_str("TL_NCHW"), TL_NCHW);
+    ck_assert_int_eq(tl_layout_from_str("TL_NHWC"), TL_NHWC);
+    ck_assert_int_eq(tl_layout_from_str("sdf"), -1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_pad_mode_name)
+{
+    ck_assert_str_eq(tl_pad_mode_name(TL_PAD_CONSTANT), "TL_PAD_CONSTANT");
+    ck_assert_str_eq(tl_pad_mode_name(TL_PAD_REFLECT), "TL_PAD_REFLECT");
+    ck_assert_str_eq(tl_pad_mode_name(TL_PAD_EDGE), "TL_PAD_EDGE");
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_pad_mode_from_str)
+{
+    ck_assert_int_eq(tl_pad_mode_from_str("TL_PAD_CONSTANT"), TL_PAD_CONSTANT);
+    ck_assert_int_eq(tl_pad_mode_from_str("TL_PAD_REFLECT"), TL_PAD_REFLECT);
+    ck_assert_int_eq(tl_pad_mode_from_str("TL_PAD_EDGE"), TL_PAD_EDGE);
+    ck_assert_int_eq(tl_pad_mode_from_str("sdf"), -1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_shuffle_name)
+{
+    ck_assert_str_eq(tl_shuffle_name(TL_SHUFFLE_NONE), "TL_SHUFFLE_NONE");
+    ck_assert_str_eq(tl_shuffle_name(TL_SHUFFLE_BYTE), "TL_SHUFFLE_BYTE");
+    ck_assert_str_eq(tl_shuffle_name(TL_SHUFFLE_BIT), "TL_SHUFFLE_BIT");
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_shuffle_from_str)
+{
+    ck_assert_int_eq(tl_shuffle_from_str("TL_SHUFFLE_NONE"), TL_SHUFFLE_NONE);
+    ck_assert_int_eq(tl_shuffle_from_str("TL_SHUFFLE_BYTE"), TL_SHUFFLE_BYTE);
+    ck_assert_int_eq(tl_shuffle_from_str("TL_SHUFFLE_BIT"), TL_SHUFFLE_BIT);
+    ck_assert_int_eq(tl_shuffle_from_str("sdf"), -1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_cpu_level_name)
+{
+    ck_assert_str_eq(tl_cpu_level_name(TL_CPU_GENERIC), "TL_CPU_GENERIC");
+    ck_assert_str_eq(tl_cpu_level_name(TL_CPU_SSE2), "TL_CPU_SSE2");
+    ck_assert_str_eq(tl_cpu_level_name(TL_CPU_AVX2), "TL_CPU_AVX2");
+    ck_assert_str_eq(tl_cpu_level_name(TL_CPU_AVX512), "TL_CPU_AVX512");
+    ck_assert_str_eq(tl_cpu_level_name(TL_CPU_NEON), "TL_CPU_NEON");
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_cpu_level_from_str)
+{
+    ck_assert_int_eq(tl_cpu_level_from_str("TL_CPU_GENERIC"), TL_CPU_GENERIC);
+    ck_assert_int_eq(tl_cpu_level_from_str("TL_CPU_SSE2"), TL_CPU_SSE2);
+    ck_assert_int_eq(tl_cpu_level_from_str("TL_CPU_AVX2"), TL_CPU_AVX2);
+    ck_assert_int_eq(tl_cpu_level_from_str("TL_CPU_AVX512"), TL_CPU_AVX512);
+    ck_assert_int_eq(tl_cpu_level_from_str("TL_CPU_NEON"), TL_CPU_NEON);
+    ck_assert_int_eq(tl_cpu_level_from_str("sdf"), -1);
+}
+LN_TEST_END
+
+LN_TEST_START(test_tl_set_cpu_level)
+{
+    tl_cpu_level level;
+
+    ck_assert(tl_cpu_level_supported(TL_CPU_GENERIC));
+    level = tl_get_cpu_level();
+    ck_assert(tl_cpu_level_supported(level));
+    tl_set_cpu_level(TL_CPU_GENERIC);
+    ck_assert_int_eq(tl_get_cpu_level(), TL_CPU_GENERIC);
+    tl_set_cpu_level(level);
+    ck_assert_int_eq(tl_get_cpu_level(), level);
+}
+LN_TEST_END
+LN_TEST_START(test_tl_half)
+{
+    float f, fs[1031], fd[1031];
+    tl_float16_t h[1031], hd[1031], hg[1031];
+    tl_bfloat16_t b[1031], bg[1031];
+    tl_cpu_level level;
+    uint32_t bits;
+    int i;
+
+    ck_assert_int_eq(tl_float_to_float16(1.0f), 0x3C00);
+    ck_assert_int_eq(tl_float_to_float16(-2.0f), 0xC000);
+    ck_assert_int_eq(tl_float_to_float16(65504.0f), 0x7BFF);
+    ck_assert_int_eq(tl_float_to_float16(1e6f), 0x7BFF);
+    ck_assert_int_eq(tl_float_to_float16(-INFINITY), 0xFBFF);
+    ck_assert_int_eq(tl_float_to_float16(5.9604644775390625e-8f), 0x0001);
+    ck_assert_int_eq(tl_float_to_float16(2.0e-8f), 0x0000);
+    /* 1 + 2^-11 is a tie between 0x3C00 and 0x3C01 */
+    ck_assert_int_eq(tl_float_to_float16(1.00048828125f), 0x3C00);
+    ck_assert_int_eq(tl_float_to_float16(1.00146484375f), 0x3C02);
+    ck_assert(isnan(tl_float16_to_float(tl_float_to_float16(NAN))));
+    ck_assert(tl_float16_to_float(0x3555) == 0.333251953125f);
+    ck_assert(tl_float16_to_float(0x0001) == 5.9604644775390625e-8f);
+    ck_assert(tl_float16_to_float(0x8000) == 0 && signbit(tl_float16_to_float(0x8000)));
+
+    ck_assert_int_eq(tl_float_to_bfloat16(1.0f), 0x3F80);
+    ck_assert_int_eq(tl_float_to_bfloat16(3.14159265f), 0x4049);
+    ck_assert_int_eq(tl_float_to_bfloat16(FLT_MAX), 0x7F7F);
+    ck_assert_int_eq(tl_float_to_bfloat16(-INFINITY), 0xFF7F);
+    ck_assert(isnan(tl_bfloat16_to_float(tl_float_to_bfloat16(NAN))));
+    ck_assert(tl_bfloat16_to_float(0x4049) == 3.140625f);
+
+    /* every instruction set level converts bit-identically */
+    bits = 1;
+    for (i = 0; i < 1031; i++) {
+        bits = bits * 1664525u + 1013904223u;
+        memcpy(&fs[i], &bits, sizeof(float));
+    }
+    level = tl_get_cpu_level();
+    tl_set_cpu_level(TL_CPU_GENERIC);
+    tl_convert_n(hg, TL_FLOAT16, fs, TL_FLOAT, 1031);
+    tl_convert_n(bg, TL_BFLOAT16, fs, TL_FLOAT, 1031);
+    tl_set_cpu_level(level);
+    tl_convert_n(h, TL_FLOAT16, fs, TL_FLOAT, 1031);
+    tl_convert_n(b, TL_BFLOAT16, fs, TL_FLOAT, 1031);
+    ck_assert(!memcmp(h, hg, sizeof(h)));
+    ck_assert(!memcmp(b, bg, sizeof(b)));
+    for (i = 0; i < 1031; i++) {
+        ck_assert_int_eq(h[i], tl_float_to_float16(fs[i]));
+        ck_assert_int_eq(b[i], tl_float_to_bfloat16(fs[i]));
+    }
+
+    /* arithmetic is done in float and rounded once per element */
+    for (i = 0; i < 1031; i++) {
+        fs[i] = (i - 515) * 0.125f;
+        h[i] = tl_float_to_float16(fs[i]);
+    }
+    tl_elew_n(h, h, hd, 1031, TL_MUL, TL_FLOAT16);
+    tl_convert_n(fd, TL_FLOAT, hd, TL_FLOAT16, 1031);
+    for (i = 0; i < 1031; i++) {
+        f = tl_float16_to_float(tl_float_to_float16(fs[i] * fs[i]));
+        ck_assert(fd[i] == f);
+    }
+    tl_lrelu_n(hd, h, 0.5f, 1031, TL_FLOAT16);
+    for (i = 0; i < 1031; i++)
+        ck_assert_int_eq(hd[i], tl_float_to_float16(fs[i] < 0 ? fs[i] * 0.5f : fs[i]));
+}
+LN_TEST_END
 /* end of tests */
 
 LN_TEST_TCASE_START(type, checked_setup, checked_teardown)
@@ -1679,6 +1874,18 @@ LN_TEST_TCASE_START(type, checked_setup, checked_teardown)
     LN_TEST_ADD_TEST(test_tl_convert);
     LN_TEST_ADD_TEST(test_tl_sort_dir_name);
     LN_TEST_ADD_TEST(test_tl_sort_dir_from_str);
+    LN_TEST_ADD_TEST(test_tl_norm_type_name);
+    LN_TEST_ADD_TEST(test_tl_norm_type_from_str);
+    LN_TEST_ADD_TEST(test_tl_layout_name);
+    LN_TEST_ADD_TEST(test_tl_layout_from_str);
+    LN_TEST_ADD_TEST(test_tl_pad_mode_name);
+    LN_TEST_ADD_TEST(test_tl_pad_mode_from_str);
+    LN_TEST_ADD_TEST(test_tl_shuffle_name);
+    LN_TEST_ADD_TEST(test_tl_shuffle_from_str);
+    LN_TEST_ADD_TEST(test_tl_cpu_level_name);
+    LN_TEST_ADD_TEST(test_tl_cpu_level_from_str);
+    LN_TEST_ADD_TEST(test_tl_set_cpu_level);
+    LN_TEST_ADD_TEST(test_tl_half);
 }
 LN_TEST_TCASE_END
 
@@ -20,6 +20,8 @@
  * SOFTWARE.
  */
 
+#include <math.h>
+
 #include "test_tensorlight.h"
 #include "lightnettest/ln_test.h"
 #include "tl_check.h"
@@ -94,6 +96,25 @@ LN_TEST_START(test_tl_read_floats)
     ck_assert_array_float_eq_tol(data, data_true, 3, 0);
 }
 LN_TEST_END
+
+LN_TEST_START(test_tl_read_floats_formats)
+{
+    const char *file_name = "__test_read_floats_tmp";
+    float data[9];
+    float data_true[9] = {-1, 0.5, 1e-3, 12345.678, 3.4028234e38, -0.0, 7, 1.5e-40, 2};
+    FILE *fp;
+
+    fp = fopen(file_name, "w");
+    ck_assert_ptr_ne(fp, NULL);
+    fputs("-1,.5 1E-3\n12345.678 [340282340000000000000000000000000000000]\n"
+          "-0.0e0;7. 1.5e-40 +2 8", fp);
+    fclose(fp);
+    ck_assert_int_eq(tl_read_floats(file_name, 9, data), 9);
+    ck_assert_array_float_eq_tol(data, data_true, 9, 0);
+    ck_assert(signbit(data[5]));
+    ck_assert_int_eq(remove(file_name), 0);
+}
+LN_TEST_END
 /* end of tests */
 
 LN_TEST_TCASE_START(util, checked_setup, checked_teardown)
@@ -103,6 +124,7 @@ LN_TEST_TCASE_START(util, checked_setup, checked_teardown)
     LN_TEST_ADD_TEST(test_tl_clone);
     LN_TEST_ADD_TEST(test_tl_repeat);
     LN_TEST_ADD_TEST(test_tl_read_floats);
+    LN_TEST_ADD_TEST(test_tl_read_floats_formats);
 
 }
 LN_TEST_TCASE_END
@@ -44,7 +44,7 @@ else
   CXXFLAGS += -std=c++11 -Wall
   
   INCPATHS += -I/usr/local/include
-  LDFLAGS += -L/usr/local/lib -lm
+  LDFLAGS += -L/usr/local/lib -lm -lpthread
   # cannot use ifeq/ifneq because they expand immediately
   INCPATHS += $(if $(REQUIRES),`pkg-config --cflags '$(REQUIRES)'`)
   LDFLAGS += $(if $(REQUIRES),`pkg-config --libs '$(REQUIRES)'`)
@@ -63,6 +63,11 @@ CXXFLAGS += -O2
 LDFLAGS += -O2
 endif
 
+ifeq ($(PROFILE), yes)
+CFLAGS += -D$(ABBR)_PROFILE
+CXXFLAGS += -D$(ABBR)_PROFILE
+endif
+
 SRC = $(filter-out %cuda.c %cuda.cc %cuda.cpp %cudnn.c %cudnn.cc %cudnn.cpp %tensorrt.c %tensorrt.cc %tensorrt.cpp %dpu.c %dpu.cc %dpu.cpp %.cu, $(SRC))
 
 OBJDIR = $(BUILD_DIR)/$(notdir $(CURDIR))